@@ -0,0 +1,189 @@
+module;
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <memory_resource>
+#include <numeric>
+#include <span>
+#include <utility>
+#include <vector>
+
+module alias_planner;
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1u) & ~(alignment - 1u);
+}
+
+AliasPlanner::AliasPlanner(std::pmr::memory_resource* resource)
+    : memory(resource),
+      requests(resource),
+      placements(resource),
+      requestSlots(resource),
+      slots(resource),
+      planned(resource)
+{
+}
+
+uint32_t AliasPlanner::add(const Request& request)
+{
+    assert(std::has_single_bit(request.alignment) && "Alignment must be a power of 2");
+    assert(request.firstUse <= request.lastUse && "Lifetime ends before it starts");
+    this->requests.push_back(request);
+    return static_cast<uint32_t>(this->requests.size() - 1u);
+}
+
+void AliasPlanner::plan()
+{
+    const uint32_t nRequests = static_cast<uint32_t>(this->requests.size());
+    this->placements.assign(nRequests, Placement{});
+    this->requestSlots.assign(nRequests, none);
+    this->slots.clear();
+    this->planned.clear();
+    this->plannerStats = {};
+    this->plannerStats.requests = nRequests;
+
+    // By group, then first use, larger requests first so smaller ones fill in around them
+    std::pmr::vector<uint32_t> sorted(nRequests, 0u, this->memory);
+    std::iota(sorted.begin(), sorted.end(), 0u);
+    std::sort(sorted.begin(), sorted.end(), [&](uint32_t a, uint32_t b) {
+        const Request& ra = this->requests[a];
+        const Request& rb = this->requests[b];
+        if (ra.group != rb.group) {
+            return ra.group < rb.group;
+        }
+        if (ra.firstUse != rb.firstUse) {
+            return ra.firstUse < rb.firstUse;
+        }
+        if (ra.size != rb.size) {
+            return ra.size > rb.size;
+        }
+        return a < b;
+    });
+
+    for (size_t begin = 0u; begin < sorted.size();) {
+        const uint32_t group = this->requests[sorted[begin]].group;
+        size_t end = begin;
+        while (end < sorted.size() && this->requests[sorted[end]].group == group) {
+            end++;
+        }
+        const std::span<const uint32_t> run(sorted.data() + begin, end - begin);
+        const size_t firstSlot = this->slots.size();
+
+        // Groups have a handful of live resources at a time, so the slots are scanned
+        for (const uint32_t r : run) {
+            const Request& request = this->requests[r];
+            const uint64_t size = alignUp(request.size, request.alignment);
+            this->plannerStats.requestedBytes += size;
+
+            uint32_t best = none;
+            for (size_t s = firstSlot; s < this->slots.size(); ++s) {
+                const Slot& slot = this->slots[s];
+                if (this->requests[slot.occupant].lastUse >= request.firstUse) {
+                    continue;
+                }
+                if (best == none) {
+                    best = static_cast<uint32_t>(s);
+                    continue;
+                }
+                const uint64_t bestSize = this->slots[best].size;
+                const bool fits = slot.size >= size;
+                const bool bestFits = bestSize >= size;
+                if ((fits && (!bestFits || slot.size < bestSize)) ||
+                    (!fits && !bestFits && slot.size > bestSize)) {
+                    best = static_cast<uint32_t>(s);
+                }
+            }
+
+            if (best == none) {
+                this->slots.push_back({ group, size, request.alignment, r, 0u });
+                best = static_cast<uint32_t>(this->slots.size() - 1u);
+            } else {
+                Slot& slot = this->slots[best];
+                this->placements[r].previous = slot.occupant;
+                this->plannerStats.aliased++;
+                slot.size = std::max(slot.size, size);
+                slot.alignment = std::max(slot.alignment, request.alignment);
+                slot.occupant = r;
+            }
+            this->requestSlots[r] = best;
+        }
+
+        // Most aligned slots first, so less is lost to padding between them
+        std::pmr::vector<uint32_t> layout(this->memory);
+        for (size_t s = firstSlot; s < this->slots.size(); ++s) {
+            layout.push_back(static_cast<uint32_t>(s));
+        }
+        std::stable_sort(layout.begin(), layout.end(), [&](uint32_t a, uint32_t b) {
+            return this->slots[a].alignment > this->slots[b].alignment;
+        });
+        Heap heap = { group, 0u, 1u };
+        for (const uint32_t s : layout) {
+            Slot& slot = this->slots[s];
+            slot.offset = alignUp(heap.size, slot.alignment);
+            heap.size = slot.offset + slot.size;
+            heap.alignment = std::max(heap.alignment, slot.alignment);
+        }
+        const uint32_t heapIndex = static_cast<uint32_t>(this->planned.size());
+        for (const uint32_t r : run) {
+            this->placements[r].heap = heapIndex;
+            this->placements[r].offset = this->slots[this->requestSlots[r]].offset;
+        }
+        this->planned.push_back(heap);
+        this->plannerStats.heapBytes += heap.size;
+        this->plannerStats.peakLiveBytes += this->peakLive(run);
+        begin = end;
+    }
+    this->plannerStats.slots = static_cast<uint32_t>(this->slots.size());
+}
+
+void AliasPlanner::clear()
+{
+    this->requests.clear();
+    this->placements.clear();
+    this->requestSlots.clear();
+    this->slots.clear();
+    this->planned.clear();
+    this->plannerStats = {};
+}
+
+std::span<const AliasPlanner::Heap> AliasPlanner::heaps() const
+{
+    return this->planned;
+}
+
+const AliasPlanner::Placement& AliasPlanner::placement(uint32_t request) const
+{
+    assert(request < this->placements.size() && "Request wasn't planned");
+    return this->placements[request];
+}
+
+AliasPlanner::Stats AliasPlanner::stats() const
+{
+    return this->plannerStats;
+}
+
+// Sweep over lifetime starts and ends, ends first where they meet since lifetimes are
+//  inclusive and one ending at position p is dead by p + 1
+uint64_t AliasPlanner::peakLive(std::span<const uint32_t> run) const
+{
+    std::pmr::vector<std::pair<uint64_t, int64_t>> events(this->memory);
+    events.reserve(run.size() * 2u);
+    for (const uint32_t r : run) {
+        const Request& request = this->requests[r];
+        const int64_t size = static_cast<int64_t>(alignUp(request.size, request.alignment));
+        events.push_back({ request.firstUse, size });
+        events.push_back({ uint64_t(request.lastUse) + 1u, -size });
+    }
+    std::sort(events.begin(), events.end());
+
+    int64_t live = 0;
+    int64_t peak = 0;
+    for (const auto& [position, delta] : events) {
+        live += delta;
+        peak = std::max(peak, live);
+    }
+    return static_cast<uint64_t>(peak);
+}
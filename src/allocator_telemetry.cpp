@@ -0,0 +1,177 @@
+module;
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <utility>
+
+module allocator_telemetry;
+
+// Threads take counter blocks in the order they first record anything, and are the only
+//  writer of their block. Threads beyond the last block share it.
+static uint32_t threadSlot()
+{
+    static std::atomic<uint32_t> nextSlot = 0u;
+    thread_local const uint32_t slot = std::min(
+        nextSlot.fetch_add(1u, std::memory_order_relaxed), AllocatorTelemetry::maxThreadSlots - 1u
+    );
+    return slot;
+}
+
+// A block with a single writer is bumped with a plain load and store, no locked instruction
+static void bump(std::atomic<uint64_t>& counter, uint64_t amount, bool shared)
+{
+    if (shared) {
+        counter.fetch_add(amount, std::memory_order_relaxed);
+    } else {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+}
+
+static std::string jsonString(const std::string& s)
+{
+    static constexpr char hex[] = "0123456789abcdef";
+    std::string out = "\"";
+    for (const char c : s) {
+        const auto u = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (u < 0x20u) {
+            // Control characters aren't allowed in JSON strings as they are
+            out += "\\u00";
+            out += hex[u >> 4u];
+            out += hex[u & 0xFu];
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+static std::string jsonSample(const AllocatorTelemetry::Sample& sample)
+{
+    return "{\"frame\":" + std::to_string(sample.frame) +
+        ",\"live\":" + std::to_string(sample.gauges.live) +
+        ",\"reserved\":" + std::to_string(sample.gauges.reserved) +
+        ",\"largestFreeBlock\":" + std::to_string(sample.gauges.largestFreeBlock) +
+        ",\"pages\":" + std::to_string(sample.gauges.pages) +
+        ",\"allocations\":" + std::to_string(sample.allocations) +
+        ",\"allocated\":" + std::to_string(sample.allocatedAmount) + "}";
+}
+
+double AllocatorTelemetry::Snapshot::fragmentation() const
+{
+    const Gauges& g = this->latest.gauges;
+    const uint64_t unused = g.reserved > g.live ? g.reserved - g.live : 0u;
+    return unused == 0u
+        ? 0.0
+        : 1.0 - static_cast<double>(std::min(g.largestFreeBlock, unused)) / unused;
+}
+
+AllocatorTelemetry::AllocatorTelemetry(std::string name, std::string unit)
+    : allocatorName(std::move(name)),
+      unit(std::move(unit)),
+      counters(std::make_unique<ThreadCounters[]>(maxThreadSlots))
+{
+}
+
+void AllocatorTelemetry::recordAllocation(uint64_t amount)
+{
+    const uint32_t slot = threadSlot();
+    const bool shared = slot == maxThreadSlots - 1u;
+    ThreadCounters& c = this->counters[slot];
+    const uint32_t bucket = std::min<uint32_t>(
+        static_cast<uint32_t>(std::bit_width(std::max<uint64_t>(amount, 1u) - 1u)),
+        histogramBuckets - 1u
+    );
+    bump(c.allocations, 1u, shared);
+    bump(c.allocatedAmount, amount, shared);
+    bump(c.histogram[bucket], 1u, shared);
+}
+
+void AllocatorTelemetry::sample(uint64_t frame, const Gauges& gauges)
+{
+    // Counters only grow, so totals read while other threads record are at worst a little
+    //  behind and get picked up by the next sample
+    Snapshot next;
+    for (uint32_t i = 0u; i < maxThreadSlots; ++i) {
+        const ThreadCounters& c = this->counters[i];
+        next.allocations += c.allocations.load(std::memory_order_relaxed);
+        next.allocatedAmount += c.allocatedAmount.load(std::memory_order_relaxed);
+        for (uint32_t b = 0u; b < histogramBuckets; ++b) {
+            next.histogram[b] += c.histogram[b].load(std::memory_order_relaxed);
+        }
+    }
+
+    std::scoped_lock lock(this->sampleMutex);
+    next.latest.frame = frame;
+    next.latest.gauges = gauges;
+    next.latest.allocations = next.allocations - this->current.allocations;
+    next.latest.allocatedAmount = next.allocatedAmount - this->current.allocatedAmount;
+    next.peakLive = std::max(this->current.peakLive, gauges.live);
+    this->current = next;
+
+    if (this->history.size() == historyLength) {
+        this->history.pop_front();
+    }
+    this->history.push_back(next.latest);
+}
+
+const std::string& AllocatorTelemetry::name() const
+{
+    return this->allocatorName;
+}
+
+AllocatorTelemetry::Snapshot AllocatorTelemetry::snapshot() const
+{
+    std::scoped_lock lock(this->sampleMutex);
+    return this->current;
+}
+
+std::string AllocatorTelemetry::json() const
+{
+    std::scoped_lock lock(this->sampleMutex);
+    const Snapshot& s = this->current;
+    std::string out = "{\"name\":" + jsonString(this->allocatorName) +
+        ",\"unit\":" + jsonString(this->unit) + ",\"latest\":" + jsonSample(s.latest) +
+        ",\"peakLive\":" + std::to_string(s.peakLive) +
+        ",\"allocations\":" + std::to_string(s.allocations) +
+        ",\"allocated\":" + std::to_string(s.allocatedAmount) +
+        ",\"fragmentation\":" + std::to_string(s.fragmentation());
+
+    // Only the buckets that were hit, keyed by their upper bound
+    out += ",\"histogram\":[";
+    bool first = true;
+    for (uint32_t b = 0u; b < histogramBuckets; ++b) {
+        if (s.histogram[b] == 0u) {
+            continue;
+        }
+        out += first ? "" : ",";
+        out += "{\"upTo\":" + std::to_string(uint64_t(1u) << b) +
+            ",\"count\":" + std::to_string(s.histogram[b]) + "}";
+        first = false;
+    }
+
+    out += "],\"history\":[";
+    for (size_t i = 0u; i < this->history.size(); ++i) {
+        out += (i == 0u ? "" : ",") + jsonSample(this->history[i]);
+    }
+    return out + "]}";
+}
+
+std::string allocatorTelemetryJson(std::span<const AllocatorTelemetry* const> allocators)
+{
+    std::string out = "[";
+    for (size_t i = 0u; i < allocators.size(); ++i) {
+        out += (i == 0u ? "" : ",") + allocators[i]->json();
+    }
+    return out + "]";
+}
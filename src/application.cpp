@@ -10,13 +10,23 @@ module;
 #include <dxgi1_6.h>
 #include <wrl.h>
 #include <algorithm>
+#include <atomic>
+#include <cassert>
 #include <chrono>
+#include <coroutine>
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <memory_resource>
 #include <gainput/gainput.h>
 #include <ScreenGrab.h>
 #include <wincodec.h>
 #include <tiny_obj_loader.h>
 #include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
 #include <spdlog/spdlog.h>
 #include "d3dx12.h"
 #include "resource.h"
@@ -45,7 +55,12 @@ static std::string GetResourceString(int resourceId)
     return std::string(static_cast<const char*>(data), size);
 }
 
-Application::Application() : inputMap(inputManager, "input_map")
+Application::Application(uint32_t recordThreads, uint32_t framesInFlight)
+    : framesInFlight(std::clamp(framesInFlight, 1u, maxFramesInFlight)),
+      recordThreads(std::clamp(recordThreads, 1u, maxRecordThreads)),
+      recordPool(this->recordThreads),
+      frameArena(this->recordThreads),
+      inputMap(inputManager, "input_map")
 {
     spdlog::info("Application constructor start");
     Window::get()->registerApp(this);
@@ -60,7 +75,29 @@ Application::Application() : inputMap(inputManager, "input_map")
     );
 
     spdlog::info("Creating CommandQueue");
-    this->cmdQueue = CommandQueue(device, D3D12_COMMAND_LIST_TYPE_DIRECT);
+    // One allocator ring entry per frame in flight, plus one spare. Frames are recorded from a
+    //  render graph that knows every list's barriers up front, so no state fixup lists are
+    //  recorded at submit and need entries of their own.
+    this->cmdQueue = CommandQueue(
+        device, D3D12_COMMAND_LIST_TYPE_DIRECT, this->recordThreads, this->framesInFlight + 1u
+    );
+    this->frameIdleEvent = ::CreateEvent(nullptr, TRUE, TRUE, nullptr);
+    assert(this->frameIdleEvent && "Failed to create frame idle event handle.");
+    spdlog::info(
+        "Recording with {} thread(s), {} frame(s) in flight", this->recordThreads,
+        this->framesInFlight
+    );
+
+    spdlog::info("Creating GpuHeapAllocator");
+    this->gpuMemory = std::make_unique<GpuHeapAllocator>(device);
+    this->renderTargets = std::make_unique<RenderTargetPool>(device);
+    // Anything used by a frame still in flight stays resident
+    this->residency =
+        std::make_unique<ResidencyManager>(device, this->adapter, this->framesInFlight + 1u);
+
+    spdlog::info("Creating UploadService");
+    this->uploads =
+        std::make_unique<UploadService>(device, *this->gpuMemory, this->releaseQueue);
 
     spdlog::info("Creating SwapChain");
     this->swapChain = this->createSwapChain();
@@ -71,6 +108,17 @@ Application::Application() : inputMap(inputManager, "input_map")
     this->rtvHeap = this->createDescHeap(D3D12_DESCRIPTOR_HEAP_TYPE_RTV, this->nBuffers);
     this->rtvDescSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
 
+    spdlog::info("Creating frame contexts");
+    this->frameDescHeap = this->createDescHeap(
+        D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, this->framesInFlight * descriptorsPerFrame,
+        D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE
+    );
+    this->frames = FrameRing(
+        this->framesInFlight, this->frameDescHeap, descriptorsPerFrame,
+        device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV),
+        this->recordThreads
+    );
+
     spdlog::info("updateRenderTargetViews");
     this->updateRenderTargetViews(this->rtvHeap);
 
@@ -97,27 +145,167 @@ Application::Application() : inputMap(inputManager, "input_map")
     this->inputMap.MapFloat(Button::AxisDeltaY, this->mouseID, gainput::MouseAxisY);
     this->inputMap.MapBool(Button::ScrollUp, this->mouseID, gainput::MouseButtonWheelUp);
     this->inputMap.MapBool(Button::ScrollDown, this->mouseID, gainput::MouseButtonWheelDown);
+    this->inputMap.MapBool(Button::DumpTelemetry, this->keyboardID, gainput::KeyF2);
 
     this->loadContent();
     this->flush();
     this->isInitialized = true;
 }
 
-Application::~Application()
+// One line per call site that waited on the queue's fence
+static void logWaitStats(const char* queueName, const CommandQueue& queue)
 {
-    this->flush();
+    queue.waitStats().forEach([&](const WaitSites::Site& site, const WaitHistogram::Snapshot& w) {
+        const std::string_view file(site.file);
+        const size_t nameStart = file.find_last_of("/\\") + 1u;
+        spdlog::info(
+            "{} fence waits at {}:{}: {} waits, p50 {:.0f}us, p99 {:.0f}us, max {:.2f}us, "
+            "{} spun, {} yielded, {} blocked, {} timed out",
+            queueName, file.substr(nameStart), site.line, w.count, w.percentileUs(0.5),
+            w.percentileUs(0.99), w.maxUs, w.inPhase(WaitPhase::Spin),
+            w.inPhase(WaitPhase::Yield), w.inPhase(WaitPhase::Block),
+            w.inPhase(WaitPhase::TimedOut)
+        );
+    });
 }
 
-void Application::transitionResource(
-    ComPtr<ID3D12GraphicsCommandList2> cmdList,
-    ComPtr<ID3D12Resource> resource,
-    D3D12_RESOURCE_STATES beforeState,
-    D3D12_RESOURCE_STATES afterState
-)
+Application::~Application()
 {
-    CD3DX12_RESOURCE_BARRIER barrier =
-        CD3DX12_RESOURCE_BARRIER::Transition(resource.Get(), beforeState, afterState);
-    cmdList->ResourceBarrier(1, &barrier);
+    this->flush();
+    this->scheduler.waitIdle();
+    ::CloseHandle(this->frameIdleEvent);
+
+    const CommandQueue::Stats stats = this->cmdQueue.stats();
+    spdlog::info(
+        "Command allocators: {} created, {} command lists created, {} stalls",
+        stats.allocatorCreations, stats.cmdListCreations, stats.stalls
+    );
+    spdlog::info(
+        "Submission: {} command lists in {} batches, {} stalls on a full ring",
+        stats.submissions, stats.batches, stats.submitStalls
+    );
+    const FrameRing::Stats& frameStats = this->frames.stats();
+    spdlog::info(
+        "Frames: {} rendered, {} blocked on fences for {:.2f}ms total ({:.2f}ms max)",
+        frameStats.frames, frameStats.blockedFrames, frameStats.blockedMs, frameStats.maxBlockedMs
+    );
+    // The scheduler is idle, so no upload can be touching the staging buffer
+    const RingAllocator::Stats& ringStats = this->uploads->stagingBuffer().ringStats();
+    spdlog::info(
+        "Upload staging ring: {} allocations, {} bytes peak in use, {} bytes lost to wrapping",
+        ringStats.allocations, ringStats.peakUsedBytes, ringStats.wastedBytes
+    );
+    const auto& largeStats = this->uploads->stagingBuffer().largePageStats();
+    spdlog::info(
+        "Large upload pages: {} created, {} reused, {} trimmed, {} bytes peak resident",
+        largeStats.pagesCreated, largeStats.pagesReused, largeStats.pagesTrimmed,
+        largeStats.peakResidentBytes
+    );
+    const ParallelUploadBuffer::Stats threadUploadStats = this->frames.threadUploads().stats();
+    spdlog::info(
+        "Thread upload pages: {} allocations, {} page acquires, {} pages created",
+        threadUploadStats.allocations, threadUploadStats.pageAcquires,
+        threadUploadStats.pagesCreated
+    );
+    const UploadService::Stats uploadStats = this->uploads->stats();
+    spdlog::info(
+        "Uploads: {} bytes in {} copies over {} batches, {:.2f}ms max latency",
+        uploadStats.bytesUploaded, uploadStats.copies, uploadStats.batches,
+        uploadStats.maxLatencyMs
+    );
+    // Both queues are idle after flushing, release whatever the last frames didn't drain
+    this->uploads->submit();
+    this->uploads->copyQueue.flush();
+    this->releaseQueue.clear();
+    const ResourceReleaseQueue::Stats releaseStats = this->releaseQueue.stats();
+    spdlog::info(
+        "Deferred releases: {} resources retired, {} bytes peak retained",
+        releaseStats.retained, releaseStats.peakRetainedBytes
+    );
+    const GpuHeapAllocator::Stats heapStats = this->gpuMemory->stats();
+    spdlog::info(
+        "GPU heaps: {} heaps, {} of {} bytes in {} placed resources, {} free blocks",
+        heapStats.heaps, heapStats.usedBytes, heapStats.heapBytes, heapStats.allocations,
+        heapStats.freeBlocks
+    );
+    const RenderTargetPool::Stats targetStats = this->renderTargets->stats();
+    spdlog::info(
+        "Render targets: {} created, {} reused, {} evicted, {:.1f}% internal fragmentation",
+        targetStats.created, targetStats.reused, targetStats.evicted,
+        targetStats.internalFragmentation() * 100.0
+    );
+    const ResourceTable::Stats resourceStats = this->resources.stats();
+    spdlog::info(
+        "Resources: {} registered ({} added, {} removed), {} bytes, {} in default heaps",
+        resourceStats.resources, resourceStats.added, resourceStats.removed,
+        resourceStats.totalBytes, resourceStats.defaultHeapBytes
+    );
+    const ResidencyManager::Set::Stats& residencyStats = this->residency->stats();
+    spdlog::info(
+        "Residency: {} bytes resident, {} evicted, {} eviction and {} make resident batches, "
+        "{} updates over budget",
+        residencyStats.residentBytes, residencyStats.evictedBytes, residencyStats.evictBatches,
+        residencyStats.makeResidentBatches, residencyStats.overBudgetUpdates
+    );
+    for (uint32_t i = 0u; i < static_cast<uint32_t>(ResidencyCategory::Count); ++i) {
+        const ResidencyCategory category = static_cast<ResidencyCategory>(i);
+        const ResidencyManager::Set::CategoryStats& c = this->residency->category(category);
+        spdlog::info(
+            "Residency of {}: {} bytes resident, {} evicted, {} evictions, {} made resident",
+            residencyCategoryName(category), c.residentBytes, c.evictedBytes, c.evictions,
+            c.madeResident
+        );
+    }
+    const LinearArena::Stats arenaStats = this->frameArena.stats();
+    spdlog::info(
+        "Frame arenas: {} allocations over {} frames, {} bytes peak, {} bytes in {} blocks created",
+        arenaStats.allocations, this->frameArena.frame().stats().resets, arenaStats.peakBytes,
+        arenaStats.capacity, arenaStats.blocksCreated
+    );
+    const DescriptorAllocator::Stats dsvStats = this->dsvAllocator->stats();
+    spdlog::info(
+        "DSV descriptors: {} allocations over {} pages, {} free in {} blocks, {:.2f} fragmented",
+        dsvStats.allocations, dsvStats.pages, dsvStats.freeDescriptors, dsvStats.freeBlocks,
+        dsvStats.fragmentation()
+    );
+    const AllocatorTelemetry* allocators[] = { &this->uploads->stagingTelemetry(),
+                                               &this->frames.threadUploads().telemetry(),
+                                               &this->dsvAllocator->telemetry() };
+    for (const AllocatorTelemetry* telemetry : allocators) {
+        const AllocatorTelemetry::Snapshot s = telemetry->snapshot();
+        spdlog::info(
+            "Telemetry of {}: {} allocations, {} peak live of {} reserved, {:.2f} fragmented",
+            telemetry->name(), s.allocations, s.peakLive, s.latest.gauges.reserved,
+            s.fragmentation()
+        );
+    }
+    DynamicDescriptorHeap::Stats tableStats;
+    for (const auto& heap : this->dynamicDescriptors) {
+        tableStats.commits += heap->stats().commits;
+        tableStats.tablesCommitted += heap->stats().tablesCommitted;
+        tableStats.descriptorsCopied += heap->stats().descriptorsCopied;
+        tableStats.sourceRanges += heap->stats().sourceRanges;
+    }
+    spdlog::info(
+        "Descriptor tables: {} in {} commits, {} descriptors copied from {} source ranges",
+        tableStats.tablesCommitted, tableStats.commits, tableStats.descriptorsCopied,
+        tableStats.sourceRanges
+    );
+    spdlog::info(
+        "Render graphs: {} passes ({} culled), {} barriers, {} command lists",
+        this->graphStats.passes, this->graphStats.culledPasses, this->graphStats.barriers,
+        this->graphStats.lists
+    );
+    if (this->pipelines) {
+        const PipelineCache::Stats s = this->pipelines->stats();
+        spdlog::info(
+            "Pipeline cache: {} hits ({:.2f}ms), {} misses ({:.2f}ms), {} reused, {} bytes loaded, "
+            "{} bytes saved",
+            s.hits, s.loadMs, s.misses, s.createMs, s.reused, s.loadedBytes, s.savedBytes
+        );
+    }
+    logWaitStats("Direct", this->cmdQueue);
+    logWaitStats("Copy", this->uploads->copyQueue);
 }
 
 void Application::clearRTV(
@@ -138,46 +326,6 @@ void Application::clearDepth(
     cmdList->ClearDepthStencilView(dsv, D3D12_CLEAR_FLAG_DEPTH, depth, 0, 0, nullptr);
 }
 
-void Application::updateBufferResource(
-    ComPtr<ID3D12GraphicsCommandList2> cmdList,
-    ID3D12Resource** pDestinationResource,
-    ID3D12Resource** pIntermediateResource,
-    size_t numElements,
-    size_t elementSize,
-    const void* bufferData,
-    D3D12_RESOURCE_FLAGS flags
-)
-{
-    const size_t bufSize = numElements * elementSize;
-    {  // Create a committed resource for the GPU resource in a default heap
-        const CD3DX12_HEAP_PROPERTIES pHeapProperties(D3D12_HEAP_TYPE_DEFAULT);
-        const CD3DX12_RESOURCE_DESC pDesc = CD3DX12_RESOURCE_DESC::Buffer(bufSize, flags);
-        chkDX(device->CreateCommittedResource(
-            &pHeapProperties, D3D12_HEAP_FLAG_NONE, &pDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
-            IID_PPV_ARGS(pDestinationResource)
-        ));
-    }
-
-    if (bufferData) {
-        // Create a committed resource for the upload
-        const CD3DX12_HEAP_PROPERTIES pHeapProperties(D3D12_HEAP_TYPE_UPLOAD);
-        const CD3DX12_RESOURCE_DESC pDesc = CD3DX12_RESOURCE_DESC::Buffer(bufSize);
-        chkDX(device->CreateCommittedResource(
-            &pHeapProperties, D3D12_HEAP_FLAG_NONE, &pDesc, D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr, IID_PPV_ARGS(pIntermediateResource)
-        ));
-
-        D3D12_SUBRESOURCE_DATA subresourceData = {};
-        subresourceData.pData = bufferData;
-        subresourceData.RowPitch = bufSize;
-        subresourceData.SlicePitch = subresourceData.RowPitch;
-
-        ::UpdateSubresources(
-            cmdList.Get(), *pDestinationResource, *pIntermediateResource, 0, 0, 1, &subresourceData
-        );
-    }
-}
-
 void Application::resizeDepthBuffer(uint32_t width, uint32_t height)
 {
     assert(this->contentLoaded);
@@ -189,14 +337,18 @@ void Application::resizeDepthBuffer(uint32_t width, uint32_t height)
     D3D12_CLEAR_VALUE optimizedClearValue = {};
     optimizedClearValue.Format = DXGI_FORMAT_D32_FLOAT;
     optimizedClearValue.DepthStencil = { 1.0f, 0 };
-    const CD3DX12_HEAP_PROPERTIES pHeapProperties(D3D12_HEAP_TYPE_DEFAULT);
     const CD3DX12_RESOURCE_DESC pDesc = CD3DX12_RESOURCE_DESC::Tex2D(
         DXGI_FORMAT_D32_FLOAT, width, height, 1, 0, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL
     );
-    chkDX(device->CreateCommittedResource(
-        &pHeapProperties, D3D12_HEAP_FLAG_NONE, &pDesc, D3D12_RESOURCE_STATE_DEPTH_WRITE,
-        &optimizedClearValue, IID_PPV_ARGS(&this->depthBuffer)
-    ));
+    // The old buffer stays cached for a few frames in case the window goes back to its size
+    if (this->depthBuffer) {
+        this->renderTargets->release(this->resources.get(this->depthBuffer), 0u);
+        this->resources.remove(this->depthBuffer);
+    }
+    this->depthBuffer = this->resources.add(
+        this->renderTargets->acquire(pDesc, D3D12_RESOURCE_STATE_DEPTH_WRITE, &optimizedClearValue),
+        D3D12_RESOURCE_STATE_DEPTH_WRITE, "depth buffer"
+    );
 
     // Update depth-stencil view
     D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
@@ -205,7 +357,7 @@ void Application::resizeDepthBuffer(uint32_t width, uint32_t height)
     dsvDesc.Texture2D.MipSlice = 0;
     dsvDesc.Flags = D3D12_DSV_FLAG_NONE;
     device->CreateDepthStencilView(
-        this->depthBuffer.Get(), &dsvDesc, this->dsvHeap->GetCPUDescriptorHandleForHeapStart()
+        this->resources.get(this->depthBuffer), &dsvDesc, this->dsv.getDescHandle()
     );
 }
 
@@ -249,14 +401,18 @@ ComPtr<IDXGISwapChain4> Application::createSwapChain()
     return dxgiSwapChain4;
 }
 
-ComPtr<ID3D12DescriptorHeap>
-Application::createDescHeap(D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t numDescriptors)
+ComPtr<ID3D12DescriptorHeap> Application::createDescHeap(
+    D3D12_DESCRIPTOR_HEAP_TYPE type,
+    uint32_t numDescriptors,
+    D3D12_DESCRIPTOR_HEAP_FLAGS flags
+)
 {
     ComPtr<ID3D12DescriptorHeap> descriptorHeap;
 
     D3D12_DESCRIPTOR_HEAP_DESC desc = {};
     desc.NumDescriptors = numDescriptors;
     desc.Type = type;
+    desc.Flags = flags;
 
     chkDX(this->device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&descriptorHeap)));
 
@@ -276,7 +432,9 @@ void Application::updateRenderTargetViews(ComPtr<ID3D12DescriptorHeap> descripto
 
         this->device->CreateRenderTargetView(backBuffer.Get(), nullptr, rtvHandle);
 
-        this->backBuffers[i] = backBuffer;
+        this->backBuffers[i] = this->resources.add(
+            backBuffer, D3D12_RESOURCE_STATE_PRESENT, "back buffer " + std::to_string(i)
+        );
 
         rtvHandle.Offset(rtvDescriptorSize);
     }
@@ -321,84 +479,213 @@ void Application::update()
     if (this->inputMap.GetBoolWasDown(Button::ScrollDown)) {
         this->cam.radius *= 0.8f;
     }
+    if (this->inputMap.GetBoolWasDown(Button::DumpTelemetry)) {
+        this->dumpAllocatorTelemetry("allocator_telemetry.json");
+    }
 }
 
-void Application::render()
+// Record state setup and a draw of the given slice of the scene's index buffer
+void Application::recordScene(
+    ComPtr<ID3D12GraphicsCommandList2> cmdList,
+    DynamicDescriptorHeap& descriptors,
+    D3D12_CPU_DESCRIPTOR_HANDLE rtv,
+    D3D12_CPU_DESCRIPTOR_HANDLE dsv,
+    D3D12_GPU_VIRTUAL_ADDRESS sceneCB,
+    IndexRange indices
+)
 {
-    auto backBuffer = this->backBuffers[this->curBackBufIdx];
-    auto cmdList = this->cmdQueue.getCmdList();
+    // Set pipeline state and root signature
+    cmdList->SetPipelineState(this->pipelineState.Get());
+    cmdList->SetGraphicsRootSignature(this->rootSignature.Get());
+
+    // Descriptor tables are copied into this frame's part of the shader-visible heap
+    ID3D12DescriptorHeap* descHeaps[] = { this->frameDescHeap.Get() };
+    cmdList->SetDescriptorHeaps(_countof(descHeaps), descHeaps);
+    descriptors.reset();
+
+    // Setup input assembler, rasterizer state
+    cmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    cmdList->IASetVertexBuffers(0, 1, &this->vertexBufferView);
+    cmdList->IASetIndexBuffer(&this->indexBufferView);
+    cmdList->RSSetViewports(1, &this->viewport);
+    cmdList->RSSetScissorRects(1, &this->scissorRect);
+
+    // Bind the render targets
+    cmdList->OMSetRenderTargets(1, &rtv, true, &dsv);
+
+    // Bind this frame's scene constants
+    cmdList->SetGraphicsRootConstantBufferView(0, sceneCB);
+
+    // Draw
+    descriptors.commitForDraw(cmdList.Get(), this->frames.current().descriptors);
+    cmdList->DrawIndexedInstanced(indices.count, 1, indices.first, 0, 0);
+}
 
-    {
-        // Transition backbuffer to render target state, then clear
-        this->transitionResource(
-            cmdList, backBuffer, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET
-        );
-        FLOAT clearColor[] = { 0.4f, 0.6f, 0.9f, 1.0f };
-        CD3DX12_CPU_DESCRIPTOR_HANDLE rtv(
-            this->rtvHeap->GetCPUDescriptorHandleForHeapStart(), this->curBackBufIdx,
-            this->rtvDescSize
-        );
-        this->clearRTV(cmdList, rtv, clearColor);
-        auto dsv = this->dsvHeap->GetCPUDescriptorHandleForHeapStart();
-        this->clearDepth(cmdList, dsv);
+// Snapshot of everything the frame needs from update(), taken on the main thread
+SceneConstantBuffer Application::sceneConstants() const
+{
+    SceneConstantBuffer scb = {};
+    scb.model = this->matModel;
+    scb.viewProj = this->cam.view() * this->cam.proj();
 
-        // Set pipeline state and root signature
-        cmdList->SetPipelineState(this->pipelineState.Get());
-        cmdList->SetGraphicsRootSignature(this->rootSignature.Get());
+    float camX = this->cam.radius * cos(this->cam.pitch) * cos(this->cam.yaw);
+    float camY = this->cam.radius * sin(this->cam.pitch);
+    float camZ = this->cam.radius * cos(this->cam.pitch) * sin(this->cam.yaw);
+    scb.cameraPos = XMFLOAT4(camX, camY, camZ, 1.0f);
 
-        // Setup input assembler, rasterizer state
-        cmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        cmdList->IASetVertexBuffers(0, 1, &this->vertexBufferView);
-        cmdList->IASetIndexBuffer(&this->indexBufferView);
-        cmdList->RSSetViewports(1, &this->viewport);
-        cmdList->RSSetScissorRects(1, &this->scissorRect);
+    scb.lightPos = XMFLOAT4(10.0f, 15.0f, -10.0f, 1.0f);
+    scb.lightColor = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+    scb.ambientColor = XMFLOAT4(0.1f, 0.1f, 0.1f, 1.0f);
 
-        // Bind the render targets
-        cmdList->OMSetRenderTargets(1, &rtv, true, &dsv);
+    return scb;
+}
 
-        // Update root params: MVP matrix into constant buffer for vert shader
-        SceneConstantBuffer scb = {};
-        scb.model = this->matModel;
-        scb.viewProj = this->cam.view() * this->cam.proj();
+void Application::render()
+{
+    // Previous frame is still being recorded or waiting on its frame context
+    if (this->frameBusy.load()) {
+        return;
+    }
 
-        float camX = this->cam.radius * cos(this->cam.pitch) * cos(this->cam.yaw);
-        float camY = this->cam.radius * sin(this->cam.pitch);
-        float camZ = this->cam.radius * cos(this->cam.pitch) * sin(this->cam.yaw);
-        scb.cameraPos = XMFLOAT4(camX, camY, camZ, 1.0f);
+    ::ResetEvent(this->frameIdleEvent);
+    this->frameBusy.store(true);
+    this->scheduler.spawn(this->renderFrame(this->sceneConstants()));
+}
 
-        scb.lightPos = XMFLOAT4(10.0f, 15.0f, -10.0f, 1.0f);
-        scb.lightColor = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-        scb.ambientColor = XMFLOAT4(0.1f, 0.1f, 0.1f, 1.0f);
+Task Application::renderFrame(SceneConstantBuffer scb)
+{
+    // Hand control back to the main thread however this frame ends. The event is set before
+    //  clearing frameBusy so render() never resets it after this point.
+    struct FrameDone
+    {
+        Application* app;
+        ~FrameDone()
+        {
+            // Runs after the frame's locals are gone, so nothing points into the arena
+            this->app->frameArena.reset();
+            ::SetEvent(this->app->frameIdleEvent);
+            this->app->frameBusy.store(false);
+        }
+    } frameDone{ this };
+
+    // Suspend rather than block until the GPU retires the frame context we're about to reuse
+    const uint64_t pendingFence = this->frames.pendingFence();
+    if (!this->cmdQueue.isFenceComplete(pendingFence)) {
+        const auto t0 = std::chrono::high_resolution_clock::now();
+        co_await this->cmdQueue.fenceReached(pendingFence, this->scheduler);
+        const std::chrono::duration<double, std::milli> waited =
+            std::chrono::high_resolution_clock::now() - t0;
+        this->frames.addWaitTime(waited.count());
+    }
+    this->frames.begin(this->cmdQueue);
+    // Descriptors freed by frames the GPU has finished with can be handed out again
+    const uint64_t frameNumber = this->frames.frameNumber();
+    this->dsvAllocator->setFrame(frameNumber);
+    if (frameNumber >= this->frames.size()) {
+        this->dsvAllocator->releaseStaleDescriptors(frameNumber - this->frames.size());
+    }
+    this->renderTargets->endFrame(this->cmdQueue.completedValue());
+    // What the allocators hold once the finished frames have been retired
+    this->uploads->sampleTelemetry(frameNumber);
+    this->frames.threadUploads().sampleTelemetry(frameNumber);
+    this->dsvAllocator->sampleTelemetry(frameNumber);
+    this->uploads->retire();
+    this->releaseQueue.drain([](const CommandQueue* queue) { return queue->completedValue(); });
+
+    ID3D12Resource* backBuffer = this->resources.get(this->backBuffers[this->curBackBufIdx]);
+    ID3D12Resource* depthBuffer = this->resources.get(this->depthBuffer);
+
+    CD3DX12_CPU_DESCRIPTOR_HANDLE rtv(
+        this->rtvHeap->GetCPUDescriptorHandleForHeapStart(), this->curBackBufIdx, this->rtvDescSize
+    );
+    auto dsv = this->dsv.getDescHandle();
 
-        cmdList->SetGraphicsRoot32BitConstants(0, sizeof(SceneConstantBuffer) / 4, &scb, 0);
+    // The mesh streams in on the scheduler, until then frames only clear
+    const bool meshReady = this->meshLoaded.load(std::memory_order_acquire);
+    if (meshReady) {
+        for (const ResidencyManager::Handle handle : this->meshResidency) {
+            this->residency->markUsed(handle);
+        }
+    }
 
-        // Draw
-        cmdList->DrawIndexedInstanced(this->numIndices, 1, 0, 0, 0);
+    // The frame as a render graph: a clear, then the draw split into whole-triangle slices, one
+    //  part per recording thread. The clear shares the first slice's list, and the barriers
+    //  come from the states the passes declare.
+    std::pmr::memory_resource* arena = &this->frameArena.frame();
+    std::pmr::vector<IndexRange> slices =
+        splitRange(meshReady ? this->numIndices : 0u, this->recordThreads, 3u, arena);
+    std::pmr::vector<ComPtr<ID3D12GraphicsCommandList2>> cmdLists(arena);
+
+    ResourceStates& states = this->resources.states();
+    RenderGraph graph(arena);
+    RenderGraph::ResourceId target = graph.importResource("back buffer", backBuffer, states);
+    RenderGraph::ResourceId depth = graph.importResource("depth buffer", depthBuffer, states);
+
+    RenderGraph::PassBuilder clear =
+        graph.addPass("clear", [&](const RenderGraph::Context& context) {
+            FLOAT clearColor[] = { 0.4f, 0.6f, 0.9f, 1.0f };
+            this->clearRTV(cmdLists[context.list], rtv, clearColor);
+            this->clearDepth(cmdLists[context.list], dsv);
+        });
+    target = clear.write(target, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    depth = clear.write(depth, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+    if (!slices.empty()) {
+        RenderGraph::PassBuilder scene =
+            graph.addPass("scene", [&](const RenderGraph::Context& context) {
+                // Each slice writes its constants into its own thread's upload pages
+                UploadBuffer::Allocation sceneCB = this->frames.threadUploads().allocate(
+                    context.list, sizeof(SceneConstantBuffer),
+                    D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT
+                );
+                std::memcpy(sceneCB.cpu, &scb, sizeof(SceneConstantBuffer));
+                this->recordScene(
+                    cmdLists[context.list], *this->dynamicDescriptors[context.list], rtv, dsv,
+                    sceneCB.gpu, slices[context.part]
+                );
+            });
+        scene.parts(static_cast<uint32_t>(slices.size()));
+        target = scene.write(target, D3D12_RESOURCE_STATE_RENDER_TARGET);
+        depth = scene.write(depth, D3D12_RESOURCE_STATE_DEPTH_WRITE);
     }
+    graph.exportResource(target, D3D12_RESOURCE_STATE_PRESENT);
+    graph.compile();
+    this->graphStats.passes += graph.stats().passes;
+    this->graphStats.culledPasses += graph.stats().culledPasses;
+    this->graphStats.barriers += graph.stats().barriers;
+    this->graphStats.lists += graph.stats().lists;
+
+    // Every list's barriers are known, so they're recorded in parallel, list i on thread slot i
+    assert(graph.listCount() <= this->recordThreads && "More lists than recording threads");
+    cmdLists.resize(graph.listCount());
+    this->recordPool.parallelFor(graph.listCount(), [&](uint32_t i) {
+        cmdLists[i] = this->cmdQueue.getCmdList(i);
+        graph.recordList(i, cmdLists[i].Get());
+    });
 
     // Present
     {
-        // Transition backbuffer to present state
-        this->transitionResource(
-            cmdList, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT
-        );
+        // Page back in anything this frame uses that was evicted, and page out what's been idle
+        //  if over budget, before the GPU can see the command lists
+        this->residency->update();
 
-        // Execute command list and present, then wait for completion
-        this->frameFenceValues[this->curBackBufIdx] = this->cmdQueue.execCmdList(cmdList);
+        // Execute command lists in graph order and present. The next frame only waits if its
+        //  frame context is still in use on the GPU.
+        const uint64_t fenceValue = this->cmdQueue.execCmdLists(cmdLists);
+        graph.commitStates(states);
 
         UINT syncInterval = this->vsync ? 1 : 0;
         UINT presentFlags = this->tearingSupported && !this->vsync ? DXGI_PRESENT_ALLOW_TEARING : 0;
         chkDX(this->swapChain->Present(syncInterval, presentFlags));
         this->curBackBufIdx = this->swapChain->GetCurrentBackBufferIndex();
+        this->frames.end(fenceValue);
 
-        this->cmdQueue.waitForFenceVal(this->frameFenceValues[this->curBackBufIdx]);
-
-        if (this->testMode) {
+        if (this->testMode && meshReady) {
             this->frameCount++;
             if (this->frameCount == 10) {
                 spdlog::info("Saving screenshot and exiting...");
                 HRESULT hr = DirectX::SaveWICTextureToFile(
-                    this->cmdQueue.queue.Get(), backBuffer.Get(), GUID_ContainerFormatPng,
+                    this->cmdQueue.queue.Get(), backBuffer, GUID_ContainerFormatPng,
                     L"screenshot.png", D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_PRESENT
                 );
                 if (FAILED(hr)) {
@@ -460,18 +747,120 @@ void Application::setFullscreen(bool val)
 
 void Application::flush()
 {
+    // Let a frame that's still recording on the scheduler submit first
+    ::WaitForSingleObject(this->frameIdleEvent, INFINITE);
     this->cmdQueue.flush();
 }
 
 bool Application::loadContent()
 {
     spdlog::info("loadContent start");
-    auto cmdList = this->cmdQueue.getCmdList();
+
+    spdlog::info("Creating DSV allocator");
+    // Descriptor for the depth-stencil view
+    this->dsvAllocator = std::make_unique<DescriptorAllocator>(D3D12_DESCRIPTOR_HEAP_TYPE_DSV, 16u);
+    this->dsv = this->dsvAllocator->allocate();
+
+    spdlog::info("Creating vertex input layout");
+    // is structured
+    D3D12_INPUT_ELEMENT_DESC inputLayout[] = {
+        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT,
+          D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT,
+          D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT,
+          D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+    };
+
+    // Specify a root signature
+    D3D12_FEATURE_DATA_ROOT_SIGNATURE featureData = {};
+    featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
+    if (FAILED(this->device->CheckFeatureSupport(
+            D3D12_FEATURE_ROOT_SIGNATURE, &featureData, sizeof(featureData)
+        ))) {
+        featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
+    }
+    const D3D12_ROOT_SIGNATURE_FLAGS rootSigFlags =
+        D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
+    CD3DX12_ROOT_PARAMETER1 rootParams[1];
+    rootParams[0].InitAsConstantBufferView(
+        0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE,
+        D3D12_SHADER_VISIBILITY_ALL
+    );
+    CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSigDesc;
+    rootSigDesc.Init_1_1(_countof(rootParams), rootParams, 0, nullptr, rootSigFlags);
+
+    // Serialize and create the root signature
+    ComPtr<ID3DBlob> rootSigBlob, errorBlob;
+    chkDX(D3DX12SerializeVersionedRootSignature(
+        &rootSigDesc, featureData.HighestVersion, &rootSigBlob, &errorBlob
+    ));
+    chkDX(this->device->CreateRootSignature(
+        0, rootSigBlob->GetBufferPointer(), rootSigBlob->GetBufferSize(),
+        IID_PPV_ARGS(&this->rootSignature)
+    ));
+    this->dynamicDescriptors.clear();
+    for (uint32_t i = 0u; i < this->recordThreads; ++i) {
+        this->dynamicDescriptors.push_back(
+            std::make_unique<DynamicDescriptorHeap>(this->device.Get())
+        );
+        this->dynamicDescriptors.back()->parseRootSignature(rootSigDesc.Desc_1_1);
+    }
+
+    // Create the pipeline state object
+    struct PipelineStateStream
+    {
+        CD3DX12_PIPELINE_STATE_STREAM_ROOT_SIGNATURE pRootSignature;
+        CD3DX12_PIPELINE_STATE_STREAM_INPUT_LAYOUT InputLayout;
+        CD3DX12_PIPELINE_STATE_STREAM_PRIMITIVE_TOPOLOGY PrimitiveTopologyType;
+        CD3DX12_PIPELINE_STATE_STREAM_VS VS;
+        CD3DX12_PIPELINE_STATE_STREAM_PS PS;
+        CD3DX12_PIPELINE_STATE_STREAM_DEPTH_STENCIL_FORMAT DSVFormat;
+        CD3DX12_PIPELINE_STATE_STREAM_RENDER_TARGET_FORMATS RTVFormats;
+    } pipelineStateStream;
+    D3D12_RT_FORMAT_ARRAY rtvFormats = {};
+    rtvFormats.NumRenderTargets = 1;
+    rtvFormats.RTFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+    pipelineStateStream.pRootSignature = this->rootSignature.Get();
+    pipelineStateStream.InputLayout = { inputLayout, _countof(inputLayout) };
+    pipelineStateStream.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+    pipelineStateStream.VS = CD3DX12_SHADER_BYTECODE(g_vertex_shader, sizeof(g_vertex_shader));
+    pipelineStateStream.PS = CD3DX12_SHADER_BYTECODE(g_pixel_shader, sizeof(g_pixel_shader));
+    pipelineStateStream.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+    pipelineStateStream.RTVFormats = rtvFormats;
+    D3D12_PIPELINE_STATE_STREAM_DESC psoDesc = { sizeof(PipelineStateStream),
+                                                 &pipelineStateStream };
+    if (!this->pipelines) {
+        this->pipelines = std::make_unique<PipelineCache>(this->device, "pipeline_cache.bin");
+    }
+    this->pipelineState = this->pipelines->create(
+        psoDesc, { static_cast<const uint8_t*>(rootSigBlob->GetBufferPointer()),
+                   rootSigBlob->GetBufferSize() }
+    );
+    this->pipelines->save();
+
+    // Resize / create the depth buffer
+    this->contentLoaded = true;
+    this->resizeDepthBuffer(this->clientWidth, this->clientHeight);
+
+    // Parsing and uploading the mesh continues on the scheduler while frames render
+    this->scheduler.spawn(this->loadMesh());
+
+    return this->contentLoaded;
+}
+
+Task Application::loadMesh()
+{
+    co_await this->scheduler.schedule();
+    spdlog::info("loadMesh start");
 
     std::string objData = GetResourceString(IDR_TEAPOT_OBJ);
     if (objData.empty()) {
         spdlog::error("Failed to load obj from resource");
-        return false;
+        co_return;
     }
     std::istringstream objStream(objData);
 
@@ -506,14 +895,21 @@ bool Application::loadContent()
     std::string warn, err;
     if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, &objStream, &matReader)) {
         spdlog::error("Failed to load obj: {}", err);
-        return false;
+        co_return;
     }
     if (!warn.empty()) {
         spdlog::warn("tinyobjloader warn: {}", warn);
     }
 
+    // One vertex per index, sized up front rather than grown one push_back at a time
+    size_t nIndices = 0u;
+    for (const auto& shape : shapes) {
+        nIndices += shape.mesh.indices.size();
+    }
     std::vector<VertexPosNormalColor> vertices;
     std::vector<uint32_t> indices;
+    vertices.reserve(nIndices);
+    indices.reserve(nIndices);
 
     for (const auto& shape : shapes) {
         for (const auto& index : shape.mesh.indices) {
@@ -534,118 +930,54 @@ bool Application::loadContent()
             indices.push_back(static_cast<uint32_t>(indices.size()));
         }
     }
-    this->numIndices = static_cast<uint32_t>(indices.size());
 
+    // Upload vertex and index buffers on the copy queue
     spdlog::info("Uploading vertex buffer");
-    // Upload vertex buffer data
-    ComPtr<ID3D12Resource> intermediateVertexBuffer;
-    this->updateBufferResource(
-        cmdList, &this->vertexBuffer, &intermediateVertexBuffer, vertices.size(),
-        sizeof(VertexPosNormalColor), vertices.data()
+    this->vertexMemory = this->uploads->uploadBuffer(
+        vertices.data(), vertices.size() * sizeof(VertexPosNormalColor)
     );
 
     // Create the vertex buffer view
-    this->vertexBufferView.BufferLocation = this->vertexBuffer->GetGPUVirtualAddress();
+    this->vertexBufferView.BufferLocation = this->vertexMemory.get()->GetGPUVirtualAddress();
     this->vertexBufferView.SizeInBytes =
         static_cast<UINT>(vertices.size() * sizeof(VertexPosNormalColor));
     this->vertexBufferView.StrideInBytes = sizeof(VertexPosNormalColor);
 
     spdlog::info("Uploading index buffer");
-    // Upload index buffer data
-    ComPtr<ID3D12Resource> intermediateIndexBuffer;
-    this->updateBufferResource(
-        cmdList, &this->indexBuffer, &intermediateIndexBuffer, indices.size(), sizeof(uint32_t),
-        indices.data()
-    );
+    this->indexMemory =
+        this->uploads->uploadBuffer(indices.data(), indices.size() * sizeof(uint32_t));
 
     // Create the index buffer view
-    this->indexBufferView.BufferLocation = this->indexBuffer->GetGPUVirtualAddress();
+    this->indexBufferView.BufferLocation = this->indexMemory.get()->GetGPUVirtualAddress();
     this->indexBufferView.Format = DXGI_FORMAT_R32_UINT;
     this->indexBufferView.SizeInBytes = static_cast<UINT>(indices.size() * sizeof(uint32_t));
 
-    spdlog::info("Creating dsvHeap");
-    // Create the descriptor heap for the depth-stencil view
-    D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc = {};
-    dsvHeapDesc.NumDescriptors = 1;
-    dsvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
-    dsvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-    chkDX(this->device->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&this->dsvHeap)));
+    // Frames submitted after this wait on the copies GPU-side, and only those frames can see
+    //  meshLoaded, so nothing on the CPU has to wait for the upload
+    const UploadTicket ticket = this->uploads->submit();
+    this->uploads->waitOnGpu(this->cmdQueue, ticket);
 
-    spdlog::info("Creating vertex input layout");
-    // is structured
-    D3D12_INPUT_ELEMENT_DESC inputLayout[] = {
-        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT,
-          D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT,
-          D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT,
-          D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
-    };
-
-    // Specify a root signature
-    D3D12_FEATURE_DATA_ROOT_SIGNATURE featureData = {};
-    featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
-    if (FAILED(this->device->CheckFeatureSupport(
-            D3D12_FEATURE_ROOT_SIGNATURE, &featureData, sizeof(featureData)
-        ))) {
-        featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
+    // Placed resources can't be evicted on their own, only the heaps holding them
+    std::vector<ComPtr<ID3D12Heap>> meshHeaps = { this->gpuMemory->heapOf(this->vertexMemory) };
+    if (ComPtr<ID3D12Heap> heap = this->gpuMemory->heapOf(this->indexMemory);
+        heap != meshHeaps.front()) {
+        meshHeaps.push_back(heap);
     }
-    const D3D12_ROOT_SIGNATURE_FLAGS rootSigFlags =
-        D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT |
-        D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
-        D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
-        D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
-    CD3DX12_ROOT_PARAMETER1 rootParams[1];
-    rootParams[0].InitAsConstants(
-        sizeof(SceneConstantBuffer) / 4, 0, 0, D3D12_SHADER_VISIBILITY_ALL
+    for (const ComPtr<ID3D12Heap>& heap : meshHeaps) {
+        this->meshResidency.push_back(this->residency->track(
+            heap, heap->GetDesc().SizeInBytes, ResidencyCategory::Buffers
+        ));
+    }
+    this->vertexBuffer = this->resources.add(
+        this->vertexMemory.resource(), D3D12_RESOURCE_STATE_COMMON, "mesh vertices"
+    );
+    this->indexBuffer = this->resources.add(
+        this->indexMemory.resource(), D3D12_RESOURCE_STATE_COMMON, "mesh indices"
     );
-    CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSigDesc;
-    rootSigDesc.Init_1_1(_countof(rootParams), rootParams, 0, nullptr, rootSigFlags);
-
-    // Serialize and create the root signature
-    ComPtr<ID3DBlob> rootSigBlob, errorBlob;
-    chkDX(D3DX12SerializeVersionedRootSignature(
-        &rootSigDesc, featureData.HighestVersion, &rootSigBlob, &errorBlob
-    ));
-    chkDX(this->device->CreateRootSignature(
-        0, rootSigBlob->GetBufferPointer(), rootSigBlob->GetBufferSize(),
-        IID_PPV_ARGS(&this->rootSignature)
-    ));
-
-    // Create the pipeline state object
-    struct PipelineStateStream
-    {
-        CD3DX12_PIPELINE_STATE_STREAM_ROOT_SIGNATURE pRootSignature;
-        CD3DX12_PIPELINE_STATE_STREAM_INPUT_LAYOUT InputLayout;
-        CD3DX12_PIPELINE_STATE_STREAM_PRIMITIVE_TOPOLOGY PrimitiveTopologyType;
-        CD3DX12_PIPELINE_STATE_STREAM_VS VS;
-        CD3DX12_PIPELINE_STATE_STREAM_PS PS;
-        CD3DX12_PIPELINE_STATE_STREAM_DEPTH_STENCIL_FORMAT DSVFormat;
-        CD3DX12_PIPELINE_STATE_STREAM_RENDER_TARGET_FORMATS RTVFormats;
-    } pipelineStateStream;
-    D3D12_RT_FORMAT_ARRAY rtvFormats = {};
-    rtvFormats.NumRenderTargets = 1;
-    rtvFormats.RTFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
-    pipelineStateStream.pRootSignature = this->rootSignature.Get();
-    pipelineStateStream.InputLayout = { inputLayout, _countof(inputLayout) };
-    pipelineStateStream.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-    pipelineStateStream.VS = CD3DX12_SHADER_BYTECODE(g_vertex_shader, sizeof(g_vertex_shader));
-    pipelineStateStream.PS = CD3DX12_SHADER_BYTECODE(g_pixel_shader, sizeof(g_pixel_shader));
-    pipelineStateStream.DSVFormat = DXGI_FORMAT_D32_FLOAT;
-    pipelineStateStream.RTVFormats = rtvFormats;
-    D3D12_PIPELINE_STATE_STREAM_DESC psoDesc = { sizeof(PipelineStateStream),
-                                                 &pipelineStateStream };
-    chkDX(this->device->CreatePipelineState(&psoDesc, IID_PPV_ARGS(&this->pipelineState)));
-
-    // Execute the created command list on the GPU
-    uint64_t fenceValue = this->cmdQueue.execCmdList(cmdList);
-    this->cmdQueue.waitForFenceVal(fenceValue);
-
-    // Resize / create the depth buffer
-    this->contentLoaded = true;
-    this->resizeDepthBuffer(this->clientWidth, this->clientHeight);
 
-    return this->contentLoaded;
+    this->numIndices = static_cast<uint32_t>(indices.size());
+    this->meshLoaded.store(true, std::memory_order_release);
+    spdlog::info("loadMesh done");
 }
 
 void Application::onResize(uint32_t width, uint32_t height)
@@ -657,11 +989,11 @@ void Application::onResize(uint32_t width, uint32_t height)
 
         // Flush the GPU queue to make sure the swap chain's back buffers
         //  are not being referenced by an in-flight command list.
-        this->cmdQueue.flush();
+        this->flush();
         for (int i = 0; i < this->nBuffers; ++i) {
             // Any references to the back buffers must be released
             //  before the swap chain can be resized.
-            this->backBuffers[i].Reset();
+            this->resources.remove(this->backBuffers[i]);
         }
         DXGI_SWAP_CHAIN_DESC swapChainDesc = {};
         chkDX(this->swapChain->GetDesc(&swapChainDesc));
@@ -686,3 +1018,17 @@ void Application::onResize(uint32_t width, uint32_t height)
         this->flush();
     }
 }
+
+void Application::dumpAllocatorTelemetry(const std::string& path)
+{
+    const AllocatorTelemetry* allocators[] = { &this->uploads->stagingTelemetry(),
+                                               &this->frames.threadUploads().telemetry(),
+                                               &this->dsvAllocator->telemetry() };
+    std::ofstream file(path);
+    file << allocatorTelemetryJson(allocators);
+    if (!file) {
+        spdlog::error("Failed to write allocator telemetry to {}", path);
+        return;
+    }
+    spdlog::info("Wrote allocator telemetry to {}", path);
+}
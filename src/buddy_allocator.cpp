@@ -0,0 +1,145 @@
+module;
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+module buddy_allocator;
+
+double BuddyAllocator::Stats::internalFragmentation() const
+{
+    return this->allocatedBytes == 0u
+        ? 0.0
+        : 1.0 - static_cast<double>(this->requestedBytes) / this->allocatedBytes;
+}
+
+BuddyAllocator::BuddyAllocator(uint64_t capacity, uint64_t minBlockSize)
+    : minBlockSize(minBlockSize)
+{
+    assert(std::has_single_bit(minBlockSize) && "Minimum block size must be a power of 2");
+    assert(capacity >= minBlockSize);
+
+    const uint64_t nBlocks = std::bit_floor(capacity / minBlockSize);
+    assert(nBlocks <= nil && "Too many minimum sized blocks");
+    this->maxOrder = static_cast<uint32_t>(std::countr_zero(nBlocks));
+    this->blockState.assign(nBlocks, 0u);
+    this->nextFree.assign(nBlocks, nil);
+    this->prevFree.assign(nBlocks, nil);
+    this->requested.assign(nBlocks, 0u);
+    this->freeHeads.assign(this->maxOrder + 1u, nil);
+    this->buddyStats.capacity = nBlocks * minBlockSize;
+    this->buddyStats.largestFreeBlock = this->buddyStats.capacity;
+    this->pushFree(0u, this->maxOrder);
+}
+
+void BuddyAllocator::pushFree(uint32_t block, uint32_t order)
+{
+    this->blockState[block] = static_cast<uint8_t>(order) | freeFlag;
+    this->prevFree[block] = nil;
+    this->nextFree[block] = this->freeHeads[order];
+    if (this->freeHeads[order] != nil) {
+        this->prevFree[this->freeHeads[order]] = block;
+    }
+    this->freeHeads[order] = block;
+    this->freeOrders |= 1ull << order;
+}
+
+void BuddyAllocator::removeFree(uint32_t block, uint32_t order)
+{
+    if (this->prevFree[block] != nil) {
+        this->nextFree[this->prevFree[block]] = this->nextFree[block];
+    } else {
+        this->freeHeads[order] = this->nextFree[block];
+    }
+    if (this->nextFree[block] != nil) {
+        this->prevFree[this->nextFree[block]] = this->prevFree[block];
+    }
+    this->blockState[block] = static_cast<uint8_t>(order);
+    if (this->freeHeads[order] == nil) {
+        this->freeOrders &= ~(1ull << order);
+    }
+}
+
+uint64_t BuddyAllocator::allocate(uint64_t size, uint64_t alignment)
+{
+    assert(std::has_single_bit(alignment) && "Alignment must be a power of 2");
+
+    // Blocks are aligned to their size, so a block at least as large as the alignment is
+    //  always aligned
+    const uint64_t units = std::max<uint64_t>(
+        (std::max<uint64_t>(size, 1u) + this->minBlockSize - 1u) / this->minBlockSize,
+        alignment / this->minBlockSize
+    );
+    const uint32_t order = static_cast<uint32_t>(std::bit_width(units - 1u));
+    const uint64_t candidates = order > this->maxOrder ? 0u : this->freeOrders >> order;
+    if (candidates == 0u) {
+        this->buddyStats.failures++;
+        return invalidOffset;
+    }
+
+    // Take the smallest free block that fits and split it down, freeing the upper halves
+    uint32_t freeOrder = order + static_cast<uint32_t>(std::countr_zero(candidates));
+    const uint32_t block = this->freeHeads[freeOrder];
+    this->removeFree(block, freeOrder);
+    while (freeOrder > order) {
+        freeOrder--;
+        this->pushFree(block + (1u << freeOrder), freeOrder);
+        this->buddyStats.splits++;
+    }
+
+    this->blockState[block] = static_cast<uint8_t>(order);
+    this->requested[block] = size;
+    this->buddyStats.allocations++;
+    this->buddyStats.allocatedBytes += this->minBlockSize << order;
+    this->buddyStats.requestedBytes += size;
+    return block * this->minBlockSize;
+}
+
+void BuddyAllocator::free(uint64_t offset)
+{
+    uint32_t block = static_cast<uint32_t>(offset / this->minBlockSize);
+    assert(
+        offset % this->minBlockSize == 0u && block < this->blockState.size() &&
+        !(this->blockState[block] & freeFlag) && "Invalid offset"
+    );
+
+    uint32_t order = this->blockState[block];
+    this->buddyStats.allocations--;
+    this->buddyStats.allocatedBytes -= this->minBlockSize << order;
+    this->buddyStats.requestedBytes -= this->requested[block];
+
+    while (order < this->maxOrder) {
+        const uint32_t buddy = block ^ (1u << order);
+        if (this->blockState[buddy] != (static_cast<uint8_t>(order) | freeFlag)) {
+            break;
+        }
+        this->removeFree(buddy, order);
+        block = std::min(block, buddy);
+        order++;
+        this->buddyStats.merges++;
+    }
+    this->pushFree(block, order);
+}
+
+uint64_t BuddyAllocator::blockSize(uint64_t offset) const
+{
+    const uint32_t block = static_cast<uint32_t>(offset / this->minBlockSize);
+    assert(!(this->blockState[block] & freeFlag));
+    return this->minBlockSize << this->blockState[block];
+}
+
+bool BuddyAllocator::empty() const
+{
+    return this->buddyStats.allocations == 0u;
+}
+
+BuddyAllocator::Stats BuddyAllocator::stats() const
+{
+    Stats s = this->buddyStats;
+    s.largestFreeBlock = this->freeOrders == 0u
+        ? 0u
+        : this->minBlockSize << (63u - std::countl_zero(this->freeOrders));
+    return s;
+}
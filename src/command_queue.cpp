@@ -1,15 +1,242 @@
 module;
 
+#if defined(__clang__)
+    #define FMT_CONSTEVAL
+#endif
+
 #include <Windows.h>
 #include <d3d12.h>
 #include <wrl.h>
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <coroutine>
 #include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <source_location>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <spdlog/spdlog.h>
 
 module command_queue;
 
-CommandQueue::CommandQueue(ComPtr<ID3D12Device2> device, D3D12_COMMAND_LIST_TYPE type)
-    : device(device), fenceValue(0), type(type)
+import mpsc_ring;
+
+// One auto-reset event per thread, so blocking fence waits may happen on any of them. A wait
+//  that timed out can leave it signaled, which only costs the next wait an extra poll.
+HANDLE threadWaitEvent()
+{
+    thread_local struct WaitEvent
+    {
+        HANDLE handle = ::CreateEvent(nullptr, FALSE, FALSE, nullptr);
+        ~WaitEvent() { ::CloseHandle(this->handle); }
+    } waitEvent;
+
+    assert(waitEvent.handle && "Failed to create fence wait event handle.");
+    return waitEvent.handle;
+}
+
+// A queue's fence as seen by its FenceWatcher, waking the watcher thread through an event
+class EventFence : public WatchedFence
+{
+   public:
+    explicit EventFence(ID3D12Fence* fence) : fence(fence)
+    {
+        this->event = ::CreateEvent(nullptr, FALSE, FALSE, nullptr);
+        assert(this->event && "Failed to create fence watcher event handle.");
+    }
+
+    ~EventFence() override { ::CloseHandle(this->event); }
+
+    uint64_t completedValue() const override { return this->fence->GetCompletedValue(); }
+    void armEvent(uint64_t value) override
+    {
+        chkDX(this->fence->SetEventOnCompletion(value, this->event));
+    }
+    void waitForSignal() override { ::WaitForSingleObject(this->event, INFINITE); }
+    void wake() override { ::SetEvent(this->event); }
+
+   private:
+    ID3D12Fence* fence;
+    HANDLE event;
+};
+
+// Sole caller of ExecuteCommandLists, Wait and Signal on a queue. Producers push into a
+//  lock-free ring, and everything found there on wakeup is coalesced into one
+//  ExecuteCommandLists call followed by a single signal. The fence value of a submission is
+//  its ring position + 1, so producers know it without waiting for the thread.
+class Submitter
+{
+   public:
+    // A list to execute, a fence to wait on, or neither to only advance the fence
+    struct Submission
+    {
+        ID3D12CommandList* cmdList = nullptr;
+        ID3D12Fence* waitFence = nullptr;
+        uint64_t waitValue = 0u;
+    };
+
+    Submitter(ComPtr<ID3D12CommandQueue> queue, ComPtr<ID3D12Fence> fence, size_t capacity)
+        : queue(queue), fence(fence), ring(capacity)
+    {
+        this->batchLists.reserve(this->ring.size());
+        this->thread = std::thread([this]() { this->run(); });
+    }
+
+    ~Submitter()
+    {
+        this->stopping.store(true);
+        this->ring.wakeConsumer();
+        this->thread.join();
+    }
+
+    uint64_t push(const Submission& submission) { return this->ring.push(submission) + 1u; }
+    uint64_t lastQueued() const { return this->ring.pushed(); }
+
+    // Block until everything up to fenceValue has been handed to the D3D12 queue
+    void waitIssued(uint64_t fenceValue) const
+    {
+        uint64_t cur = this->issued.load(std::memory_order_acquire);
+        while (cur < fenceValue) {
+            this->issued.wait(cur, std::memory_order_acquire);
+            cur = this->issued.load(std::memory_order_acquire);
+        }
+    }
+
+    void addStats(CommandQueue::Stats& stats) const
+    {
+        stats.submissions += this->submissions.load(std::memory_order_relaxed);
+        stats.batches += this->batches.load(std::memory_order_relaxed);
+        stats.submitStalls += this->ring.stalls();
+    }
+
+   private:
+    ComPtr<ID3D12CommandQueue> queue;
+    ComPtr<ID3D12Fence> fence;
+    MpscRing<Submission> ring;
+    std::thread thread;
+    std::atomic<bool> stopping = false;
+    std::atomic<uint64_t> issued = 0u;
+    std::atomic<uint64_t> submissions = 0u;
+    std::atomic<uint64_t> batches = 0u;
+    // Scratch for the current batch, kept around so its capacity is reused
+    std::vector<ID3D12CommandList*> batchLists;
+
+    void run()
+    {
+        while (true) {
+            const uint64_t snapshot = this->ring.pushSnapshot();
+            const uint64_t first = this->ring.popped();
+
+            // Bound a batch by the ring size so busy producers can't starve the signal
+            Submission submission;
+            while (this->ring.popped() - first < this->ring.size() &&
+                   this->ring.tryPop(submission)) {
+                if (submission.cmdList) {
+                    this->batchLists.push_back(submission.cmdList);
+                } else if (submission.waitFence) {
+                    // Lists queued before the wait must not be held back by it
+                    this->executeBatch();
+                    chkDX(this->queue->Wait(submission.waitFence, submission.waitValue));
+                }
+            }
+
+            const uint64_t last = this->ring.popped();
+            if (last == first) {
+                if (this->stopping.load()) {
+                    return;
+                }
+                this->ring.waitForPush(snapshot);
+                continue;
+            }
+
+            this->executeBatch();
+            chkDX(this->queue->Signal(this->fence.Get(), last));
+            this->issued.store(last, std::memory_order_release);
+            this->issued.notify_all();
+        }
+    }
+
+    void executeBatch()
+    {
+        if (this->batchLists.empty()) {
+            return;
+        }
+        this->queue->ExecuteCommandLists(
+            static_cast<UINT>(this->batchLists.size()), this->batchLists.data()
+        );
+        this->submissions.fetch_add(this->batchLists.size(), std::memory_order_relaxed);
+        this->batches.fetch_add(1u, std::memory_order_relaxed);
+        this->batchLists.clear();
+    }
+};
+
+class CommandQueue::AllocSource
+    : public CmdAllocSource<ComPtr<ID3D12CommandAllocator>, ComPtr<ID3D12GraphicsCommandList2>>
+{
+   public:
+    explicit AllocSource(CommandQueue& queue) : queue(queue) {}
+
+    ComPtr<ID3D12CommandAllocator> createAllocator() override
+    {
+        ComPtr<ID3D12CommandAllocator> allocator;
+        chkDX(this->queue.device->CreateCommandAllocator(
+            this->queue.type, IID_PPV_ARGS(&allocator)
+        ));
+        return allocator;
+    }
+
+    ComPtr<ID3D12GraphicsCommandList2> createList(
+        const ComPtr<ID3D12CommandAllocator>& allocator
+    ) override
+    {
+        ComPtr<ID3D12GraphicsCommandList2> list;
+        chkDX(this->queue.device->CreateCommandList(
+            0, this->queue.type, allocator.Get(), nullptr, IID_PPV_ARGS(&list)
+        ));
+        return list;
+    }
+
+    void reset(
+        const ComPtr<ID3D12CommandAllocator>& allocator,
+        const ComPtr<ID3D12GraphicsCommandList2>& list
+    ) override
+    {
+        chkDX(allocator->Reset());
+        chkDX(list->Reset(allocator.Get(), nullptr));
+    }
+
+    bool isFenceComplete(uint64_t fenceValue) override
+    {
+        return this->queue.isFenceComplete(fenceValue);
+    }
+
+    bool waitForFenceVal(uint64_t fenceValue) override
+    {
+        return this->queue.waitForFenceVal(fenceValue);
+    }
+
+   private:
+    CommandQueue& queue;
+};
+
+CommandQueue::CommandQueue() = default;
+CommandQueue::~CommandQueue() = default;
+CommandQueue::CommandQueue(CommandQueue&&) noexcept = default;
+CommandQueue& CommandQueue::operator=(CommandQueue&&) noexcept = default;
+
+CommandQueue::CommandQueue(
+    ComPtr<ID3D12Device2> device,
+    D3D12_COMMAND_LIST_TYPE type,
+    uint32_t nThreadSlots,
+    uint32_t ringSize
+)
+    : device(device), type(type), allocRings(nThreadSlots, ringSize)
 {
     D3D12_COMMAND_QUEUE_DESC desc = {};
     desc.Type = type;
@@ -18,63 +245,56 @@ CommandQueue::CommandQueue(ComPtr<ID3D12Device2> device, D3D12_COMMAND_LIST_TYPE
     desc.NodeMask = 0;
 
     chkDX(device->CreateCommandQueue(&desc, IID_PPV_ARGS(&this->queue)));
-    chkDX(device->CreateFence(this->fenceValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&this->fence)));
-    this->fenceEvent = ::CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    chkDX(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&this->fence)));
+    this->waitSites = std::make_unique<WaitSites>();
+    this->fenceWatcher =
+        std::make_unique<FenceWatcher>(std::make_unique<EventFence>(this->fence.Get()));
 
-    assert(this->fenceEvent && "Failed to create fence event handle.");
+    // Room for every list that can be open at once plus signals and waits in between
+    const size_t submitCapacity = std::max<size_t>(
+        64u, 2u * this->allocRings.threadSlotCount() * this->allocRings.ringSize()
+    );
+    this->submitter = std::make_unique<Submitter>(this->queue, this->fence, submitCapacity);
 }
 
-// Get or create a commandlist, using next available command allocator
-ComPtr<ID3D12GraphicsCommandList2> CommandQueue::getCmdList()
+ComPtr<ID3D12GraphicsCommandList2> CommandQueue::getCmdList(uint32_t threadSlot)
 {
-    ComPtr<ID3D12GraphicsCommandList2> commandList;
-    ComPtr<ID3D12CommandAllocator> commandAllocator = this->createCmdAlloc();
-
-    if (this->cmdListQueue.empty()) {
-        commandList = this->createCmdList(commandAllocator);
-    } else {
-        commandList = this->cmdListQueue.front();
-        chkDX(commandList->Reset(commandAllocator.Get(), nullptr));
-        this->cmdListQueue.pop();
-    }
-
-    // Assign allocator to command list
-    chkDX(commandList->SetPrivateDataInterface(
-        __uuidof(ID3D12CommandAllocator), commandAllocator.Get()
-    ));
-
-    return commandList;
+    AllocSource source(*this);
+    return this->allocRings.open(source, threadSlot);
 }
 
-uint64_t CommandQueue::execCmdList(ComPtr<ID3D12GraphicsCommandList2> cmdList)
+uint64_t CommandQueue::submit(ComPtr<ID3D12GraphicsCommandList2> cmdList)
 {
     chkDX(cmdList->Close());
+    return this->allocRings.submit({ &cmdList, 1 }, [&](const auto& list) {
+        return this->submitter->push({ list.Get() });
+    });
+}
 
-    // Retrieve command allocator from private data of command list
-    ID3D12CommandAllocator* commandAllocator;
-    UINT dataSize = sizeof(commandAllocator);
-    chkDX(cmdList->GetPrivateData(__uuidof(ID3D12CommandAllocator), &dataSize, &commandAllocator));
-
-    ID3D12CommandList* const commandLists[] = { cmdList.Get() };
-    this->queue->ExecuteCommandLists(_countof(commandLists), commandLists);
-    uint64_t fenceVal = this->signal();
-
-    // Push bach the allocator and list to their queues so they can be re-used
-    this->cmdAllocQueue.emplace(CmdAllocEntry{ fenceVal, commandAllocator });
-    this->cmdListQueue.push(cmdList);
+uint64_t CommandQueue::execCmdList(ComPtr<ID3D12GraphicsCommandList2> cmdList)
+{
+    return this->execCmdLists({ &cmdList, 1 });
+}
 
-    // Release ownership of the command allocator
-    commandAllocator->Release();
+uint64_t CommandQueue::execCmdLists(std::span<const ComPtr<ID3D12GraphicsCommandList2>> cmdLists)
+{
+    if (cmdLists.empty()) {
+        return this->submitter->lastQueued();
+    }
 
+    for (const auto& cmdList : cmdLists) {
+        chkDX(cmdList->Close());
+    }
+    const uint64_t fenceVal = this->allocRings.submit(cmdLists, [&](const auto& list) {
+        return this->submitter->push({ list.Get() });
+    });
+    this->submitter->waitIssued(fenceVal);
     return fenceVal;
 }
 
 uint64_t CommandQueue::signal()
 {
-    uint64_t fenceValueForSignal = ++fenceValue;
-    chkDX(this->queue->Signal(fence.Get(), fenceValueForSignal));
-
-    return fenceValueForSignal;
+    return this->submitter->push({});
 }
 
 bool CommandQueue::isFenceComplete(uint64_t fval)
@@ -82,47 +302,63 @@ bool CommandQueue::isFenceComplete(uint64_t fval)
     return (this->fence->GetCompletedValue() >= fval);
 }
 
-void CommandQueue::waitForFenceVal(uint64_t fval)
+uint64_t CommandQueue::completedValue() const
 {
-    if (!this->isFenceComplete(fval)) {
-        chkDX(fence->SetEventOnCompletion(fval, fenceEvent));
-        WaitForSingleObject(fenceEvent, INFINITE);
-    }
+    return this->fence->GetCompletedValue();
 }
 
-void CommandQueue::flush()
+bool CommandQueue::waitForFenceVal(uint64_t fval, const std::source_location& site)
 {
-    uint64_t fenceValueForSignal = this->signal();
-    this->waitForFenceVal(fenceValueForSignal);
+    const WaitResult result = adaptiveWait(
+        this->waitPolicy, [&]() { return this->isFenceComplete(fval); },
+        [&](std::chrono::microseconds remaining) {
+            const HANDLE event = threadWaitEvent();
+            chkDX(this->fence->SetEventOnCompletion(fval, event));
+            const DWORD timeoutMs = remaining == std::chrono::microseconds::max()
+                                        ? INFINITE
+                                        : static_cast<DWORD>((remaining.count() + 999) / 1000);
+            ::WaitForSingleObject(event, timeoutMs);
+        }
+    );
+    this->waitSites->at(site).record(result);
+    return result.reached();
+}
+
+FenceAwaiter CommandQueue::fenceReached(uint64_t fval, Scheduler& scheduler)
+{
+    return { this->fenceWatcher.get(), fval, &scheduler };
 }
 
-// Command allocator can't be re-used unless associated cmd list's commands
-//  have finished on the GPU (i.e. entry's fence value is greater than the
-//  current fence value)
-ComPtr<ID3D12CommandAllocator> CommandQueue::createCmdAlloc()
+void CommandQueue::gpuWait(const CommandQueue& other, uint64_t fval)
 {
-    ComPtr<ID3D12CommandAllocator> allocator;
+    this->submitter->push({ nullptr, other.fence.Get(), fval });
+}
 
-    if (this->cmdAllocQueue.size() > 0 &&
-        this->isFenceComplete(this->cmdAllocQueue.front().fenceValue)) {
-        allocator = this->cmdAllocQueue.front().commandAllocator;
-        chkDX(allocator->Reset());
-        this->cmdAllocQueue.pop();
-    } else {
-        chkDX(device->CreateCommandAllocator(this->type, IID_PPV_ARGS(&allocator)));
-    }
+void CommandQueue::setWaitPolicy(const WaitPolicy& policy)
+{
+    this->waitPolicy = policy;
+}
 
-    return allocator;
+const WaitSites& CommandQueue::waitStats() const
+{
+    return *this->waitSites;
 }
 
-ComPtr<ID3D12GraphicsCommandList2> CommandQueue::createCmdList(
-    ComPtr<ID3D12CommandAllocator> allocator
-)
+void CommandQueue::flush()
 {
-    ComPtr<ID3D12GraphicsCommandList2> commandList;
-    chkDX(device->CreateCommandList(
-        0, this->type, allocator.Get(), nullptr, IID_PPV_ARGS(&commandList)
-    ));
+    uint64_t fenceValueForSignal = this->signal();
+    this->waitForFenceVal(fenceValueForSignal);
+}
 
-    return commandList;
+CommandQueue::Stats CommandQueue::stats() const
+{
+    const auto ringStats = this->allocRings.stats();
+    Stats total;
+    total.allocatorCreations = ringStats.allocatorCreations;
+    total.cmdListCreations = ringStats.cmdListCreations;
+    total.stalls = ringStats.stalls;
+    if (this->submitter) {
+        this->submitter->addStats(total);
+    }
+    return total;
 }
@@ -1,14 +1,18 @@
 module;
 
 #include <d3d12.h>
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <utility>
 
 module descriptor_allocator;
 
-import application;
+import window;
 
 DescriptorAllocation::DescriptorAllocation()
 {
@@ -77,11 +81,236 @@ uint32_t DescriptorAllocation::getNumHandles() const
 void DescriptorAllocation::free()
 {
     if (!this->isNull() && this->page != nullptr) {
-        this->page->free(std::move(*this), Application::nBuffers);
+        // Keep the page alive through the call, this may be its last reference
+        std::shared_ptr<DescriptorAllocatorPage> owner = this->page;
+        owner->free(std::move(*this), owner->frame());
     }
 }
 
-void DescriptorAllocatorPage::free(DescriptorAllocation&& /*allocation*/, uint64_t /*frameNumber*/)
+double DescriptorAllocator::Stats::fragmentation() const
 {
-    // TODO: Implement free-list based deallocation
-}
\ No newline at end of file
+    if (this->freeDescriptors == 0u) {
+        return 0.0;
+    }
+    return 1.0 - static_cast<double>(this->largestFreeBlock) / this->freeDescriptors;
+}
+
+static const char* descriptorHeapTypeName(D3D12_DESCRIPTOR_HEAP_TYPE type)
+{
+    switch (type) {
+        case D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV:
+            return "CBV/SRV/UAV";
+        case D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER:
+            return "sampler";
+        case D3D12_DESCRIPTOR_HEAP_TYPE_RTV:
+            return "RTV";
+        case D3D12_DESCRIPTOR_HEAP_TYPE_DSV:
+            return "DSV";
+        default:
+            return "unknown";
+    }
+}
+
+DescriptorAllocator::DescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t nDescPerHeap)
+    : type(type),
+      nDescPerHeap(nDescPerHeap),
+      allocatorTelemetry(std::string(descriptorHeapTypeName(type)) + " descriptors", "descriptors")
+{
+}
+
+DescriptorAllocation DescriptorAllocator::allocate(uint32_t nDescriptors)
+{
+    this->allocations.fetch_add(1u, std::memory_order_relaxed);
+    this->allocatorTelemetry.recordAllocation(nDescriptors);
+
+    if (nDescriptors == 1u) {
+        // Pages are never destroyed before the allocator, so this only needs the page's lock
+        if (DescriptorAllocatorPage* page = this->singlePage.load(std::memory_order_acquire)) {
+            DescriptorAllocation allocation = page->allocate(1u);
+            if (!allocation.isNull()) {
+                this->fastAllocations.fetch_add(1u, std::memory_order_relaxed);
+                return allocation;
+            }
+        }
+    }
+
+    std::scoped_lock lock(this->allocMutex);
+
+    for (auto it = this->availableHeaps.begin(); it != this->availableHeaps.end();) {
+        const std::shared_ptr<DescriptorAllocatorPage>& page = this->heapPool[*it];
+        DescriptorAllocation allocation = page->allocate(nDescriptors);
+        if (page->numFreeHandles() == 0u) {
+            it = this->availableHeaps.erase(it);
+        } else {
+            ++it;
+        }
+        if (!allocation.isNull()) {
+            if (nDescriptors == 1u) {
+                this->singlePage.store(page.get(), std::memory_order_release);
+            }
+            return allocation;
+        }
+    }
+
+    // No page has a large enough block, requests bigger than a page get a page of their own
+    std::shared_ptr<DescriptorAllocatorPage> page =
+        this->createAllocatorPage(std::max(this->nDescPerHeap, nDescriptors));
+    DescriptorAllocation allocation = page->allocate(nDescriptors);
+    if (nDescriptors == 1u) {
+        this->singlePage.store(page.get(), std::memory_order_release);
+    }
+    return allocation;
+}
+
+void DescriptorAllocator::setFrame(uint64_t frameNumber)
+{
+    std::scoped_lock lock(this->allocMutex);
+    this->frameNumber = frameNumber;
+    for (const auto& page : this->heapPool) {
+        page->setFrame(frameNumber);
+    }
+}
+
+void DescriptorAllocator::releaseStaleDescriptors(uint64_t frameNumber)
+{
+    std::scoped_lock lock(this->allocMutex);
+    for (size_t i = 0u; i < this->heapPool.size(); i++) {
+        auto& page = this->heapPool[i];
+        page->releaseStaleDescriptors(frameNumber);
+        if (page->numFreeHandles() > 0u) {
+            this->availableHeaps.insert(i);
+        }
+    }
+}
+
+DescriptorAllocator::Stats DescriptorAllocator::stats()
+{
+    std::scoped_lock lock(this->allocMutex);
+    Stats stats;
+    stats.pages = static_cast<uint32_t>(this->heapPool.size());
+    for (const auto& page : this->heapPool) {
+        const FreeList::Stats pageStats = page->stats();
+        stats.descriptors += pageStats.capacity;
+        stats.freeDescriptors += pageStats.freeCount;
+        stats.freeBlocks += pageStats.freeBlocks;
+        stats.largestFreeBlock = std::max(stats.largestFreeBlock, pageStats.largestFreeBlock);
+        stats.staleDescriptors += page->numStaleHandles();
+    }
+    stats.allocations = this->allocations.load(std::memory_order_relaxed);
+    stats.fastAllocations = this->fastAllocations.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void DescriptorAllocator::sampleTelemetry(uint64_t frame)
+{
+    // Freed descriptors waiting for their frame are neither live nor available
+    const Stats s = this->stats();
+    AllocatorTelemetry::Gauges gauges;
+    gauges.live = s.descriptors - s.freeDescriptors - s.staleDescriptors;
+    gauges.reserved = s.descriptors;
+    gauges.largestFreeBlock = s.largestFreeBlock;
+    gauges.pages = s.pages;
+    this->allocatorTelemetry.sample(frame, gauges);
+}
+
+const AllocatorTelemetry& DescriptorAllocator::telemetry() const
+{
+    return this->allocatorTelemetry;
+}
+
+std::shared_ptr<DescriptorAllocatorPage> DescriptorAllocator::createAllocatorPage(
+    uint32_t nDescriptors
+)
+{
+    auto page = std::make_shared<DescriptorAllocatorPage>(this->type, nDescriptors);
+    page->setFrame(this->frameNumber);
+    this->heapPool.push_back(page);
+    this->availableHeaps.insert(this->heapPool.size() - 1u);
+    return page;
+}
+
+DescriptorAllocatorPage::DescriptorAllocatorPage(
+    D3D12_DESCRIPTOR_HEAP_TYPE type,
+    uint32_t nDescPerHeap
+)
+    : type(type), nDescriptors(nDescPerHeap), slots(nDescPerHeap)
+{
+    auto device = Window::get()->device;
+
+    D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+    heapDesc.Type = type;
+    heapDesc.NumDescriptors = nDescPerHeap;
+    chkDX(device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&this->heap)));
+
+    this->baseDescriptor = this->heap->GetCPUDescriptorHandleForHeapStart();
+    this->descriptorSize = device->GetDescriptorHandleIncrementSize(type);
+}
+
+D3D12_DESCRIPTOR_HEAP_TYPE DescriptorAllocatorPage::getHeapType() const
+{
+    return this->type;
+}
+
+uint32_t DescriptorAllocatorPage::numFreeHandles() const
+{
+    std::scoped_lock lock(this->mutex);
+    return this->slots.freeCount();
+}
+
+DescriptorAllocation DescriptorAllocatorPage::allocate(uint32_t nDescriptors)
+{
+    std::scoped_lock lock(this->mutex);
+    const uint32_t offset = this->slots.allocate(nDescriptors);
+    if (offset == FrameFreeList::invalidOffset) {
+        return {};
+    }
+    return DescriptorAllocation(
+        { this->baseDescriptor.ptr + static_cast<size_t>(offset) * this->descriptorSize },
+        nDescriptors, this->descriptorSize, this->shared_from_this()
+    );
+}
+
+void DescriptorAllocatorPage::free(DescriptorAllocation&& allocation, uint64_t frameNumber)
+{
+    const uint32_t offset = static_cast<uint32_t>(
+        (allocation.handle.ptr - this->baseDescriptor.ptr) / this->descriptorSize
+    );
+    {
+        std::scoped_lock lock(this->mutex);
+        // The GPU may still reference the descriptors until frameNumber completes
+        this->slots.free(offset, allocation.numHandles, frameNumber);
+    }
+
+    allocation.handle.ptr = 0;
+    allocation.numHandles = 0u;
+    allocation.descriptorSize = 0u;
+    allocation.page = nullptr;
+}
+
+void DescriptorAllocatorPage::releaseStaleDescriptors(uint64_t frameNumber)
+{
+    std::scoped_lock lock(this->mutex);
+    this->slots.releaseStale(frameNumber);
+}
+
+void DescriptorAllocatorPage::setFrame(uint64_t frameNumber)
+{
+    this->currentFrame.store(frameNumber, std::memory_order_relaxed);
+}
+
+uint64_t DescriptorAllocatorPage::frame() const
+{
+    return this->currentFrame.load(std::memory_order_relaxed);
+}
+
+FreeList::Stats DescriptorAllocatorPage::stats() const
+{
+    std::scoped_lock lock(this->mutex);
+    return this->slots.stats();
+}
+
+uint32_t DescriptorAllocatorPage::numStaleHandles() const
+{
+    std::scoped_lock lock(this->mutex);
+    return this->slots.staleCount();
+}
@@ -0,0 +1,33 @@
+module;
+
+#include <d3d12.h>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+module descriptor_range;
+
+uint32_t DescriptorRange::allocate(uint32_t n)
+{
+    uint32_t index = this->used.load(std::memory_order_relaxed);
+    do {
+        if (index + n > this->capacity) {
+            throw std::bad_alloc();
+        }
+    } while (!this->used.compare_exchange_weak(index, index + n, std::memory_order_relaxed));
+    return index;
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DescriptorRange::cpu(uint32_t index) const
+{
+    assert(index < this->capacity && "Descriptor index out of range");
+    return { this->cpuBase.ptr + static_cast<size_t>(index) * this->descriptorSize };
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE DescriptorRange::gpu(uint32_t index) const
+{
+    assert(index < this->capacity && "Descriptor index out of range");
+    return { this->gpuBase.ptr + static_cast<uint64_t>(index) * this->descriptorSize };
+}
@@ -0,0 +1,188 @@
+module;
+
+#if defined(__clang__)
+    #define FMT_CONSTEVAL
+#endif
+
+#include <d3d12.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <climits>
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <vector>
+
+module dynamic_descriptor_heap;
+
+DynamicDescriptorHeap::DynamicDescriptorHeap(
+    ID3D12Device* device,
+    D3D12_DESCRIPTOR_HEAP_TYPE type
+)
+    : device(device), type(type), descriptorSize(device->GetDescriptorHandleIncrementSize(type))
+{
+}
+
+void DynamicDescriptorHeap::parseRootSignature(const D3D12_ROOT_SIGNATURE_DESC1& desc)
+{
+    std::fill(std::begin(this->tables), std::end(this->tables), Table{});
+    this->tableMask = 0u;
+    this->dirtyMask = 0u;
+    uint32_t nDescriptors = 0u;
+    for (uint32_t i = 0u; i < desc.NumParameters; ++i) {
+        const D3D12_ROOT_PARAMETER1& param = desc.pParameters[i];
+        if (param.ParameterType != D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE) {
+            continue;
+        }
+
+        // Sampler tables go to a sampler heap, everything else to a CBV/SRV/UAV heap
+        const D3D12_ROOT_DESCRIPTOR_TABLE1& table = param.DescriptorTable;
+        const bool samplers = table.NumDescriptorRanges > 0u &&
+            table.pDescriptorRanges[0].RangeType == D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER;
+        if (samplers != (this->type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER)) {
+            continue;
+        }
+        if (i >= maxDescriptorTables) {
+            spdlog::error("Descriptor table at root index {} is out of range", i);
+            throw std::exception();
+        }
+
+        uint32_t count = 0u;
+        for (uint32_t r = 0u; r < table.NumDescriptorRanges; ++r) {
+            const D3D12_DESCRIPTOR_RANGE1& range = table.pDescriptorRanges[r];
+            if (range.NumDescriptors == UINT_MAX) {
+                spdlog::error("Unbounded descriptor table at root index {}", i);
+                throw std::exception();
+            }
+            // Ranges may be placed explicitly, the table spans to the end of the last one
+            const uint32_t start =
+                range.OffsetInDescriptorsFromTableStart == D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND
+                ? count
+                : range.OffsetInDescriptorsFromTableStart;
+            count = std::max(count, start + range.NumDescriptors);
+        }
+
+        this->tables[i] = { nDescriptors, count, 0u };
+        this->tableMask |= 1u << i;
+        nDescriptors += count;
+    }
+
+    this->staged.assign(nDescriptors, {});
+}
+
+void DynamicDescriptorHeap::stageDescriptors(
+    uint32_t rootIndex,
+    uint32_t offset,
+    uint32_t count,
+    D3D12_CPU_DESCRIPTOR_HANDLE src
+)
+{
+    assert(rootIndex < maxDescriptorTables && (this->tableMask >> rootIndex) & 1u);
+    Table& table = this->tables[rootIndex];
+    assert(offset + count <= table.count && "Staged descriptors overrun the table");
+    if (count == 0u) {
+        return;
+    }
+
+    for (uint32_t i = 0u; i < count; ++i) {
+        this->staged[table.offset + offset + i] = {
+            src.ptr + static_cast<size_t>(i) * this->descriptorSize
+        };
+    }
+    table.stagedCount = std::max(table.stagedCount, offset + count);
+    this->dirtyMask |= 1u << rootIndex;
+}
+
+void DynamicDescriptorHeap::commitForDraw(
+    ID3D12GraphicsCommandList* cmdList,
+    DescriptorRange& range
+)
+{
+    this->commit(cmdList, range, &ID3D12GraphicsCommandList::SetGraphicsRootDescriptorTable);
+}
+
+void DynamicDescriptorHeap::commitForDispatch(
+    ID3D12GraphicsCommandList* cmdList,
+    DescriptorRange& range
+)
+{
+    this->commit(cmdList, range, &ID3D12GraphicsCommandList::SetComputeRootDescriptorTable);
+}
+
+void DynamicDescriptorHeap::commit(
+    ID3D12GraphicsCommandList* cmdList,
+    DescriptorRange& range,
+    SetTableFn setTable
+)
+{
+    const uint32_t dirty = this->dirtyMask & this->tableMask;
+    if (dirty == 0u) {
+        return;
+    }
+
+    // Dirty tables are laid out back to back in the frame's range, so the destination is one
+    //  contiguous range and only the sources need to be listed
+    uint32_t total = 0u;
+    for (uint32_t mask = dirty; mask != 0u; mask &= mask - 1u) {
+        total += this->tables[std::countr_zero(mask)].stagedCount;
+    }
+    const uint32_t first = range.allocate(total);
+
+    this->srcStarts.clear();
+    this->srcSizes.clear();
+    for (uint32_t mask = dirty; mask != 0u; mask &= mask - 1u) {
+        const Table& table = this->tables[std::countr_zero(mask)];
+        for (uint32_t i = 0u; i < table.stagedCount; ++i) {
+            const D3D12_CPU_DESCRIPTOR_HANDLE src = this->staged[table.offset + i];
+            assert(src.ptr != 0u && "Descriptor table has unstaged descriptors");
+            // Extend the previous run if this descriptor directly follows it
+            if (!this->srcStarts.empty() &&
+                src.ptr == this->srcStarts.back().ptr +
+                        static_cast<size_t>(this->srcSizes.back()) * this->descriptorSize) {
+                this->srcSizes.back()++;
+            } else {
+                this->srcStarts.push_back(src);
+                this->srcSizes.push_back(1u);
+            }
+        }
+    }
+
+    if (total > 0u) {
+        const D3D12_CPU_DESCRIPTOR_HANDLE dest = range.cpu(first);
+        this->device->CopyDescriptors(
+            1u, &dest, &total, static_cast<UINT>(this->srcStarts.size()), this->srcStarts.data(),
+            this->srcSizes.data(), this->type
+        );
+    }
+
+    uint32_t next = first;
+    for (uint32_t mask = dirty; mask != 0u; mask &= mask - 1u) {
+        const uint32_t rootIndex = std::countr_zero(mask);
+        (cmdList->*setTable)(rootIndex, range.gpu(next));
+        next += this->tables[rootIndex].stagedCount;
+    }
+
+    this->dirtyMask = 0u;
+    this->heapStats.commits++;
+    this->heapStats.tablesCommitted += std::popcount(dirty);
+    this->heapStats.descriptorsCopied += total;
+    this->heapStats.sourceRanges += this->srcStarts.size();
+}
+
+void DynamicDescriptorHeap::reset()
+{
+    this->dirtyMask = 0u;
+    for (uint32_t mask = this->tableMask; mask != 0u; mask &= mask - 1u) {
+        const uint32_t rootIndex = std::countr_zero(mask);
+        if (this->tables[rootIndex].stagedCount > 0u) {
+            this->dirtyMask |= 1u << rootIndex;
+        }
+    }
+}
+
+const DynamicDescriptorHeap::Stats& DynamicDescriptorHeap::stats() const
+{
+    return this->heapStats;
+}
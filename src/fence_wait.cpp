@@ -0,0 +1,126 @@
+module;
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <source_location>
+
+module fence_wait;
+
+double WaitHistogram::Snapshot::percentileUs(double fraction) const
+{
+    if (this->count == 0u) {
+        return 0.0;
+    }
+
+    const uint64_t target = std::max<uint64_t>(
+        1u, static_cast<uint64_t>(fraction * static_cast<double>(this->count))
+    );
+    uint64_t seen = 0u;
+    for (size_t i = 0u; i < nBuckets; i++) {
+        seen += this->buckets[i];
+        if (seen >= target) {
+            return std::min(static_cast<double>(uint64_t(1u) << i), this->maxUs);
+        }
+    }
+    return this->maxUs;
+}
+
+void WaitHistogram::record(const WaitResult& result)
+{
+    const uint64_t us = static_cast<uint64_t>(result.us);
+    const size_t bucket = std::min<size_t>(std::bit_width(us), nBuckets - 1u);
+    this->buckets[bucket].fetch_add(1u, std::memory_order_relaxed);
+    this->phases[static_cast<size_t>(result.phase)].fetch_add(1u, std::memory_order_relaxed);
+    this->count.fetch_add(1u, std::memory_order_relaxed);
+
+    const uint64_t ns = static_cast<uint64_t>(result.us * 1000.0);
+    this->totalNs.fetch_add(ns, std::memory_order_relaxed);
+    uint64_t prevMax = this->maxNs.load(std::memory_order_relaxed);
+    while (ns > prevMax &&
+           !this->maxNs.compare_exchange_weak(prevMax, ns, std::memory_order_relaxed)) {
+    }
+}
+
+WaitHistogram::Snapshot WaitHistogram::snapshot() const
+{
+    Snapshot snap;
+    for (size_t i = 0u; i < nBuckets; i++) {
+        snap.buckets[i] = this->buckets[i].load(std::memory_order_relaxed);
+    }
+    for (size_t i = 0u; i < nPhases; i++) {
+        snap.phases[i] = this->phases[i].load(std::memory_order_relaxed);
+    }
+    snap.count = this->count.load(std::memory_order_relaxed);
+    snap.totalUs = static_cast<double>(this->totalNs.load(std::memory_order_relaxed)) / 1000.0;
+    snap.maxUs = static_cast<double>(this->maxNs.load(std::memory_order_relaxed)) / 1000.0;
+    return snap;
+}
+
+WaitHistogram& WaitSites::at(const std::source_location& location)
+{
+    const char* file = location.file_name();
+    if (WaitHistogram* histogram = this->findIndexed(file, location.line())) {
+        return *histogram;
+    }
+
+    std::scoped_lock lock(this->mutex);
+    WaitHistogram* histogram = nullptr;
+    for (Site& site : this->sites) {
+        if (site.line == location.line() && std::strcmp(site.file, file) == 0) {
+            histogram = site.histogram.get();
+            break;
+        }
+    }
+    if (!histogram) {
+        this->sites.push_back(
+            { file, location.function_name(), location.line(), std::make_unique<WaitHistogram>() }
+        );
+        histogram = this->sites.back().histogram.get();
+    }
+
+    // Publish the key, unless another thread already did. Entries are only added under the
+    //  mutex, so the probe below can't race with another insert.
+    const size_t start = indexSlot(file, location.line());
+    for (size_t i = 0u; i < indexSize; i++) {
+        IndexEntry& entry = this->index[(start + i) & (indexSize - 1u)];
+        if (entry.histogram.load(std::memory_order_relaxed) == nullptr) {
+            entry.file = file;
+            entry.line = location.line();
+            entry.histogram.store(histogram, std::memory_order_release);
+            break;
+        }
+        if (entry.file == file && entry.line == location.line()) {
+            break;
+        }
+    }
+    return *histogram;
+}
+
+size_t WaitSites::indexSlot(const char* file, uint32_t line)
+{
+    const uint64_t key = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(file)) ^
+                         (static_cast<uint64_t>(line) << 32u);
+    return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32u) & (indexSize - 1u);
+}
+
+WaitHistogram* WaitSites::findIndexed(const char* file, uint32_t line) const
+{
+    const size_t start = indexSlot(file, line);
+    for (size_t i = 0u; i < indexSize; i++) {
+        const IndexEntry& entry = this->index[(start + i) & (indexSize - 1u)];
+        WaitHistogram* histogram = entry.histogram.load(std::memory_order_acquire);
+        if (!histogram) {
+            return nullptr;
+        }
+        if (entry.file == file && entry.line == line) {
+            return histogram;
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,100 @@
+module;
+
+#if defined(__clang__)
+    #define FMT_CONSTEVAL
+#endif
+
+#include <algorithm>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <spdlog/spdlog.h>
+
+module fence_watcher;
+
+FenceWatcher::FenceWatcher(std::unique_ptr<WatchedFence> fence) : fence(std::move(fence))
+{
+    this->thread = std::thread([this]() { this->watch(); });
+}
+
+FenceWatcher::~FenceWatcher()
+{
+    {
+        std::scoped_lock lock(this->mutex);
+        this->stopping = true;
+    }
+    this->fence->wake();
+    this->thread.join();
+
+    // Nothing will reach these fence values anymore. Resume the waiters with an error so
+    //  their coroutines unwind, running their destructors and whatever awaits them, rather
+    //  than leaking their frames. The scheduler may already be gone, so resume them here.
+    std::vector<Waiter> pending = std::move(this->waiters);
+    for (const Waiter& w : pending) {
+        *w.cancelled = true;
+        w.handle.resume();
+    }
+}
+
+bool FenceWatcher::isComplete(uint64_t fenceValue) const
+{
+    return this->fence->completedValue() >= fenceValue;
+}
+
+void FenceWatcher::add(
+    uint64_t fenceValue,
+    std::coroutine_handle<> h,
+    Scheduler* scheduler,
+    bool* cancelled
+)
+{
+    {
+        std::scoped_lock lock(this->mutex);
+        this->waiters.push_back({ fenceValue, h, scheduler, cancelled });
+    }
+    this->fence->armEvent(fenceValue);
+}
+
+void FenceWatcher::watch()
+{
+    while (true) {
+        this->fence->waitForSignal();
+
+        {
+            std::scoped_lock lock(this->mutex);
+            if (this->stopping) {
+                return;
+            }
+            const uint64_t completedValue = this->fence->completedValue();
+            auto done = std::partition(
+                this->waiters.begin(), this->waiters.end(),
+                [&](const Waiter& w) { return w.fenceValue > completedValue; }
+            );
+            this->completed.assign(done, this->waiters.end());
+            this->waiters.erase(done, this->waiters.end());
+        }
+
+        for (const Waiter& w : this->completed) {
+            w.scheduler->post(w.handle);
+        }
+        this->completed.clear();
+    }
+}
+
+void FenceAwaiter::await_suspend(std::coroutine_handle<> h)
+{
+    this->watcher->add(this->fenceValue, h, this->scheduler, &this->cancelled);
+}
+
+void FenceAwaiter::await_resume() const
+{
+    if (this->cancelled) {
+        spdlog::error("Fence watcher destroyed while waiting for fence value {}", this->fenceValue);
+        throw std::exception();
+    }
+}
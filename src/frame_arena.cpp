@@ -0,0 +1,149 @@
+module;
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+module frame_arena;
+
+#if defined(_DEBUG)
+static constexpr bool poisonFreedMemory = true;
+#else
+static constexpr bool poisonFreedMemory = false;
+#endif
+static constexpr unsigned char freedPattern = 0xDD;
+
+// Round value up to a multiple of alignment, which must be a power of two
+static size_t alignUp(size_t value, size_t alignment)
+{
+    assert(std::has_single_bit(alignment) && "Alignment must be a power of 2");
+    return (value + alignment - 1u) & ~(alignment - 1u);
+}
+
+LinearArena::LinearArena(size_t blockSize)
+    : blockSize(std::bit_ceil(std::max<size_t>(blockSize, 64u)))
+{
+    this->addBlock(this->blockSize);
+}
+
+void* LinearArena::do_allocate(size_t bytes, size_t alignment)
+{
+    Block* block = &this->blocks.back();
+    const uintptr_t base = reinterpret_cast<uintptr_t>(block->data.get());
+    size_t start = alignUp(base + this->offset, alignment) - base;
+    if (start + bytes > block->size) {
+        // Enough for the request at any alignment, the chain is collapsed at the next reset
+        this->usedBefore += this->offset;
+        this->addBlock(std::max(this->blockSize, bytes + alignment));
+        block = &this->blocks.back();
+        start = alignUp(reinterpret_cast<uintptr_t>(block->data.get()), alignment) -
+            reinterpret_cast<uintptr_t>(block->data.get());
+    }
+    this->offset = start + bytes;
+
+    this->arenaStats.allocations++;
+    this->arenaStats.usedBytes = this->usedBefore + this->offset;
+    this->arenaStats.peakBytes = std::max(this->arenaStats.peakBytes, this->arenaStats.usedBytes);
+    return block->data.get() + start;
+}
+
+void LinearArena::do_deallocate(void* p, size_t bytes, size_t)
+{
+    if constexpr (poisonFreedMemory) {
+        std::memset(p, freedPattern, bytes);
+    }
+}
+
+bool LinearArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+void LinearArena::reset()
+{
+    if constexpr (poisonFreedMemory) {
+        for (size_t i = 0u; i + 1u < this->blocks.size(); ++i) {
+            std::memset(this->blocks[i].data.get(), freedPattern, this->blocks[i].size);
+        }
+        std::memset(this->blocks.back().data.get(), freedPattern, this->offset);
+    }
+
+    // This frame needed more than one block, size the next frame's single block to fit it
+    if (this->blocks.size() > 1u) {
+        size_t total = 0u;
+        for (const Block& block : this->blocks) {
+            total += block.size;
+        }
+        this->blocks.clear();
+        this->addBlock(total);
+    }
+    this->offset = 0u;
+    this->usedBefore = 0u;
+    this->arenaStats.usedBytes = 0u;
+    this->arenaStats.resets++;
+}
+
+LinearArena::Stats LinearArena::stats() const
+{
+    return this->arenaStats;
+}
+
+void LinearArena::addBlock(size_t minSize)
+{
+    const size_t size = alignUp(minSize, this->blockSize);
+    this->blocks.push_back({ std::make_unique_for_overwrite<std::byte[]>(size), size });
+    this->offset = 0u;
+    this->arenaStats.capacity = 0u;
+    for (const Block& block : this->blocks) {
+        this->arenaStats.capacity += block.size;
+    }
+    this->arenaStats.blocksCreated++;
+}
+
+FrameArena::FrameArena(uint32_t nThreads, size_t blockSize)
+    : frameArena(std::make_unique<LinearArena>(blockSize))
+{
+    for (uint32_t i = 0u; i < std::max(nThreads, 1u); ++i) {
+        this->threadArenas.push_back(std::make_unique<LinearArena>(blockSize));
+    }
+}
+
+LinearArena& FrameArena::frame()
+{
+    return *this->frameArena;
+}
+
+LinearArena& FrameArena::thread(uint32_t threadSlot)
+{
+    assert(threadSlot < this->threadArenas.size() && "Thread slot out of range");
+    return *this->threadArenas[threadSlot];
+}
+
+void FrameArena::reset()
+{
+    this->frameArena->reset();
+    for (auto& arena : this->threadArenas) {
+        arena->reset();
+    }
+}
+
+LinearArena::Stats FrameArena::stats() const
+{
+    LinearArena::Stats total = this->frameArena->stats();
+    for (const auto& arena : this->threadArenas) {
+        const LinearArena::Stats s = arena->stats();
+        total.usedBytes += s.usedBytes;
+        total.peakBytes += s.peakBytes;
+        total.capacity += s.capacity;
+        total.allocations += s.allocations;
+        total.blocksCreated += s.blocksCreated;
+        total.resets += s.resets;
+    }
+    return total;
+}
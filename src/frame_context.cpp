@@ -0,0 +1,92 @@
+module;
+
+#include <d3d12.h>
+#include <wrl.h>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+
+module frame_context;
+
+FrameRing::FrameRing(
+    uint32_t framesInFlight,
+    ComPtr<ID3D12DescriptorHeap> descHeap,
+    uint32_t descPerFrame,
+    uint32_t descSize,
+    uint32_t recordThreads
+)
+    : slots(framesInFlight)
+{
+    framesInFlight = this->slots.size();
+    assert(descHeap->GetDesc().NumDescriptors >= framesInFlight * descPerFrame);
+
+    const D3D12_CPU_DESCRIPTOR_HANDLE cpuStart = descHeap->GetCPUDescriptorHandleForHeapStart();
+    const D3D12_GPU_DESCRIPTOR_HANDLE gpuStart = descHeap->GetGPUDescriptorHandleForHeapStart();
+    this->frames.reserve(framesInFlight);
+    for (uint32_t i = 0u; i < framesInFlight; ++i) {
+        auto frame = std::make_unique<FrameContext>();
+        const size_t offset = static_cast<size_t>(i) * descPerFrame * descSize;
+        frame->descriptors.cpuBase = { cpuStart.ptr + offset };
+        frame->descriptors.gpuBase = { gpuStart.ptr + offset };
+        frame->descriptors.descriptorSize = descSize;
+        frame->descriptors.capacity = descPerFrame;
+        this->frames.push_back(std::move(frame));
+    }
+    this->threadUploadPages = std::make_unique<ParallelUploadBuffer>(recordThreads);
+}
+
+FrameContext& FrameRing::begin(CommandQueue& queue)
+{
+    // The GPU is done with everything this slot handed out last time around, and possibly with
+    //  upload memory of newer frames too
+    const uint64_t completedValue = this->slots.begin(queue);
+    FrameContext& frame = this->current();
+    frame.frameNumber = this->slots.frameNumber();
+    this->threadUploadPages->retire(completedValue);
+    frame.descriptors.used = 0u;
+
+    return frame;
+}
+
+void FrameRing::addWaitTime(double ms)
+{
+    this->slots.addWaitTime(ms);
+}
+
+void FrameRing::end(uint64_t fenceValue)
+{
+    this->threadUploadPages->commit(fenceValue);
+    this->slots.end(fenceValue);
+}
+
+FrameContext& FrameRing::current()
+{
+    return *this->frames[this->slots.currentSlot()];
+}
+
+uint64_t FrameRing::pendingFence() const
+{
+    return this->slots.pendingFence();
+}
+
+ParallelUploadBuffer& FrameRing::threadUploads()
+{
+    return *this->threadUploadPages;
+}
+
+uint32_t FrameRing::size() const
+{
+    return this->slots.size();
+}
+
+uint64_t FrameRing::frameNumber() const
+{
+    return this->slots.frameNumber();
+}
+
+const FrameRing::Stats& FrameRing::stats() const
+{
+    return this->slots.stats();
+}
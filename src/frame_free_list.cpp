@@ -0,0 +1,79 @@
+module;
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+module frame_free_list;
+
+FrameFreeList::FrameFreeList(uint32_t capacity) : freeList(capacity)
+{
+    this->singles.reserve(maxCachedSingles);
+}
+
+uint32_t FrameFreeList::allocate(uint32_t count)
+{
+    if (count == 1u && !this->singles.empty()) {
+        const uint32_t offset = this->singles.back();
+        this->singles.pop_back();
+        return offset;
+    }
+
+    uint32_t offset = this->freeList.allocate(count);
+    if (offset == invalidOffset && !this->singles.empty()) {
+        // Cached singles may be what's keeping a large enough block apart
+        this->flushSingles();
+        offset = this->freeList.allocate(count);
+    }
+    return offset;
+}
+
+void FrameFreeList::free(uint32_t offset, uint32_t count, uint64_t frameNumber)
+{
+    this->stale.push_back({ offset, count, frameNumber });
+    this->nStale += count;
+}
+
+void FrameFreeList::releaseStale(uint64_t frameNumber)
+{
+    while (!this->stale.empty() && this->stale.front().frameNumber <= frameNumber) {
+        const StaleBlock& block = this->stale.front();
+        if (block.count == 1u && this->singles.size() < maxCachedSingles) {
+            this->singles.push_back(block.offset);
+        } else {
+            this->freeList.free(block.offset, block.count);
+        }
+        this->nStale -= block.count;
+        this->stale.pop_front();
+    }
+}
+
+uint32_t FrameFreeList::freeCount() const
+{
+    return this->freeList.freeCount() + static_cast<uint32_t>(this->singles.size());
+}
+
+uint32_t FrameFreeList::staleCount() const
+{
+    return this->nStale;
+}
+
+FreeList::Stats FrameFreeList::stats() const
+{
+    FreeList::Stats stats = this->freeList.stats();
+    stats.freeCount += static_cast<uint32_t>(this->singles.size());
+    stats.freeBlocks += static_cast<uint32_t>(this->singles.size());
+    if (!this->singles.empty()) {
+        stats.largestFreeBlock = std::max(stats.largestFreeBlock, 1u);
+    }
+    return stats;
+}
+
+void FrameFreeList::flushSingles()
+{
+    for (uint32_t offset : this->singles) {
+        this->freeList.free(offset, 1u);
+    }
+    this->singles.clear();
+}
@@ -0,0 +1,51 @@
+module;
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+module frame_slots;
+
+FrameSlots::FrameSlots(uint32_t framesInFlight) : fenceValues(std::max(1u, framesInFlight), 0u) {}
+
+void FrameSlots::addWaitTime(double ms)
+{
+    this->frameStats.blockedFrames++;
+    this->frameStats.blockedMs += ms;
+    this->frameStats.maxBlockedMs = std::max(this->frameStats.maxBlockedMs, ms);
+}
+
+void FrameSlots::end(uint64_t fenceValue)
+{
+    assert(fenceValue >= this->lastFenceValue && "Frame fence values went backwards");
+    this->lastFenceValue = fenceValue;
+    this->fenceValues[this->currentSlot()] = fenceValue;
+    this->frameIndex++;
+    this->frameStats.frames++;
+}
+
+uint32_t FrameSlots::currentSlot() const
+{
+    return static_cast<uint32_t>(this->frameIndex % this->fenceValues.size());
+}
+
+uint64_t FrameSlots::pendingFence() const
+{
+    return this->fenceValues[this->currentSlot()];
+}
+
+uint32_t FrameSlots::size() const
+{
+    return static_cast<uint32_t>(this->fenceValues.size());
+}
+
+uint64_t FrameSlots::frameNumber() const
+{
+    return this->frameIndex;
+}
+
+const FrameSlots::Stats& FrameSlots::stats() const
+{
+    return this->frameStats;
+}
@@ -0,0 +1,90 @@
+module;
+
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <map>
+
+module free_list;
+
+FreeList::FreeList(uint32_t capacity) : size(capacity), nFree(capacity)
+{
+    if (capacity > 0u) {
+        this->addBlock(0u, capacity);
+    }
+}
+
+uint32_t FreeList::allocate(uint32_t count)
+{
+    auto sizeIt = this->bySize.lower_bound(count);
+    if (count == 0u || sizeIt == this->bySize.end()) {
+        return invalidOffset;
+    }
+
+    const uint32_t blockSize = sizeIt->first;
+    const uint32_t offset = sizeIt->second;
+    this->byOffset.erase(offset);
+    this->bySize.erase(sizeIt);
+
+    if (blockSize > count) {
+        this->addBlock(offset + count, blockSize - count);
+    }
+    this->nFree -= count;
+    return offset;
+}
+
+void FreeList::free(uint32_t offset, uint32_t count)
+{
+    assert(offset + count <= this->size && "Block out of range");
+
+    // First free block after this one, and the one before it if any
+    auto nextIt = this->byOffset.upper_bound(offset);
+    auto prevIt = nextIt == this->byOffset.begin() ? this->byOffset.end() : std::prev(nextIt);
+
+    assert(
+        (prevIt == this->byOffset.end() || prevIt->first + prevIt->second->first <= offset) &&
+        (nextIt == this->byOffset.end() || offset + count <= nextIt->first) &&
+        "Freed block overlaps a free block"
+    );
+
+    this->nFree += count;
+
+    if (prevIt != this->byOffset.end() && prevIt->first + prevIt->second->first == offset) {
+        offset = prevIt->first;
+        count += prevIt->second->first;
+        this->bySize.erase(prevIt->second);
+        this->byOffset.erase(prevIt);
+    }
+    if (nextIt != this->byOffset.end() && offset + count == nextIt->first) {
+        count += nextIt->second->first;
+        this->bySize.erase(nextIt->second);
+        this->byOffset.erase(nextIt);
+    }
+    this->addBlock(offset, count);
+}
+
+uint32_t FreeList::capacity() const
+{
+    return this->size;
+}
+
+uint32_t FreeList::freeCount() const
+{
+    return this->nFree;
+}
+
+FreeList::Stats FreeList::stats() const
+{
+    Stats stats;
+    stats.capacity = this->size;
+    stats.freeCount = this->nFree;
+    stats.freeBlocks = static_cast<uint32_t>(this->byOffset.size());
+    stats.largestFreeBlock = this->bySize.empty() ? 0u : std::prev(this->bySize.end())->first;
+    return stats;
+}
+
+void FreeList::addBlock(uint32_t offset, uint32_t count)
+{
+    auto sizeIt = this->bySize.emplace(count, offset);
+    this->byOffset.emplace(offset, sizeIt);
+}
@@ -0,0 +1,349 @@
+module;
+
+#include <d3d12.h>
+#include <wrl.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "d3dx12.h"
+
+module gpu_heap_allocator;
+
+GpuAllocation::~GpuAllocation()
+{
+    this->free();
+}
+
+GpuAllocation::GpuAllocation(GpuAllocation&& other) noexcept
+    : placed(std::move(other.placed)),
+      owner(std::exchange(other.owner, nullptr)),
+      pool(other.pool),
+      heap(other.heap),
+      block(std::exchange(other.block, TlsfAllocator::invalidHandle)),
+      size(std::exchange(other.size, 0u))
+{
+    if (this->owner) {
+        this->owner->setOwner(*this, this);
+    }
+}
+
+GpuAllocation& GpuAllocation::operator=(GpuAllocation&& other) noexcept
+{
+    if (this != &other) {
+        this->free();
+        this->placed = std::move(other.placed);
+        this->owner = std::exchange(other.owner, nullptr);
+        this->pool = other.pool;
+        this->heap = other.heap;
+        this->block = std::exchange(other.block, TlsfAllocator::invalidHandle);
+        this->size = std::exchange(other.size, 0u);
+        if (this->owner) {
+            this->owner->setOwner(*this, this);
+        }
+    }
+    return *this;
+}
+
+bool GpuAllocation::isNull() const
+{
+    return this->placed == nullptr;
+}
+
+ID3D12Resource* GpuAllocation::get() const
+{
+    return this->placed.Get();
+}
+
+const ComPtr<ID3D12Resource>& GpuAllocation::resource() const
+{
+    return this->placed;
+}
+
+uint64_t GpuAllocation::sizeInBytes() const
+{
+    return this->size;
+}
+
+void GpuAllocation::free()
+{
+    if (this->owner) {
+        this->owner->free(*this);
+        this->owner = nullptr;
+        this->block = TlsfAllocator::invalidHandle;
+        this->size = 0u;
+    }
+    this->placed.Reset();
+}
+
+GpuHeapAllocator::GpuHeapAllocator(ComPtr<ID3D12Device2> device, uint64_t heapSize)
+    : device(device), heapSize(heapSize)
+{
+}
+
+GpuAllocation GpuHeapAllocator::createResource(
+    const D3D12_RESOURCE_DESC& desc,
+    D3D12_HEAP_TYPE heapType,
+    D3D12_RESOURCE_STATES initialState,
+    const D3D12_CLEAR_VALUE* clearValue
+)
+{
+    Category category = Category::Textures;
+    if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER) {
+        category = Category::Buffers;
+    } else if (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET |
+                             D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) {
+        category = Category::RenderTargets;
+    }
+
+    // Small textures can be placed at 4KB instead of 64KB if the device agrees
+    D3D12_RESOURCE_DESC placedDesc = desc;
+    D3D12_RESOURCE_ALLOCATION_INFO info = {};
+    if (category == Category::Textures && desc.SampleDesc.Count <= 1u) {
+        placedDesc.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+        info = this->device->GetResourceAllocationInfo(0, 1, &placedDesc);
+    }
+    if (info.Alignment != D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT) {
+        placedDesc.Alignment = 0u;
+        info = this->device->GetResourceAllocationInfo(0, 1, &placedDesc);
+    }
+    if (info.SizeInBytes == UINT64_MAX) {
+        spdlog::error("Invalid resource description for a placed resource");
+        throw std::exception();
+    }
+
+    GpuAllocation allocation;
+    {
+        std::scoped_lock lock(this->mutex);
+        const uint32_t poolIndex = this->findPool(heapType, category);
+        Pool& pool = this->pools[poolIndex];
+
+        uint32_t heapIndex = 0u;
+        TlsfAllocator::Handle block = TlsfAllocator::invalidHandle;
+        for (; heapIndex < pool.heaps.size(); ++heapIndex) {
+            const auto& heap = pool.heaps[heapIndex];
+            if (heap && !heap->dedicated) {
+                block = heap->ranges.allocate(info.SizeInBytes, info.Alignment);
+                if (block != TlsfAllocator::invalidHandle) {
+                    break;
+                }
+            }
+        }
+        if (block == TlsfAllocator::invalidHandle) {
+            // Resources a fresh heap couldn't hold get a heap of their own, freed along with
+            //  them. The TLSF search pads for alignment, so that's sized by what it asks for
+            //  rather than by the resource.
+            const uint64_t needed = TlsfAllocator::capacityFor(
+                info.SizeInBytes, info.Alignment, placementGranularity(category)
+            );
+            const bool dedicated = needed > this->heapSize;
+            heapIndex = this->createHeap(pool, dedicated ? needed : this->heapSize, dedicated);
+            block = pool.heaps[heapIndex]->ranges.allocate(info.SizeInBytes, info.Alignment);
+            if (block == TlsfAllocator::invalidHandle) {
+                pool.heaps[heapIndex].reset();
+                spdlog::error(
+                    "Failed to place {} bytes aligned to {} in a new heap", info.SizeInBytes,
+                    info.Alignment
+                );
+                throw std::exception();
+            }
+        }
+
+        Heap& heap = *pool.heaps[heapIndex];
+        const HRESULT hr = this->device->CreatePlacedResource(
+            heap.heap.Get(), heap.ranges.offset(block), &placedDesc, initialState, clearValue,
+            IID_PPV_ARGS(&allocation.placed)
+        );
+        if (FAILED(hr)) {
+            heap.ranges.free(block);
+            chkDX(hr);
+        }
+
+        if (heap.owners.size() <= block) {
+            heap.owners.resize(block + 1u, nullptr);
+        }
+        heap.owners[block] = &allocation;
+        allocation.owner = this;
+        allocation.pool = poolIndex;
+        allocation.heap = heapIndex;
+        allocation.block = block;
+        allocation.size = heap.ranges.size(block);
+    }
+    return allocation;
+}
+
+uint32_t GpuHeapAllocator::findPool(D3D12_HEAP_TYPE heapType, Category category)
+{
+    for (uint32_t i = 0u; i < this->pools.size(); ++i) {
+        if (this->pools[i].heapType == heapType && this->pools[i].category == category) {
+            return i;
+        }
+    }
+    this->pools.push_back({ heapType, category, {} });
+    return static_cast<uint32_t>(this->pools.size() - 1u);
+}
+
+uint64_t GpuHeapAllocator::placementGranularity(Category category)
+{
+    // Only textures that aren't targets can be placed at 4KB
+    return category == Category::Textures ? D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT
+                                          : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+}
+
+uint32_t GpuHeapAllocator::createHeap(Pool& pool, uint64_t size, bool dedicated)
+{
+    D3D12_HEAP_FLAGS flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+    uint64_t alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    if (pool.category == Category::Textures) {
+        flags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+    } else if (pool.category == Category::RenderTargets) {
+        // MSAA targets need the heap itself aligned to 4MB
+        flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+        alignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+    }
+    // Heap sizes should be a multiple of their alignment
+    size = (size + alignment - 1u) & ~(alignment - 1u);
+
+    auto heap = std::make_unique<Heap>();
+    const CD3DX12_HEAP_DESC heapDesc(size, pool.heapType, alignment, flags);
+    chkDX(this->device->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap->heap)));
+    heap->ranges = TlsfAllocator(size, placementGranularity(pool.category));
+    heap->dedicated = dedicated;
+
+    // Reuse the slot of a released heap, allocations refer to heaps by index
+    auto slot = std::find(pool.heaps.begin(), pool.heaps.end(), nullptr);
+    if (slot == pool.heaps.end()) {
+        pool.heaps.push_back(std::move(heap));
+        return static_cast<uint32_t>(pool.heaps.size() - 1u);
+    }
+    *slot = std::move(heap);
+    return static_cast<uint32_t>(slot - pool.heaps.begin());
+}
+
+ComPtr<ID3D12Heap> GpuHeapAllocator::heapOf(const GpuAllocation& allocation)
+{
+    std::scoped_lock lock(this->mutex);
+    return this->pools[allocation.pool].heaps[allocation.heap]->heap;
+}
+
+void GpuHeapAllocator::setOwner(const GpuAllocation& allocation, GpuAllocation* owner)
+{
+    std::scoped_lock lock(this->mutex);
+    this->pools[allocation.pool].heaps[allocation.heap]->owners[allocation.block] = owner;
+}
+
+void GpuHeapAllocator::free(GpuAllocation& allocation)
+{
+    std::scoped_lock lock(this->mutex);
+    // The resource has to go before its memory can be handed out again
+    allocation.placed.Reset();
+
+    Pool& pool = this->pools[allocation.pool];
+    Heap& heap = *pool.heaps[allocation.heap];
+    heap.owners[allocation.block] = nullptr;
+    heap.ranges.free(allocation.block);
+
+    // Drop a planned move of this allocation along with its destination
+    auto move = std::find_if(
+        this->pendingMoves.begin(), this->pendingMoves.end(),
+        [&](const PendingMove& m) {
+            return m.pool == allocation.pool && m.heap == allocation.heap &&
+                m.src == allocation.block;
+        }
+    );
+    if (move != this->pendingMoves.end()) {
+        move->resource.Reset();
+        heap.ranges.free(move->dst);
+        this->pendingMoves.erase(move);
+    }
+
+    // Keep one regular heap per pool around, release the rest once empty
+    if (heap.ranges.empty()) {
+        const bool otherHeaps = std::any_of(pool.heaps.begin(), pool.heaps.end(), [&](auto& h) {
+            return h && h.get() != &heap && !h->dedicated;
+        });
+        if (heap.dedicated || otherHeaps) {
+            pool.heaps[allocation.heap].reset();
+        }
+    }
+}
+
+std::vector<GpuHeapAllocator::DefragMove> GpuHeapAllocator::beginDefragment(
+    D3D12_HEAP_TYPE heapType,
+    uint32_t maxMoves,
+    D3D12_RESOURCE_STATES state
+)
+{
+    std::scoped_lock lock(this->mutex);
+    assert(this->pendingMoves.empty() && "Previous defragmentation wasn't ended");
+
+    std::vector<DefragMove> moves;
+    for (uint32_t poolIndex = 0u; poolIndex < this->pools.size(); ++poolIndex) {
+        Pool& pool = this->pools[poolIndex];
+        if (pool.heapType != heapType) {
+            continue;
+        }
+        for (uint32_t heapIndex = 0u; heapIndex < pool.heaps.size(); ++heapIndex) {
+            Heap* heap = pool.heaps[heapIndex].get();
+            if (!heap || heap->dedicated) {
+                continue;
+            }
+            for (const TlsfAllocator::Move& m : heap->ranges.beginDefragment(maxMoves)) {
+                if (heap->owners.size() <= m.dst) {
+                    heap->owners.resize(m.dst + 1u, nullptr);
+                }
+                ID3D12Resource* src = heap->owners[m.src]->placed.Get();
+                const D3D12_RESOURCE_DESC desc = src->GetDesc();
+                ComPtr<ID3D12Resource> dst;
+                chkDX(this->device->CreatePlacedResource(
+                    heap->heap.Get(), heap->ranges.offset(m.dst), &desc, state, nullptr,
+                    IID_PPV_ARGS(&dst)
+                ));
+                this->pendingMoves.push_back({ poolIndex, heapIndex, m.src, m.dst, dst });
+                moves.push_back({ src, dst });
+            }
+        }
+    }
+    return moves;
+}
+
+void GpuHeapAllocator::endDefragment()
+{
+    std::scoped_lock lock(this->mutex);
+    for (PendingMove& m : this->pendingMoves) {
+        Heap& heap = *this->pools[m.pool].heaps[m.heap];
+        GpuAllocation* allocation = heap.owners[m.src];
+        allocation->placed = std::move(m.resource);
+        allocation->block = m.dst;
+        heap.owners[m.dst] = allocation;
+        heap.owners[m.src] = nullptr;
+        heap.ranges.free(m.src);
+    }
+    this->pendingMoves.clear();
+}
+
+GpuHeapAllocator::Stats GpuHeapAllocator::stats()
+{
+    std::scoped_lock lock(this->mutex);
+    Stats s;
+    for (const Pool& pool : this->pools) {
+        for (const auto& heap : pool.heaps) {
+            if (!heap) {
+                continue;
+            }
+            const TlsfAllocator::Stats rangeStats = heap->ranges.stats();
+            s.heaps++;
+            s.heapBytes += rangeStats.capacity;
+            s.usedBytes += rangeStats.usedBytes;
+            s.allocations += rangeStats.allocations;
+            s.freeBlocks += rangeStats.freeBlocks;
+            s.largestFreeBlock = std::max(s.largestFreeBlock, rangeStats.largestFreeBlock);
+        }
+    }
+    return s;
+}
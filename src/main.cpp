@@ -6,6 +6,7 @@
 #include <gainput/gainput.h>
 #include <shellapi.h>
 #include <objbase.h>
+#include <algorithm>
 #include <spdlog/spdlog.h>
 
 import application;
@@ -30,12 +31,18 @@ _Use_decl_annotations_ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR,
     spdlog::info("Command line: {}", GetCommandLineA());
     bool useWarp = false;
     bool testMode = false;
+    uint32_t recordThreads = 1u;
+    uint32_t framesInFlight = 2u;
     if (argv) {
         for (int i = 0; i < argc; ++i) {
             if (wcscmp(argv[i], L"--test") == 0) {
                 testMode = true;
                 useWarp = true;  // Use WARP in test mode for headless environments
                 spdlog::info("Running in test mode");
+            } else if (wcscmp(argv[i], L"--record-threads") == 0 && i + 1 < argc) {
+                recordThreads = static_cast<uint32_t>(std::max(1, _wtoi(argv[++i])));
+            } else if (wcscmp(argv[i], L"--frames-in-flight") == 0 && i + 1 < argc) {
+                framesInFlight = static_cast<uint32_t>(std::max(1, _wtoi(argv[++i])));
             }
         }
         LocalFree(argv);
@@ -45,7 +52,7 @@ _Use_decl_annotations_ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR,
         spdlog::info("Initializing window...");
         Window::get()->initialize(hInstance, "D3D12 Experiment", 1280, 720, nCmdShow, useWarp);
         spdlog::info("Creating Application...");
-        Application app;
+        Application app(recordThreads, framesInFlight);
         app.testMode = testMode;
         spdlog::info("Application created.");
 
@@ -72,6 +79,14 @@ _Use_decl_annotations_ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR,
                     break;
                 }
 
+                // Sleep until there's a message or the frame on the scheduler has submitted
+                if (app.frameBusy.load()) {
+                    ::MsgWaitForMultipleObjects(
+                        1, &app.frameIdleEvent, FALSE, INFINITE, QS_ALLINPUT
+                    );
+                    continue;
+                }
+
                 inputManager.Update();
                 app.update();
                 app.render();
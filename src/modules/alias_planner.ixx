@@ -0,0 +1,93 @@
+module;
+
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+export module alias_planner;
+
+// Places resources that only live for part of a frame so that resources whose lifetimes don't
+//  overlap share memory. Lifetimes are inclusive ranges of pass positions. Each heap group
+//  (resources allowed in the same heap) is packed into one heap by coloring its interval
+//  graph: taken in order of first use, a resource goes into a slot whose last occupant is
+//  dead by then, the smallest one it fits in or else the largest one, grown to fit. A new slot
+//  is only opened when every slot is live, so a group never has more slots than resources live
+//  at once. Slots are laid out back to back once their sizes are known.
+export class AliasPlanner
+{
+   public:
+    static constexpr uint32_t none = UINT32_MAX;
+
+    struct Request
+    {
+        uint64_t size;
+        uint64_t alignment;
+        uint32_t group;
+        uint32_t firstUse;
+        uint32_t lastUse;
+    };
+
+    struct Placement
+    {
+        uint32_t heap = none;
+        uint64_t offset = 0u;
+        // Request that last occupied the memory, which needs an aliasing barrier before this
+        //  one's first use
+        uint32_t previous = none;
+    };
+
+    struct Heap
+    {
+        uint32_t group;
+        uint64_t size;
+        uint64_t alignment;
+    };
+
+    struct Stats
+    {
+        uint32_t requests = 0u;
+        uint32_t slots = 0u;
+        // Requests placed in memory another request used before them
+        uint32_t aliased = 0u;
+        // Sum of aligned request sizes, what every request in its own memory would take
+        uint64_t requestedBytes = 0u;
+        uint64_t heapBytes = 0u;
+        // Largest sum of live request sizes at any position, per group, the least any
+        //  placement could use
+        uint64_t peakLiveBytes = 0u;
+    };
+
+    explicit AliasPlanner(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    uint32_t add(const Request& request);
+    void plan();
+    // Forget every request, keeping allocated capacity
+    void clear();
+
+    std::span<const Heap> heaps() const;
+    const Placement& placement(uint32_t request) const;
+    Stats stats() const;
+
+   private:
+    struct Slot
+    {
+        uint32_t group;
+        uint64_t size;
+        uint64_t alignment;
+        uint32_t occupant;
+        uint64_t offset;
+    };
+
+    std::pmr::memory_resource* memory;
+    std::pmr::vector<Request> requests;
+    std::pmr::vector<Placement> placements;
+    // Slot each request went into
+    std::pmr::vector<uint32_t> requestSlots;
+    std::pmr::vector<Slot> slots;
+    std::pmr::vector<Heap> planned;
+    Stats plannerStats;
+
+    // Peak live bytes of one group's requests
+    uint64_t peakLive(std::span<const uint32_t> run) const;
+};
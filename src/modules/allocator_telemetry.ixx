@@ -0,0 +1,88 @@
+module;
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+
+export module allocator_telemetry;
+
+// Usage statistics of one allocator. The hot path only counts allocations and their sizes,
+//  with relaxed atomics in per-thread counter blocks, so threads allocating at once neither
+//  share a cache line nor need locked instructions. Once a frame, the owning allocator calls
+//  sample() with what it currently holds (live and reserved amounts, pages, largest free
+//  block), which also folds the counters into a snapshot kept in a short history. Amounts are
+//  in the allocator's unit, bytes or descriptors.
+export class AllocatorTelemetry
+{
+   public:
+    // Bucket i counts allocations of (2^(i-1), 2^i] units, the last one everything larger
+    static constexpr uint32_t histogramBuckets = 32u;
+    static constexpr uint32_t maxThreadSlots = 32u;
+    static constexpr size_t historyLength = 256u;
+
+    // What the allocator holds at the time of a sample
+    struct Gauges
+    {
+        uint64_t live = 0u;
+        uint64_t reserved = 0u;
+        uint64_t largestFreeBlock = 0u;
+        uint32_t pages = 0u;
+    };
+
+    struct Sample
+    {
+        uint64_t frame = 0u;
+        Gauges gauges;
+        uint64_t allocations = 0u;
+        uint64_t allocatedAmount = 0u;
+    };
+
+    struct Snapshot
+    {
+        Sample latest;
+        uint64_t peakLive = 0u;
+        uint64_t allocations = 0u;
+        uint64_t allocatedAmount = 0u;
+        std::array<uint64_t, histogramBuckets> histogram = {};
+
+        // Share of the unused reserved space outside the largest free block
+        double fragmentation() const;
+    };
+
+    AllocatorTelemetry(std::string name, std::string unit);
+    AllocatorTelemetry(const AllocatorTelemetry&) = delete;
+    AllocatorTelemetry& operator=(const AllocatorTelemetry&) = delete;
+
+    void recordAllocation(uint64_t amount);
+    // Fold the counters into a new snapshot for this frame
+    void sample(uint64_t frame, const Gauges& gauges);
+
+    const std::string& name() const;
+    Snapshot snapshot() const;
+    // Latest snapshot plus the sample history as one JSON object
+    std::string json() const;
+
+   private:
+    struct alignas(64) ThreadCounters
+    {
+        std::atomic<uint64_t> allocations = 0u;
+        std::atomic<uint64_t> allocatedAmount = 0u;
+        std::array<std::atomic<uint64_t>, histogramBuckets> histogram = {};
+    };
+
+    const std::string allocatorName;
+    const std::string unit;
+    std::unique_ptr<ThreadCounters[]> counters;
+
+    mutable std::mutex sampleMutex;
+    Snapshot current;
+    std::deque<Sample> history;
+};
+
+// JSON array of several allocators' telemetry
+export std::string allocatorTelemetryJson(std::span<const AllocatorTelemetry* const> allocators);
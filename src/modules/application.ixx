@@ -7,13 +7,29 @@ module;
 #include <wrl.h>
 #include "d3dx12.h"
 #include <gainput/gainput.h>
+#include <atomic>
+#include <memory>
+#include <string>
 #include <unordered_set>
 
 export module application;
 
 export import camera;
 export import command_queue;
+export import descriptor_allocator;
+export import dynamic_descriptor_heap;
+export import frame_arena;
+export import frame_context;
+export import gpu_heap_allocator;
 export import input;
+export import pipeline_cache;
+export import render_graph;
+export import render_target_pool;
+export import residency_manager;
+export import resource_table;
+export import scheduler;
+export import task_pool;
+export import upload_service;
 
 export struct VertexPosNormalColor
 {
@@ -36,6 +52,9 @@ export class Application
 {
    public:
     constexpr static uint8_t nBuffers = 3u;
+    constexpr static uint32_t maxRecordThreads = 64u;
+    constexpr static uint32_t maxFramesInFlight = 8u;
+    constexpr static uint32_t descriptorsPerFrame = 256u;
     bool useWarp = false;
     uint32_t clientWidth = 1280;
     uint32_t clientHeight = 720;
@@ -46,21 +65,40 @@ export class Application
     std::unordered_set<MouseButton> pressedMouseButtons;
     vec2 mousePos;
     vec2 mouseDelta;
+    ComPtr<IDXGIAdapter4> adapter;
     ComPtr<ID3D12Device2> device;
     CommandQueue cmdQueue;
     ComPtr<IDXGISwapChain4> swapChain;
-    ComPtr<ID3D12Resource> backBuffers[nBuffers];
+    ResourceHandle backBuffers[nBuffers];
     ComPtr<ID3D12DescriptorHeap> rtvHeap;
     UINT rtvDescSize;
     UINT curBackBufIdx;
 
-    ComPtr<ID3D12Resource> vertexBuffer;
+    // Placed resources, declared before the allocations that return to it
+    std::unique_ptr<GpuHeapAllocator> gpuMemory;
+    // Mesh buffers, released after the resource table entries referring to them
+    GpuAllocation vertexMemory;
+    GpuAllocation indexMemory;
+    // Render and depth targets, cached across frames and resizes
+    std::unique_ptr<RenderTargetPool> renderTargets;
+    // Evicts idle resources when over the adapter's video memory budget
+    std::unique_ptr<ResidencyManager> residency;
+    // Owns the resources below, which are referred to by handle
+    ResourceTable resources;
+    ResourceHandle vertexBuffer;
     D3D12_VERTEX_BUFFER_VIEW vertexBufferView;
-    ComPtr<ID3D12Resource> indexBuffer;
+    ResourceHandle indexBuffer;
     D3D12_INDEX_BUFFER_VIEW indexBufferView;
-    ComPtr<ID3D12Resource> depthBuffer;
-    ComPtr<ID3D12DescriptorHeap> dsvHeap;
+    // Heaps the mesh buffers are placed in, each tracked once
+    std::vector<ResidencyManager::Handle> meshResidency;
+    ResourceHandle depthBuffer;
+    std::unique_ptr<DescriptorAllocator> dsvAllocator;
+    DescriptorAllocation dsv;
     ComPtr<ID3D12RootSignature> rootSignature;
+    // Descriptor table staging, one per recording thread
+    std::vector<std::unique_ptr<DynamicDescriptorHeap>> dynamicDescriptors;
+    // Pipeline states, compiled once and loaded from disk on later launches
+    std::unique_ptr<PipelineCache> pipelines;
     ComPtr<ID3D12PipelineState> pipelineState;
     D3D12_VIEWPORT viewport;
     D3D12_RECT scissorRect = CD3DX12_RECT(0, 0, LONG_MAX, LONG_MAX);
@@ -70,26 +108,41 @@ export class Application
     bool contentLoaded = false;
     uint32_t numIndices = 0;
 
-    uint64_t frameFenceValues[nBuffers] = {};
+    // Per-frame upload memory, descriptors and fence, independent of the swap chain buffer count
+    uint32_t framesInFlight = 2u;
+    FrameRing frames;
+    ComPtr<ID3D12DescriptorHeap> frameDescHeap;
+    // Resources the GPU may still reference, released once their queue's fence passes
+    ResourceReleaseQueue releaseQueue;
+    // Mesh and other static data stream in on a dedicated copy queue
+    std::unique_ptr<UploadService> uploads;
 
     bool vsync = true;
     bool tearingSupported = false;
     bool fullscreen = false;
     bool testMode = false;
     int frameCount = 0;
+    // Number of threads recording the scene draw in parallel, one command list each
+    uint32_t recordThreads = 1u;
+    TaskPool recordPool;
+    // Transient CPU allocations of the frame being recorded, reset once it's submitted
+    FrameArena frameArena;
+    // Totals over every frame's render graph
+    RenderGraph::Stats graphStats;
+    // Frames and mesh loading run as coroutines on the scheduler. The main thread only starts
+    //  a new frame once the previous one has been submitted, and waits on frameIdleEvent
+    //  (manual reset, signaled while no frame is being recorded) in the meantime.
+    Scheduler scheduler;
+    std::atomic<bool> frameBusy = false;
+    HANDLE frameIdleEvent = nullptr;
+    std::atomic<bool> meshLoaded = false;
 
     gainput::InputMap inputMap;
     gainput::DeviceId keyboardID, mouseID, rawMouseID;
 
-    Application();
+    explicit Application(uint32_t recordThreads = 1u, uint32_t framesInFlight = 2u);
     ~Application();
 
-    void transitionResource(
-        ComPtr<ID3D12GraphicsCommandList2> cmdList,
-        ComPtr<ID3D12Resource> resource,
-        D3D12_RESOURCE_STATES beforeState,
-        D3D12_RESOURCE_STATES afterState
-    );
     void clearRTV(
         ComPtr<ID3D12GraphicsCommandList2> cmdList,
         D3D12_CPU_DESCRIPTOR_HANDLE rtv,
@@ -100,24 +153,31 @@ export class Application
         D3D12_CPU_DESCRIPTOR_HANDLE dsv,
         FLOAT depth = 1.0f
     );
-    void updateBufferResource(
-        ComPtr<ID3D12GraphicsCommandList2> cmdList,
-        ID3D12Resource** pDestinationResource,
-        ID3D12Resource** pIntermediateResource,
-        size_t numElements,
-        size_t elementSize,
-        const void* bufferData = nullptr,
-        D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE
-    );
     void resizeDepthBuffer(uint32_t width, uint32_t height);
     ComPtr<IDXGISwapChain4> createSwapChain();
-    ComPtr<ID3D12DescriptorHeap>
-    createDescHeap(D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t numDescriptors);
+    ComPtr<ID3D12DescriptorHeap> createDescHeap(
+        D3D12_DESCRIPTOR_HEAP_TYPE type,
+        uint32_t numDescriptors,
+        D3D12_DESCRIPTOR_HEAP_FLAGS flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE
+    );
     void updateRenderTargetViews(ComPtr<ID3D12DescriptorHeap> descriptorHeap);
+    void recordScene(
+        ComPtr<ID3D12GraphicsCommandList2> cmdList,
+        DynamicDescriptorHeap& descriptors,
+        D3D12_CPU_DESCRIPTOR_HANDLE rtv,
+        D3D12_CPU_DESCRIPTOR_HANDLE dsv,
+        D3D12_GPU_VIRTUAL_ADDRESS sceneCB,
+        IndexRange indices
+    );
+    SceneConstantBuffer sceneConstants() const;
     void update();
     void render();
+    Task renderFrame(SceneConstantBuffer scb);
     void setFullscreen(bool val);
     void flush();
     bool loadContent();
+    Task loadMesh();
     void onResize(uint32_t width, uint32_t height);
+    // Write the latest allocator telemetry and its per-frame history as JSON
+    void dumpAllocatorTelemetry(const std::string& path);
 };
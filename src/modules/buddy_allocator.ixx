@@ -0,0 +1,62 @@
+module;
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+export module buddy_allocator;
+
+// Binary buddy allocator over [0, capacity). Blocks are powers of two times minBlockSize and
+//  start at a multiple of their own size, so any alignment up to the block size comes for
+//  free. Free blocks of each order sit on their own list, and a bitmask of non-empty orders
+//  finds the block to split in O(1). Freed blocks merge with their buddy as long as it's free.
+export class BuddyAllocator
+{
+   public:
+    static constexpr uint64_t invalidOffset = std::numeric_limits<uint64_t>::max();
+
+    struct Stats
+    {
+        uint64_t capacity = 0u;
+        // Bytes of the blocks handed out, and the bytes that were asked for
+        uint64_t allocatedBytes = 0u;
+        uint64_t requestedBytes = 0u;
+        uint32_t allocations = 0u;
+        uint64_t largestFreeBlock = 0u;
+        uint64_t splits = 0u;
+        uint64_t merges = 0u;
+        uint64_t failures = 0u;
+
+        // Share of allocated bytes lost to rounding up to a power of two
+        double internalFragmentation() const;
+    };
+
+    BuddyAllocator() = default;
+    // capacity is rounded down to a power of two times minBlockSize, a power of two itself
+    BuddyAllocator(uint64_t capacity, uint64_t minBlockSize);
+
+    uint64_t allocate(uint64_t size, uint64_t alignment = 1u);
+    void free(uint64_t offset);
+    uint64_t blockSize(uint64_t offset) const;
+    bool empty() const;
+    Stats stats() const;
+
+   private:
+    static constexpr uint32_t nil = std::numeric_limits<uint32_t>::max();
+    static constexpr uint8_t freeFlag = 0x80u;
+
+    uint64_t minBlockSize = 1u;
+    uint32_t maxOrder = 0u;
+    // Per min-sized block: order of the block starting there plus freeFlag, free list links,
+    //  and the size requested for it
+    std::vector<uint8_t> blockState;
+    std::vector<uint32_t> nextFree;
+    std::vector<uint32_t> prevFree;
+    std::vector<uint64_t> requested;
+    std::vector<uint32_t> freeHeads;
+    uint64_t freeOrders = 0u;
+    Stats buddyStats;
+
+    void pushFree(uint32_t block, uint32_t order);
+    void removeFree(uint32_t block, uint32_t order);
+};
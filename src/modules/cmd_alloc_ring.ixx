@@ -0,0 +1,192 @@
+module;
+
+#if defined(__clang__)
+    #define FMT_CONSTEVAL
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <span>
+#include <vector>
+#include <spdlog/spdlog.h>
+
+export module cmd_alloc_ring;
+
+// The part of a command queue its allocator rings need: creating and resetting allocators and
+//  lists, and the queue's fence
+export template <typename Allocator, typename List> class CmdAllocSource
+{
+   public:
+    virtual ~CmdAllocSource() = default;
+
+    virtual Allocator createAllocator() = 0;
+    // Create a list recording into allocator
+    virtual List createList(const Allocator& allocator) = 0;
+    // Reset allocator and list for recording, the GPU being done with both
+    virtual void reset(const Allocator& allocator, const List& list) = 0;
+    virtual bool isFenceComplete(uint64_t fenceValue) = 0;
+    // Returns false if the wait timed out
+    virtual bool waitForFenceVal(uint64_t fenceValue) = 0;
+};
+
+// Fixed-size allocator rings, one per recording thread with an entry per frame in flight. An
+//  entry owns its allocator and the list recorded into it, and can be reused once the GPU has
+//  passed the fence value it was submitted with. Rings never grow after construction, so
+//  steady-state recording doesn't touch the heap.
+export template <typename Allocator, typename List> class CmdAllocRings
+{
+   public:
+    using Source = CmdAllocSource<Allocator, List>;
+
+    // Summed over all thread slots
+    struct Stats
+    {
+        uint64_t allocatorCreations = 0u;
+        uint64_t cmdListCreations = 0u;
+        // Times a ring entry was still in flight and recording had to wait on the GPU
+        uint64_t stalls = 0u;
+    };
+
+    CmdAllocRings() = default;
+    CmdAllocRings(uint32_t nThreadSlots, uint32_t ringSize)
+        : threadSlots(std::max(1u, nThreadSlots))
+    {
+        ringSize = std::max(1u, ringSize);
+        for (auto& slot : this->threadSlots) {
+            slot.ring = std::make_unique<Entry[]>(ringSize);
+            slot.ringSize = ringSize;
+        }
+    }
+
+    uint32_t threadSlotCount() const { return static_cast<uint32_t>(this->threadSlots.size()); }
+    uint32_t ringSize() const
+    {
+        return this->threadSlots.empty() ? 0u : this->threadSlots.front().ringSize;
+    }
+
+    // Take the next entry of the thread slot's ring, waiting for the GPU if it's still in
+    //  flight, and reset its list for recording. Only the slot's own thread may call this.
+    const List& open(Source& source, uint32_t threadSlot)
+    {
+        assert(threadSlot < this->threadSlots.size() && "Thread slot out of range");
+        ThreadSlot& slot = this->threadSlots[threadSlot];
+        Entry& entry = slot.ring[slot.head];
+        slot.head = (slot.head + 1u) % slot.ringSize;
+
+        [[maybe_unused]] const bool wasReserved =
+            entry.reserved.exchange(true, std::memory_order_acquire);
+        assert(!wasReserved && "Allocator ring wrapped onto a list that was never submitted");
+        const uint64_t entryFenceValue = entry.fenceValue.load(std::memory_order_relaxed);
+
+        if (!entry.allocator) {
+            entry.allocator = source.createAllocator();
+            slot.stats.allocatorCreations.fetch_add(1u, std::memory_order_relaxed);
+        } else if (!source.isFenceComplete(entryFenceValue)) {
+            // Command allocator can't be re-used unless associated cmd list's commands
+            //  have finished on the GPU
+            slot.stats.stalls.fetch_add(1u, std::memory_order_relaxed);
+            if (!source.waitForFenceVal(entryFenceValue)) {
+                spdlog::error("Timed out waiting for a command allocator to be released");
+                throw std::exception();
+            }
+        }
+
+        if (!entry.list) {
+            entry.list = source.createList(entry.allocator);
+            slot.stats.cmdListCreations.fetch_add(1u, std::memory_order_relaxed);
+        } else {
+            source.reset(entry.allocator, entry.list);
+        }
+
+        entry.open.store(true, std::memory_order_release);
+        return entry.list;
+    }
+
+    // Submit closed lists taken from open(), in order, as one batch. submitFn queues a list
+    //  and returns the fence value it completes at. Every allocator of the batch is tagged with
+    //  the last of them, the value the batch's signal reaches, so they're recycled together.
+    //  Lists may be submitted from another thread than the one that recorded them.
+    template <typename SubmitFn> uint64_t submit(std::span<const List> lists, SubmitFn&& submitFn)
+    {
+        // Nothing is queued if any of them wasn't taken from these rings
+        for (const List& list : lists) {
+            this->findOpen(list);
+        }
+        uint64_t fenceValue = 0u;
+        for (const List& list : lists) {
+            fenceValue = submitFn(list);
+        }
+        // The lists stay alive in their entries, which can't be reused before fenceValue
+        for (const List& list : lists) {
+            Entry& entry = this->findOpen(list);
+            entry.fenceValue.store(fenceValue, std::memory_order_relaxed);
+            entry.open.store(false, std::memory_order_relaxed);
+            entry.reserved.store(false, std::memory_order_release);
+        }
+        return fenceValue;
+    }
+
+    Stats stats() const
+    {
+        Stats total;
+        for (const auto& slot : this->threadSlots) {
+            total.allocatorCreations +=
+                slot.stats.allocatorCreations.load(std::memory_order_relaxed);
+            total.cmdListCreations += slot.stats.cmdListCreations.load(std::memory_order_relaxed);
+            total.stalls += slot.stats.stalls.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+   private:
+    // Ownership fields are atomic since the list may be submitted by another thread than the
+    //  one recording it. allocator and list are only written while the entry is reserved and
+    //  not open.
+    struct Entry
+    {
+        std::atomic<uint64_t> fenceValue = 0u;
+        Allocator allocator = {};
+        List list = {};
+        // Set while the list is handed out for recording
+        std::atomic<bool> open = false;
+        std::atomic<bool> reserved = false;
+    };
+
+    // Written by the slot's recording thread, read by stats() from any other
+    struct SlotStats
+    {
+        std::atomic<uint64_t> allocatorCreations = 0u;
+        std::atomic<uint64_t> cmdListCreations = 0u;
+        std::atomic<uint64_t> stalls = 0u;
+    };
+
+    struct ThreadSlot
+    {
+        std::unique_ptr<Entry[]> ring;
+        uint32_t ringSize = 0u;
+        uint32_t head = 0u;
+        SlotStats stats;
+    };
+
+    std::vector<ThreadSlot> threadSlots;
+
+    // Rings are tiny (threads x frames in flight), so a scan beats any extra bookkeeping
+    Entry& findOpen(const List& list)
+    {
+        for (auto& slot : this->threadSlots) {
+            for (uint32_t i = 0u; i < slot.ringSize; i++) {
+                Entry& entry = slot.ring[i];
+                if (entry.open.load(std::memory_order_acquire) && entry.list == list) {
+                    return entry;
+                }
+            }
+        }
+
+        spdlog::error("Submitted a command list that wasn't taken from this queue");
+        throw std::exception();
+    }
+};
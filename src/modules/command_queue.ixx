@@ -3,44 +3,99 @@ module;
 #include <Windows.h>
 #include <d3d12.h>
 #include <wrl.h>
-#include <queue>
+#include <atomic>
+#include <coroutine>
+#include <memory>
+#include <source_location>
+#include <span>
+#include <vector>
 
 export module command_queue;
 
+export import cmd_alloc_ring;
 export import common;
+export import fence_wait;
+export import fence_watcher;
+export import scheduler;
+
+class Submitter;
 
 export class CommandQueue
 {
    public:
+    // Allocator ring bookkeeping, summed over all thread slots
+    struct Stats
+    {
+        uint64_t allocatorCreations = 0u;
+        uint64_t cmdListCreations = 0u;
+        // Times a ring entry was still in flight and recording had to wait on the GPU
+        uint64_t stalls = 0u;
+        // Lists handed to the submission thread, and ExecuteCommandLists calls it made for them
+        uint64_t submissions = 0u;
+        uint64_t batches = 0u;
+        // Times a producer found the submission ring full
+        uint64_t submitStalls = 0u;
+    };
+
     ComPtr<ID3D12CommandQueue> queue;
 
-    CommandQueue() = default;
-    CommandQueue(ComPtr<ID3D12Device2> device, D3D12_COMMAND_LIST_TYPE type);
+    CommandQueue();
+    CommandQueue(
+        ComPtr<ID3D12Device2> device,
+        D3D12_COMMAND_LIST_TYPE type,
+        uint32_t nThreadSlots = 1u,
+        uint32_t ringSize = 3u
+    );
+    ~CommandQueue();
+    CommandQueue(CommandQueue&&) noexcept;
+    CommandQueue& operator=(CommandQueue&&) noexcept;
 
-    ComPtr<ID3D12GraphicsCommandList2> getCmdList();
+    // Each recording thread uses its own slot, so concurrent getCmdList calls are safe as long
+    //  as no two threads share a slot. Submission and signaling may happen from any thread.
+    ComPtr<ID3D12GraphicsCommandList2> getCmdList(uint32_t threadSlot = 0u);
+    // Close a list and queue it for the submission thread without waiting, returning the fence
+    //  value it completes at. Lists submitted by one thread execute in submission order, and
+    //  whatever producers queue while the submission thread is busy goes out as one batch.
+    uint64_t submit(ComPtr<ID3D12GraphicsCommandList2> cmdList);
     uint64_t execCmdList(ComPtr<ID3D12GraphicsCommandList2> cmdList);
+    // Submit lists in order and wait until they've been handed to the D3D12 queue, so work
+    //  issued directly on it afterwards (like Present) runs after them
+    uint64_t execCmdLists(std::span<const ComPtr<ID3D12GraphicsCommandList2>> cmdLists);
     uint64_t signal();
     bool isFenceComplete(uint64_t fval);
-    void waitForFenceVal(uint64_t fval);
+    uint64_t completedValue() const;
+    // Blocking wait following the queue's wait policy, safe from any thread. Returns false if
+    //  the policy's timeout passed first. The duration is recorded under the caller's location.
+    bool waitForFenceVal(
+        uint64_t fval,
+        const std::source_location& site = std::source_location::current()
+    );
+    // Suspend the awaiting coroutine until the fence reaches fval and resume it on scheduler.
+    //  The await throws if the queue is destroyed first.
+    FenceAwaiter fenceReached(uint64_t fval, Scheduler& scheduler);
+    // Queue a GPU-side wait for another queue's fence, later submissions here won't start
+    //  until it is reached
+    void gpuWait(const CommandQueue& other, uint64_t fval);
     void flush();
+    Stats stats() const;
+    void setWaitPolicy(const WaitPolicy& policy);
+    // Wait duration histograms per call site of waitForFenceVal and recording stalls
+    const WaitSites& waitStats() const;
 
    private:
     ComPtr<ID3D12Device2> device;
 
     ComPtr<ID3D12Fence> fence;
-    uint64_t fenceValue = 0;
-    HANDLE fenceEvent;
+    WaitPolicy waitPolicy;
+    std::unique_ptr<WaitSites> waitSites;
+    std::unique_ptr<FenceWatcher> fenceWatcher;
+    // Owns the only thread that calls ExecuteCommandLists, Wait and Signal on the queue.
+    //  Fence values are positions in its submission sequence.
+    std::unique_ptr<Submitter> submitter;
 
-    struct CmdAllocEntry
-    {
-        uint64_t fenceValue;
-        ComPtr<ID3D12CommandAllocator> commandAllocator;
-    };
+    // Creates the rings' allocators and lists on the device and waits on the queue's fence
+    class AllocSource;
 
     D3D12_COMMAND_LIST_TYPE type;
-    std::queue<CmdAllocEntry> cmdAllocQueue;
-    std::queue<ComPtr<ID3D12GraphicsCommandList2>> cmdListQueue;
-
-    ComPtr<ID3D12CommandAllocator> createCmdAlloc();
-    ComPtr<ID3D12GraphicsCommandList2> createCmdList(ComPtr<ID3D12CommandAllocator> allocator);
+    CmdAllocRings<ComPtr<ID3D12CommandAllocator>, ComPtr<ID3D12GraphicsCommandList2>> allocRings;
 };
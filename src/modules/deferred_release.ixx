@@ -0,0 +1,113 @@
+module;
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+export module deferred_release;
+
+// Holds objects the GPU may still be reading until the queue that used them passes a fence
+//  value. Entries are kept in one FIFO per queue; fence values only grow per queue, so
+//  draining stops at the first incomplete entry and costs O(queues + released).
+export template <typename T, typename QueueKey = const void*> class DeferredReleaseQueue
+{
+   public:
+    struct Stats
+    {
+        size_t retainedBytes = 0u;
+        size_t peakRetainedBytes = 0u;
+        uint64_t retained = 0u;
+        uint64_t released = 0u;
+    };
+
+    // Keep object alive until queue has completed fenceValue
+    void retire(QueueKey queue, uint64_t fenceValue, T object, size_t sizeInBytes = 0u)
+    {
+        std::scoped_lock lock(this->mutex);
+        PerQueue& perQueue = this->findQueue(queue);
+        assert(
+            (perQueue.entries.empty() || perQueue.entries.back().fenceValue <= fenceValue) &&
+            "Fence values retired on a queue must not decrease"
+        );
+        perQueue.entries.push_back({ fenceValue, sizeInBytes, std::move(object) });
+
+        this->releaseStats.retained++;
+        this->releaseStats.retainedBytes += sizeInBytes;
+        this->releaseStats.peakRetainedBytes =
+            std::max(this->releaseStats.peakRetainedBytes, this->releaseStats.retainedBytes);
+    }
+
+    // Release every object whose fence has been reached, completedValue(queue) returns the
+    //  last completed fence value of a queue. Returns how many objects were released.
+    template <typename CompletedFn> size_t drain(CompletedFn&& completedValue)
+    {
+        std::scoped_lock lock(this->mutex);
+        size_t nReleased = 0u;
+        for (PerQueue& perQueue : this->queues) {
+            if (perQueue.entries.empty()) {
+                continue;
+            }
+            const uint64_t completed = completedValue(perQueue.queue);
+            while (!perQueue.entries.empty() && perQueue.entries.front().fenceValue <= completed) {
+                this->releaseStats.retainedBytes -= perQueue.entries.front().sizeInBytes;
+                perQueue.entries.pop_front();
+                nReleased++;
+            }
+        }
+        this->releaseStats.released += nReleased;
+        return nReleased;
+    }
+
+    // Release everything regardless of fences, only valid once the GPU is idle
+    void clear()
+    {
+        std::scoped_lock lock(this->mutex);
+        for (PerQueue& perQueue : this->queues) {
+            this->releaseStats.released += perQueue.entries.size();
+            perQueue.entries.clear();
+        }
+        this->releaseStats.retainedBytes = 0u;
+    }
+
+    Stats stats()
+    {
+        std::scoped_lock lock(this->mutex);
+        return this->releaseStats;
+    }
+
+   private:
+    struct Entry
+    {
+        uint64_t fenceValue;
+        size_t sizeInBytes;
+        T object;
+    };
+
+    struct PerQueue
+    {
+        QueueKey queue;
+        std::deque<Entry> entries;
+    };
+
+    std::mutex mutex;
+    // Only a handful of queues ever exist, a linear lookup is fine. A deque keeps entries
+    //  stable and never has to copy the per-queue FIFOs when growing.
+    std::deque<PerQueue> queues;
+    Stats releaseStats;
+
+    PerQueue& findQueue(QueueKey queue)
+    {
+        auto it = std::find_if(this->queues.begin(), this->queues.end(), [&](const PerQueue& q) {
+            return q.queue == queue;
+        });
+        if (it == this->queues.end()) {
+            this->queues.push_back({ queue, {} });
+            return this->queues.back();
+        }
+        return *it;
+    }
+};
@@ -1,6 +1,7 @@
 module;
 
 #include <d3d12.h>
+#include <atomic>
 #include <mutex>
 #include <memory>
 #include <vector>
@@ -8,7 +9,9 @@ module;
 
 export module descriptor_allocator;
 
+export import allocator_telemetry;
 export import common;
+export import frame_free_list;
 
 export class DescriptorAllocatorPage;
 
@@ -40,11 +43,33 @@ export class DescriptorAllocation
     void free();
 
     friend class DescriptorAllocator;
+    friend class DescriptorAllocatorPage;
 };
 
+// CPU-only descriptors, for views that are created once and copied into shader-visible heaps
+//  or bound directly (RTVs, DSVs). Freed descriptors are only recycled once the frame that
+//  freed them has completed on the GPU.
 export class DescriptorAllocator
 {
    public:
+    struct Stats
+    {
+        uint32_t pages = 0u;
+        uint32_t descriptors = 0u;
+        uint32_t freeDescriptors = 0u;
+        uint32_t freeBlocks = 0u;
+        uint32_t largestFreeBlock = 0u;
+        // Freed but waiting for their frame to complete
+        uint32_t staleDescriptors = 0u;
+        uint64_t allocations = 0u;
+        // Single descriptors served without taking the allocator lock
+        uint64_t fastAllocations = 0u;
+
+        // Share of free descriptors that can't be handed out as one block, 0 when all free
+        //  space is contiguous
+        double fragmentation() const;
+    };
+
     const D3D12_DESCRIPTOR_HEAP_TYPE type;
     const uint32_t nDescPerHeap;
 
@@ -52,7 +77,14 @@ export class DescriptorAllocator
     virtual ~DescriptorAllocator() = default;
 
     DescriptorAllocation allocate(uint32_t nDescriptors = 1u);
+    // Descriptors freed from now on belong to frameNumber
+    void setFrame(uint64_t frameNumber);
+    // Recycle descriptors freed during frames up to and including frameNumber
     void releaseStaleDescriptors(uint64_t frameNumber);
+    Stats stats();
+    // Record what the allocator holds for this frame, in descriptors
+    void sampleTelemetry(uint64_t frame);
+    const AllocatorTelemetry& telemetry() const;
 
    private:
     using DescriptorHeapPool = std::vector<std::shared_ptr<DescriptorAllocatorPage>>;
@@ -60,13 +92,41 @@ export class DescriptorAllocator
     DescriptorHeapPool heapPool;
     std::unordered_set<size_t> availableHeaps;
     std::mutex allocMutex;
+    // Page that served the last single descriptor, tried first without the allocator lock
+    std::atomic<DescriptorAllocatorPage*> singlePage = nullptr;
+    std::atomic<uint64_t> allocations = 0u;
+    std::atomic<uint64_t> fastAllocations = 0u;
+    uint64_t frameNumber = 0u;
+    AllocatorTelemetry allocatorTelemetry;
 
-    std::shared_ptr<DescriptorAllocatorPage> createAllocatorPage();
+    std::shared_ptr<DescriptorAllocatorPage> createAllocatorPage(uint32_t nDescriptors);
 };
 
 export class DescriptorAllocatorPage : public std::enable_shared_from_this<DescriptorAllocatorPage>
 {
    public:
     DescriptorAllocatorPage(D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t nDescPerHeap);
+
+    D3D12_DESCRIPTOR_HEAP_TYPE getHeapType() const;
+    uint32_t numFreeHandles() const;
+    // Null allocation if no free block is large enough
+    DescriptorAllocation allocate(uint32_t nDescriptors);
     void free(DescriptorAllocation&& allocation, uint64_t frameNumber);
+    void releaseStaleDescriptors(uint64_t frameNumber);
+    void setFrame(uint64_t frameNumber);
+    uint64_t frame() const;
+    FreeList::Stats stats() const;
+    uint32_t numStaleHandles() const;
+
+   private:
+    ComPtr<ID3D12DescriptorHeap> heap;
+    D3D12_DESCRIPTOR_HEAP_TYPE type;
+    D3D12_CPU_DESCRIPTOR_HANDLE baseDescriptor;
+    uint32_t descriptorSize;
+    uint32_t nDescriptors;
+
+    // Offsets into the heap, guarded by mutex
+    FrameFreeList slots;
+    std::atomic<uint64_t> currentFrame = 0u;
+    mutable std::mutex mutex;
 };
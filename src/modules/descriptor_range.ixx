@@ -0,0 +1,23 @@
+module;
+
+#include <d3d12.h>
+#include <atomic>
+#include <cstdint>
+
+export module descriptor_range;
+
+// Linear sub-range of a shader-visible descriptor heap, reset when its frame begins
+export struct DescriptorRange
+{
+    D3D12_CPU_DESCRIPTOR_HANDLE cpuBase = {};
+    D3D12_GPU_DESCRIPTOR_HANDLE gpuBase = {};
+    uint32_t descriptorSize = 0u;
+    uint32_t capacity = 0u;
+    std::atomic<uint32_t> used = 0u;
+
+    // Returns the index of the first of n contiguous descriptors within the range, safe to call
+    //  from several recording threads at once
+    uint32_t allocate(uint32_t n = 1u);
+    D3D12_CPU_DESCRIPTOR_HANDLE cpu(uint32_t index) const;
+    D3D12_GPU_DESCRIPTOR_HANDLE gpu(uint32_t index) const;
+};
@@ -0,0 +1,82 @@
+module;
+
+#include <d3d12.h>
+#include <cstdint>
+#include <vector>
+
+export module dynamic_descriptor_heap;
+
+export import descriptor_range;
+
+// Stages CPU-only descriptors for the descriptor tables of a root signature and copies the
+//  tables that changed into a frame's shader-visible range right before a draw or dispatch.
+//  All dirty tables are copied with one CopyDescriptors call. One instance per recording
+//  thread, it isn't thread-safe itself.
+export class DynamicDescriptorHeap
+{
+   public:
+    struct Stats
+    {
+        uint64_t commits = 0u;
+        uint64_t tablesCommitted = 0u;
+        uint64_t descriptorsCopied = 0u;
+        // Runs of adjacent source descriptors, each one copy range
+        uint64_t sourceRanges = 0u;
+    };
+
+    // Root signatures have at most 64 DWORDs and tables cost one each, but a 32 bit mask is
+    //  plenty for anything this renderer builds
+    static constexpr uint32_t maxDescriptorTables = 32u;
+
+    // device must outlive the heap
+    DynamicDescriptorHeap(
+        ID3D12Device* device,
+        D3D12_DESCRIPTOR_HEAP_TYPE type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV
+    );
+
+    // Size the staging area for the descriptor tables of a root signature matching this
+    //  heap's type. Drops everything staged so far.
+    void parseRootSignature(const D3D12_ROOT_SIGNATURE_DESC1& desc);
+    // Stage count descriptors starting at src, which must be contiguous in a CPU-only heap,
+    //  into the table bound at rootIndex beginning at offset
+    void stageDescriptors(
+        uint32_t rootIndex,
+        uint32_t offset,
+        uint32_t count,
+        D3D12_CPU_DESCRIPTOR_HANDLE src
+    );
+    // Copy dirty tables into range and bind them on the command list. The frame's heap must
+    //  already be set on the command list with SetDescriptorHeaps.
+    void commitForDraw(ID3D12GraphicsCommandList* cmdList, DescriptorRange& range);
+    void commitForDispatch(ID3D12GraphicsCommandList* cmdList, DescriptorRange& range);
+    // Bindings don't carry over to a new command list, so commit every staged table again
+    void reset();
+    const Stats& stats() const;
+
+   private:
+    using SetTableFn =
+        void (STDMETHODCALLTYPE ID3D12GraphicsCommandList::*)(UINT, D3D12_GPU_DESCRIPTOR_HANDLE);
+
+    struct Table
+    {
+        // Offset into staged and number of descriptors in the table
+        uint32_t offset = 0u;
+        uint32_t count = 0u;
+        // One past the highest descriptor staged so far, only that much is copied
+        uint32_t stagedCount = 0u;
+    };
+
+    ID3D12Device* device;
+    D3D12_DESCRIPTOR_HEAP_TYPE type;
+    uint32_t descriptorSize;
+    Table tables[maxDescriptorTables] = {};
+    uint32_t tableMask = 0u;
+    uint32_t dirtyMask = 0u;
+    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> staged;
+    // Reused between commits so committing doesn't allocate
+    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> srcStarts;
+    std::vector<UINT> srcSizes;
+    Stats heapStats;
+
+    void commit(ID3D12GraphicsCommandList* cmdList, DescriptorRange& range, SetTableFn setTable);
+};
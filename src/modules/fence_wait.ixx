@@ -0,0 +1,183 @@
+module;
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define FENCE_WAIT_PAUSE() _mm_pause()
+#else
+    #define FENCE_WAIT_PAUSE() std::this_thread::yield()
+#endif
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <source_location>
+#include <thread>
+#include <vector>
+
+export module fence_wait;
+
+// How long to keep polling before handing a wait to the OS. Most fence waits while pacing
+//  frames are either already done or finish within a few microseconds, where a kernel
+//  transition costs more than the wait itself.
+export struct WaitPolicy
+{
+    // Polls separated by a pause hint
+    uint32_t spinCount = 1000u;
+    // Polls separated by giving up the time slice
+    uint32_t yieldCount = 32u;
+    // Give up after this long, max() waits forever
+    std::chrono::microseconds timeout = std::chrono::microseconds::max();
+};
+
+// Phase in which a wait finished
+export enum class WaitPhase : uint8_t
+{
+    Ready,
+    Spin,
+    Yield,
+    Block,
+    TimedOut,
+};
+
+export struct WaitResult
+{
+    WaitPhase phase = WaitPhase::Ready;
+    double us = 0.0;
+
+    bool reached() const { return this->phase != WaitPhase::TimedOut; }
+};
+
+// Spin, then yield, then block until isDone() returns true or the policy's timeout passes.
+//  block(remaining) should sleep until the condition may have changed or remaining elapsed,
+//  it is called again whenever it returns early.
+export template <typename PollFn, typename BlockFn>
+WaitResult adaptiveWait(const WaitPolicy& policy, PollFn&& isDone, BlockFn&& block)
+{
+    using Clock = std::chrono::steady_clock;
+
+    if (isDone()) {
+        return { WaitPhase::Ready, 0.0 };
+    }
+
+    const Clock::time_point start = Clock::now();
+    const auto finish = [&](WaitPhase phase) -> WaitResult {
+        const std::chrono::duration<double, std::micro> waited = Clock::now() - start;
+        return { phase, waited.count() };
+    };
+
+    for (uint32_t i = 0u; i < policy.spinCount; i++) {
+        FENCE_WAIT_PAUSE();
+        if (isDone()) {
+            return finish(WaitPhase::Spin);
+        }
+    }
+    for (uint32_t i = 0u; i < policy.yieldCount; i++) {
+        std::this_thread::yield();
+        if (isDone()) {
+            return finish(WaitPhase::Yield);
+        }
+    }
+
+    const bool forever = policy.timeout == std::chrono::microseconds::max();
+    while (true) {
+        std::chrono::microseconds remaining = std::chrono::microseconds::max();
+        if (!forever) {
+            const auto elapsed =
+                std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start);
+            if (elapsed >= policy.timeout) {
+                return finish(WaitPhase::TimedOut);
+            }
+            remaining = policy.timeout - elapsed;
+        }
+        block(remaining);
+        if (isDone()) {
+            return finish(WaitPhase::Block);
+        }
+    }
+}
+
+// Log2 histogram of wait durations. Bucket 0 counts waits under 1us, bucket i > 0 counts
+//  waits in [2^(i-1), 2^i) us. Recording is lock-free and may happen from any thread.
+export class WaitHistogram
+{
+   public:
+    static constexpr size_t nBuckets = 24u;
+    static constexpr size_t nPhases = 5u;
+
+    struct Snapshot
+    {
+        std::array<uint64_t, nBuckets> buckets = {};
+        std::array<uint64_t, nPhases> phases = {};
+        uint64_t count = 0u;
+        double totalUs = 0.0;
+        double maxUs = 0.0;
+
+        // Upper bound of the bucket holding the given fraction of waits
+        double percentileUs(double fraction) const;
+        uint64_t inPhase(WaitPhase phase) const
+        {
+            return this->phases[static_cast<size_t>(phase)];
+        }
+    };
+
+    void record(const WaitResult& result);
+    Snapshot snapshot() const;
+
+   private:
+    std::array<std::atomic<uint64_t>, nBuckets> buckets = {};
+    std::array<std::atomic<uint64_t>, nPhases> phases = {};
+    std::atomic<uint64_t> count = 0u;
+    std::atomic<uint64_t> totalNs = 0u;
+    std::atomic<uint64_t> maxNs = 0u;
+};
+
+// Histograms keyed by the source location that waited
+export class WaitSites
+{
+   public:
+    struct Site
+    {
+        const char* file;
+        const char* function;
+        uint32_t line;
+        std::unique_ptr<WaitHistogram> histogram;
+    };
+
+    // Lock-free once a site has been seen, which is every wait but its first
+    WaitHistogram& at(const std::source_location& location);
+
+    template <typename Fn> void forEach(Fn&& fn) const
+    {
+        std::scoped_lock lock(this->mutex);
+        for (const Site& site : this->sites) {
+            fn(site, site.histogram->snapshot());
+        }
+    }
+
+   private:
+    // Entry of the lookup index, file and line are written before histogram is published and
+    //  never change after
+    struct IndexEntry
+    {
+        std::atomic<WaitHistogram*> histogram = nullptr;
+        const char* file = nullptr;
+        uint32_t line = 0u;
+    };
+
+    static constexpr size_t indexSize = 64u;
+
+    mutable std::mutex mutex;
+    // A handful of call sites at most, a linear lookup is fine
+    std::vector<Site> sites;
+    // Open-addressed, keyed by the file name pointer and line, which are the same on every
+    //  call from one site. A site whose key isn't in the index (it's full, or the same file
+    //  name has another address in another module) takes the locked path.
+    std::array<IndexEntry, indexSize> index;
+
+    static size_t indexSlot(const char* file, uint32_t line);
+    WaitHistogram* findIndexed(const char* file, uint32_t line) const;
+};
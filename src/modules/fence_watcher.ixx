@@ -0,0 +1,78 @@
+module;
+
+#include <coroutine>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+export module fence_watcher;
+
+export import scheduler;
+
+// The part of a fence a FenceWatcher needs. CommandQueue implements it over an ID3D12Fence and
+//  an event, tests over a simulated fence.
+export class WatchedFence
+{
+   public:
+    virtual ~WatchedFence() = default;
+
+    virtual uint64_t completedValue() const = 0;
+    // Make waitForSignal() return once value has been reached, right away if it already has
+    virtual void armEvent(uint64_t value) = 0;
+    // Block until an armed value is reached or wake() is called. May return spuriously.
+    virtual void waitForSignal() = 0;
+    virtual void wake() = 0;
+};
+
+// Resumes coroutines waiting on a fence. Registering a waiter arms the fence for that value,
+//  so the watcher thread wakes for whichever pending value completes first.
+export class FenceWatcher
+{
+   public:
+    explicit FenceWatcher(std::unique_ptr<WatchedFence> fence);
+    // Resumes the waiters whose values were never reached, see FenceAwaiter
+    ~FenceWatcher();
+    FenceWatcher(const FenceWatcher&) = delete;
+    FenceWatcher& operator=(const FenceWatcher&) = delete;
+
+    bool isComplete(uint64_t fenceValue) const;
+    // Post h to scheduler once fenceValue is reached. cancelled is set instead if the watcher
+    //  is destroyed first.
+    void add(uint64_t fenceValue, std::coroutine_handle<> h, Scheduler* scheduler, bool* cancelled);
+
+   private:
+    struct Waiter
+    {
+        uint64_t fenceValue;
+        std::coroutine_handle<> handle;
+        Scheduler* scheduler;
+        // In the suspended awaiter, set before resuming a waiter that was never reached
+        bool* cancelled;
+    };
+
+    std::unique_ptr<WatchedFence> fence;
+    std::thread thread;
+    std::mutex mutex;
+    std::vector<Waiter> waiters;
+    std::vector<Waiter> completed;
+    bool stopping = false;
+
+    void watch();
+};
+
+// Suspends the awaiting coroutine until a fence reaches a value, then resumes it on the
+//  scheduler instead of blocking a thread. If the watcher is destroyed first, the coroutine is
+//  resumed right away and the await throws, unwinding it.
+export struct FenceAwaiter
+{
+    FenceWatcher* watcher;
+    uint64_t fenceValue;
+    Scheduler* scheduler;
+    bool cancelled = false;
+
+    bool await_ready() const { return this->watcher->isComplete(this->fenceValue); }
+    void await_suspend(std::coroutine_handle<> h);
+    void await_resume() const;
+};
@@ -0,0 +1,80 @@
+module;
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+export module frame_arena;
+
+// Bump allocator for data that lives until the end of a frame, usable with std::pmr
+//  containers. Deallocation does nothing, everything is freed at once by reset(). When a frame
+//  outgrows the current block another one is chained on, and the next reset() replaces the
+//  chain with a single block big enough for all of it, so a steady frame loop stops allocating
+//  after its first frames. Not thread-safe, each thread needs its own arena.
+export class LinearArena : public std::pmr::memory_resource
+{
+   public:
+    struct Stats
+    {
+        size_t usedBytes = 0u;
+        size_t peakBytes = 0u;
+        size_t capacity = 0u;
+        uint64_t allocations = 0u;
+        // Blocks requested from the global heap, including the first
+        uint64_t blocksCreated = 0u;
+        uint64_t resets = 0u;
+    };
+
+    // blockSize is rounded up to a power of two
+    explicit LinearArena(size_t blockSize = 64u * 1024u);
+    LinearArena(const LinearArena&) = delete;
+    LinearArena& operator=(const LinearArena&) = delete;
+
+    // Free everything allocated since the last reset. Debug builds fill the freed memory with
+    //  0xDD so stale pointers into the frame show up.
+    void reset();
+    Stats stats() const;
+
+   private:
+    struct Block
+    {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    void addBlock(size_t minSize);
+
+    const size_t blockSize;
+    std::vector<Block> blocks;
+    // Bytes used in the last block, the ones before it are full
+    size_t offset = 0u;
+    // Bytes used in the blocks before the last
+    size_t usedBefore = 0u;
+    Stats arenaStats;
+};
+
+// Per-frame arena for the thread driving the frame, plus one sub-arena per recording thread
+//  so parallel recording doesn't contend. All of them are reset together at the end of the
+//  frame, once nothing allocated from them is referenced anymore.
+export class FrameArena
+{
+   public:
+    explicit FrameArena(uint32_t nThreads = 1u, size_t blockSize = 64u * 1024u);
+
+    LinearArena& frame();
+    LinearArena& thread(uint32_t threadSlot);
+    void reset();
+    // Summed over the frame arena and the thread arenas
+    LinearArena::Stats stats() const;
+
+   private:
+    std::unique_ptr<LinearArena> frameArena;
+    // Separate allocations keep the thread arenas' bookkeeping off each other's cache lines
+    std::vector<std::unique_ptr<LinearArena>> threadArenas;
+};
@@ -0,0 +1,62 @@
+module;
+
+#include <d3d12.h>
+#include <wrl.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+export module frame_context;
+
+export import command_queue;
+export import descriptor_range;
+export import frame_slots;
+export import upload_buffer;
+
+// Resources that are only safe to reuse once the GPU has finished the frame that last used them
+export class FrameContext
+{
+   public:
+    uint64_t frameNumber = 0u;
+    DescriptorRange descriptors;
+};
+
+// Cycles through a fixed number of frame contexts so the CPU can record frame N + 1 while the
+//  GPU is still working on frame N. The number of frames in flight is independent of the
+//  swap chain's buffer count. Upload memory for recording threads is retired with the frame
+//  that used it.
+export class FrameRing
+{
+   public:
+    using Stats = FrameSlots::Stats;
+
+    FrameRing() = default;
+    FrameRing(
+        uint32_t framesInFlight,
+        ComPtr<ID3D12DescriptorHeap> descHeap,
+        uint32_t descPerFrame,
+        uint32_t descSize,
+        uint32_t recordThreads = 1u
+    );
+
+    // Wait for the oldest frame in the slot to retire, then recycle its resources
+    FrameContext& begin(CommandQueue& queue);
+    // Account for time the next frame spent waiting on its fence outside of begin()
+    void addWaitTime(double ms);
+    // Record the fence value that retires the current frame and advance to the next slot
+    void end(uint64_t fenceValue);
+    FrameContext& current();
+    // Fence value that retires the frame last recorded into the current slot, 0 if none was
+    uint64_t pendingFence() const;
+    // Upload memory for recording threads, indexed by thread slot, valid until the current
+    //  frame's fence completes
+    ParallelUploadBuffer& threadUploads();
+    uint32_t size() const;
+    uint64_t frameNumber() const;
+    const Stats& stats() const;
+
+   private:
+    std::vector<std::unique_ptr<FrameContext>> frames;
+    std::unique_ptr<ParallelUploadBuffer> threadUploadPages;
+    FrameSlots slots;
+};
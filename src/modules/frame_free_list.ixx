@@ -0,0 +1,57 @@
+module;
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+export module frame_free_list;
+
+export import free_list;
+
+// Range allocator whose frees only become allocatable once the frame they were made in has
+//  retired, for ranges the GPU may still read after the CPU let go of them. Freed blocks wait in
+//  a queue in frame order. Single-element blocks come back through a small cache in front of
+//  the free list, so allocating and freeing one at a time doesn't pay for coalescing. Not
+//  thread-safe.
+export class FrameFreeList
+{
+   public:
+    static constexpr uint32_t invalidOffset = FreeList::invalidOffset;
+    // Released single-element blocks skip the free list up to this many
+    static constexpr size_t maxCachedSingles = 64u;
+
+    FrameFreeList() = default;
+    explicit FrameFreeList(uint32_t capacity);
+
+    // Offset of count contiguous elements, invalidOffset if no free block is large enough
+    uint32_t allocate(uint32_t count);
+    // Return a block that may be in use until frameNumber retires. Blocks are released in the
+    //  order they were freed, so one freed with an older frame than a block queued before it
+    //  waits for that block's frame.
+    void free(uint32_t offset, uint32_t count, uint64_t frameNumber);
+    // Make blocks freed during frames up to and including frameNumber allocatable
+    void releaseStale(uint64_t frameNumber);
+
+    // Allocatable elements, cached singles included
+    uint32_t freeCount() const;
+    // Freed elements still waiting for their frame
+    uint32_t staleCount() const;
+    // Free list stats with each cached single counted as a block of its own
+    FreeList::Stats stats() const;
+
+   private:
+    struct StaleBlock
+    {
+        uint32_t offset;
+        uint32_t count;
+        uint64_t frameNumber;
+    };
+
+    FreeList freeList;
+    std::vector<uint32_t> singles;
+    std::deque<StaleBlock> stale;
+    uint32_t nStale = 0u;
+
+    void flushSingles();
+};
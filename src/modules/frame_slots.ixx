@@ -0,0 +1,59 @@
+module;
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+export module frame_slots;
+
+// Slot and fence bookkeeping of a frame ring, apart from the resources it cycles through.
+//  Frame N records into slot N % framesInFlight and may only start once the GPU has retired
+//  frame N - framesInFlight, the slot's previous user.
+export class FrameSlots
+{
+   public:
+    struct Stats
+    {
+        uint64_t frames = 0u;
+        // Frames whose begin() had to wait for the GPU to retire an older frame
+        uint64_t blockedFrames = 0u;
+        double blockedMs = 0.0;
+        double maxBlockedMs = 0.0;
+    };
+
+    explicit FrameSlots(uint32_t framesInFlight = 1u);
+
+    // Wait until the current slot's previous frame has retired. Returns the fence's completed
+    //  value, everything committed up to which may be recycled. Fence provides
+    //  isFenceComplete, waitForFenceVal and completedValue, like CommandQueue.
+    template <typename Fence> uint64_t begin(Fence& fence)
+    {
+        const uint64_t pending = this->pendingFence();
+        if (!fence.isFenceComplete(pending)) {
+            const auto t0 = std::chrono::high_resolution_clock::now();
+            fence.waitForFenceVal(pending);
+            const std::chrono::duration<double, std::milli> blocked =
+                std::chrono::high_resolution_clock::now() - t0;
+            this->addWaitTime(blocked.count());
+        }
+        return fence.completedValue();
+    }
+
+    // Account for time the next frame spent waiting on its fence outside of begin()
+    void addWaitTime(double ms);
+    // Record the fence value that retires the current frame and advance to the next slot.
+    //  Fence values must not decrease from one frame to the next.
+    void end(uint64_t fenceValue);
+    uint32_t currentSlot() const;
+    // Fence value that retires the frame last recorded into the current slot, 0 if none was
+    uint64_t pendingFence() const;
+    uint32_t size() const;
+    uint64_t frameNumber() const;
+    const Stats& stats() const;
+
+   private:
+    std::vector<uint64_t> fenceValues;
+    uint64_t lastFenceValue = 0u;
+    uint64_t frameIndex = 0u;
+    Stats frameStats;
+};
@@ -0,0 +1,47 @@
+module;
+
+#include <cstdint>
+#include <limits>
+#include <map>
+
+export module free_list;
+
+// Range allocator over [0, capacity). Free blocks are indexed both by offset, to merge a freed
+//  block with its neighbors, and by size, for best-fit allocation in O(log n).
+export class FreeList
+{
+   public:
+    static constexpr uint32_t invalidOffset = std::numeric_limits<uint32_t>::max();
+
+    struct Stats
+    {
+        uint32_t capacity = 0u;
+        uint32_t freeCount = 0u;
+        uint32_t freeBlocks = 0u;
+        uint32_t largestFreeBlock = 0u;
+    };
+
+    FreeList() = default;
+    explicit FreeList(uint32_t capacity);
+
+    // Offset of the smallest free block that fits count, split off its front
+    uint32_t allocate(uint32_t count);
+    // Return a block, merging it with free neighbors
+    void free(uint32_t offset, uint32_t count);
+
+    uint32_t capacity() const;
+    uint32_t freeCount() const;
+    Stats stats() const;
+
+   private:
+    using SizeMap = std::multimap<uint32_t, uint32_t>;
+    using OffsetMap = std::map<uint32_t, SizeMap::iterator>;
+
+    uint32_t size = 0u;
+    uint32_t nFree = 0u;
+    // offset -> its entry in bySize, and size -> offset
+    OffsetMap byOffset;
+    SizeMap bySize;
+
+    void addBlock(uint32_t offset, uint32_t count);
+};
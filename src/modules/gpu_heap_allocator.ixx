@@ -0,0 +1,145 @@
+module;
+
+#include <d3d12.h>
+#include <wrl.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+export module gpu_heap_allocator;
+
+export import common;
+export import tlsf_allocator;
+
+export class GpuHeapAllocator;
+
+// Placed resource and the heap range backing it, returned to the allocator on destruction.
+//  The GPU must be done with the resource before then.
+export class GpuAllocation
+{
+   public:
+    GpuAllocation() = default;
+    ~GpuAllocation();
+    GpuAllocation(const GpuAllocation&) = delete;
+    GpuAllocation& operator=(const GpuAllocation&) = delete;
+    GpuAllocation(GpuAllocation&& other) noexcept;
+    GpuAllocation& operator=(GpuAllocation&& other) noexcept;
+
+    bool isNull() const;
+    ID3D12Resource* get() const;
+    const ComPtr<ID3D12Resource>& resource() const;
+    uint64_t sizeInBytes() const;
+
+   private:
+    ComPtr<ID3D12Resource> placed;
+    GpuHeapAllocator* owner = nullptr;
+    uint32_t pool = 0u;
+    uint32_t heap = 0u;
+    TlsfAllocator::Handle block = TlsfAllocator::invalidHandle;
+    uint64_t size = 0u;
+
+    void free();
+
+    friend class GpuHeapAllocator;
+};
+
+// Reserves large ID3D12Heaps and places resources in them, so creating a resource doesn't
+//  create a heap of its own. Heaps are pooled per heap type and per resource category
+//  (buffers, textures, render target and depth textures), which resource heap tier 1
+//  requires to be kept apart. Ranges within a heap come from a TLSF allocator.
+export class GpuHeapAllocator
+{
+   public:
+    struct Stats
+    {
+        uint32_t heaps = 0u;
+        uint64_t heapBytes = 0u;
+        uint64_t usedBytes = 0u;
+        uint32_t allocations = 0u;
+        uint32_t freeBlocks = 0u;
+        uint64_t largestFreeBlock = 0u;
+    };
+
+    // Resource about to be moved by defragmentation, dst is placed at its new location
+    struct DefragMove
+    {
+        ID3D12Resource* src;
+        ComPtr<ID3D12Resource> dst;
+    };
+
+    GpuHeapAllocator(ComPtr<ID3D12Device2> device, uint64_t heapSize = 64_MB);
+
+    GpuAllocation createResource(
+        const D3D12_RESOURCE_DESC& desc,
+        D3D12_HEAP_TYPE heapType,
+        D3D12_RESOURCE_STATES initialState,
+        const D3D12_CLEAR_VALUE* clearValue = nullptr
+    );
+
+    // Defragmentation hooks. beginDefragment plans up to maxMoves moves per heap of heapType
+    //  toward the start of the heap and places each moved resource again at its destination,
+    //  in the moved resource's current state. The caller records a copy from src to dst for
+    //  every move, and once the copies have completed on the GPU calls endDefragment, which
+    //  points the allocations at their new resources and frees the old ranges. Views of moved
+    //  resources have to be recreated afterwards.
+    std::vector<DefragMove> beginDefragment(
+        D3D12_HEAP_TYPE heapType,
+        uint32_t maxMoves,
+        D3D12_RESOURCE_STATES state = D3D12_RESOURCE_STATE_COMMON
+    );
+    void endDefragment();
+
+    // Heap an allocation is placed in. Residency of placed resources is managed through their
+    //  heap, which other allocations may share.
+    ComPtr<ID3D12Heap> heapOf(const GpuAllocation& allocation);
+
+    Stats stats();
+
+   private:
+    enum class Category
+    {
+        Buffers,
+        Textures,
+        RenderTargets
+    };
+
+    struct Heap
+    {
+        ComPtr<ID3D12Heap> heap;
+        TlsfAllocator ranges;
+        // Allocation owning each TLSF block, indexed by handle, so defragmentation can move it
+        std::vector<GpuAllocation*> owners;
+        bool dedicated = false;
+    };
+
+    struct Pool
+    {
+        D3D12_HEAP_TYPE heapType;
+        Category category;
+        std::vector<std::unique_ptr<Heap>> heaps;
+    };
+
+    struct PendingMove
+    {
+        uint32_t pool;
+        uint32_t heap;
+        TlsfAllocator::Handle src;
+        TlsfAllocator::Handle dst;
+        ComPtr<ID3D12Resource> resource;
+    };
+
+    ComPtr<ID3D12Device2> device;
+    const uint64_t heapSize;
+    std::vector<Pool> pools;
+    std::vector<PendingMove> pendingMoves;
+    std::mutex mutex;
+
+    static uint64_t placementGranularity(Category category);
+    uint32_t findPool(D3D12_HEAP_TYPE heapType, Category category);
+    uint32_t createHeap(Pool& pool, uint64_t size, bool dedicated);
+    void setOwner(const GpuAllocation& allocation, GpuAllocation* owner);
+    void free(GpuAllocation& allocation);
+
+    friend class GpuAllocation;
+};
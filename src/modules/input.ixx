@@ -140,6 +140,7 @@ export namespace Button
         Exit,
         ScrollUp,
         ScrollDown,
+        DumpTelemetry,
     };
 }
 
@@ -0,0 +1,151 @@
+module;
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+export module large_page_pool;
+
+// Dedicated pages for allocations too big for a regular page, pooled by power-of-two size
+//  class so a later allocation of a similar size reuses memory instead of creating a new
+//  resource. A page handed out by acquire() stays in use until the tag it was committed with
+//  is retired. Pages that sit unused in the pool for trimAfterFrames frames are released.
+export template <typename Page> class LargePagePool
+{
+   public:
+    using Factory = std::function<std::unique_ptr<Page>(size_t sizeInBytes)>;
+
+    struct Stats
+    {
+        uint64_t pagesCreated = 0u;
+        uint64_t pagesReused = 0u;
+        uint64_t pagesTrimmed = 0u;
+        // Bytes of pages in use plus pages idling in the pool
+        size_t residentBytes = 0u;
+        size_t peakResidentBytes = 0u;
+    };
+
+    LargePagePool() = default;
+    LargePagePool(Factory factory, size_t minClassSize, uint32_t trimAfterFrames)
+        : factory(std::move(factory)),
+          minClassSize(std::bit_ceil(std::max<size_t>(minClassSize, 1u))),
+          trimAfterFrames(trimAfterFrames)
+    {
+    }
+
+    // Size of the page that serves an allocation of sizeInBytes
+    size_t classSize(size_t sizeInBytes) const
+    {
+        return std::bit_ceil(std::max(sizeInBytes, this->minClassSize));
+    }
+
+    // Page of at least sizeInBytes, in use until a commit() tag covering it is retired
+    Page& acquire(size_t sizeInBytes)
+    {
+        const size_t size = this->classSize(sizeInBytes);
+        const size_t sizeClass = std::countr_zero(size);
+        if (this->freePages.size() <= sizeClass) {
+            this->freePages.resize(sizeClass + 1u);
+        }
+
+        Entry entry;
+        std::vector<Entry>& pool = this->freePages[sizeClass];
+        if (!pool.empty()) {
+            // Most recently released first, so pages that keep getting used stay warm and
+            //  the rest age out
+            entry = std::move(pool.back());
+            pool.pop_back();
+            this->poolStats.pagesReused++;
+        } else {
+            entry.page = this->factory(size);
+            entry.size = size;
+            this->poolStats.pagesCreated++;
+            this->poolStats.residentBytes += size;
+            this->poolStats.peakResidentBytes =
+                std::max(this->poolStats.peakResidentBytes, this->poolStats.residentBytes);
+        }
+
+        entry.tag = uncommitted;
+        this->inUse.push_back(std::move(entry));
+        return *this->inUse.back().page;
+    }
+
+    // Tag every page acquired since the last commit, they return to the pool once tag retires
+    void commit(uint64_t tag)
+    {
+        for (Entry& entry : this->inUse) {
+            if (entry.tag == uncommitted) {
+                entry.tag = tag;
+            }
+        }
+    }
+
+    // Return pages committed with tags <= completed to the pool. Passing the maximum value
+    //  also returns uncommitted pages.
+    void retire(uint64_t completed)
+    {
+        auto done = std::stable_partition(
+            this->inUse.begin(), this->inUse.end(),
+            [&](const Entry& e) { return e.tag > completed; }
+        );
+        for (auto it = done; it != this->inUse.end(); ++it) {
+            it->tag = this->frame;
+            this->freePages[std::countr_zero(it->size)].push_back(std::move(*it));
+        }
+        this->inUse.erase(done, this->inUse.end());
+    }
+
+    // Advance the frame count and release pages idle for longer than trimAfterFrames
+    void endFrame()
+    {
+        this->frame++;
+        for (std::vector<Entry>& pool : this->freePages) {
+            // Pool entries are ordered by release frame, oldest first
+            auto keep = std::find_if(pool.begin(), pool.end(), [&](const Entry& e) {
+                return this->frame - e.tag <= this->trimAfterFrames;
+            });
+            for (auto it = pool.begin(); it != keep; ++it) {
+                this->poolStats.residentBytes -= it->size;
+                this->poolStats.pagesTrimmed++;
+            }
+            pool.erase(pool.begin(), keep);
+        }
+    }
+
+    const Stats& stats() const { return this->poolStats; }
+    // Bytes of the pages currently handed out
+    size_t inUseBytes() const
+    {
+        size_t bytes = 0u;
+        for (const Entry& entry : this->inUse) {
+            bytes += entry.size;
+        }
+        return bytes;
+    }
+
+   private:
+    static constexpr uint64_t uncommitted = std::numeric_limits<uint64_t>::max();
+
+    // While in use, tag is the retire tag. While pooled, it's the frame it was released on.
+    struct Entry
+    {
+        std::unique_ptr<Page> page;
+        size_t size = 0u;
+        uint64_t tag = 0u;
+    };
+
+    Factory factory;
+    size_t minClassSize = 1u;
+    uint32_t trimAfterFrames = 0u;
+    uint64_t frame = 0u;
+    std::vector<Entry> inUse;
+    // Indexed by log2 of the page size
+    std::vector<std::vector<Entry>> freePages;
+    Stats poolStats;
+};
@@ -0,0 +1,112 @@
+module;
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+
+export module mpsc_ring;
+
+// Bounded lock-free queue for many producers and a single consumer. Every push claims the next
+//  position of a global sequence, and values are popped strictly in that order, so pushes from
+//  one thread are always consumed in the order they were made.
+export template <typename T> class MpscRing
+{
+   public:
+    explicit MpscRing(size_t capacity = 64u)
+        : capacity(std::bit_ceil(std::max<size_t>(capacity, 2u))),
+          cells(std::make_unique<Cell[]>(this->capacity))
+    {
+        for (size_t i = 0u; i < this->capacity; i++) {
+            this->cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Returns the position the value was queued at. Yields while the ring is full.
+    uint64_t push(T value)
+    {
+        uint64_t pos = this->enqueuePos.load(std::memory_order_relaxed);
+        Cell* cell = nullptr;
+        while (true) {
+            cell = &this->cells[pos & (this->capacity - 1u)];
+            const uint64_t seq = cell->sequence.load(std::memory_order_acquire);
+            const int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+            if (diff == 0) {
+                if (this->enqueuePos.compare_exchange_weak(
+                        pos, pos + 1u, std::memory_order_relaxed
+                    )) {
+                    break;
+                }
+            } else if (diff < 0) {
+                // Consumer hasn't freed this cell yet
+                this->fullStalls.fetch_add(1u, std::memory_order_relaxed);
+                std::this_thread::yield();
+                pos = this->enqueuePos.load(std::memory_order_relaxed);
+            } else {
+                pos = this->enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1u, std::memory_order_release);
+
+        this->published.fetch_add(1u, std::memory_order_release);
+        this->published.notify_one();
+        return pos;
+    }
+
+    // Consumer only. Fails if the next value in sequence hasn't been published yet, even if
+    //  later ones have.
+    bool tryPop(T& out)
+    {
+        Cell& cell = this->cells[this->dequeuePos & (this->capacity - 1u)];
+        const uint64_t seq = cell.sequence.load(std::memory_order_acquire);
+        if (seq != this->dequeuePos + 1u) {
+            return false;
+        }
+        out = std::move(cell.value);
+        cell.sequence.store(this->dequeuePos + this->capacity, std::memory_order_release);
+        this->dequeuePos++;
+        return true;
+    }
+
+    // Consumer only. Take a snapshot before draining, then pass it here once the ring came up
+    //  empty to sleep until something is pushed after the snapshot.
+    uint64_t pushSnapshot() const { return this->published.load(std::memory_order_acquire); }
+    void waitForPush(uint64_t snapshot) const
+    {
+        this->published.wait(snapshot, std::memory_order_acquire);
+    }
+    // Wake a consumer blocked in waitForPush without pushing anything
+    void wakeConsumer()
+    {
+        this->published.fetch_add(1u, std::memory_order_release);
+        this->published.notify_one();
+    }
+
+    // Positions claimed so far, and popped so far (consumer only)
+    uint64_t pushed() const { return this->enqueuePos.load(std::memory_order_acquire); }
+    uint64_t popped() const { return this->dequeuePos; }
+    uint64_t stalls() const { return this->fullStalls.load(std::memory_order_relaxed); }
+    size_t size() const { return this->capacity; }
+
+   private:
+    struct Cell
+    {
+        std::atomic<uint64_t> sequence;
+        T value;
+    };
+
+    size_t capacity;
+    std::unique_ptr<Cell[]> cells;
+
+    // Producers and consumer counters live on separate cache lines
+    alignas(64) std::atomic<uint64_t> enqueuePos = 0u;
+    alignas(64) std::atomic<uint64_t> published = 0u;
+    std::atomic<uint64_t> fullStalls = 0u;
+    alignas(64) uint64_t dequeuePos = 0u;
+};
@@ -0,0 +1,63 @@
+module;
+
+#include <d3d12.h>
+#include <wrl.h>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+export module pipeline_cache;
+
+export import common;
+export import pipeline_key;
+
+// Pipeline states kept in a pipeline library that's saved to disk and loaded again on the next
+//  launch, so the driver only compiles a pipeline the first time it's ever used. Pipelines are
+//  named in the library by the hash of their stream, so any change to a shader or state makes
+//  a new entry rather than loading a stale one. A missing, corrupt or rejected cache file (a
+//  new driver throws the old library out) just starts an empty library.
+export class PipelineCache
+{
+   public:
+    struct Stats
+    {
+        // Loaded from the library
+        uint64_t hits = 0u;
+        // Compiled and stored in the library
+        uint64_t misses = 0u;
+        // Already created this run
+        uint64_t reused = 0u;
+        double loadMs = 0.0;
+        double createMs = 0.0;
+        uint64_t loadedBytes = 0u;
+        uint64_t savedBytes = 0u;
+    };
+
+    PipelineCache(ComPtr<ID3D12Device2> device, std::string path);
+
+    // Pipeline state for a stream, rootSignature being the serialized blob of the root
+    //  signature in it
+    ComPtr<ID3D12PipelineState> create(
+        const D3D12_PIPELINE_STATE_STREAM_DESC& desc,
+        std::span<const uint8_t> rootSignature
+    );
+    // Write the library out if pipelines were added to it
+    void save();
+    Stats stats();
+
+   private:
+    ComPtr<ID3D12Device2> device;
+    const std::string path;
+    // Backs the library, which reads from it for as long as it lives
+    std::vector<uint8_t> fileData;
+    ComPtr<ID3D12PipelineLibrary1> library;
+    std::unordered_map<uint64_t, ComPtr<ID3D12PipelineState>> pipelines;
+    bool dirty = false;
+    Stats cacheStats;
+    std::mutex mutex;
+
+    void createLibrary(std::span<const uint8_t> blob);
+};
@@ -0,0 +1,28 @@
+module;
+
+#include <d3d12.h>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+export module pipeline_key;
+
+// Hash of everything a pipeline state stream describes, the same from one run to the next:
+//  shader bytecode, input layout semantics and the contents of every other subobject are
+//  hashed, never the addresses they're at. The root signature is hashed from its serialized
+//  blob, since only that identifies it across runs. Cached PSO subobjects don't change what
+//  the pipeline is and are skipped. Throws on a subobject type it doesn't know.
+export uint64_t hashPipelineStream(
+    const D3D12_PIPELINE_STATE_STREAM_DESC& desc,
+    std::span<const uint8_t> rootSignature
+);
+
+// Name of the pipeline with a key in a pipeline library
+export std::wstring pipelineName(uint64_t key);
+
+// Pipeline cache file: a header with a magic number, format version, and the size and hash of
+//  the serialized pipeline library that follows it. Decoding returns the library, or nothing
+//  if the file is truncated, from another format version or corrupt.
+export std::vector<uint8_t> encodePipelineCache(std::span<const uint8_t> library);
+export std::span<const uint8_t> decodePipelineCache(std::span<const uint8_t> file);
@@ -0,0 +1,252 @@
+module;
+
+#include <d3d12.h>
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <span>
+#include <string_view>
+#include <vector>
+
+export module render_graph;
+
+export import alias_planner;
+export import resource_states;
+
+// One frame's passes and the resources they read and write. Passes may be declared in any
+//  order: writing a resource yields its next version, and reads name the version they need,
+//  so compile() can order passes by what they produce and consume. Passes whose outputs
+//  nothing reads or exports are culled. Every resource state is known up front, so the
+//  barriers before each pass are computed once, with consecutive reads merged into one read
+//  state. Transitions are split to begin right after a resource's previous use and end just
+//  before the next where both fall in one command list, so the GPU can overlap them with the
+//  passes in between. The command lists can then be recorded in any order or in parallel.
+//  Transient resources only live within the graph, and ones not live at the same time share
+//  memory.
+// ResourceStates stays the record of states between frames: imported resources start in the
+//  state it has for them and commitStates() writes back what the graph leaves them in. Within
+//  the frame the graph knows the state at every list boundary when it compiles, so lists need
+//  no state tracking of their own while recorded, and no fixup lists resolving the states they
+//  find at submit.
+export class RenderGraph
+{
+   public:
+    // A version of a resource
+    using ResourceId = uint32_t;
+    static constexpr uint32_t none = UINT32_MAX;
+
+    struct Context
+    {
+        ID3D12GraphicsCommandList2* cmdList;
+        // Part of the pass being recorded, and the list it's recorded into
+        uint32_t part;
+        uint32_t list;
+    };
+    using Execute = std::function<void(const Context&)>;
+
+    // Where a transient goes in the planned heaps, and the state to create it in
+    struct TransientPlacement
+    {
+        uint32_t heap;
+        uint64_t offset;
+        D3D12_RESOURCE_STATES initialState;
+    };
+    // Creates the placed resource of a transient, given the version createTransient returned
+    using PlaceTransient =
+        std::function<ID3D12Resource*(ResourceId transient, const TransientPlacement&)>;
+
+    struct Stats
+    {
+        uint64_t passes = 0u;
+        uint64_t culledPasses = 0u;
+        uint64_t barriers = 0u;
+        uint64_t lists = 0u;
+        // Transitions split into a begin and an end barrier, both counted in barriers
+        uint64_t splitBarriers = 0u;
+        // Transient bytes if each had its own memory, and the heap bytes they were packed into
+        uint64_t transientBytes = 0u;
+        uint64_t transientHeapBytes = 0u;
+    };
+
+    // Positions a transition between two uses of a resource begins and ends at, the same one
+    //  when it isn't split
+    struct SplitPlacement
+    {
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    class PassBuilder
+    {
+       public:
+        PassBuilder& read(ResourceId version, D3D12_RESOURCE_STATES state);
+        // Modify a version, returning the one the pass produces. Throws if the version was
+        //  already written, resources can't fork.
+        ResourceId write(ResourceId version, D3D12_RESOURCE_STATES state);
+        // Recorded as several parts, each into its own command list
+        PassBuilder& parts(uint32_t nParts);
+        // Never culled, for passes with effects outside the graph
+        PassBuilder& sideEffects();
+
+       private:
+        friend class RenderGraph;
+        PassBuilder(RenderGraph* graph, uint32_t pass) : graph(graph), pass(pass) {}
+
+        RenderGraph* graph;
+        uint32_t pass;
+    };
+
+    explicit RenderGraph(
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource()
+    );
+
+    ResourceId importResource(
+        std::string_view name,
+        ID3D12Resource* resource,
+        D3D12_RESOURCE_STATES state
+    );
+    // Imported in the state the submitted lists leave it in
+    ResourceId importResource(
+        std::string_view name,
+        ID3D12Resource* resource,
+        const ResourceStates& states
+    );
+    // Resource placed by compile() in memory it may share with transients whose uses don't
+    //  overlap its own. Transients in the same heap group may share a heap. Its first use has
+    //  to initialize it fully with a clear, discard or copy, as the memory holds whatever was
+    //  last placed there.
+    ResourceId createTransient(
+        std::string_view name,
+        uint64_t size,
+        uint64_t alignment,
+        uint32_t heapGroup = 0u
+    );
+    // Keep a version's producers and leave the resource in a state once the graph is done
+    void exportResource(ResourceId version, D3D12_RESOURCE_STATES state);
+    PassBuilder addPass(std::string_view name, Execute execute);
+
+    // Cull, order, place transients and compute barriers. Throws on a cycle, or if transients
+    //  are used with nothing to place them.
+    void compile(const PlaceTransient& place = nullptr);
+
+    // Declaration indices of the passes left, in execution order
+    std::span<const uint32_t> passOrder() const;
+    bool culled(uint32_t pass) const;
+    std::span<const D3D12_RESOURCE_BARRIER> barriersBefore(uint32_t pass) const;
+    // Transitions into the exported states, at the end of the last list
+    std::span<const D3D12_RESOURCE_BARRIER> finalBarriers() const;
+    // State the graph leaves a version's resource in
+    D3D12_RESOURCE_STATES finalState(ResourceId version) const;
+    // Record the final states of the imported resources, once the lists are submitted
+    void commitStates(ResourceStates& states) const;
+    std::string_view passName(uint32_t pass) const;
+    // Imported resource, or transient once placed
+    ID3D12Resource* resource(ResourceId version) const;
+    // Heaps the transients are placed in, planned by the time they're placed
+    std::span<const AliasPlanner::Heap> transientHeaps() const;
+
+    // Lists to record and execute in order. A run of single part passes shares a list with
+    //  the first part of the pass after it, every other part gets its own.
+    uint32_t listCount() const;
+    // Different lists may be recorded on different threads at once
+    void recordList(uint32_t list, ID3D12GraphicsCommandList2* cmdList) const;
+
+    Stats stats() const;
+
+    // Where the transition for the use at position next goes, given the use before it at
+    //  position previous (none for the first). It ends right before next and begins right
+    //  after previous, when passes run in between and both positions are recorded into the
+    //  same list. positionLists holds the list of each position, that of the final barriers
+    //  last.
+    static SplitPlacement splitPlacement(
+        uint32_t previous,
+        uint32_t next,
+        std::span<const uint32_t> positionLists
+    );
+
+   private:
+    struct Resource
+    {
+        std::string_view name;
+        ID3D12Resource* resource;
+        D3D12_RESOURCE_STATES initialState;
+        D3D12_RESOURCE_STATES finalState;
+        ResourceId exportedVersion = none;
+        // Transients only: first version, size, and the request planning their memory
+        ResourceId firstVersion = none;
+        uint64_t size = 0u;
+        uint64_t alignment = 0u;
+        uint32_t heapGroup = 0u;
+        uint32_t request = none;
+    };
+
+    struct Version
+    {
+        uint32_t resource;
+        uint32_t producer = none;
+        // The pass that modifies this version into the next, if any
+        uint32_t writer = none;
+    };
+
+    struct Access
+    {
+        // Version read, or modified for a write
+        ResourceId version;
+        D3D12_RESOURCE_STATES state;
+        bool write;
+    };
+
+    struct Pass
+    {
+        std::string_view name;
+        Execute execute;
+        std::pmr::vector<Access> accesses;
+        uint32_t parts = 1u;
+        bool sideEffects = false;
+        bool culled = false;
+        uint32_t firstBarrier = 0u;
+        uint32_t nBarriers = 0u;
+        // List the first part is recorded into
+        uint32_t list = 0u;
+    };
+
+    // Accesses of a resource by a pass, merged into one
+    struct Use
+    {
+        uint32_t resource;
+        uint32_t position;
+        D3D12_RESOURCE_STATES state;
+        bool write;
+    };
+
+    struct Unit
+    {
+        uint32_t pass;
+        uint32_t part;
+    };
+
+    std::pmr::memory_resource* memory;
+    std::pmr::vector<Resource> resources;
+    std::pmr::vector<Version> versions;
+    std::pmr::vector<Pass> passes;
+    std::pmr::vector<uint32_t> order;
+    // Uses by resource, then execution order
+    std::pmr::vector<Use> uses;
+    AliasPlanner aliasing;
+    // Resource of each aliasing request
+    std::pmr::vector<uint32_t> transients;
+    std::pmr::vector<D3D12_RESOURCE_BARRIER> barriers;
+    uint32_t firstFinalBarrier = 0u;
+    uint32_t nSplitBarriers = 0u;
+    // Units of each list, list i being units [listStarts[i], listStarts[i + 1])
+    std::pmr::vector<Unit> units;
+    std::pmr::vector<uint32_t> listStarts;
+    bool compiled = false;
+
+    void cull();
+    void sort();
+    void collectUses();
+    void placeTransients(const PlaceTransient& place);
+    void buildLists();
+    void computeBarriers();
+};
@@ -0,0 +1,90 @@
+module;
+
+#include <d3d12.h>
+#include <wrl.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+export module render_target_pool;
+
+export import common;
+export import buddy_allocator;
+
+// Render and depth targets placed in large RT/DS heaps, carved up by a buddy allocator so
+//  64KB and 4MB (MSAA) placement alignment fall out of the block sizes. Released targets stay
+//  cached and are handed out again to an acquire() with the same description; targets that
+//  sit released for more than retainFrames frames give their memory back once the GPU is done
+//  with them. Targets are meant to be used on one queue, where a later acquire of a released
+//  target is ordered after its previous use.
+export class RenderTargetPool
+{
+   public:
+    struct Stats
+    {
+        uint32_t heaps = 0u;
+        uint64_t heapBytes = 0u;
+        uint64_t allocatedBytes = 0u;
+        uint64_t requestedBytes = 0u;
+        uint32_t targets = 0u;
+        uint64_t created = 0u;
+        uint64_t reused = 0u;
+        uint64_t evicted = 0u;
+
+        // Share of allocated bytes lost to rounding targets up to a power of two
+        double internalFragmentation() const;
+    };
+
+    RenderTargetPool(
+        ComPtr<ID3D12Device2> device,
+        uint64_t heapSize = 128_MB,
+        uint32_t retainFrames = 3u
+    );
+
+    // Target matching desc, created in initialState if there's no released one to reuse. A
+    //  reused target is in the state it was released in.
+    ComPtr<ID3D12Resource> acquire(
+        const D3D12_RESOURCE_DESC& desc,
+        D3D12_RESOURCE_STATES initialState,
+        const D3D12_CLEAR_VALUE* clearValue = nullptr
+    );
+    // Hand a target back, its last use completes at fenceValue
+    void release(ID3D12Resource* target, uint64_t fenceValue);
+    // Advance the frame count and free targets released long enough ago and done on the GPU
+    void endFrame(uint64_t completedValue);
+    Stats stats();
+
+   private:
+    struct Heap
+    {
+        ComPtr<ID3D12Heap> heap;
+        BuddyAllocator blocks;
+    };
+
+    struct Target
+    {
+        ComPtr<ID3D12Resource> resource;
+        D3D12_RESOURCE_DESC desc;
+        D3D12_CLEAR_VALUE clearValue;
+        bool hasClearValue;
+        uint32_t heap;
+        uint64_t offset;
+        bool inUse;
+        uint64_t fenceValue;
+        uint64_t releasedFrame;
+    };
+
+    ComPtr<ID3D12Device2> device;
+    const uint64_t heapSize;
+    const uint32_t retainFrames;
+    std::vector<std::unique_ptr<Heap>> heaps;
+    std::vector<Target> targets;
+    uint64_t frame = 0u;
+    uint64_t nCreated = 0u;
+    uint64_t nReused = 0u;
+    uint64_t nEvicted = 0u;
+    std::mutex mutex;
+
+    uint32_t createHeap(uint64_t size);
+};
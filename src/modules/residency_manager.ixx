@@ -0,0 +1,56 @@
+module;
+
+#include <d3d12.h>
+#include <dxgi1_6.h>
+#include <wrl.h>
+#include <cstdint>
+
+export module residency_manager;
+
+export import common;
+export import residency_set;
+
+export enum class ResidencyCategory : uint32_t
+{
+    Buffers,
+    Textures,
+    RenderTargets,
+    Heaps,
+    Count
+};
+
+export const char* residencyCategoryName(ResidencyCategory category);
+
+// Keeps tracked resources and heaps within the adapter's local memory budget. The budget is
+//  polled once per frame, least recently used objects are evicted in one Evict call when over
+//  it, and evicted objects used again are brought back in one MakeResident call.
+export class ResidencyManager
+{
+   public:
+    using Set = ResidencySet<ComPtr<ID3D12Pageable>>;
+    using Handle = Set::Handle;
+
+    ResidencyManager(
+        ComPtr<ID3D12Device2> device,
+        ComPtr<IDXGIAdapter3> adapter,
+        uint32_t minIdleFrames
+    );
+
+    Handle track(ComPtr<ID3D12Pageable> object, uint64_t sizeInBytes, ResidencyCategory category);
+    void untrack(Handle handle);
+    void markUsed(Handle handle);
+    // Poll the budget and evict or make resident as needed. Call after recording a frame and
+    //  before submitting it, since MakeResident returns once the objects are usable.
+    void update();
+
+    // Budget left for tracked objects after what the rest of the process uses
+    uint64_t budget() const;
+    const Set::CategoryStats& category(ResidencyCategory category) const;
+    const Set::Stats& stats() const;
+
+   private:
+    ComPtr<ID3D12Device2> device;
+    ComPtr<IDXGIAdapter3> adapter;
+    Set set;
+    uint64_t trackedBudget = 0u;
+};
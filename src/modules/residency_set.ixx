@@ -0,0 +1,235 @@
+module;
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+export module residency_set;
+
+// Tracks the size and last use of objects that can be paged out of video memory, and decides
+//  what to evict and what to bring back against a memory budget. Resident objects are kept in
+//  least-recently-used order, so finding eviction candidates never scans. The actual paging is
+//  left to the callbacks passed to update(), each called with one batch per update.
+export template <typename Object> class ResidencySet
+{
+   public:
+    using Handle = uint32_t;
+    static constexpr Handle invalidHandle = std::numeric_limits<Handle>::max();
+    static constexpr uint32_t maxCategories = 8u;
+
+    struct CategoryStats
+    {
+        uint64_t residentBytes = 0u;
+        uint64_t evictedBytes = 0u;
+        uint64_t evictions = 0u;
+        uint64_t madeResident = 0u;
+    };
+
+    struct Stats
+    {
+        uint64_t residentBytes = 0u;
+        uint64_t evictedBytes = 0u;
+        uint64_t evictBatches = 0u;
+        uint64_t makeResidentBatches = 0u;
+        // Updates that couldn't get under budget because everything left was recently used
+        uint64_t overBudgetUpdates = 0u;
+    };
+
+    // Objects used within the last minIdleFrames frames are never evicted, since the GPU may
+    //  still be working on the frames that used them
+    explicit ResidencySet(uint32_t minIdleFrames) : minIdleFrames(minIdleFrames) {}
+
+    // Start tracking a resident object
+    Handle track(Object object, uint64_t sizeInBytes, uint32_t category = 0u)
+    {
+        std::scoped_lock lock(this->mutex);
+        Handle handle;
+        if (!this->unusedSlots.empty()) {
+            handle = this->unusedSlots.back();
+            this->unusedSlots.pop_back();
+        } else {
+            handle = static_cast<Handle>(this->entries.size());
+            this->entries.emplace_back();
+        }
+
+        Entry& entry = this->entries[handle];
+        entry = {};
+        entry.object = std::move(object);
+        entry.size = sizeInBytes;
+        entry.category = category;
+        entry.lastUsed = this->frame;
+        entry.resident = true;
+        this->pushMostRecent(handle);
+        this->setStats.residentBytes += sizeInBytes;
+        this->categoryStats[category].residentBytes += sizeInBytes;
+        return handle;
+    }
+
+    void untrack(Handle handle)
+    {
+        std::scoped_lock lock(this->mutex);
+        Entry& entry = this->entries[handle];
+        if (entry.resident) {
+            this->unlink(handle);
+            this->setStats.residentBytes -= entry.size;
+            this->categoryStats[entry.category].residentBytes -= entry.size;
+        } else {
+            this->setStats.evictedBytes -= entry.size;
+            this->categoryStats[entry.category].evictedBytes -= entry.size;
+        }
+        if (entry.pending) {
+            std::erase(this->pending, handle);
+        }
+        entry = {};
+        this->unusedSlots.push_back(handle);
+    }
+
+    // Record a use in the current frame. An evicted object is made resident by the next
+    //  update(), which has to happen before the work using it is submitted.
+    void markUsed(Handle handle)
+    {
+        std::scoped_lock lock(this->mutex);
+        Entry& entry = this->entries[handle];
+        entry.lastUsed = this->frame;
+        if (entry.resident) {
+            this->unlink(handle);
+            this->pushMostRecent(handle);
+        } else if (!entry.pending) {
+            entry.pending = true;
+            this->pending.push_back(handle);
+        }
+    }
+
+    // Evict least recently used objects until resident bytes plus the objects waiting to be
+    //  made resident fit in budget, then make those resident. Advances to the next frame.
+    template <typename MakeResidentFn, typename EvictFn>
+    void update(uint64_t budget, MakeResidentFn&& makeResident, EvictFn&& evict)
+    {
+        std::scoped_lock lock(this->mutex);
+
+        uint64_t pendingBytes = 0u;
+        for (Handle handle : this->pending) {
+            pendingBytes += this->entries[handle].size;
+        }
+
+        this->batch.clear();
+        while (this->setStats.residentBytes + pendingBytes > budget &&
+               this->leastRecent != invalidHandle) {
+            Entry& entry = this->entries[this->leastRecent];
+            if (this->frame - entry.lastUsed < this->minIdleFrames) {
+                this->setStats.overBudgetUpdates++;
+                break;
+            }
+            this->batch.push_back(entry.object);
+            this->unlink(this->leastRecent);
+            entry.resident = false;
+            this->moveBytes(entry, false);
+            this->categoryStats[entry.category].evictions++;
+        }
+        if (!this->batch.empty()) {
+            evict(std::span<const Object>(this->batch));
+            this->setStats.evictBatches++;
+        }
+
+        this->batch.clear();
+        for (Handle handle : this->pending) {
+            Entry& entry = this->entries[handle];
+            if (!entry.pending) {
+                continue;
+            }
+            this->batch.push_back(entry.object);
+            entry.pending = false;
+            entry.resident = true;
+            this->pushMostRecent(handle);
+            this->moveBytes(entry, true);
+            this->categoryStats[entry.category].madeResident++;
+        }
+        this->pending.clear();
+        if (!this->batch.empty()) {
+            makeResident(std::span<const Object>(this->batch));
+            this->setStats.makeResidentBatches++;
+        }
+
+        this->frame++;
+    }
+
+    const CategoryStats& category(uint32_t category) const
+    {
+        return this->categoryStats[category];
+    }
+    const Stats& stats() const { return this->setStats; }
+
+   private:
+    struct Entry
+    {
+        Object object = {};
+        uint64_t size = 0u;
+        uint64_t lastUsed = 0u;
+        uint32_t category = 0u;
+        Handle prev = invalidHandle;
+        Handle next = invalidHandle;
+        bool resident = false;
+        bool pending = false;
+    };
+
+    void pushMostRecent(Handle handle)
+    {
+        Entry& entry = this->entries[handle];
+        entry.prev = this->mostRecent;
+        entry.next = invalidHandle;
+        if (this->mostRecent != invalidHandle) {
+            this->entries[this->mostRecent].next = handle;
+        } else {
+            this->leastRecent = handle;
+        }
+        this->mostRecent = handle;
+    }
+
+    void unlink(Handle handle)
+    {
+        Entry& entry = this->entries[handle];
+        if (entry.prev != invalidHandle) {
+            this->entries[entry.prev].next = entry.next;
+        } else {
+            this->leastRecent = entry.next;
+        }
+        if (entry.next != invalidHandle) {
+            this->entries[entry.next].prev = entry.prev;
+        } else {
+            this->mostRecent = entry.prev;
+        }
+        entry.prev = entry.next = invalidHandle;
+    }
+
+    void moveBytes(const Entry& entry, bool toResident)
+    {
+        CategoryStats& c = this->categoryStats[entry.category];
+        if (toResident) {
+            this->setStats.evictedBytes -= entry.size;
+            this->setStats.residentBytes += entry.size;
+            c.evictedBytes -= entry.size;
+            c.residentBytes += entry.size;
+        } else {
+            this->setStats.residentBytes -= entry.size;
+            this->setStats.evictedBytes += entry.size;
+            c.residentBytes -= entry.size;
+            c.evictedBytes += entry.size;
+        }
+    }
+
+    const uint32_t minIdleFrames;
+    uint64_t frame = 0u;
+    std::vector<Entry> entries;
+    std::vector<Handle> unusedSlots;
+    std::vector<Handle> pending;
+    std::vector<Object> batch;
+    Handle leastRecent = invalidHandle;
+    Handle mostRecent = invalidHandle;
+    std::array<CategoryStats, maxCategories> categoryStats = {};
+    Stats setStats;
+    std::mutex mutex;
+};
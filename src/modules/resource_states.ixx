@@ -0,0 +1,34 @@
+module;
+
+#include <d3d12.h>
+#include <cstdint>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+export module resource_states;
+
+// State of every subresource of the registered resources, as left by the command lists
+//  submitted so far. Recording threads read it concurrently while frames are built, and the
+//  submitting thread writes back what the submitted lists leave behind.
+export class ResourceStates
+{
+   public:
+    void add(ID3D12Resource* resource, D3D12_RESOURCE_STATES state, uint32_t nSubresources = 1u);
+    void remove(ID3D12Resource* resource);
+
+    // State of one subresource, or of the whole resource if all its subresources agree
+    D3D12_RESOURCE_STATES state(
+        ID3D12Resource* resource,
+        UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES
+    ) const;
+    void setState(
+        ID3D12Resource* resource,
+        D3D12_RESOURCE_STATES state,
+        UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES
+    );
+
+   private:
+    std::unordered_map<ID3D12Resource*, std::vector<D3D12_RESOURCE_STATES>> resources;
+    mutable std::shared_mutex mutex;
+};
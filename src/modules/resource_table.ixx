@@ -0,0 +1,69 @@
+module;
+
+#include <d3d12.h>
+#include <wrl.h>
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+
+export module resource_table;
+
+export import common;
+export import resource_states;
+export import slot_map;
+
+// Registry of the GPU resources the application owns, referred to by generational handles
+//  instead of ComPtr copies. The table holds the one reference; size, heap type and name sit
+//  in their own dense columns next to it, per-subresource states in the ResourceStates that
+//  command lists are resolved against. Lookups may run on several recording threads at once,
+//  adding and removing take the table exclusively.
+export class ResourceTable
+{
+   public:
+    using Map = SlotMap<ComPtr<ID3D12Resource>, uint64_t, D3D12_HEAP_TYPE, std::string>;
+    using Handle = Map::Handle;
+
+    struct Stats
+    {
+        uint32_t resources = 0u;
+        uint64_t totalBytes = 0u;
+        uint64_t defaultHeapBytes = 0u;
+        uint64_t uploadHeapBytes = 0u;
+        uint64_t added = 0u;
+        uint64_t removed = 0u;
+    };
+
+    // Take over a resource in the given state. Its size, heap type and subresource count are
+    //  queried from the resource.
+    Handle add(ComPtr<ID3D12Resource> resource, D3D12_RESOURCE_STATES state, std::string name);
+    // Drop the table's reference, the handle and any copies of it go stale
+    void remove(Handle handle);
+
+    // nullptr for a stale handle. The pointer stays valid until the handle is removed.
+    ID3D12Resource* get(Handle handle) const;
+    bool contains(Handle handle) const;
+    D3D12_RESOURCE_STATES state(Handle handle) const;
+    void setState(Handle handle, D3D12_RESOURCE_STATES state);
+    uint64_t sizeInBytes(Handle handle) const;
+    D3D12_HEAP_TYPE heapType(Handle handle) const;
+    std::string name(Handle handle) const;
+    Stats stats() const;
+    ResourceStates& states();
+
+   private:
+    enum Column : size_t
+    {
+        Resource,
+        Size,
+        Heap,
+        Name
+    };
+
+    Map map;
+    ResourceStates resourceStates;
+    uint64_t nAdded = 0u;
+    uint64_t nRemoved = 0u;
+    mutable std::shared_mutex mutex;
+};
+
+export using ResourceHandle = ResourceTable::Handle;
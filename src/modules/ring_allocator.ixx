@@ -0,0 +1,70 @@
+module;
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+export module ring_allocator;
+
+// Offset bookkeeping for a circular buffer whose space is reclaimed in fence order. Blocks
+//  allocated between two commit() calls share the committed fence value, and retire() frees
+//  every batch whose fence has completed by moving the tail past it. Nothing is allocated
+//  after construction, and no GPU API is involved so the same logic backs any memory.
+export class RingAllocator
+{
+   public:
+    static constexpr size_t invalidOffset = std::numeric_limits<size_t>::max();
+
+    struct Stats
+    {
+        uint64_t allocations = 0u;
+        // Allocations that didn't fit until older fences retired
+        uint64_t failures = 0u;
+        // Bytes skipped at the end of the buffer when an allocation wrapped around
+        uint64_t wastedBytes = 0u;
+        size_t peakUsedBytes = 0u;
+    };
+
+    RingAllocator() = default;
+    explicit RingAllocator(size_t capacity, uint32_t maxPendingFences = 16u);
+
+    // Offset of an aligned block of sizeInBytes, or invalidOffset if it doesn't fit yet
+    size_t allocate(size_t sizeInBytes, size_t alignment);
+    // Tag everything allocated since the last commit with fenceValue. When more fences are
+    //  pending than the ring tracks, the newest batch absorbs this one.
+    void commit(uint64_t fenceValue);
+    // Reclaim every committed batch whose fence value is <= completedValue
+    void retire(uint64_t completedValue);
+    // Free everything, only valid once the GPU is idle
+    void reset();
+
+    size_t capacity() const;
+    size_t usedBytes() const;
+    // Largest allocation that would fit right now, ignoring alignment
+    size_t largestFreeBlock() const;
+    const Stats& stats() const;
+
+   private:
+    // Fence value retiring a batch, and where the head was when it was committed
+    struct Batch
+    {
+        uint64_t fenceValue = 0u;
+        size_t end = 0u;
+        uint64_t allocatedTotal = 0u;
+    };
+
+    size_t size = 0u;
+    size_t head = 0u;
+    size_t tail = 0u;
+    // Running byte totals including wrap waste, their difference is the space in use
+    uint64_t allocatedTotal = 0u;
+    uint64_t retiredTotal = 0u;
+
+    // Pending batches as a fixed circular array, oldest at firstBatch
+    std::vector<Batch> batches;
+    uint32_t firstBatch = 0u;
+    uint32_t nBatches = 0u;
+
+    Stats ringStats;
+};
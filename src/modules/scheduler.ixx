@@ -0,0 +1,107 @@
+module;
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+export module scheduler;
+
+export class Scheduler;
+
+// Lazily started coroutine. Awaiting a Task runs it to completion and resumes the awaiter
+//  afterwards, rethrowing anything it threw. Tasks handed to Scheduler::spawn run detached.
+export class Task
+{
+   public:
+    struct promise_type;
+
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept;
+        void await_resume() const noexcept {}
+    };
+
+    struct promise_type
+    {
+        std::coroutine_handle<> continuation = nullptr;
+        std::exception_ptr error = nullptr;
+        // Set when the task was spawned, the frame then destroys itself on completion
+        Scheduler* owner = nullptr;
+
+        Task get_return_object()
+        {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        FinalAwaiter final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() noexcept { this->error = std::current_exception(); }
+    };
+
+    Task() = default;
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+    ~Task();
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Task& operator=(Task&& other) noexcept;
+
+    bool await_ready() const noexcept { return !this->handle || this->handle.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept;
+    void await_resume();
+
+   private:
+    std::coroutine_handle<promise_type> handle = nullptr;
+
+    friend class Scheduler;
+};
+
+// Thread pool that resumes coroutines. A coroutine moves onto the pool with
+//  co_await scheduler.schedule(), and anything else (fence watchers, I/O) hands
+//  suspended coroutines back to it with post().
+export class Scheduler
+{
+   public:
+    struct ScheduleAwaiter
+    {
+        Scheduler* scheduler;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) const { this->scheduler->post(h); }
+        void await_resume() const noexcept {}
+    };
+
+    explicit Scheduler(uint32_t nThreads = 2u);
+    // Waits for every spawned task to finish before joining the workers
+    ~Scheduler();
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    ScheduleAwaiter schedule() { return { this }; }
+    void post(std::coroutine_handle<> h);
+    // Start a task on the pool without anyone awaiting it
+    void spawn(Task task);
+    // Block until all spawned tasks have completed
+    void waitIdle();
+
+   private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable readyCv;
+    std::condition_variable idleCv;
+    std::deque<std::coroutine_handle<>> ready;
+    uint32_t nSpawned = 0u;
+    bool stopping = false;
+
+    void workerMain();
+    void taskDone(std::exception_ptr error);
+
+    friend struct Task::FinalAwaiter;
+};
@@ -0,0 +1,103 @@
+module;
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+
+export module shared_page_pool;
+
+// Fixed-size pages shared between threads. Free pages sit on a lock-free stack, so taking and
+//  returning a page never blocks; only creating a page when the stack is empty takes a lock.
+//  Pages are referred to by index and are never destroyed before the pool.
+export template <typename Page> class SharedPagePool
+{
+   public:
+    using Factory = std::function<std::unique_ptr<Page>()>;
+
+    struct Stats
+    {
+        uint64_t pagesCreated = 0u;
+        uint64_t acquires = 0u;
+    };
+
+    SharedPagePool(Factory factory, uint32_t maxPages)
+        : factory(std::move(factory)),
+          maxPages(maxPages),
+          pages(std::make_unique<std::unique_ptr<Page>[]>(maxPages)),
+          next(std::make_unique<std::atomic<uint32_t>[]>(maxPages))
+    {
+    }
+
+    // Index of a free page, creating one if none is free. Throws std::bad_alloc once maxPages
+    //  pages exist and all are taken.
+    uint32_t acquire()
+    {
+        this->acquireCount.fetch_add(1u, std::memory_order_relaxed);
+
+        uint64_t head = this->freeHead.load(std::memory_order_acquire);
+        while (headIndex(head) != 0u) {
+            const uint32_t index = headIndex(head) - 1u;
+            const uint32_t nextIndex = this->next[index].load(std::memory_order_relaxed);
+            // Bumping the tag on every change keeps a stale head from winning the exchange
+            //  after the page was popped and pushed again in between (ABA)
+            if (this->freeHead.compare_exchange_weak(
+                    head, makeHead(headTag(head) + 1u, nextIndex), std::memory_order_acquire,
+                    std::memory_order_acquire
+                )) {
+                return index;
+            }
+        }
+
+        std::scoped_lock lock(this->growMutex);
+        const uint32_t index = this->nPages.load(std::memory_order_relaxed);
+        if (index == this->maxPages) {
+            throw std::bad_alloc();
+        }
+        this->pages[index] = this->factory();
+        this->nPages.store(index + 1u, std::memory_order_release);
+        return index;
+    }
+
+    void release(uint32_t index)
+    {
+        uint64_t head = this->freeHead.load(std::memory_order_relaxed);
+        do {
+            this->next[index].store(headIndex(head), std::memory_order_relaxed);
+        } while (!this->freeHead.compare_exchange_weak(
+            head, makeHead(headTag(head) + 1u, index + 1u), std::memory_order_release,
+            std::memory_order_relaxed
+        ));
+    }
+
+    Page& page(uint32_t index) { return *this->pages[index]; }
+
+    Stats stats() const
+    {
+        return { this->nPages.load(std::memory_order_relaxed),
+                 this->acquireCount.load(std::memory_order_relaxed) };
+    }
+
+   private:
+    // The stack head packs a change counter in the high half and index + 1 in the low half,
+    //  0 meaning empty. next[] uses the same index + 1 encoding.
+    static uint64_t makeHead(uint32_t tag, uint32_t indexPlusOne)
+    {
+        return (static_cast<uint64_t>(tag) << 32u) | indexPlusOne;
+    }
+    static uint32_t headIndex(uint64_t head) { return static_cast<uint32_t>(head); }
+    static uint32_t headTag(uint64_t head) { return static_cast<uint32_t>(head >> 32u); }
+
+    Factory factory;
+    const uint32_t maxPages;
+    std::unique_ptr<std::unique_ptr<Page>[]> pages;
+    std::unique_ptr<std::atomic<uint32_t>[]> next;
+    std::mutex growMutex;
+    std::atomic<uint32_t> nPages = 0u;
+    std::atomic<uint64_t> acquireCount = 0u;
+    alignas(64) std::atomic<uint64_t> freeHead = 0u;
+};
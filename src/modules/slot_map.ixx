@@ -0,0 +1,175 @@
+module;
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <span>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+export module slot_map;
+
+// Objects addressed by 32-bit handles that go stale when the object is erased. Each column of
+//  the objects is its own densely packed array (structure of arrays), so walking one column
+//  touches only that column. A handle is a slot index plus the slot's generation, which is
+//  bumped on erase; lookups compare the two, so a stale handle is detected rather than
+//  reaching whatever was inserted into the slot after. Erase moves the last object into the
+//  hole, keeping the columns dense, and freed slots are reused oldest first to make a slot
+//  come around to the same generation as slowly as possible.
+export template <typename... Columns> class SlotMap
+{
+   public:
+    static constexpr uint32_t indexBits = 20u;
+    static constexpr uint32_t maxSlots = 1u << indexBits;
+    static constexpr uint32_t maxGeneration = (1u << (32u - indexBits)) - 1u;
+
+    // Zero is never a valid handle, so a default constructed one is always stale
+    struct Handle
+    {
+        uint32_t value = 0u;
+
+        uint32_t index() const { return this->value & (maxSlots - 1u); }
+        uint32_t generation() const { return this->value >> indexBits; }
+        explicit operator bool() const { return this->value != 0u; }
+        bool operator==(const Handle&) const = default;
+    };
+
+    template <size_t Column>
+    using ColumnType = std::tuple_element_t<Column, std::tuple<Columns...>>;
+
+    Handle insert(Columns... values)
+    {
+        uint32_t index;
+        if (this->freeHead != noSlot) {
+            index = this->freeHead;
+            this->freeHead = this->slots[index].dense & ~freeBit;
+            if (this->freeHead == noIndex) {
+                this->freeHead = noSlot;
+                this->freeTail = noSlot;
+            }
+        } else {
+            if (this->slots.size() == maxSlots) {
+                throw std::bad_alloc();
+            }
+            index = static_cast<uint32_t>(this->slots.size());
+            this->slots.push_back({ freeBit | noIndex, 1u });
+        }
+
+        Slot& slot = this->slots[index];
+        slot.dense = static_cast<uint32_t>(this->denseToSlot.size());
+        this->denseToSlot.push_back(index);
+        this->pushColumns(std::index_sequence_for<Columns...>{}, std::move(values)...);
+        return { (slot.generation << indexBits) | index };
+    }
+
+    // False if the handle was already stale
+    bool erase(Handle handle)
+    {
+        const uint32_t dense = this->denseIndex(handle);
+        if (dense == noSlot) {
+            return false;
+        }
+
+        // Move the last object into the hole
+        const uint32_t last = static_cast<uint32_t>(this->denseToSlot.size() - 1u);
+        if (dense != last) {
+            this->moveColumns(std::index_sequence_for<Columns...>{}, last, dense);
+            this->denseToSlot[dense] = this->denseToSlot[last];
+            this->slots[this->denseToSlot[dense]].dense = dense;
+        }
+        this->popColumns(std::index_sequence_for<Columns...>{});
+        this->denseToSlot.pop_back();
+
+        // Generation 0 is skipped so no live handle is ever zero
+        const uint32_t index = handle.index();
+        Slot& slot = this->slots[index];
+        slot.generation = slot.generation == maxGeneration ? 1u : slot.generation + 1u;
+        slot.dense = freeBit | noIndex;
+        if (this->freeTail != noSlot) {
+            this->slots[this->freeTail].dense = freeBit | index;
+        } else {
+            this->freeHead = index;
+        }
+        this->freeTail = index;
+        return true;
+    }
+
+    bool contains(Handle handle) const { return this->denseIndex(handle) != noSlot; }
+
+    // Pointer into the column, or nullptr for a stale handle. Valid until the next insert or
+    //  erase.
+    template <size_t Column> ColumnType<Column>* get(Handle handle)
+    {
+        const uint32_t dense = this->denseIndex(handle);
+        return dense == noSlot ? nullptr : &std::get<Column>(this->columns)[dense];
+    }
+    template <size_t Column> const ColumnType<Column>* get(Handle handle) const
+    {
+        const uint32_t dense = this->denseIndex(handle);
+        return dense == noSlot ? nullptr : &std::get<Column>(this->columns)[dense];
+    }
+
+    // Dense columns, in no particular order but the same order for every column
+    template <size_t Column> std::span<ColumnType<Column>> column()
+    {
+        return std::get<Column>(this->columns);
+    }
+    template <size_t Column> std::span<const ColumnType<Column>> column() const
+    {
+        return std::get<Column>(this->columns);
+    }
+    // Handle of the object at a position in the columns
+    Handle handleAt(uint32_t dense) const
+    {
+        const uint32_t index = this->denseToSlot[dense];
+        return { (this->slots[index].generation << indexBits) | index };
+    }
+
+    uint32_t size() const { return static_cast<uint32_t>(this->denseToSlot.size()); }
+    bool empty() const { return this->denseToSlot.empty(); }
+
+   private:
+    static constexpr uint32_t noSlot = UINT32_MAX;
+    static constexpr uint32_t freeBit = 1u << 31u;
+    static constexpr uint32_t noIndex = ~freeBit;
+
+    // Where a live slot's object sits in the columns, or freeBit and the next free slot
+    struct Slot
+    {
+        uint32_t dense;
+        uint32_t generation;
+    };
+
+    uint32_t denseIndex(Handle handle) const
+    {
+        const uint32_t index = handle.index();
+        if (index >= this->slots.size()) {
+            return noSlot;
+        }
+        // A free slot's generation is that of its next occupant, which no handle has yet
+        const Slot& slot = this->slots[index];
+        const bool live = slot.generation == handle.generation() && !(slot.dense & freeBit);
+        return live ? slot.dense : noSlot;
+    }
+
+    template <size_t... I> void pushColumns(std::index_sequence<I...>, Columns&&... values)
+    {
+        (std::get<I>(this->columns).push_back(std::move(values)), ...);
+    }
+    template <size_t... I> void moveColumns(std::index_sequence<I...>, uint32_t from, uint32_t to)
+    {
+        ((std::get<I>(this->columns)[to] = std::move(std::get<I>(this->columns)[from])), ...);
+    }
+    template <size_t... I> void popColumns(std::index_sequence<I...>)
+    {
+        (std::get<I>(this->columns).pop_back(), ...);
+    }
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> denseToSlot;
+    std::tuple<std::vector<Columns>...> columns;
+    // Freed slots, linked through Slot::dense
+    uint32_t freeHead = noSlot;
+    uint32_t freeTail = noSlot;
+};
@@ -0,0 +1,61 @@
+module;
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+export module task_pool;
+
+// Contiguous [first, first + count) slice of an index range
+export struct IndexRange
+{
+    uint32_t first = 0u;
+    uint32_t count = 0u;
+};
+
+// Split [0, total) into at most nParts contiguous slices, each a multiple of granularity
+//  (except possibly the last). Never returns more slices than there are granules.
+export std::pmr::vector<IndexRange> splitRange(
+    uint32_t total,
+    uint32_t nParts,
+    uint32_t granularity = 1u,
+    std::pmr::memory_resource* resource = std::pmr::get_default_resource()
+);
+
+// Fixed set of worker threads for fork/join style work. The calling thread participates,
+//  so a pool of size N spawns N - 1 workers.
+export class TaskPool
+{
+   public:
+    explicit TaskPool(uint32_t nThreads = 1u);
+    ~TaskPool();
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    uint32_t size() const;
+    // Invoke fn(i) for every i in [0, count) across the pool, returning once all calls are
+    //  done. The first exception thrown by any invocation is rethrown on the calling thread.
+    void parallelFor(uint32_t count, const std::function<void(uint32_t)>& fn);
+
+   private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wakeCv;
+    std::condition_variable doneCv;
+    const std::function<void(uint32_t)>* job = nullptr;
+    uint32_t jobCount = 0u;
+    std::atomic<uint32_t> nextIndex = 0u;
+    uint32_t nBusy = 0u;
+    uint64_t generation = 0u;
+    bool stopping = false;
+    std::exception_ptr error = nullptr;
+
+    void workerMain();
+    void runJob(const std::function<void(uint32_t)>& fn, uint32_t count);
+};
@@ -0,0 +1,100 @@
+module;
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+export module tlsf_allocator;
+
+// Two-level segregated fit allocator over an address range [0, capacity), storing nothing in
+//  the managed memory itself so it works for GPU heaps. Free blocks are binned by the position
+//  of their highest set bit, then by the next slBits bits, and two bitmaps find a non-empty
+//  bin that's guaranteed to fit in O(1). Allocation and free never walk a list.
+export class TlsfAllocator
+{
+   public:
+    using Handle = uint32_t;
+    static constexpr Handle invalidHandle = std::numeric_limits<Handle>::max();
+
+    struct Stats
+    {
+        uint64_t capacity = 0u;
+        uint64_t usedBytes = 0u;
+        uint32_t allocations = 0u;
+        uint32_t freeBlocks = 0u;
+        uint64_t largestFreeBlock = 0u;
+        uint64_t failures = 0u;
+    };
+
+    // Block to copy from src to dst, then free src
+    struct Move
+    {
+        Handle src;
+        Handle dst;
+    };
+
+    TlsfAllocator() = default;
+    // Sizes and offsets are multiples of granularity, which must be a power of 2
+    TlsfAllocator(uint64_t capacity, uint64_t granularity = 256u);
+
+    // Smallest capacity at which a fresh allocator is sure to satisfy allocate(size, alignment).
+    //  The search pads size for the worst case alignment and only looks at bins whose every
+    //  block fits, so this can be well above size.
+    static uint64_t capacityFor(uint64_t size, uint64_t alignment, uint64_t granularity = 256u);
+
+    Handle allocate(uint64_t size, uint64_t alignment = 1u);
+    void free(Handle handle);
+    uint64_t offset(Handle handle) const;
+    uint64_t size(Handle handle) const;
+    bool empty() const;
+    Stats stats() const;
+
+    // Defragmentation hook: plan up to maxMoves moves of the blocks nearest the end of the
+    //  range into free space before them. Destinations are allocated right away; the caller
+    //  copies each src to its dst and frees src afterwards, or frees dst to cancel.
+    std::vector<Move> beginDefragment(uint32_t maxMoves);
+
+   private:
+    static constexpr uint32_t slBits = 5u;
+    static constexpr uint32_t slCount = 1u << slBits;
+    static constexpr uint32_t flCount = 40u;
+    static constexpr uint32_t nil = std::numeric_limits<uint32_t>::max();
+
+    // Blocks tile the range in physical order; free blocks are also on their bin's list
+    struct Block
+    {
+        uint64_t offset = 0u;
+        uint64_t size = 0u;
+        uint64_t alignment = 0u;
+        uint32_t prevPhys = nil;
+        uint32_t nextPhys = nil;
+        uint32_t prevFree = nil;
+        uint32_t nextFree = nil;
+        bool free = false;
+    };
+
+    uint64_t totalSize = 0u;
+    uint64_t granularity = 1u;
+    uint64_t used = 0u;
+    uint32_t nAllocations = 0u;
+    uint64_t nFailures = 0u;
+    std::vector<Block> blocks;
+    std::vector<uint32_t> unusedBlocks;
+    uint32_t firstBlock = nil;
+    uint64_t flBitmap = 0u;
+    uint32_t slBitmaps[flCount] = {};
+    uint32_t freeHeads[flCount][slCount] = {};
+
+    // Bin holding blocks of size units, and the first bin whose blocks all hold size units
+    static void mapping(uint64_t units, uint32_t& fl, uint32_t& sl);
+    static void mappingRoundUp(uint64_t units, uint32_t& fl, uint32_t& sl);
+    // Free space a search for an aligned allocation of size asks for
+    static uint64_t searchSize(uint64_t size, uint64_t alignment, uint64_t granularity);
+    uint32_t findFree(uint64_t size) const;
+    void insertFree(uint32_t index);
+    void removeFree(uint32_t index);
+    uint32_t newBlock();
+    // Carve an aligned allocation out of the free block at index
+    Handle use(uint32_t index, uint64_t size, uint64_t alignment);
+    uint64_t alignedOffset(const Block& block, uint64_t alignment) const;
+};
@@ -0,0 +1,169 @@
+module;
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+export module upload_batcher;
+
+export import deferred_release;
+
+// Queue fence value that must be reached before uploaded data may be read
+export struct UploadTicket
+{
+    uint64_t fenceValue = 0u;
+};
+
+// The part of a copy queue an UploadBatcher records into. Batches are submitted in order and
+//  each one signals a larger fence value than the last.
+export template <typename Resource> class UploadQueue
+{
+   public:
+    virtual ~UploadQueue() = default;
+
+    // Start recording a new batch
+    virtual void openBatch() = 0;
+    // Record a copy of size bytes from source, starting at sourceOffset, to the start of
+    //  destination into the open batch
+    virtual void copy(
+        const Resource& destination,
+        const Resource& source,
+        size_t sourceOffset,
+        size_t size
+    ) = 0;
+    // Submit the open batch, returning the fence value signalled once it has completed
+    virtual uint64_t submitBatch() = 0;
+    virtual uint64_t completedValue() const = 0;
+};
+
+// Batches copies into one submission until submit(), so many uploads cost a single submit and
+//  fence signal. Sources are handed to a release queue under the fence of the batch that
+//  reads them, and completed batches are only accounted for in retire().
+export template <typename Resource, typename QueueKey> class UploadBatcher
+{
+   public:
+    struct Stats
+    {
+        uint64_t bytesUploaded = 0u;
+        uint64_t copies = 0u;
+        uint64_t batches = 0u;
+        // Time from a batch's first copy being queued to its completion being observed
+        double totalLatencyMs = 0.0;
+        double maxLatencyMs = 0.0;
+    };
+
+    // queueKey identifies queue to the release queue
+    UploadBatcher(
+        UploadQueue<Resource>& queue,
+        DeferredReleaseQueue<Resource, QueueKey>& releaseQueue,
+        QueueKey queueKey
+    )
+        : queue(queue), releaseQueue(releaseQueue), queueKey(queueKey)
+    {
+    }
+
+    // Queue a copy of size bytes from source, starting at sourceOffset, into destination.
+    //  source is kept alive until the batch has completed.
+    void copy(const Resource& destination, Resource source, size_t sourceOffset, size_t size)
+    {
+        std::scoped_lock lock(this->mutex);
+        if (!this->batchOpen) {
+            this->queue.openBatch();
+            this->batchOpen = true;
+            this->openBatch.queuedAt = Clock::now();
+        }
+        this->queue.copy(destination, source, sourceOffset, size);
+        this->openBatch.sources.push_back({ std::move(source), size });
+
+        this->uploadStats.bytesUploaded += size;
+        this->uploadStats.copies++;
+    }
+
+    // Submit the open batch, if any, returning the ticket covering every copy queued so far
+    UploadTicket submit()
+    {
+        std::scoped_lock lock(this->mutex);
+        if (this->batchOpen) {
+            const uint64_t fenceValue = this->queue.submitBatch();
+            assert(
+                fenceValue > this->lastTicket.fenceValue &&
+                "Upload batches must signal increasing fence values"
+            );
+            this->openBatch.fenceValue = fenceValue;
+            this->lastTicket = { fenceValue };
+            for (Source& source : this->openBatch.sources) {
+                this->releaseQueue.retire(
+                    this->queueKey, fenceValue, std::move(source.resource), source.size
+                );
+            }
+            this->openBatch.sources.clear();
+            this->inFlight.push_back(std::exchange(this->openBatch, {}));
+            this->batchOpen = false;
+            this->uploadStats.batches++;
+        }
+        return this->lastTicket;
+    }
+
+    // Account for completed batches, call once per frame. Batches complete in submission
+    //  order, so only a prefix of the in-flight ones can be done.
+    void retire()
+    {
+        std::scoped_lock lock(this->mutex);
+        const uint64_t completed = this->queue.completedValue();
+        const auto now = Clock::now();
+        auto done = std::find_if(this->inFlight.begin(), this->inFlight.end(), [&](const Batch& b) {
+            return b.fenceValue > completed;
+        });
+        for (auto it = this->inFlight.begin(); it != done; ++it) {
+            const std::chrono::duration<double, std::milli> latency = now - it->queuedAt;
+            this->uploadStats.totalLatencyMs += latency.count();
+            this->uploadStats.maxLatencyMs =
+                std::max(this->uploadStats.maxLatencyMs, latency.count());
+        }
+        this->inFlight.erase(this->inFlight.begin(), done);
+    }
+
+    // Batches submitted but not yet seen complete by retire()
+    size_t batchesInFlight()
+    {
+        std::scoped_lock lock(this->mutex);
+        return this->inFlight.size();
+    }
+
+    Stats stats()
+    {
+        std::scoped_lock lock(this->mutex);
+        return this->uploadStats;
+    }
+
+   private:
+    using Clock = std::chrono::high_resolution_clock;
+
+    struct Source
+    {
+        Resource resource;
+        size_t size;
+    };
+
+    struct Batch
+    {
+        uint64_t fenceValue = 0u;
+        Clock::time_point queuedAt;
+        std::vector<Source> sources;
+    };
+
+    UploadQueue<Resource>& queue;
+    DeferredReleaseQueue<Resource, QueueKey>& releaseQueue;
+    const QueueKey queueKey;
+    std::mutex mutex;
+    bool batchOpen = false;
+    Batch openBatch;
+    std::vector<Batch> inFlight;
+    UploadTicket lastTicket;
+    Stats uploadStats;
+};
@@ -2,12 +2,18 @@ module;
 
 #include <d3d12.h>
 #include <wrl.h>
-#include <deque>
 #include <memory>
+#include <vector>
 
 export module upload_buffer;
 
+export import allocator_telemetry;
 export import common;
+export import large_page_pool;
+export import ring_allocator;
+export import shared_page_pool;
+
+export class ParallelUploadBuffer;
 
 export class UploadBuffer
 {
@@ -16,9 +22,23 @@ export class UploadBuffer
     {
         void* cpu = nullptr;
         D3D12_GPU_VIRTUAL_ADDRESS gpu = 0;
+        // Page holding the allocation and where in it it starts, for copies out of it
+        ID3D12Resource* resource = nullptr;
+        size_t offset = 0u;
+    };
+
+    // Pages: linear allocation over pages that are all recycled by reset(), for memory owned
+    //  by a single frame. Ring: one page used as a ring, where each commit() tags what was
+    //  allocated with a fence value and retire() reclaims it once that fence completes.
+    enum class Mode
+    {
+        Pages,
+        Ring,
     };
 
    private:
+    friend class ParallelUploadBuffer;
+
     class Page
     {
        public:
@@ -26,6 +46,8 @@ export class UploadBuffer
         ~Page();
         bool fits(size_t sizeInBytes, size_t alignment) const;
         Allocation allocate(size_t sizeInBytes, size_t alignment);
+        Allocation at(size_t offset) const;
+        size_t used() const;
         void reset();
 
        private:
@@ -38,16 +60,95 @@ export class UploadBuffer
 
    public:
     const size_t pageSize;
+    const Mode mode;
 
-    explicit UploadBuffer(size_t pageSize = 2_MB);
+    // Allocations larger than pageSize get a dedicated page from a pool of power-of-two size
+    //  classes. Pooled pages left unused for largePageTrimFrames frames are released.
+    explicit UploadBuffer(
+        size_t pageSize = 2_MB,
+        Mode mode = Mode::Pages,
+        uint32_t largePageTrimFrames = 120u
+    );
     Allocation allocate(size_t sizeInBytes, size_t alignment = 256u);
+    // Pages mode, or Ring mode once the GPU is idle: make all memory available again
     void reset();
+    // Ring mode: fence value after which everything allocated since the last commit is unused
+    void commit(uint64_t fenceValue);
+    // Ring mode: reclaim allocations committed with fence values <= completedValue. Call once
+    //  per frame, pooled large pages count their idle frames by it.
+    void retire(uint64_t completedValue);
+    const RingAllocator::Stats& ringStats() const;
+    const LargePagePool<Page>::Stats& largePageStats() const;
+    // Record what the buffer holds for this frame
+    void sampleTelemetry(uint64_t frame);
+    const AllocatorTelemetry& telemetry() const;
 
    private:
-    using PagePool = std::deque<std::shared_ptr<Page>>;
+    Page& requestPage();
+    // Pages are only created, never freed, curPage indexes the one being filled
+    std::vector<std::unique_ptr<Page>> pages;
+    size_t curPage = 0u;
+    RingAllocator ring;
+    LargePagePool<Page> largePages;
+    AllocatorTelemetry allocatorTelemetry;
+};
+
+// Upload memory for several recording threads at once. Each thread slot bump-allocates from
+//  pages it owns privately and takes new pages from a pool shared by all slots, so workers
+//  never contend unless the pool has to create a page. Pages used during a frame return to the
+//  pool once that frame's fence completes.
+export class ParallelUploadBuffer
+{
+   public:
+    using Allocation = UploadBuffer::Allocation;
+
+    struct Stats
+    {
+        uint64_t pagesCreated = 0u;
+        uint64_t pageAcquires = 0u;
+        uint64_t allocations = 0u;
+    };
+
+    const size_t pageSize;
+
+    explicit ParallelUploadBuffer(
+        uint32_t nThreadSlots,
+        size_t pageSize = 256_KB,
+        uint32_t maxPages = 1024u
+    );
+
+    // Only the thread currently owning threadSlot may call this. Allocations can't be larger
+    //  than pageSize.
+    Allocation allocate(uint32_t threadSlot, size_t sizeInBytes, size_t alignment = 256u);
+    // Tag every page used since the last commit with fenceValue. Must not overlap allocate().
+    void commit(uint64_t fenceValue);
+    // Return pages committed with fence values <= completedValue to the shared pool
+    void retire(uint64_t completedValue);
+    Stats stats() const;
+    // Record what the buffer holds for this frame. Must not overlap allocate().
+    void sampleTelemetry(uint64_t frame);
+    const AllocatorTelemetry& telemetry() const;
+
+   private:
+    static constexpr uint32_t noPage = ~0u;
+
+    // Padded so slots of different threads never share a cache line
+    struct alignas(64) ThreadSlot
+    {
+        uint32_t page = noPage;
+        uint64_t allocations = 0u;
+        std::vector<uint32_t> usedPages;
+    };
+
+    struct PendingPage
+    {
+        uint64_t fenceValue;
+        uint32_t page;
+    };
 
-    std::shared_ptr<Page> requestPage();
-    PagePool pagePool;
-    PagePool freePages;
-    std::shared_ptr<Page> curPage = nullptr;
+    SharedPagePool<UploadBuffer::Page> pool;
+    std::vector<ThreadSlot> slots;
+    // Committed pages in fence order
+    std::vector<PendingPage> pending;
+    AllocatorTelemetry allocatorTelemetry;
 };
@@ -0,0 +1,93 @@
+module;
+
+#include <d3d12.h>
+#include <wrl.h>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+export module upload_service;
+
+export import command_queue;
+export import deferred_release;
+export import gpu_heap_allocator;
+export import upload_batcher;
+export import upload_buffer;
+
+// Resources kept alive until the queue that last used them has passed a fence value
+export using ResourceReleaseQueue =
+    DeferredReleaseQueue<ComPtr<ID3D12Resource>, const CommandQueue*>;
+
+// Streams buffer data to buffers placed in default heaps on a dedicated copy queue. Copies are
+//  batched into one command list until submit(), and consumers wait on the returned ticket
+//  GPU-side so uploads overlap with rendering. Data is staged in a ring upload buffer tagged
+//  with the copy queue's fence, larger uploads in its pooled large pages.
+export class UploadService
+{
+   public:
+    using Stats = UploadBatcher<ComPtr<ID3D12Resource>, const CommandQueue*>::Stats;
+
+    CommandQueue copyQueue;
+
+    UploadService(
+        ComPtr<ID3D12Device2> device,
+        GpuHeapAllocator& gpuMemory,
+        ResourceReleaseQueue& releaseQueue,
+        size_t stagingBytes = 8_MB
+    );
+    ~UploadService();
+
+    // Place a buffer in COMMON state and queue a copy of data into it. The buffer may only be
+    //  used after waiting on the ticket of the batch it was submitted in.
+    GpuAllocation uploadBuffer(
+        const void* data,
+        size_t sizeInBytes,
+        D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE
+    );
+    // Submit the open batch, if any, returning the ticket covering every copy queued so far
+    UploadTicket submit();
+    // Make the given queue wait on the GPU until the ticket's copies have completed
+    void waitOnGpu(CommandQueue& queue, UploadTicket ticket);
+    // Account for completed batches and reclaim their staging memory, call once per frame
+    void retire();
+    Stats stats();
+    // Record what the staging buffer holds for this frame
+    void sampleTelemetry(uint64_t frame);
+    const AllocatorTelemetry& stagingTelemetry() const;
+    // Only safe to read while no other thread is uploading
+    const UploadBuffer& stagingBuffer() const;
+
+   private:
+    // Records batches into command lists of the copy queue
+    class CopyList : public UploadQueue<ComPtr<ID3D12Resource>>
+    {
+       public:
+        explicit CopyList(CommandQueue& queue) : queue(queue) {}
+
+        void openBatch() override;
+        void copy(
+            const ComPtr<ID3D12Resource>& destination,
+            const ComPtr<ID3D12Resource>& source,
+            size_t sourceOffset,
+            size_t size
+        ) override;
+        uint64_t submitBatch() override;
+        uint64_t completedValue() const override;
+
+       private:
+        CommandQueue& queue;
+        ComPtr<ID3D12GraphicsCommandList2> cmdList;
+    };
+
+    GpuHeapAllocator& gpuMemory;
+    CopyList copyList;
+    UploadBatcher<ComPtr<ID3D12Resource>, const CommandQueue*> batcher;
+    // Held from staging an upload until its copy is queued, and from submitting a batch until
+    //  its staging memory is committed, so no allocation is tagged with the wrong batch
+    std::mutex stagingMutex;
+    UploadBuffer staging;
+
+    UploadBuffer::Allocation allocateStaging(size_t sizeInBytes);
+    // Caller holds stagingMutex
+    UploadTicket submitStaged();
+};
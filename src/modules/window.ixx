@@ -2,6 +2,7 @@ module;
 
 #include <Windows.h>
 #include <d3d12.h>
+#include <dxgi1_6.h>
 #include <wrl.h>
 #include <string>
 
@@ -13,6 +14,7 @@ export import common;
 export class Window
 {
    public:
+    ComPtr<IDXGIAdapter4> adapter;
     ComPtr<ID3D12Device2> device;
     HWND hWnd;
     RECT windowRect;
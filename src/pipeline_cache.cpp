@@ -0,0 +1,142 @@
+module;
+
+#include <d3d12.h>
+#include <wrl.h>
+#include <spdlog/spdlog.h>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <span>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+module pipeline_cache;
+
+PipelineCache::PipelineCache(ComPtr<ID3D12Device2> device, std::string path)
+    : device(device), path(std::move(path))
+{
+    std::ifstream file(this->path, std::ios::binary);
+    if (file) {
+        this->fileData.assign(
+            std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()
+        );
+    }
+    const std::span<const uint8_t> blob = decodePipelineCache(this->fileData);
+    if (!this->fileData.empty() && blob.empty()) {
+        spdlog::warn("Ignoring invalid pipeline cache {}", this->path);
+    }
+    this->createLibrary(blob);
+}
+
+void PipelineCache::createLibrary(std::span<const uint8_t> blob)
+{
+    ComPtr<ID3D12PipelineLibrary> created;
+    if (!blob.empty()) {
+        const HRESULT hr =
+            this->device->CreatePipelineLibrary(blob.data(), blob.size(), IID_PPV_ARGS(&created));
+        if (SUCCEEDED(hr)) {
+            created.As(&this->library);
+            this->cacheStats.loadedBytes = blob.size();
+            return;
+        }
+        // Libraries are thrown out by other drivers and adapters, which is expected
+        spdlog::info(
+            "Pipeline cache {} rejected ({:#010x}), starting over", this->path,
+            static_cast<uint32_t>(hr)
+        );
+    }
+    this->fileData.clear();
+    this->fileData.shrink_to_fit();
+    if (FAILED(this->device->CreatePipelineLibrary(nullptr, 0u, IID_PPV_ARGS(&created))) ||
+        FAILED(created.As(&this->library))) {
+        spdlog::warn("Pipeline libraries unsupported, pipelines won't be cached");
+        this->library.Reset();
+    }
+}
+
+ComPtr<ID3D12PipelineState> PipelineCache::create(
+    const D3D12_PIPELINE_STATE_STREAM_DESC& desc,
+    std::span<const uint8_t> rootSignature
+)
+{
+    const uint64_t key = hashPipelineStream(desc, rootSignature);
+
+    std::scoped_lock lock(this->mutex);
+    if (const auto it = this->pipelines.find(key); it != this->pipelines.end()) {
+        this->cacheStats.reused++;
+        return it->second;
+    }
+
+    const std::wstring name = pipelineName(key);
+    ComPtr<ID3D12PipelineState> pipeline;
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    if (this->library &&
+        SUCCEEDED(this->library->LoadPipeline(name.c_str(), &desc, IID_PPV_ARGS(&pipeline)))) {
+        const std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::high_resolution_clock::now() - t0;
+        this->cacheStats.hits++;
+        this->cacheStats.loadMs += elapsed.count();
+    } else {
+        chkDX(this->device->CreatePipelineState(&desc, IID_PPV_ARGS(&pipeline)));
+        const std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::high_resolution_clock::now() - t0;
+        this->cacheStats.misses++;
+        this->cacheStats.createMs += elapsed.count();
+
+        if (this->library) {
+            const HRESULT hr = this->library->StorePipeline(name.c_str(), pipeline.Get());
+            if (SUCCEEDED(hr)) {
+                this->dirty = true;
+            } else {
+                spdlog::warn(
+                    "Failed to store pipeline {:016x} ({:#010x})", key, static_cast<uint32_t>(hr)
+                );
+            }
+        }
+    }
+    this->pipelines.emplace(key, pipeline);
+    return pipeline;
+}
+
+void PipelineCache::save()
+{
+    std::scoped_lock lock(this->mutex);
+    if (!this->library || !this->dirty) {
+        return;
+    }
+
+    std::vector<uint8_t> blob(this->library->GetSerializedSize());
+    chkDX(this->library->Serialize(blob.data(), blob.size()));
+    const std::vector<uint8_t> file = encodePipelineCache(blob);
+
+    // Written aside and moved over the old file, so a crash mid-write can't leave half a cache
+    const std::string tmpPath = this->path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(file.data()), std::streamsize(file.size()));
+        if (!out) {
+            spdlog::error("Failed to write pipeline cache to {}", tmpPath);
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(tmpPath, this->path, error);
+    if (error) {
+        spdlog::error("Failed to replace pipeline cache {}: {}", this->path, error.message());
+        return;
+    }
+    this->dirty = false;
+    this->cacheStats.savedBytes = file.size();
+    spdlog::info("Wrote pipeline cache to {} ({} bytes)", this->path, file.size());
+}
+
+PipelineCache::Stats PipelineCache::stats()
+{
+    std::scoped_lock lock(this->mutex);
+    return this->cacheStats;
+}
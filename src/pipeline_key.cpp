@@ -0,0 +1,343 @@
+module;
+
+#if defined(__clang__)
+    #define FMT_CONSTEVAL
+#endif
+
+#include <d3d12.h>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <spdlog/spdlog.h>
+
+module pipeline_key;
+
+// FNV-1a, over values rather than whole structs so padding never ends up in the hash
+struct Fnv
+{
+    uint64_t value = 0xcbf29ce484222325ull;
+
+    void bytes(const void* data, size_t size)
+    {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        for (size_t i = 0u; i < size; ++i) {
+            this->value = (this->value ^ p[i]) * 0x100000001b3ull;
+        }
+    }
+
+    template <typename T> void add(T v)
+    {
+        static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "Hash values, not pointers");
+        this->bytes(&v, sizeof(T));
+    }
+
+    void string(const char* s)
+    {
+        if (s) {
+            this->bytes(s, std::strlen(s) + 1u);
+        } else {
+            this->add(uint8_t(0u));
+        }
+    }
+};
+
+// Subobjects as laid out by d3dx12's stream subobject wrappers
+template <typename Inner> struct alignas(void*) Subobject
+{
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type;
+    Inner inner;
+};
+
+template <typename Inner> static const Inner& inner(const uint8_t* at)
+{
+    return reinterpret_cast<const Subobject<Inner>*>(at)->inner;
+}
+
+static void hashBytecode(Fnv& h, const D3D12_SHADER_BYTECODE& bytecode)
+{
+    h.add(uint64_t(bytecode.BytecodeLength));
+    if (bytecode.pShaderBytecode) {
+        h.bytes(bytecode.pShaderBytecode, bytecode.BytecodeLength);
+    }
+}
+
+static void hashStencilOp(Fnv& h, const D3D12_DEPTH_STENCILOP_DESC& op)
+{
+    h.add(op.StencilFailOp);
+    h.add(op.StencilDepthFailOp);
+    h.add(op.StencilPassOp);
+    h.add(op.StencilFunc);
+}
+
+static void hashDepthStencil(Fnv& h, const D3D12_DEPTH_STENCIL_DESC& d)
+{
+    h.add(d.DepthEnable);
+    h.add(d.DepthWriteMask);
+    h.add(d.DepthFunc);
+    h.add(d.StencilEnable);
+    h.add(d.StencilReadMask);
+    h.add(d.StencilWriteMask);
+    hashStencilOp(h, d.FrontFace);
+    hashStencilOp(h, d.BackFace);
+}
+
+static void hashDepthStencil1(Fnv& h, const D3D12_DEPTH_STENCIL_DESC1& d)
+{
+    h.add(d.DepthEnable);
+    h.add(d.DepthWriteMask);
+    h.add(d.DepthFunc);
+    h.add(d.StencilEnable);
+    h.add(d.StencilReadMask);
+    h.add(d.StencilWriteMask);
+    hashStencilOp(h, d.FrontFace);
+    hashStencilOp(h, d.BackFace);
+    h.add(d.DepthBoundsTestEnable);
+}
+
+static void hashBlend(Fnv& h, const D3D12_BLEND_DESC& d)
+{
+    h.add(d.AlphaToCoverageEnable);
+    h.add(d.IndependentBlendEnable);
+    for (const D3D12_RENDER_TARGET_BLEND_DESC& rt : d.RenderTarget) {
+        h.add(rt.BlendEnable);
+        h.add(rt.LogicOpEnable);
+        h.add(rt.SrcBlend);
+        h.add(rt.DestBlend);
+        h.add(rt.BlendOp);
+        h.add(rt.SrcBlendAlpha);
+        h.add(rt.DestBlendAlpha);
+        h.add(rt.BlendOpAlpha);
+        h.add(rt.LogicOp);
+        h.add(rt.RenderTargetWriteMask);
+    }
+}
+
+static void hashRasterizer(Fnv& h, const D3D12_RASTERIZER_DESC& d)
+{
+    h.add(d.FillMode);
+    h.add(d.CullMode);
+    h.add(d.FrontCounterClockwise);
+    h.add(d.DepthBias);
+    h.add(d.DepthBiasClamp);
+    h.add(d.SlopeScaledDepthBias);
+    h.add(d.DepthClipEnable);
+    h.add(d.MultisampleEnable);
+    h.add(d.AntialiasedLineEnable);
+    h.add(d.ForcedSampleCount);
+    h.add(d.ConservativeRaster);
+}
+
+static void hashInputLayout(Fnv& h, const D3D12_INPUT_LAYOUT_DESC& d)
+{
+    h.add(d.NumElements);
+    for (UINT i = 0u; i < d.NumElements; ++i) {
+        const D3D12_INPUT_ELEMENT_DESC& e = d.pInputElementDescs[i];
+        h.string(e.SemanticName);
+        h.add(e.SemanticIndex);
+        h.add(e.Format);
+        h.add(e.InputSlot);
+        h.add(e.AlignedByteOffset);
+        h.add(e.InputSlotClass);
+        h.add(e.InstanceDataStepRate);
+    }
+}
+
+static void hashStreamOutput(Fnv& h, const D3D12_STREAM_OUTPUT_DESC& d)
+{
+    h.add(d.NumEntries);
+    for (UINT i = 0u; i < d.NumEntries; ++i) {
+        const D3D12_SO_DECLARATION_ENTRY& e = d.pSODeclaration[i];
+        h.add(e.Stream);
+        h.string(e.SemanticName);
+        h.add(e.SemanticIndex);
+        h.add(e.StartComponent);
+        h.add(e.ComponentCount);
+        h.add(e.OutputSlot);
+    }
+    h.add(d.NumStrides);
+    for (UINT i = 0u; i < d.NumStrides; ++i) {
+        h.add(d.pBufferStrides[i]);
+    }
+    h.add(d.RasterizedStream);
+}
+
+static void hashViewInstancing(Fnv& h, const D3D12_VIEW_INSTANCING_DESC& d)
+{
+    h.add(d.ViewInstanceCount);
+    for (UINT i = 0u; i < d.ViewInstanceCount; ++i) {
+        h.add(d.pViewInstanceLocations[i].ViewportArrayIndex);
+        h.add(d.pViewInstanceLocations[i].RenderTargetArrayIndex);
+    }
+    h.add(d.Flags);
+}
+
+uint64_t hashPipelineStream(
+    const D3D12_PIPELINE_STATE_STREAM_DESC& desc,
+    std::span<const uint8_t> rootSignature
+)
+{
+    Fnv h;
+    const uint8_t* at = static_cast<const uint8_t*>(desc.pPipelineStateSubobjectStream);
+    const uint8_t* const end = at + desc.SizeInBytes;
+    while (at < end) {
+        const D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type =
+            *reinterpret_cast<const D3D12_PIPELINE_STATE_SUBOBJECT_TYPE*>(at);
+        h.add(type);
+
+        size_t size = 0u;
+        switch (type) {
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE:
+                h.add(uint64_t(rootSignature.size()));
+                h.bytes(rootSignature.data(), rootSignature.size());
+                size = sizeof(Subobject<ID3D12RootSignature*>);
+                break;
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VS:
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PS:
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DS:
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_HS:
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_GS:
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_CS:
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_AS:
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_MS:
+                hashBytecode(h, inner<D3D12_SHADER_BYTECODE>(at));
+                size = sizeof(Subobject<D3D12_SHADER_BYTECODE>);
+                break;
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_STREAM_OUTPUT:
+                hashStreamOutput(h, inner<D3D12_STREAM_OUTPUT_DESC>(at));
+                size = sizeof(Subobject<D3D12_STREAM_OUTPUT_DESC>);
+                break;
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_BLEND:
+                hashBlend(h, inner<D3D12_BLEND_DESC>(at));
+                size = sizeof(Subobject<D3D12_BLEND_DESC>);
+                break;
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_SAMPLE_MASK:
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_NODE_MASK:
+                h.add(inner<UINT>(at));
+                size = sizeof(Subobject<UINT>);
+                break;
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RASTERIZER:
+                hashRasterizer(h, inner<D3D12_RASTERIZER_DESC>(at));
+                size = sizeof(Subobject<D3D12_RASTERIZER_DESC>);
+                break;
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL:
+                hashDepthStencil(h, inner<D3D12_DEPTH_STENCIL_DESC>(at));
+                size = sizeof(Subobject<D3D12_DEPTH_STENCIL_DESC>);
+                break;
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL1:
+                hashDepthStencil1(h, inner<D3D12_DEPTH_STENCIL_DESC1>(at));
+                size = sizeof(Subobject<D3D12_DEPTH_STENCIL_DESC1>);
+                break;
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_INPUT_LAYOUT:
+                hashInputLayout(h, inner<D3D12_INPUT_LAYOUT_DESC>(at));
+                size = sizeof(Subobject<D3D12_INPUT_LAYOUT_DESC>);
+                break;
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_IB_STRIP_CUT_VALUE:
+                h.add(inner<D3D12_INDEX_BUFFER_STRIP_CUT_VALUE>(at));
+                size = sizeof(Subobject<D3D12_INDEX_BUFFER_STRIP_CUT_VALUE>);
+                break;
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PRIMITIVE_TOPOLOGY:
+                h.add(inner<D3D12_PRIMITIVE_TOPOLOGY_TYPE>(at));
+                size = sizeof(Subobject<D3D12_PRIMITIVE_TOPOLOGY_TYPE>);
+                break;
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RENDER_TARGET_FORMATS: {
+                const D3D12_RT_FORMAT_ARRAY& formats = inner<D3D12_RT_FORMAT_ARRAY>(at);
+                h.add(formats.NumRenderTargets);
+                for (const DXGI_FORMAT format : formats.RTFormats) {
+                    h.add(format);
+                }
+                size = sizeof(Subobject<D3D12_RT_FORMAT_ARRAY>);
+                break;
+            }
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL_FORMAT:
+                h.add(inner<DXGI_FORMAT>(at));
+                size = sizeof(Subobject<DXGI_FORMAT>);
+                break;
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_SAMPLE_DESC:
+                h.add(inner<DXGI_SAMPLE_DESC>(at).Count);
+                h.add(inner<DXGI_SAMPLE_DESC>(at).Quality);
+                size = sizeof(Subobject<DXGI_SAMPLE_DESC>);
+                break;
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_CACHED_PSO:
+                size = sizeof(Subobject<D3D12_CACHED_PIPELINE_STATE>);
+                break;
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_FLAGS:
+                h.add(inner<D3D12_PIPELINE_STATE_FLAGS>(at));
+                size = sizeof(Subobject<D3D12_PIPELINE_STATE_FLAGS>);
+                break;
+            case D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VIEW_INSTANCING:
+                hashViewInstancing(h, inner<D3D12_VIEW_INSTANCING_DESC>(at));
+                size = sizeof(Subobject<D3D12_VIEW_INSTANCING_DESC>);
+                break;
+            default:
+                spdlog::error("Can't hash pipeline state subobject of type {}", int(type));
+                throw std::exception();
+        }
+        if (size > static_cast<size_t>(end - at)) {
+            spdlog::error("Pipeline state stream ends in the middle of a subobject");
+            throw std::exception();
+        }
+        at += size;
+    }
+    return h.value;
+}
+
+std::wstring pipelineName(uint64_t key)
+{
+    static constexpr wchar_t digits[] = L"0123456789abcdef";
+    std::wstring name = L"pso_";
+    for (int shift = 60; shift >= 0; shift -= 4) {
+        name += digits[(key >> shift) & 0xfu];
+    }
+    return name;
+}
+
+struct CacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t size;
+    uint64_t hash;
+};
+
+// "PSOL", little endian
+static constexpr uint32_t cacheMagic = 0x4c4f5350u;
+static constexpr uint32_t cacheVersion = 1u;
+
+std::vector<uint8_t> encodePipelineCache(std::span<const uint8_t> library)
+{
+    Fnv h;
+    h.bytes(library.data(), library.size());
+    const CacheHeader header = { cacheMagic, cacheVersion, library.size(), h.value };
+
+    std::vector<uint8_t> file(sizeof(CacheHeader) + library.size());
+    std::memcpy(file.data(), &header, sizeof(CacheHeader));
+    if (!library.empty()) {
+        std::memcpy(file.data() + sizeof(CacheHeader), library.data(), library.size());
+    }
+    return file;
+}
+
+std::span<const uint8_t> decodePipelineCache(std::span<const uint8_t> file)
+{
+    CacheHeader header;
+    if (file.size() < sizeof(CacheHeader)) {
+        return {};
+    }
+    std::memcpy(&header, file.data(), sizeof(CacheHeader));
+    if (header.magic != cacheMagic || header.version != cacheVersion ||
+        header.size != file.size() - sizeof(CacheHeader)) {
+        return {};
+    }
+
+    const std::span<const uint8_t> library = file.subspan(sizeof(CacheHeader));
+    Fnv h;
+    h.bytes(library.data(), library.size());
+    if (h.value != header.hash) {
+        return {};
+    }
+    return library;
+}
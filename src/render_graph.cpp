@@ -0,0 +1,597 @@
+module;
+
+#if defined(__clang__)
+    #define FMT_CONSTEVAL
+#endif
+
+#include <d3d12.h>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory_resource>
+#include <queue>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <spdlog/spdlog.h>
+
+module render_graph;
+
+// States that only read, any combination of which a resource can be in at once
+static constexpr D3D12_RESOURCE_STATES readOnlyStates = D3D12_RESOURCE_STATES(
+    D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_INDEX_BUFFER |
+    D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE |
+    D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT | D3D12_RESOURCE_STATE_COPY_SOURCE |
+    D3D12_RESOURCE_STATE_DEPTH_READ
+);
+
+static bool isReadOnly(D3D12_RESOURCE_STATES state)
+{
+    return state != D3D12_RESOURCE_STATE_COMMON && (state & ~readOnlyStates) == 0;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::read(
+    ResourceId version,
+    D3D12_RESOURCE_STATES state
+)
+{
+    assert(version < this->graph->versions.size() && "Unknown resource version");
+    this->graph->passes[this->pass].accesses.push_back({ version, state, false });
+    return *this;
+}
+
+RenderGraph::ResourceId RenderGraph::PassBuilder::write(
+    ResourceId version,
+    D3D12_RESOURCE_STATES state
+)
+{
+    assert(version < this->graph->versions.size() && "Unknown resource version");
+    Version& input = this->graph->versions[version];
+    if (input.writer != none) {
+        spdlog::error(
+            "Render graph passes {} and {} both write the same version of {}",
+            this->graph->passes[input.writer].name, this->graph->passes[this->pass].name,
+            this->graph->resources[input.resource].name
+        );
+        throw std::exception();
+    }
+    input.writer = this->pass;
+    this->graph->passes[this->pass].accesses.push_back({ version, state, true });
+
+    const uint32_t resource = input.resource;
+    this->graph->versions.push_back({ resource, this->pass });
+    return static_cast<ResourceId>(this->graph->versions.size() - 1u);
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::parts(uint32_t nParts)
+{
+    this->graph->passes[this->pass].parts = std::max(1u, nParts);
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::sideEffects()
+{
+    this->graph->passes[this->pass].sideEffects = true;
+    return *this;
+}
+
+RenderGraph::RenderGraph(std::pmr::memory_resource* resource)
+    : memory(resource),
+      resources(resource),
+      versions(resource),
+      passes(resource),
+      order(resource),
+      uses(resource),
+      aliasing(resource),
+      transients(resource),
+      barriers(resource),
+      units(resource),
+      listStarts(resource)
+{
+}
+
+RenderGraph::ResourceId RenderGraph::importResource(
+    std::string_view name,
+    ID3D12Resource* resource,
+    D3D12_RESOURCE_STATES state
+)
+{
+    this->resources.push_back({ name, resource, state, state });
+    this->versions.push_back({ static_cast<uint32_t>(this->resources.size() - 1u) });
+    return static_cast<ResourceId>(this->versions.size() - 1u);
+}
+
+RenderGraph::ResourceId RenderGraph::importResource(
+    std::string_view name,
+    ID3D12Resource* resource,
+    const ResourceStates& states
+)
+{
+    return this->importResource(name, resource, states.state(resource));
+}
+
+RenderGraph::ResourceId RenderGraph::createTransient(
+    std::string_view name,
+    uint64_t size,
+    uint64_t alignment,
+    uint32_t heapGroup
+)
+{
+    Resource resource = { name, nullptr, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COMMON };
+    resource.firstVersion = static_cast<ResourceId>(this->versions.size());
+    resource.size = size;
+    resource.alignment = alignment;
+    resource.heapGroup = heapGroup;
+    this->resources.push_back(resource);
+    this->versions.push_back({ static_cast<uint32_t>(this->resources.size() - 1u) });
+    return resource.firstVersion;
+}
+
+void RenderGraph::exportResource(ResourceId version, D3D12_RESOURCE_STATES state)
+{
+    assert(version < this->versions.size() && "Unknown resource version");
+    Resource& resource = this->resources[this->versions[version].resource];
+    assert(resource.firstVersion == none && "Transients can't outlive the graph");
+    resource.exportedVersion = version;
+    resource.finalState = state;
+}
+
+RenderGraph::PassBuilder RenderGraph::addPass(std::string_view name, Execute execute)
+{
+    this->passes.push_back(
+        Pass{ name, std::move(execute), std::pmr::vector<Access>(this->memory) }
+    );
+    return PassBuilder(this, static_cast<uint32_t>(this->passes.size() - 1u));
+}
+
+void RenderGraph::compile(const PlaceTransient& place)
+{
+    assert(!this->compiled && "Render graph compiled twice");
+    this->cull();
+    this->sort();
+    this->collectUses();
+    this->placeTransients(place);
+    // Lists first, split barriers can't span them
+    this->buildLists();
+    this->computeBarriers();
+    this->compiled = true;
+}
+
+std::span<const uint32_t> RenderGraph::passOrder() const
+{
+    return this->order;
+}
+
+bool RenderGraph::culled(uint32_t pass) const
+{
+    return this->passes[pass].culled;
+}
+
+std::span<const D3D12_RESOURCE_BARRIER> RenderGraph::barriersBefore(uint32_t pass) const
+{
+    const Pass& p = this->passes[pass];
+    return { this->barriers.data() + p.firstBarrier, p.nBarriers };
+}
+
+std::span<const D3D12_RESOURCE_BARRIER> RenderGraph::finalBarriers() const
+{
+    return std::span<const D3D12_RESOURCE_BARRIER>(this->barriers)
+        .subspan(this->firstFinalBarrier);
+}
+
+D3D12_RESOURCE_STATES RenderGraph::finalState(ResourceId version) const
+{
+    return this->resources[this->versions[version].resource].finalState;
+}
+
+void RenderGraph::commitStates(ResourceStates& states) const
+{
+    assert(this->compiled && "Render graph committed before it was compiled");
+    for (const Resource& resource : this->resources) {
+        if (resource.firstVersion == none) {
+            states.setState(resource.resource, resource.finalState);
+        }
+    }
+}
+
+std::string_view RenderGraph::passName(uint32_t pass) const
+{
+    return this->passes[pass].name;
+}
+
+ID3D12Resource* RenderGraph::resource(ResourceId version) const
+{
+    return this->resources[this->versions[version].resource].resource;
+}
+
+std::span<const AliasPlanner::Heap> RenderGraph::transientHeaps() const
+{
+    return this->aliasing.heaps();
+}
+
+uint32_t RenderGraph::listCount() const
+{
+    return static_cast<uint32_t>(this->listStarts.size()) - 1u;
+}
+
+void RenderGraph::recordList(uint32_t list, ID3D12GraphicsCommandList2* cmdList) const
+{
+    assert(this->compiled && list < this->listCount() && "List out of range");
+    for (uint32_t u = this->listStarts[list]; u < this->listStarts[list + 1u]; ++u) {
+        const Unit& unit = this->units[u];
+        const Pass& pass = this->passes[unit.pass];
+        if (unit.part == 0u && pass.nBarriers > 0u) {
+            cmdList->ResourceBarrier(pass.nBarriers, this->barriers.data() + pass.firstBarrier);
+        }
+        if (pass.execute) {
+            pass.execute({ cmdList, unit.part, list });
+        }
+    }
+
+    const std::span<const D3D12_RESOURCE_BARRIER> final = this->finalBarriers();
+    if (list == this->listCount() - 1u && !final.empty()) {
+        cmdList->ResourceBarrier(static_cast<UINT>(final.size()), final.data());
+    }
+}
+
+RenderGraph::Stats RenderGraph::stats() const
+{
+    Stats s;
+    s.passes = this->passes.size();
+    s.culledPasses = this->passes.size() - this->order.size();
+    s.barriers = this->barriers.size();
+    s.lists = this->compiled ? this->listCount() : 0u;
+    s.splitBarriers = this->nSplitBarriers;
+    s.transientBytes = this->aliasing.stats().requestedBytes;
+    s.transientHeapBytes = this->aliasing.stats().heapBytes;
+    return s;
+}
+
+RenderGraph::SplitPlacement RenderGraph::splitPlacement(
+    uint32_t previous,
+    uint32_t next,
+    std::span<const uint32_t> positionLists
+)
+{
+    assert(next < positionLists.size() && "Position out of range");
+    const uint32_t begin = previous == none ? 0u : previous + 1u;
+    if (begin < next && positionLists[begin] == positionLists[next]) {
+        return { begin, next };
+    }
+    return { next, next };
+}
+
+// A pass is kept while anything kept reads one of its outputs or it has side effects. Passes
+//  nothing references are culled, which in turn drops the references they held.
+void RenderGraph::cull()
+{
+    std::pmr::vector<uint32_t> refCount(this->passes.size(), 0u, this->memory);
+    for (const Pass& pass : this->passes) {
+        for (const Access& access : pass.accesses) {
+            const uint32_t producer = this->versions[access.version].producer;
+            if (producer != none) {
+                refCount[producer]++;
+            }
+        }
+    }
+    for (const Resource& resource : this->resources) {
+        if (resource.exportedVersion != none) {
+            const uint32_t producer = this->versions[resource.exportedVersion].producer;
+            if (producer != none) {
+                refCount[producer]++;
+            }
+        }
+    }
+
+    std::pmr::vector<uint32_t> unreferenced(this->memory);
+    for (uint32_t p = 0u; p < this->passes.size(); ++p) {
+        if (refCount[p] == 0u && !this->passes[p].sideEffects) {
+            this->passes[p].culled = true;
+            unreferenced.push_back(p);
+        }
+    }
+    while (!unreferenced.empty()) {
+        const uint32_t p = unreferenced.back();
+        unreferenced.pop_back();
+        for (const Access& access : this->passes[p].accesses) {
+            const uint32_t producer = this->versions[access.version].producer;
+            if (producer == none) {
+                continue;
+            }
+            Pass& pass = this->passes[producer];
+            if (--refCount[producer] == 0u && !pass.sideEffects && !pass.culled) {
+                pass.culled = true;
+                unreferenced.push_back(producer);
+            }
+        }
+    }
+}
+
+// Kahn's algorithm, taking the earliest declared ready pass first so the order only differs
+//  from declaration order where dependencies require it
+void RenderGraph::sort()
+{
+    const uint32_t nPasses = static_cast<uint32_t>(this->passes.size());
+    std::pmr::vector<std::pair<uint32_t, uint32_t>> edges(this->memory);
+    for (uint32_t p = 0u; p < nPasses; ++p) {
+        const Pass& pass = this->passes[p];
+        if (pass.culled) {
+            continue;
+        }
+        for (const Access& access : pass.accesses) {
+            const Version& version = this->versions[access.version];
+            // Consumers run after the producer of what they consume
+            if (version.producer != none) {
+                edges.push_back({ version.producer, p });
+            }
+            // Readers of a version run before the pass that modifies it
+            if (!access.write && version.writer != none && version.writer != p &&
+                !this->passes[version.writer].culled) {
+                edges.push_back({ p, version.writer });
+            }
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+
+    std::pmr::vector<uint32_t> firstEdge(nPasses + 1u, 0u, this->memory);
+    std::pmr::vector<uint32_t> inDegree(nPasses, 0u, this->memory);
+    for (const auto& [from, to] : edges) {
+        firstEdge[from + 1u]++;
+        inDegree[to]++;
+    }
+    for (uint32_t p = 0u; p < nPasses; ++p) {
+        firstEdge[p + 1u] += firstEdge[p];
+    }
+
+    std::priority_queue<uint32_t, std::pmr::vector<uint32_t>, std::greater<uint32_t>> ready(
+        std::greater<uint32_t>(), std::pmr::vector<uint32_t>(this->memory)
+    );
+    uint32_t nAlive = 0u;
+    for (uint32_t p = 0u; p < nPasses; ++p) {
+        if (!this->passes[p].culled) {
+            nAlive++;
+            if (inDegree[p] == 0u) {
+                ready.push(p);
+            }
+        }
+    }
+    while (!ready.empty()) {
+        const uint32_t p = ready.top();
+        ready.pop();
+        this->order.push_back(p);
+        for (uint32_t e = firstEdge[p]; e < firstEdge[p + 1u]; ++e) {
+            if (--inDegree[edges[e].second] == 0u) {
+                ready.push(edges[e].second);
+            }
+        }
+    }
+
+    if (this->order.size() != nAlive) {
+        for (uint32_t p = 0u; p < nPasses; ++p) {
+            if (!this->passes[p].culled && inDegree[p] > 0u) {
+                spdlog::error("Render graph has a cycle through pass {}", this->passes[p].name);
+                break;
+            }
+        }
+        throw std::exception();
+    }
+}
+
+// One use per resource per pass, ordered by resource and then position. Runs of reads share
+//  one state combining all of them, so switching between readers needs no barrier.
+void RenderGraph::collectUses()
+{
+    // A write takes precedence over reads
+    std::pmr::vector<Use>& uses = this->uses;
+    for (uint32_t pos = 0u; pos < this->order.size(); ++pos) {
+        const size_t passUses = uses.size();
+        for (const Access& access : this->passes[this->order[pos]].accesses) {
+            const uint32_t resource = this->versions[access.version].resource;
+            auto use = std::find_if(uses.begin() + passUses, uses.end(), [&](const Use& u) {
+                return u.resource == resource;
+            });
+            if (use == uses.end()) {
+                uses.push_back({ resource, pos, access.state, access.write });
+            } else if (access.write) {
+                assert(
+                    (!use->write || use->state == access.state) &&
+                    "Pass writes a resource in two states"
+                );
+                use->state = access.state;
+                use->write = true;
+            } else if (!use->write) {
+                use->state = D3D12_RESOURCE_STATES(use->state | access.state);
+            }
+        }
+    }
+    std::stable_sort(uses.begin(), uses.end(), [](const Use& a, const Use& b) {
+        return a.resource < b.resource;
+    });
+
+    for (size_t i = 0u; i < uses.size();) {
+        // Merge the states of each run of reads
+        size_t end = i;
+        if (!uses[i].write && isReadOnly(uses[i].state)) {
+            D3D12_RESOURCE_STATES merged = uses[i].state;
+            while (end + 1u < uses.size() && uses[end + 1u].resource == uses[i].resource &&
+                   !uses[end + 1u].write && isReadOnly(uses[end + 1u].state)) {
+                merged = D3D12_RESOURCE_STATES(merged | uses[++end].state);
+            }
+            for (size_t j = i; j <= end; ++j) {
+                uses[j].state = merged;
+            }
+        }
+        i = end + 1u;
+    }
+}
+
+// A transient lives from the position of its first use to that of its last, and is created
+//  in the state of its first use. Transients culled along with every pass using them aren't
+//  placed at all.
+void RenderGraph::placeTransients(const PlaceTransient& place)
+{
+    for (size_t i = 0u; i < this->uses.size();) {
+        const uint32_t r = this->uses[i].resource;
+        size_t last = i;
+        while (last + 1u < this->uses.size() && this->uses[last + 1u].resource == r) {
+            last++;
+        }
+        Resource& resource = this->resources[r];
+        if (resource.firstVersion != none) {
+            resource.initialState = this->uses[i].state;
+            resource.request = this->aliasing.add(
+                { resource.size, resource.alignment, resource.heapGroup, this->uses[i].position,
+                  this->uses[last].position }
+            );
+            this->transients.push_back(r);
+        }
+        i = last + 1u;
+    }
+    if (this->transients.empty()) {
+        return;
+    }
+    if (!place) {
+        spdlog::error(
+            "Render graph uses transient {} with nothing to place it",
+            this->resources[this->transients.front()].name
+        );
+        throw std::exception();
+    }
+
+    this->aliasing.plan();
+    for (const uint32_t r : this->transients) {
+        Resource& resource = this->resources[r];
+        const AliasPlanner::Placement& placement = this->aliasing.placement(resource.request);
+        resource.resource = place(
+            resource.firstVersion, { placement.heap, placement.offset, resource.initialState }
+        );
+    }
+}
+
+// Walk each resource's uses in execution order, transitioning it between the states they
+//  need, split across the passes in between where splitPlacement() allows. Consecutive
+//  unordered access uses where either writes are separated by a UAV barrier, and a
+//  transient's first use waits on the uses of whatever had its memory before.
+void RenderGraph::computeBarriers()
+{
+    const std::pmr::vector<Use>& uses = this->uses;
+    std::pmr::vector<std::pair<uint32_t, D3D12_RESOURCE_BARRIER>> placed(this->memory);
+
+    // Barriers at a position are recorded before that pass's first part, the final barriers
+    //  at the end of the last list
+    std::pmr::vector<uint32_t> positionLists(this->memory);
+    positionLists.reserve(this->order.size() + 1u);
+    for (const uint32_t p : this->order) {
+        positionLists.push_back(this->passes[p].list);
+    }
+    positionLists.push_back(this->units.empty() ? 0u : this->listCount() - 1u);
+    const auto transition = [&](ID3D12Resource* resource, uint32_t previous, uint32_t next,
+                                D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after) {
+        D3D12_RESOURCE_BARRIER barrier = {};
+        barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+        barrier.Transition.pResource = resource;
+        barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+        barrier.Transition.StateBefore = before;
+        barrier.Transition.StateAfter = after;
+        const SplitPlacement placement = splitPlacement(previous, next, positionLists);
+        if (placement.begin != placement.end) {
+            barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY;
+            placed.push_back({ placement.begin, barrier });
+            barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+            this->nSplitBarriers++;
+        }
+        placed.push_back({ placement.end, barrier });
+    };
+
+    // Resources without uses left may still need their exported state
+    size_t i = 0u;
+    for (uint32_t r = 0u; r < this->resources.size(); ++r) {
+        Resource& resource = this->resources[r];
+        D3D12_RESOURCE_STATES current = resource.initialState;
+        bool lastWrite = false;
+        uint32_t previous = none;
+        if (resource.request != none) {
+            const uint32_t aliased = this->aliasing.placement(resource.request).previous;
+            if (aliased != AliasPlanner::none) {
+                D3D12_RESOURCE_BARRIER barrier = {};
+                barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+                const Resource& before = this->resources[this->transients[aliased]];
+                barrier.Aliasing.pResourceBefore = before.resource;
+                barrier.Aliasing.pResourceAfter = resource.resource;
+                placed.push_back({ uses[i].position, barrier });
+            }
+        }
+        // Nothing used a transient before its first use to order it against
+        const size_t firstUse = resource.request == none ? SIZE_MAX : i;
+        for (; i < uses.size() && uses[i].resource == r; ++i) {
+            const Use& use = uses[i];
+            D3D12_RESOURCE_BARRIER barrier = {};
+            // A resource already in a read state covering what's needed stays in it
+            const bool covered = isReadOnly(current) && isReadOnly(use.state) &&
+                (current & use.state) == use.state;
+            if (current != use.state && !covered) {
+                transition(resource.resource, previous, use.position, current, use.state);
+                current = use.state;
+            } else if (current == D3D12_RESOURCE_STATE_UNORDERED_ACCESS &&
+                       (use.write || lastWrite) && i != firstUse) {
+                barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+                barrier.UAV.pResource = resource.resource;
+                placed.push_back({ use.position, barrier });
+            }
+            lastWrite = use.write;
+            previous = use.position;
+        }
+
+        if (resource.exportedVersion == none) {
+            resource.finalState = current;
+        } else if (current != resource.finalState) {
+            const uint32_t end = static_cast<uint32_t>(this->order.size());
+            transition(resource.resource, previous, end, current, resource.finalState);
+        }
+    }
+    std::stable_sort(placed.begin(), placed.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+    });
+
+    // Group by pass, the final barriers last
+    this->barriers.reserve(placed.size());
+    size_t next = 0u;
+    for (uint32_t pos = 0u; pos <= this->order.size(); ++pos) {
+        const uint32_t first = static_cast<uint32_t>(this->barriers.size());
+        for (; next < placed.size() && placed[next].first == pos; ++next) {
+            this->barriers.push_back(placed[next].second);
+        }
+        if (pos < this->order.size()) {
+            Pass& pass = this->passes[this->order[pos]];
+            pass.firstBarrier = first;
+            pass.nBarriers = static_cast<uint32_t>(this->barriers.size()) - first;
+        } else {
+            this->firstFinalBarrier = first;
+        }
+    }
+
+    // The final barriers still need a list when every pass was culled
+    if (this->units.empty() && !this->finalBarriers().empty()) {
+        this->listStarts.push_back(0u);
+    }
+}
+
+void RenderGraph::buildLists()
+{
+    bool afterMultiPart = false;
+    for (const uint32_t p : this->order) {
+        Pass& pass = this->passes[p];
+        for (uint32_t part = 0u; part < pass.parts; ++part) {
+            if (this->units.empty() || part > 0u || afterMultiPart) {
+                this->listStarts.push_back(static_cast<uint32_t>(this->units.size()));
+            }
+            this->units.push_back({ p, part });
+        }
+        pass.list = static_cast<uint32_t>(this->listStarts.size()) - pass.parts;
+        afterMultiPart = pass.parts > 1u;
+    }
+    this->listStarts.push_back(static_cast<uint32_t>(this->units.size()));
+}
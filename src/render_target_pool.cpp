@@ -0,0 +1,201 @@
+module;
+
+#include <d3d12.h>
+#include <wrl.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "d3dx12.h"
+
+module render_target_pool;
+
+static bool sameTarget(
+    const D3D12_RESOURCE_DESC& a,
+    const D3D12_RESOURCE_DESC& b,
+    const D3D12_CLEAR_VALUE* clearA,
+    const D3D12_CLEAR_VALUE* clearB
+)
+{
+    const bool sameDesc = a.Dimension == b.Dimension && a.Width == b.Width &&
+        a.Height == b.Height && a.DepthOrArraySize == b.DepthOrArraySize &&
+        a.MipLevels == b.MipLevels && a.Format == b.Format &&
+        a.SampleDesc.Count == b.SampleDesc.Count && a.SampleDesc.Quality == b.SampleDesc.Quality &&
+        a.Layout == b.Layout && a.Flags == b.Flags;
+    // A different optimized clear value only costs speed, but keep targets exact
+    const bool sameClear = (clearA == nullptr) == (clearB == nullptr) &&
+        (!clearA || std::memcmp(clearA, clearB, sizeof(D3D12_CLEAR_VALUE)) == 0);
+    return sameDesc && sameClear;
+}
+
+double RenderTargetPool::Stats::internalFragmentation() const
+{
+    return this->allocatedBytes == 0u
+        ? 0.0
+        : 1.0 - static_cast<double>(this->requestedBytes) / this->allocatedBytes;
+}
+
+RenderTargetPool::RenderTargetPool(
+    ComPtr<ID3D12Device2> device,
+    uint64_t heapSize,
+    uint32_t retainFrames
+)
+    : device(device), heapSize(std::bit_floor(heapSize)), retainFrames(retainFrames)
+{
+}
+
+ComPtr<ID3D12Resource> RenderTargetPool::acquire(
+    const D3D12_RESOURCE_DESC& desc,
+    D3D12_RESOURCE_STATES initialState,
+    const D3D12_CLEAR_VALUE* clearValue
+)
+{
+    assert(
+        (desc.Flags &
+         (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) &&
+        "Only render and depth targets go in the pool"
+    );
+
+    std::scoped_lock lock(this->mutex);
+    for (Target& target : this->targets) {
+        if (!target.inUse &&
+            sameTarget(
+                target.desc, desc, target.hasClearValue ? &target.clearValue : nullptr, clearValue
+            )) {
+            target.inUse = true;
+            this->nReused++;
+            return target.resource;
+        }
+    }
+
+    const D3D12_RESOURCE_ALLOCATION_INFO info =
+        this->device->GetResourceAllocationInfo(0, 1, &desc);
+    if (info.SizeInBytes == UINT64_MAX) {
+        spdlog::error("Invalid render target description");
+        throw std::exception();
+    }
+
+    uint32_t heapIndex = 0u;
+    uint64_t offset = BuddyAllocator::invalidOffset;
+    for (; heapIndex < this->heaps.size(); ++heapIndex) {
+        if (this->heaps[heapIndex]) {
+            offset = this->heaps[heapIndex]->blocks.allocate(info.SizeInBytes, info.Alignment);
+            if (offset != BuddyAllocator::invalidOffset) {
+                break;
+            }
+        }
+    }
+    if (offset == BuddyAllocator::invalidOffset) {
+        // Targets larger than a heap get a heap rounded up to the next power of two
+        heapIndex = this->createHeap(std::max(this->heapSize, std::bit_ceil(info.SizeInBytes)));
+        offset = this->heaps[heapIndex]->blocks.allocate(info.SizeInBytes, info.Alignment);
+        assert(offset != BuddyAllocator::invalidOffset);
+    }
+
+    Target target = {};
+    target.desc = desc;
+    target.hasClearValue = clearValue != nullptr;
+    if (clearValue) {
+        target.clearValue = *clearValue;
+    }
+    target.heap = heapIndex;
+    target.offset = offset;
+    target.inUse = true;
+    const HRESULT hr = this->device->CreatePlacedResource(
+        this->heaps[heapIndex]->heap.Get(), offset, &desc, initialState, clearValue,
+        IID_PPV_ARGS(&target.resource)
+    );
+    if (FAILED(hr)) {
+        this->heaps[heapIndex]->blocks.free(offset);
+        chkDX(hr);
+    }
+
+    this->targets.push_back(target);
+    this->nCreated++;
+    return target.resource;
+}
+
+void RenderTargetPool::release(ID3D12Resource* resource, uint64_t fenceValue)
+{
+    std::scoped_lock lock(this->mutex);
+    auto target = std::find_if(this->targets.begin(), this->targets.end(), [&](Target& t) {
+        return t.resource.Get() == resource;
+    });
+    assert(target != this->targets.end() && target->inUse && "Target isn't acquired");
+    target->inUse = false;
+    target->fenceValue = fenceValue;
+    target->releasedFrame = this->frame;
+}
+
+void RenderTargetPool::endFrame(uint64_t completedValue)
+{
+    std::scoped_lock lock(this->mutex);
+    this->frame++;
+
+    auto evicted = std::stable_partition(
+        this->targets.begin(), this->targets.end(),
+        [&](const Target& t) {
+            return t.inUse || this->frame - t.releasedFrame <= this->retainFrames ||
+                t.fenceValue > completedValue;
+        }
+    );
+    for (auto it = evicted; it != this->targets.end(); ++it) {
+        // The resource has to go before its memory can be placed again
+        it->resource.Reset();
+        Heap& heap = *this->heaps[it->heap];
+        heap.blocks.free(it->offset);
+        this->nEvicted++;
+        // Keep the first heap around for the next target, release the others once empty
+        if (heap.blocks.empty() && it->heap > 0u) {
+            this->heaps[it->heap].reset();
+        }
+    }
+    this->targets.erase(evicted, this->targets.end());
+}
+
+RenderTargetPool::Stats RenderTargetPool::stats()
+{
+    std::scoped_lock lock(this->mutex);
+    Stats s;
+    for (const auto& heap : this->heaps) {
+        if (heap) {
+            const BuddyAllocator::Stats blockStats = heap->blocks.stats();
+            s.heaps++;
+            s.heapBytes += blockStats.capacity;
+            s.allocatedBytes += blockStats.allocatedBytes;
+            s.requestedBytes += blockStats.requestedBytes;
+        }
+    }
+    s.targets = static_cast<uint32_t>(this->targets.size());
+    s.created = this->nCreated;
+    s.reused = this->nReused;
+    s.evicted = this->nEvicted;
+    return s;
+}
+
+uint32_t RenderTargetPool::createHeap(uint64_t size)
+{
+    // MSAA targets need the heap itself aligned to 4MB
+    auto heap = std::make_unique<Heap>();
+    const CD3DX12_HEAP_DESC heapDesc(
+        size, D3D12_HEAP_TYPE_DEFAULT, D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT,
+        D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES
+    );
+    chkDX(this->device->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap->heap)));
+    heap->blocks = BuddyAllocator(size, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+
+    // Heaps are referred to by index, so reuse the slot of a released one
+    auto slot = std::find(this->heaps.begin(), this->heaps.end(), nullptr);
+    if (slot == this->heaps.end()) {
+        this->heaps.push_back(std::move(heap));
+        return static_cast<uint32_t>(this->heaps.size() - 1u);
+    }
+    *slot = std::move(heap);
+    return static_cast<uint32_t>(slot - this->heaps.begin());
+}
@@ -0,0 +1,101 @@
+module;
+
+#include <d3d12.h>
+#include <dxgi1_6.h>
+#include <wrl.h>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+module residency_manager;
+
+const char* residencyCategoryName(ResidencyCategory category)
+{
+    switch (category) {
+        case ResidencyCategory::Buffers:
+            return "buffers";
+        case ResidencyCategory::Textures:
+            return "textures";
+        case ResidencyCategory::RenderTargets:
+            return "render targets";
+        case ResidencyCategory::Heaps:
+            return "heaps";
+        default:
+            return "unknown";
+    }
+}
+
+ResidencyManager::ResidencyManager(
+    ComPtr<ID3D12Device2> device,
+    ComPtr<IDXGIAdapter3> adapter,
+    uint32_t minIdleFrames
+)
+    : device(device), adapter(adapter), set(minIdleFrames)
+{
+}
+
+ResidencyManager::Handle ResidencyManager::track(
+    ComPtr<ID3D12Pageable> object,
+    uint64_t sizeInBytes,
+    ResidencyCategory category
+)
+{
+    return this->set.track(std::move(object), sizeInBytes, static_cast<uint32_t>(category));
+}
+
+void ResidencyManager::untrack(Handle handle)
+{
+    this->set.untrack(handle);
+}
+
+void ResidencyManager::markUsed(Handle handle)
+{
+    this->set.markUsed(handle);
+}
+
+void ResidencyManager::update()
+{
+    DXGI_QUERY_VIDEO_MEMORY_INFO info = {};
+    chkDX(this->adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &info));
+    // Memory this manager doesn't know about (swap chain, pooled heaps, driver) comes first
+    const uint64_t tracked = this->set.stats().residentBytes;
+    const uint64_t untracked = info.CurrentUsage > tracked ? info.CurrentUsage - tracked : 0u;
+    this->trackedBudget = info.Budget > untracked ? info.Budget - untracked : 0u;
+
+    std::vector<ID3D12Pageable*> objects;
+    const auto toRaw = [&](std::span<const ComPtr<ID3D12Pageable>> batch) {
+        objects.clear();
+        for (const ComPtr<ID3D12Pageable>& object : batch) {
+            objects.push_back(object.Get());
+        }
+    };
+    this->set.update(
+        this->trackedBudget,
+        [&](std::span<const ComPtr<ID3D12Pageable>> batch) {
+            toRaw(batch);
+            chkDX(this->device->MakeResident(static_cast<UINT>(objects.size()), objects.data()));
+        },
+        [&](std::span<const ComPtr<ID3D12Pageable>> batch) {
+            toRaw(batch);
+            chkDX(this->device->Evict(static_cast<UINT>(objects.size()), objects.data()));
+        }
+    );
+}
+
+uint64_t ResidencyManager::budget() const
+{
+    return this->trackedBudget;
+}
+
+const ResidencyManager::Set::CategoryStats& ResidencyManager::category(
+    ResidencyCategory category
+) const
+{
+    return this->set.category(static_cast<uint32_t>(category));
+}
+
+const ResidencyManager::Set::Stats& ResidencyManager::stats() const
+{
+    return this->set.stats();
+}
@@ -0,0 +1,69 @@
+module;
+
+#include <d3d12.h>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+module resource_states;
+
+static bool uniform(const std::vector<D3D12_RESOURCE_STATES>& states)
+{
+    return std::all_of(states.begin(), states.end(), [&](D3D12_RESOURCE_STATES s) {
+        return s == states.front();
+    });
+}
+
+void ResourceStates::add(
+    ID3D12Resource* resource,
+    D3D12_RESOURCE_STATES state,
+    uint32_t nSubresources
+)
+{
+    std::unique_lock lock(this->mutex);
+    this->resources[resource].assign(std::max(1u, nSubresources), state);
+}
+
+void ResourceStates::remove(ID3D12Resource* resource)
+{
+    std::unique_lock lock(this->mutex);
+    this->resources.erase(resource);
+}
+
+D3D12_RESOURCE_STATES ResourceStates::state(ID3D12Resource* resource, UINT subresource) const
+{
+    std::shared_lock lock(this->mutex);
+    const auto it = this->resources.find(resource);
+    assert(it != this->resources.end() && "Resource has no tracked state");
+    if (it == this->resources.end()) {
+        return D3D12_RESOURCE_STATE_COMMON;
+    }
+    if (subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES) {
+        assert(uniform(it->second) && "Subresources are in different states");
+        return it->second.front();
+    }
+    return it->second[subresource];
+}
+
+void ResourceStates::setState(
+    ID3D12Resource* resource,
+    D3D12_RESOURCE_STATES state,
+    UINT subresource
+)
+{
+    std::unique_lock lock(this->mutex);
+    const auto it = this->resources.find(resource);
+    assert(it != this->resources.end() && "Resource has no tracked state");
+    if (it == this->resources.end()) {
+        return;
+    }
+    if (subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES) {
+        std::fill(it->second.begin(), it->second.end(), state);
+    } else {
+        it->second[subresource] = state;
+    }
+}
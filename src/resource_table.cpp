@@ -0,0 +1,135 @@
+module;
+
+#include <d3d12.h>
+#include <wrl.h>
+#include <cassert>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+#include "d3dx12.h"
+
+module resource_table;
+
+ResourceTable::Handle ResourceTable::add(
+    ComPtr<ID3D12Resource> resource,
+    D3D12_RESOURCE_STATES state,
+    std::string name
+)
+{
+    const D3D12_RESOURCE_DESC desc = resource->GetDesc();
+    ComPtr<ID3D12Device> device;
+    chkDX(resource->GetDevice(IID_PPV_ARGS(&device)));
+    const uint64_t size = device->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes;
+    // Swap chain buffers and reserved resources have no heap properties to report
+    D3D12_HEAP_PROPERTIES heapProperties = {};
+    heapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
+    resource->GetHeapProperties(&heapProperties, nullptr);
+    const uint32_t nSubresources = desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER
+        ? 1u
+        : desc.MipLevels *
+            (desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ? 1u : desc.DepthOrArraySize) *
+            D3D12GetFormatPlaneCount(device.Get(), desc.Format);
+    this->resourceStates.add(resource.Get(), state, nSubresources);
+
+    std::unique_lock lock(this->mutex);
+    this->nAdded++;
+    return this->map.insert(std::move(resource), size, heapProperties.Type, std::move(name));
+}
+
+void ResourceTable::remove(Handle handle)
+{
+    // Release outside the lock, the last reference going can take a while
+    ComPtr<ID3D12Resource> resource;
+    {
+        std::unique_lock lock(this->mutex);
+        ComPtr<ID3D12Resource>* slot = this->map.get<Resource>(handle);
+        assert(slot && "Removing a stale resource handle");
+        if (!slot) {
+            return;
+        }
+        resource = std::move(*slot);
+        this->map.erase(handle);
+        this->nRemoved++;
+    }
+    this->resourceStates.remove(resource.Get());
+}
+
+ID3D12Resource* ResourceTable::get(Handle handle) const
+{
+    std::shared_lock lock(this->mutex);
+    const ComPtr<ID3D12Resource>* resource = this->map.get<Resource>(handle);
+    return resource ? resource->Get() : nullptr;
+}
+
+bool ResourceTable::contains(Handle handle) const
+{
+    std::shared_lock lock(this->mutex);
+    return this->map.contains(handle);
+}
+
+D3D12_RESOURCE_STATES ResourceTable::state(Handle handle) const
+{
+    ID3D12Resource* resource = this->get(handle);
+    assert(resource && "Stale resource handle");
+    return resource ? this->resourceStates.state(resource) : D3D12_RESOURCE_STATE_COMMON;
+}
+
+void ResourceTable::setState(Handle handle, D3D12_RESOURCE_STATES state)
+{
+    ID3D12Resource* resource = this->get(handle);
+    assert(resource && "Stale resource handle");
+    if (resource) {
+        this->resourceStates.setState(resource, state);
+    }
+}
+
+uint64_t ResourceTable::sizeInBytes(Handle handle) const
+{
+    std::shared_lock lock(this->mutex);
+    const uint64_t* size = this->map.get<Size>(handle);
+    assert(size && "Stale resource handle");
+    return size ? *size : 0u;
+}
+
+D3D12_HEAP_TYPE ResourceTable::heapType(Handle handle) const
+{
+    std::shared_lock lock(this->mutex);
+    const D3D12_HEAP_TYPE* heap = this->map.get<Heap>(handle);
+    assert(heap && "Stale resource handle");
+    return heap ? *heap : D3D12_HEAP_TYPE_DEFAULT;
+}
+
+std::string ResourceTable::name(Handle handle) const
+{
+    std::shared_lock lock(this->mutex);
+    const std::string* name = this->map.get<Name>(handle);
+    return name ? *name : std::string();
+}
+
+ResourceTable::Stats ResourceTable::stats() const
+{
+    std::shared_lock lock(this->mutex);
+    Stats s;
+    s.resources = this->map.size();
+    // Only the size and heap columns are touched
+    const auto sizes = this->map.column<Size>();
+    const auto heaps = this->map.column<Heap>();
+    for (size_t i = 0u; i < sizes.size(); ++i) {
+        s.totalBytes += sizes[i];
+        if (heaps[i] == D3D12_HEAP_TYPE_DEFAULT) {
+            s.defaultHeapBytes += sizes[i];
+        } else if (heaps[i] == D3D12_HEAP_TYPE_UPLOAD) {
+            s.uploadHeapBytes += sizes[i];
+        }
+    }
+    s.added = this->nAdded;
+    s.removed = this->nRemoved;
+    return s;
+}
+
+ResourceStates& ResourceTable::states()
+{
+    return this->resourceStates;
+}
@@ -0,0 +1,125 @@
+module;
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+module ring_allocator;
+
+RingAllocator::RingAllocator(size_t capacity, uint32_t maxPendingFences)
+    : size(capacity), batches(std::max(1u, maxPendingFences))
+{
+}
+
+size_t RingAllocator::allocate(size_t sizeInBytes, size_t alignment)
+{
+    assert((alignment & (alignment - 1)) == 0 && "Alignment must be a power of 2");
+
+    if (this->usedBytes() == 0u) {
+        // Start over at the beginning so an empty ring never has to wrap
+        this->head = this->tail = 0u;
+    }
+
+    const size_t alignedHead = (this->head + alignment - 1) & ~(alignment - 1);
+    size_t offset = invalidOffset;
+    bool wrapped = false;
+    if (this->head >= this->tail && this->usedBytes() < this->size) {
+        // Free space is [head, size) followed by [0, tail)
+        if (alignedHead + sizeInBytes <= this->size) {
+            offset = alignedHead;
+        } else if (sizeInBytes <= this->tail) {
+            offset = 0u;
+            wrapped = true;
+        }
+    } else if (this->head < this->tail) {
+        // Free space is [head, tail)
+        if (alignedHead + sizeInBytes <= this->tail) {
+            offset = alignedHead;
+        }
+    }
+
+    if (offset == invalidOffset) {
+        this->ringStats.failures++;
+        return invalidOffset;
+    }
+
+    // Wrapping gives up whatever was left past the head
+    const size_t skipped = wrapped ? this->size - this->head : 0u;
+    const size_t newHead = offset + sizeInBytes;
+    this->allocatedTotal += wrapped ? skipped + newHead : newHead - this->head;
+    this->head = newHead;
+
+    this->ringStats.allocations++;
+    this->ringStats.wastedBytes += skipped;
+    this->ringStats.peakUsedBytes = std::max(this->ringStats.peakUsedBytes, this->usedBytes());
+    return offset;
+}
+
+void RingAllocator::commit(uint64_t fenceValue)
+{
+    const uint32_t capacity = static_cast<uint32_t>(this->batches.size());
+    if (this->nBatches > 0u) {
+        Batch& newest = this->batches[(this->firstBatch + this->nBatches - 1u) % capacity];
+        assert(newest.fenceValue <= fenceValue && "Fence values must not decrease");
+        if (newest.allocatedTotal == this->allocatedTotal || this->nBatches == capacity) {
+            // Nothing new to track, or no room: retire this batch along with the newest one
+            newest = { fenceValue, this->head, this->allocatedTotal };
+            return;
+        }
+    } else if (this->allocatedTotal == this->retiredTotal) {
+        return;
+    }
+
+    this->batches[(this->firstBatch + this->nBatches) % capacity] =
+        { fenceValue, this->head, this->allocatedTotal };
+    this->nBatches++;
+}
+
+void RingAllocator::retire(uint64_t completedValue)
+{
+    const uint32_t capacity = static_cast<uint32_t>(this->batches.size());
+    while (this->nBatches > 0u && this->batches[this->firstBatch].fenceValue <= completedValue) {
+        const Batch& batch = this->batches[this->firstBatch];
+        this->tail = batch.end;
+        this->retiredTotal = batch.allocatedTotal;
+        this->firstBatch = (this->firstBatch + 1u) % capacity;
+        this->nBatches--;
+    }
+}
+
+void RingAllocator::reset()
+{
+    this->head = this->tail = 0u;
+    this->retiredTotal = this->allocatedTotal;
+    this->firstBatch = 0u;
+    this->nBatches = 0u;
+}
+
+size_t RingAllocator::capacity() const
+{
+    return this->size;
+}
+
+size_t RingAllocator::usedBytes() const
+{
+    return static_cast<size_t>(this->allocatedTotal - this->retiredTotal);
+}
+
+size_t RingAllocator::largestFreeBlock() const
+{
+    const size_t used = this->usedBytes();
+    if (used == 0u || used == this->size) {
+        return this->size - used;
+    }
+    if (this->head >= this->tail) {
+        return std::max(this->size - this->head, this->tail);
+    }
+    return this->tail - this->head;
+}
+
+const RingAllocator::Stats& RingAllocator::stats() const
+{
+    return this->ringStats;
+}
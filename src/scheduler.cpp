@@ -0,0 +1,156 @@
+module;
+
+#if defined(__clang__)
+    #define FMT_CONSTEVAL
+#endif
+
+#include <algorithm>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <spdlog/spdlog.h>
+
+module scheduler;
+
+Task::~Task()
+{
+    if (this->handle) {
+        this->handle.destroy();
+    }
+}
+
+Task& Task::operator=(Task&& other) noexcept
+{
+    if (this != &other) {
+        if (this->handle) {
+            this->handle.destroy();
+        }
+        this->handle = std::exchange(other.handle, nullptr);
+    }
+    return *this;
+}
+
+std::coroutine_handle<> Task::await_suspend(std::coroutine_handle<> awaiting) noexcept
+{
+    this->handle.promise().continuation = awaiting;
+    return this->handle;
+}
+
+void Task::await_resume()
+{
+    if (this->handle && this->handle.promise().error) {
+        std::rethrow_exception(this->handle.promise().error);
+    }
+}
+
+std::coroutine_handle<> Task::FinalAwaiter::await_suspend(std::coroutine_handle<promise_type> h
+) noexcept
+{
+    promise_type& promise = h.promise();
+    if (promise.continuation) {
+        return promise.continuation;
+    }
+
+    // Detached: nobody will look at the result, so clean up here
+    if (promise.owner) {
+        Scheduler* owner = promise.owner;
+        std::exception_ptr error = promise.error;
+        h.destroy();
+        owner->taskDone(error);
+    }
+    return std::noop_coroutine();
+}
+
+Scheduler::Scheduler(uint32_t nThreads)
+{
+    nThreads = std::max(1u, nThreads);
+    this->workers.reserve(nThreads);
+    for (uint32_t i = 0u; i < nThreads; ++i) {
+        this->workers.emplace_back([this]() { this->workerMain(); });
+    }
+}
+
+Scheduler::~Scheduler()
+{
+    this->waitIdle();
+    {
+        std::scoped_lock lock(this->mutex);
+        this->stopping = true;
+    }
+    this->readyCv.notify_all();
+    for (auto& worker : this->workers) {
+        worker.join();
+    }
+}
+
+void Scheduler::post(std::coroutine_handle<> h)
+{
+    {
+        std::scoped_lock lock(this->mutex);
+        this->ready.push_back(h);
+    }
+    this->readyCv.notify_one();
+}
+
+void Scheduler::spawn(Task task)
+{
+    std::coroutine_handle<Task::promise_type> h = std::exchange(task.handle, nullptr);
+    if (!h) {
+        return;
+    }
+
+    h.promise().owner = this;
+    {
+        std::scoped_lock lock(this->mutex);
+        this->nSpawned++;
+    }
+    this->post(h);
+}
+
+void Scheduler::waitIdle()
+{
+    std::unique_lock lock(this->mutex);
+    this->idleCv.wait(lock, [this]() { return this->nSpawned == 0u; });
+}
+
+void Scheduler::workerMain()
+{
+    while (true) {
+        std::coroutine_handle<> h = nullptr;
+        {
+            std::unique_lock lock(this->mutex);
+            this->readyCv.wait(lock, [this]() { return this->stopping || !this->ready.empty(); });
+            if (this->ready.empty()) {
+                return;
+            }
+            h = this->ready.front();
+            this->ready.pop_front();
+        }
+        h.resume();
+    }
+}
+
+void Scheduler::taskDone(std::exception_ptr error)
+{
+    if (error) {
+        try {
+            std::rethrow_exception(error);
+        } catch (const std::exception& e) {
+            spdlog::error("Unhandled exception in spawned task: {}", e.what());
+        } catch (...) {
+            spdlog::error("Unhandled exception in spawned task");
+        }
+    }
+
+    {
+        std::scoped_lock lock(this->mutex);
+        this->nSpawned--;
+    }
+    this->idleCv.notify_all();
+}
@@ -0,0 +1,156 @@
+module;
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+module task_pool;
+
+std::pmr::vector<IndexRange> splitRange(
+    uint32_t total,
+    uint32_t nParts,
+    uint32_t granularity,
+    std::pmr::memory_resource* resource
+)
+{
+    std::pmr::vector<IndexRange> ranges(resource);
+    granularity = std::max(1u, granularity);
+    const uint32_t nGranules = (total + granularity - 1u) / granularity;
+    if (nGranules == 0u) {
+        return ranges;
+    }
+
+    nParts = std::clamp(nParts, 1u, nGranules);
+    const uint32_t perPart = nGranules / nParts;
+    const uint32_t remainder = nGranules % nParts;
+    ranges.reserve(nParts);
+
+    uint32_t first = 0u;
+    for (uint32_t i = 0u; i < nParts; ++i) {
+        const uint32_t granules = perPart + (i < remainder ? 1u : 0u);
+        const uint32_t count = std::min(granules * granularity, total - first);
+        ranges.push_back({ first, count });
+        first += count;
+    }
+
+    return ranges;
+}
+
+TaskPool::TaskPool(uint32_t nThreads)
+{
+    nThreads = std::max(1u, nThreads);
+    this->workers.reserve(nThreads - 1u);
+    for (uint32_t i = 1u; i < nThreads; ++i) {
+        this->workers.emplace_back([this]() { this->workerMain(); });
+    }
+}
+
+TaskPool::~TaskPool()
+{
+    {
+        std::scoped_lock lock(this->mutex);
+        this->stopping = true;
+    }
+    this->wakeCv.notify_all();
+    for (auto& worker : this->workers) {
+        worker.join();
+    }
+}
+
+uint32_t TaskPool::size() const
+{
+    return static_cast<uint32_t>(this->workers.size()) + 1u;
+}
+
+void TaskPool::parallelFor(uint32_t count, const std::function<void(uint32_t)>& fn)
+{
+    if (count == 0u) {
+        return;
+    }
+
+    // Nothing to fan out, skip the wake/join round trip
+    if (this->workers.empty() || count == 1u) {
+        for (uint32_t i = 0u; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+
+    {
+        std::scoped_lock lock(this->mutex);
+        this->job = &fn;
+        this->jobCount = count;
+        this->nextIndex.store(0u, std::memory_order_relaxed);
+        this->nBusy = static_cast<uint32_t>(this->workers.size());
+        this->error = nullptr;
+        ++this->generation;
+    }
+    this->wakeCv.notify_all();
+
+    this->runJob(fn, count);
+
+    std::exception_ptr jobError = nullptr;
+    {
+        std::unique_lock lock(this->mutex);
+        this->doneCv.wait(lock, [this]() { return this->nBusy == 0u; });
+        this->job = nullptr;
+        jobError = std::exchange(this->error, nullptr);
+    }
+
+    if (jobError) {
+        std::rethrow_exception(jobError);
+    }
+}
+
+void TaskPool::workerMain()
+{
+    uint64_t seenGeneration = 0u;
+    while (true) {
+        const std::function<void(uint32_t)>* fn = nullptr;
+        uint32_t count = 0u;
+        {
+            std::unique_lock lock(this->mutex);
+            this->wakeCv.wait(lock, [&]() {
+                return this->stopping || this->generation != seenGeneration;
+            });
+            if (this->stopping) {
+                return;
+            }
+            seenGeneration = this->generation;
+            fn = this->job;
+            count = this->jobCount;
+        }
+
+        this->runJob(*fn, count);
+
+        {
+            std::scoped_lock lock(this->mutex);
+            if (--this->nBusy == 0u) {
+                this->doneCv.notify_one();
+            }
+        }
+    }
+}
+
+// Claim indices until the job is exhausted, recording the first failure
+void TaskPool::runJob(const std::function<void(uint32_t)>& fn, uint32_t count)
+{
+    for (uint32_t i = this->nextIndex.fetch_add(1u, std::memory_order_relaxed); i < count;
+         i = this->nextIndex.fetch_add(1u, std::memory_order_relaxed)) {
+        try {
+            fn(i);
+        } catch (...) {
+            std::scoped_lock lock(this->mutex);
+            if (!this->error) {
+                this->error = std::current_exception();
+            }
+        }
+    }
+}
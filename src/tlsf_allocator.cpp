@@ -0,0 +1,300 @@
+module;
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+module tlsf_allocator;
+
+TlsfAllocator::TlsfAllocator(uint64_t capacity, uint64_t granularity)
+    : totalSize(capacity & ~(granularity - 1u)), granularity(granularity)
+{
+    assert(std::has_single_bit(granularity) && "Granularity must be a power of 2");
+    assert(this->totalSize / granularity < (1ull << (flCount + slBits - 1u)));
+
+    for (auto& heads : this->freeHeads) {
+        std::fill(std::begin(heads), std::end(heads), nil);
+    }
+    if (this->totalSize > 0u) {
+        this->firstBlock = this->newBlock();
+        this->blocks[this->firstBlock].size = this->totalSize;
+        this->blocks[this->firstBlock].free = true;
+        this->insertFree(this->firstBlock);
+    }
+}
+
+void TlsfAllocator::mapping(uint64_t units, uint32_t& fl, uint32_t& sl)
+{
+    if (units < slCount) {
+        // Small sizes get one exact bin each in the first level
+        fl = 0u;
+        sl = static_cast<uint32_t>(units);
+    } else {
+        const uint32_t msb = static_cast<uint32_t>(std::bit_width(units)) - 1u;
+        fl = msb - slBits + 1u;
+        sl = static_cast<uint32_t>(units >> (msb - slBits)) - slCount;
+    }
+}
+
+void TlsfAllocator::mappingRoundUp(uint64_t units, uint32_t& fl, uint32_t& sl)
+{
+    if (units >= slCount) {
+        // Any block in the next bin up is at least this large
+        const uint32_t msb = static_cast<uint32_t>(std::bit_width(units)) - 1u;
+        units += (1ull << (msb - slBits)) - 1u;
+    }
+    mapping(units, fl, sl);
+}
+
+uint32_t TlsfAllocator::findFree(uint64_t size) const
+{
+    uint32_t fl, sl;
+    mappingRoundUp(size / this->granularity, fl, sl);
+    if (fl >= flCount) {
+        return nil;
+    }
+
+    uint32_t slMap = this->slBitmaps[fl] & (~0u << sl);
+    if (slMap == 0u) {
+        const uint64_t flMap = this->flBitmap & (~0ull << (fl + 1u));
+        if (flMap == 0u) {
+            return nil;
+        }
+        fl = static_cast<uint32_t>(std::countr_zero(flMap));
+        slMap = this->slBitmaps[fl];
+    }
+    return this->freeHeads[fl][std::countr_zero(slMap)];
+}
+
+void TlsfAllocator::insertFree(uint32_t index)
+{
+    uint32_t fl, sl;
+    mapping(this->blocks[index].size / this->granularity, fl, sl);
+
+    Block& block = this->blocks[index];
+    block.prevFree = nil;
+    block.nextFree = this->freeHeads[fl][sl];
+    if (block.nextFree != nil) {
+        this->blocks[block.nextFree].prevFree = index;
+    }
+    this->freeHeads[fl][sl] = index;
+    this->slBitmaps[fl] |= 1u << sl;
+    this->flBitmap |= 1ull << fl;
+}
+
+void TlsfAllocator::removeFree(uint32_t index)
+{
+    uint32_t fl, sl;
+    mapping(this->blocks[index].size / this->granularity, fl, sl);
+
+    const Block& block = this->blocks[index];
+    if (block.prevFree != nil) {
+        this->blocks[block.prevFree].nextFree = block.nextFree;
+    } else {
+        this->freeHeads[fl][sl] = block.nextFree;
+    }
+    if (block.nextFree != nil) {
+        this->blocks[block.nextFree].prevFree = block.prevFree;
+    }
+
+    if (this->freeHeads[fl][sl] == nil) {
+        this->slBitmaps[fl] &= ~(1u << sl);
+        if (this->slBitmaps[fl] == 0u) {
+            this->flBitmap &= ~(1ull << fl);
+        }
+    }
+}
+
+uint32_t TlsfAllocator::newBlock()
+{
+    if (!this->unusedBlocks.empty()) {
+        const uint32_t index = this->unusedBlocks.back();
+        this->unusedBlocks.pop_back();
+        return index;
+    }
+    this->blocks.emplace_back();
+    return static_cast<uint32_t>(this->blocks.size() - 1u);
+}
+
+uint64_t TlsfAllocator::alignedOffset(const Block& block, uint64_t alignment) const
+{
+    return (block.offset + alignment - 1u) & ~(alignment - 1u);
+}
+
+TlsfAllocator::Handle TlsfAllocator::use(uint32_t index, uint64_t size, uint64_t alignment)
+{
+    this->removeFree(index);
+
+    // Neighbors of a free block are always in use, so leftovers on either side become free
+    //  blocks of their own without merging
+    const uint64_t padding = this->alignedOffset(this->blocks[index], alignment) -
+        this->blocks[index].offset;
+    if (padding > 0u) {
+        const uint32_t front = this->newBlock();
+        Block& block = this->blocks[index];
+        this->blocks[front] = { block.offset, padding, 0u, block.prevPhys, index, nil, nil, true };
+        if (block.prevPhys != nil) {
+            this->blocks[block.prevPhys].nextPhys = front;
+        } else {
+            this->firstBlock = front;
+        }
+        block.prevPhys = front;
+        block.offset += padding;
+        block.size -= padding;
+        this->insertFree(front);
+    }
+
+    if (this->blocks[index].size > size) {
+        const uint32_t back = this->newBlock();
+        Block& block = this->blocks[index];
+        this->blocks[back] = {
+            block.offset + size, block.size - size, 0u, index, block.nextPhys, nil, nil, true
+        };
+        if (block.nextPhys != nil) {
+            this->blocks[block.nextPhys].prevPhys = back;
+        }
+        block.nextPhys = back;
+        block.size = size;
+        this->insertFree(back);
+    }
+
+    Block& block = this->blocks[index];
+    block.free = false;
+    block.alignment = alignment;
+    this->used += size;
+    this->nAllocations++;
+    return index;
+}
+
+uint64_t TlsfAllocator::searchSize(uint64_t size, uint64_t alignment, uint64_t granularity)
+{
+    // Searching for room to align in the worst case keeps the search O(1), at the cost of
+    //  passing over blocks that would have happened to be aligned
+    return size + std::max(alignment, granularity) - granularity;
+}
+
+uint64_t TlsfAllocator::capacityFor(uint64_t size, uint64_t alignment, uint64_t granularity)
+{
+    size = (std::max<uint64_t>(size, 1u) + granularity - 1u) & ~(granularity - 1u);
+    uint64_t units = searchSize(size, alignment, granularity) / granularity;
+    if (units >= slCount) {
+        // A lone free block only satisfies the search once it reaches the start of the bin
+        //  that mappingRoundUp() picks
+        const uint64_t binSize = 1ull << (std::bit_width(units) - 1u - slBits);
+        units = (units + binSize - 1u) & ~(binSize - 1u);
+    }
+    return units * granularity;
+}
+
+TlsfAllocator::Handle TlsfAllocator::allocate(uint64_t size, uint64_t alignment)
+{
+    assert(std::has_single_bit(alignment) && "Alignment must be a power of 2");
+
+    size = (std::max<uint64_t>(size, 1u) + this->granularity - 1u) & ~(this->granularity - 1u);
+    alignment = std::max(alignment, this->granularity);
+
+    const uint32_t index = this->findFree(searchSize(size, alignment, this->granularity));
+    if (index == nil) {
+        this->nFailures++;
+        return invalidHandle;
+    }
+    return this->use(index, size, alignment);
+}
+
+void TlsfAllocator::free(Handle handle)
+{
+    assert(handle < this->blocks.size() && !this->blocks[handle].free && "Invalid handle");
+
+    uint32_t index = handle;
+    this->used -= this->blocks[index].size;
+    this->nAllocations--;
+    this->blocks[index].free = true;
+
+    const uint32_t prev = this->blocks[index].prevPhys;
+    if (prev != nil && this->blocks[prev].free) {
+        this->removeFree(prev);
+        this->blocks[prev].size += this->blocks[index].size;
+        this->blocks[prev].nextPhys = this->blocks[index].nextPhys;
+        if (this->blocks[index].nextPhys != nil) {
+            this->blocks[this->blocks[index].nextPhys].prevPhys = prev;
+        }
+        this->blocks[index] = {};
+        this->unusedBlocks.push_back(index);
+        index = prev;
+    }
+
+    const uint32_t next = this->blocks[index].nextPhys;
+    if (next != nil && this->blocks[next].free) {
+        this->removeFree(next);
+        this->blocks[index].size += this->blocks[next].size;
+        this->blocks[index].nextPhys = this->blocks[next].nextPhys;
+        if (this->blocks[next].nextPhys != nil) {
+            this->blocks[this->blocks[next].nextPhys].prevPhys = index;
+        }
+        this->blocks[next] = {};
+        this->unusedBlocks.push_back(next);
+    }
+
+    this->insertFree(index);
+}
+
+uint64_t TlsfAllocator::offset(Handle handle) const
+{
+    assert(handle < this->blocks.size() && !this->blocks[handle].free);
+    return this->blocks[handle].offset;
+}
+
+uint64_t TlsfAllocator::size(Handle handle) const
+{
+    assert(handle < this->blocks.size() && !this->blocks[handle].free);
+    return this->blocks[handle].size;
+}
+
+bool TlsfAllocator::empty() const
+{
+    return this->nAllocations == 0u;
+}
+
+TlsfAllocator::Stats TlsfAllocator::stats() const
+{
+    Stats s;
+    s.capacity = this->totalSize;
+    s.usedBytes = this->used;
+    s.allocations = this->nAllocations;
+    s.failures = this->nFailures;
+    for (uint32_t i = this->firstBlock; i != nil; i = this->blocks[i].nextPhys) {
+        if (this->blocks[i].free) {
+            s.freeBlocks++;
+            s.largestFreeBlock = std::max(s.largestFreeBlock, this->blocks[i].size);
+        }
+    }
+    return s;
+}
+
+std::vector<TlsfAllocator::Move> TlsfAllocator::beginDefragment(uint32_t maxMoves)
+{
+    std::vector<uint32_t> inUse;
+    for (uint32_t i = this->firstBlock; i != nil; i = this->blocks[i].nextPhys) {
+        if (!this->blocks[i].free) {
+            inUse.push_back(i);
+        }
+    }
+
+    // Walking the physical list is linear per move, fine for a pass that runs rarely
+    std::vector<Move> moves;
+    for (auto it = inUse.rbegin(); it != inUse.rend() && moves.size() < maxMoves; ++it) {
+        const Block src = this->blocks[*it];
+        for (uint32_t i = this->firstBlock; i != nil && this->blocks[i].offset < src.offset;
+             i = this->blocks[i].nextPhys) {
+            const Block& candidate = this->blocks[i];
+            if (candidate.free && this->alignedOffset(candidate, src.alignment) + src.size <=
+                                      candidate.offset + candidate.size) {
+                moves.push_back({ *it, this->use(i, src.size, src.alignment) });
+                break;
+            }
+        }
+    }
+    return moves;
+}
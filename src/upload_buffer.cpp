@@ -2,6 +2,11 @@ module;
 
 #include <d3d12.h>
 #include <wrl.h>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <memory>
 #include <new>
 #include "d3dx12.h"
 
@@ -9,45 +14,127 @@ module upload_buffer;
 
 import window;
 
-UploadBuffer::UploadBuffer(size_t pageSize) : pageSize(pageSize) {}
+UploadBuffer::UploadBuffer(size_t pageSize, Mode mode, uint32_t largePageTrimFrames)
+    : pageSize(pageSize),
+      mode(mode),
+      largePages(
+          [](size_t sizeInBytes) { return std::make_unique<Page>(sizeInBytes); }, pageSize * 2u,
+          largePageTrimFrames
+      ),
+      allocatorTelemetry(mode == Mode::Ring ? "upload ring" : "upload pages", "bytes")
+{
+    if (mode == Mode::Ring) {
+        this->pages.push_back(std::make_unique<Page>(pageSize));
+        this->ring = RingAllocator(pageSize);
+    }
+}
 
 UploadBuffer::Allocation UploadBuffer::allocate(size_t sizeInBytes, size_t alignment)
 {
+    this->allocatorTelemetry.recordAllocation(sizeInBytes);
     if (sizeInBytes > this->pageSize) {
-        throw std::bad_alloc();
+        // Placed at the start of its page, which is at least as aligned as any upload needs
+        Page& page = this->largePages.acquire(sizeInBytes);
+        page.reset();
+        return page.allocate(sizeInBytes, alignment);
     }
 
-    if (!this->curPage || !this->curPage->fits(sizeInBytes, alignment)) {
-        this->curPage = this->requestPage();
+    if (this->mode == Mode::Ring) {
+        const size_t offset = this->ring.allocate(sizeInBytes, alignment);
+        if (offset == RingAllocator::invalidOffset) {
+            // Everything is still in flight, the ring is too small for the frames it serves
+            throw std::bad_alloc();
+        }
+        return this->pages.front()->at(offset);
     }
 
-    return this->curPage->allocate(sizeInBytes, alignment);
+    if (this->pages.empty() || !this->pages[this->curPage]->fits(sizeInBytes, alignment)) {
+        return this->requestPage().allocate(sizeInBytes, alignment);
+    }
+    return this->pages[this->curPage]->allocate(sizeInBytes, alignment);
 }
 
-std::shared_ptr<UploadBuffer::Page> UploadBuffer::requestPage()
+UploadBuffer::Page& UploadBuffer::requestPage()
 {
-    std::shared_ptr<Page> page = nullptr;
-
-    if (!this->freePages.empty()) {
-        page = this->freePages.front();
-        this->freePages.pop_front();
-    } else {
-        page = std::make_shared<Page>(this->pageSize);
-        this->pagePool.push_back(page);
+    if (!this->pages.empty()) {
+        this->curPage++;
     }
-
-    return page;
+    if (this->curPage == this->pages.size()) {
+        this->pages.push_back(std::make_unique<Page>(this->pageSize));
+    }
+    return *this->pages[this->curPage];
 }
 
 void UploadBuffer::reset()
 {
-    this->curPage = nullptr;
-    this->freePages = this->pagePool;
-    for (auto& page : this->freePages) {
+    // Each reset ends a frame's use of the buffer
+    this->largePages.retire(std::numeric_limits<uint64_t>::max());
+    this->largePages.endFrame();
+
+    if (this->mode == Mode::Ring) {
+        this->ring.reset();
+        return;
+    }
+
+    this->curPage = 0u;
+    for (auto& page : this->pages) {
         page->reset();
     }
 }
 
+void UploadBuffer::commit(uint64_t fenceValue)
+{
+    assert(this->mode == Mode::Ring && "commit() is only meaningful for ring upload buffers");
+    this->ring.commit(fenceValue);
+    this->largePages.commit(fenceValue);
+}
+
+void UploadBuffer::retire(uint64_t completedValue)
+{
+    assert(this->mode == Mode::Ring && "retire() is only meaningful for ring upload buffers");
+    this->ring.retire(completedValue);
+    this->largePages.retire(completedValue);
+    this->largePages.endFrame();
+}
+
+const RingAllocator::Stats& UploadBuffer::ringStats() const
+{
+    return this->ring.stats();
+}
+
+const LargePagePool<UploadBuffer::Page>::Stats& UploadBuffer::largePageStats() const
+{
+    return this->largePages.stats();
+}
+
+void UploadBuffer::sampleTelemetry(uint64_t frame)
+{
+    AllocatorTelemetry::Gauges gauges;
+    gauges.live = this->largePages.inUseBytes();
+    gauges.reserved = this->largePages.stats().residentBytes;
+    if (this->mode == Mode::Ring) {
+        gauges.live += this->ring.usedBytes();
+        gauges.reserved += this->ring.capacity();
+        gauges.largestFreeBlock = this->ring.largestFreeBlock();
+    } else {
+        for (size_t i = 0u; i < this->pages.size(); ++i) {
+            // Pages past the current one are untouched since the last reset
+            const size_t used = i <= this->curPage ? this->pages[i]->used() : 0u;
+            gauges.live += used;
+            gauges.largestFreeBlock =
+                std::max<uint64_t>(gauges.largestFreeBlock, this->pageSize - used);
+        }
+        gauges.reserved += this->pages.size() * this->pageSize;
+    }
+    gauges.pages = static_cast<uint32_t>(this->pages.size());
+    this->allocatorTelemetry.sample(frame, gauges);
+}
+
+const AllocatorTelemetry& UploadBuffer::telemetry() const
+{
+    return this->allocatorTelemetry;
+}
+
 UploadBuffer::Page::Page(size_t sizeInBytes) : size(sizeInBytes)
 {
     auto device = Window::get()->device;
@@ -85,14 +172,135 @@ UploadBuffer::Allocation UploadBuffer::Page::allocate(size_t sizeInBytes, size_t
     const size_t alignedSize = align(sizeInBytes, alignment);
     this->offset = align(this->offset, alignment);
 
-    Allocation allocation;
-    allocation.cpu = static_cast<uint8_t*>(this->cpuPtr) + this->offset;
-    allocation.gpu = this->gpuPtr + this->offset;
+    Allocation allocation = this->at(this->offset);
     this->offset += alignedSize;
     return allocation;
 }
 
+UploadBuffer::Allocation UploadBuffer::Page::at(size_t offset) const
+{
+    Allocation allocation;
+    allocation.cpu = static_cast<uint8_t*>(this->cpuPtr) + offset;
+    allocation.gpu = this->gpuPtr + offset;
+    allocation.resource = this->resource.Get();
+    allocation.offset = offset;
+    return allocation;
+}
+
+size_t UploadBuffer::Page::used() const
+{
+    return this->offset;
+}
+
 void UploadBuffer::Page::reset()
 {
     this->offset = 0u;
 }
+
+ParallelUploadBuffer::ParallelUploadBuffer(
+    uint32_t nThreadSlots,
+    size_t pageSize,
+    uint32_t maxPages
+)
+    : pageSize(pageSize),
+      pool([pageSize]() { return std::make_unique<UploadBuffer::Page>(pageSize); }, maxPages),
+      slots(std::max(1u, nThreadSlots)),
+      allocatorTelemetry("thread upload pages", "bytes")
+{
+}
+
+ParallelUploadBuffer::Allocation ParallelUploadBuffer::allocate(
+    uint32_t threadSlot,
+    size_t sizeInBytes,
+    size_t alignment
+)
+{
+    assert(threadSlot < this->slots.size() && "Thread slot out of range");
+    if (sizeInBytes > this->pageSize) {
+        throw std::bad_alloc();
+    }
+
+    ThreadSlot& slot = this->slots[threadSlot];
+    if (slot.page == noPage || !this->pool.page(slot.page).fits(sizeInBytes, alignment)) {
+        if (slot.page != noPage) {
+            slot.usedPages.push_back(slot.page);
+        }
+        slot.page = this->pool.acquire();
+        this->pool.page(slot.page).reset();
+    }
+
+    slot.allocations++;
+    this->allocatorTelemetry.recordAllocation(sizeInBytes);
+    return this->pool.page(slot.page).allocate(sizeInBytes, alignment);
+}
+
+void ParallelUploadBuffer::commit(uint64_t fenceValue)
+{
+    for (ThreadSlot& slot : this->slots) {
+        // The partially filled page is in flight too, the slot starts on a fresh one
+        if (slot.page != noPage) {
+            slot.usedPages.push_back(slot.page);
+            slot.page = noPage;
+        }
+        for (uint32_t page : slot.usedPages) {
+            this->pending.push_back({ fenceValue, page });
+        }
+        slot.usedPages.clear();
+    }
+}
+
+void ParallelUploadBuffer::retire(uint64_t completedValue)
+{
+    auto done = std::find_if(this->pending.begin(), this->pending.end(), [&](const PendingPage& p) {
+        return p.fenceValue > completedValue;
+    });
+    for (auto it = this->pending.begin(); it != done; ++it) {
+        this->pool.release(it->page);
+    }
+    this->pending.erase(this->pending.begin(), done);
+}
+
+ParallelUploadBuffer::Stats ParallelUploadBuffer::stats() const
+{
+    const auto poolStats = this->pool.stats();
+    Stats total{ poolStats.pagesCreated, poolStats.acquires, 0u };
+    for (const ThreadSlot& slot : this->slots) {
+        total.allocations += slot.allocations;
+    }
+    return total;
+}
+
+void ParallelUploadBuffer::sampleTelemetry(uint64_t frame)
+{
+    // Pages held by a slot or waiting on a fence are in use, the rest sit in the pool
+    AllocatorTelemetry::Gauges gauges;
+    uint32_t held = 0u;
+    for (const ThreadSlot& slot : this->slots) {
+        if (slot.page != noPage) {
+            const size_t used = this->pool.page(slot.page).used();
+            gauges.live += used;
+            gauges.largestFreeBlock =
+                std::max<uint64_t>(gauges.largestFreeBlock, this->pageSize - used);
+            held++;
+        }
+        for (uint32_t page : slot.usedPages) {
+            gauges.live += this->pool.page(page).used();
+            held++;
+        }
+    }
+    for (const PendingPage& p : this->pending) {
+        gauges.live += this->pool.page(p.page).used();
+        held++;
+    }
+    gauges.pages = static_cast<uint32_t>(this->pool.stats().pagesCreated);
+    gauges.reserved = static_cast<uint64_t>(gauges.pages) * this->pageSize;
+    if (held < gauges.pages) {
+        gauges.largestFreeBlock = this->pageSize;
+    }
+    this->allocatorTelemetry.sample(frame, gauges);
+}
+
+const AllocatorTelemetry& ParallelUploadBuffer::telemetry() const
+{
+    return this->allocatorTelemetry;
+}
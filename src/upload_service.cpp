@@ -0,0 +1,144 @@
+module;
+
+#include <d3d12.h>
+#include <wrl.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <utility>
+#include "d3dx12.h"
+
+module upload_service;
+
+UploadService::UploadService(
+    ComPtr<ID3D12Device2> device,
+    GpuHeapAllocator& gpuMemory,
+    ResourceReleaseQueue& releaseQueue,
+    size_t stagingBytes
+)
+    : copyQueue(device, D3D12_COMMAND_LIST_TYPE_COPY),
+      gpuMemory(gpuMemory),
+      copyList(this->copyQueue),
+      batcher(this->copyList, releaseQueue, &this->copyQueue),
+      staging(stagingBytes, UploadBuffer::Mode::Ring)
+{
+}
+
+UploadService::~UploadService()
+{
+    this->submit();
+    this->copyQueue.flush();
+    this->retire();
+}
+
+GpuAllocation UploadService::uploadBuffer(
+    const void* data,
+    size_t sizeInBytes,
+    D3D12_RESOURCE_FLAGS flags
+)
+{
+    // Copy queues only accept resources in the COMMON state, buffers are promoted on first use
+    GpuAllocation destination = this->gpuMemory.createResource(
+        CD3DX12_RESOURCE_DESC::Buffer(sizeInBytes, flags), D3D12_HEAP_TYPE_DEFAULT,
+        D3D12_RESOURCE_STATE_COMMON
+    );
+
+    std::scoped_lock lock(this->stagingMutex);
+    const UploadBuffer::Allocation source = this->allocateStaging(sizeInBytes);
+    std::memcpy(source.cpu, data, sizeInBytes);
+
+    // The ring decides when the bytes are reused, the batcher's reference only keeps the page
+    //  alive until the copy has run
+    this->batcher.copy(
+        destination.resource(), ComPtr<ID3D12Resource>(source.resource), source.offset,
+        sizeInBytes
+    );
+    return destination;
+}
+
+UploadBuffer::Allocation UploadService::allocateStaging(size_t sizeInBytes)
+{
+    try {
+        return this->staging.allocate(sizeInBytes);
+    } catch (const std::bad_alloc&) {
+        // Every byte of the ring is waiting on a copy. Submit what's queued and wait for the
+        //  copy queue to drain rather than growing the ring, then start over on an empty one.
+        this->submitStaged();
+        this->copyQueue.flush();
+        this->staging.retire(this->copyQueue.completedValue());
+        return this->staging.allocate(sizeInBytes);
+    }
+}
+
+UploadTicket UploadService::submit()
+{
+    std::scoped_lock lock(this->stagingMutex);
+    return this->submitStaged();
+}
+
+UploadTicket UploadService::submitStaged()
+{
+    const UploadTicket ticket = this->batcher.submit();
+    this->staging.commit(ticket.fenceValue);
+    return ticket;
+}
+
+void UploadService::waitOnGpu(CommandQueue& queue, UploadTicket ticket)
+{
+    queue.gpuWait(this->copyQueue, ticket.fenceValue);
+}
+
+void UploadService::retire()
+{
+    std::scoped_lock lock(this->stagingMutex);
+    this->batcher.retire();
+    this->staging.retire(this->copyQueue.completedValue());
+}
+
+UploadService::Stats UploadService::stats()
+{
+    return this->batcher.stats();
+}
+
+void UploadService::sampleTelemetry(uint64_t frame)
+{
+    std::scoped_lock lock(this->stagingMutex);
+    this->staging.sampleTelemetry(frame);
+}
+
+const AllocatorTelemetry& UploadService::stagingTelemetry() const
+{
+    return this->staging.telemetry();
+}
+
+const UploadBuffer& UploadService::stagingBuffer() const
+{
+    return this->staging;
+}
+
+void UploadService::CopyList::openBatch()
+{
+    this->cmdList = this->queue.getCmdList();
+}
+
+void UploadService::CopyList::copy(
+    const ComPtr<ID3D12Resource>& destination,
+    const ComPtr<ID3D12Resource>& source,
+    size_t sourceOffset,
+    size_t size
+)
+{
+    this->cmdList->CopyBufferRegion(destination.Get(), 0, source.Get(), sourceOffset, size);
+}
+
+uint64_t UploadService::CopyList::submitBatch()
+{
+    return this->queue.execCmdList(std::exchange(this->cmdList, nullptr));
+}
+
+uint64_t UploadService::CopyList::completedValue() const
+{
+    return this->queue.completedValue();
+}
@@ -236,6 +236,7 @@ void Window::registerApp(Application* application)
 
     this->app = application;
     this->app->hWnd = this->hWnd;
+    this->app->adapter = this->adapter;
     this->app->device = this->device;
     this->app->tearingSupported = this->tearingSupported;
     this->app->clientWidth = this->width;
@@ -263,7 +264,8 @@ void Window::initialize(
     this->hWnd = makeWindow(windowClassName, hInstance, wTitle.c_str(), w, h);
     GetWindowRect(this->hWnd, &this->windowRect);
 
-    this->device = createDevice(getAdapter(useWarp));
+    this->adapter = getAdapter(useWarp);
+    this->device = createDevice(this->adapter);
     this->width = w;
     this->height = h;
 }
@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <vector>
+#include "check.h"
+
+import alias_planner;
+
+constexpr uint64_t KB = 1024u;
+constexpr uint64_t MB = 1024u * KB;
+
+static void testDisjointLifetimesShare()
+{
+    AliasPlanner planner;
+    const uint32_t a = planner.add({ 1u * MB, 64u * KB, 0u, 0u, 1u });
+    const uint32_t b = planner.add({ 1u * MB, 64u * KB, 0u, 2u, 3u });
+    planner.plan();
+
+    CHECK(planner.heaps().size() == 1u);
+    CHECK(planner.heaps()[0].size == 1u * MB);
+    CHECK(planner.placement(a).offset == planner.placement(b).offset);
+    CHECK(planner.placement(a).previous == AliasPlanner::none);
+    CHECK(planner.placement(b).previous == a);
+    CHECK(planner.stats().aliased == 1u);
+    CHECK(planner.stats().requestedBytes == 2u * MB);
+    CHECK(planner.stats().peakLiveBytes == 1u * MB);
+}
+
+static void testOverlappingLifetimesDont()
+{
+    AliasPlanner planner;
+    const uint32_t a = planner.add({ 1u * MB, 64u * KB, 0u, 0u, 2u });
+    // Lifetimes are inclusive, so meeting at position 2 is an overlap
+    const uint32_t b = planner.add({ 1u * MB, 64u * KB, 0u, 2u, 3u });
+    planner.plan();
+
+    CHECK(planner.placement(a).offset != planner.placement(b).offset);
+    CHECK(planner.placement(b).previous == AliasPlanner::none);
+    CHECK(planner.heaps()[0].size == 2u * MB);
+    CHECK(planner.stats().aliased == 0u);
+}
+
+// A dead slot the request fits in is preferred, the smallest of them
+static void testSmallestFittingSlot()
+{
+    AliasPlanner planner;
+    planner.add({ 4u * MB, 64u * KB, 0u, 0u, 0u });
+    const uint32_t small = planner.add({ 1u * MB, 64u * KB, 0u, 0u, 0u });
+    const uint32_t next = planner.add({ 1u * MB, 64u * KB, 0u, 1u, 1u });
+    planner.plan();
+
+    CHECK(planner.placement(next).previous == small);
+    CHECK(planner.placement(next).offset == planner.placement(small).offset);
+    CHECK(planner.heaps()[0].size == 5u * MB);
+}
+
+// With no dead slot large enough, the largest one grows rather than a new slot opening
+static void testLargestSlotGrows()
+{
+    AliasPlanner planner;
+    planner.add({ 1u * MB, 64u * KB, 0u, 0u, 0u });
+    const uint32_t large = planner.add({ 2u * MB, 64u * KB, 0u, 0u, 0u });
+    const uint32_t next = planner.add({ 3u * MB, 64u * KB, 0u, 1u, 1u });
+    planner.plan();
+
+    CHECK(planner.placement(next).previous == large);
+    CHECK(planner.stats().slots == 2u);
+    CHECK(planner.heaps()[0].size == 4u * MB);
+}
+
+static void testGroupsGetTheirOwnHeaps()
+{
+    AliasPlanner planner;
+    const uint32_t a = planner.add({ 1u * MB, 64u * KB, 1u, 0u, 0u });
+    const uint32_t b = planner.add({ 1u * MB, 64u * KB, 0u, 1u, 1u });
+    planner.plan();
+
+    CHECK(planner.heaps().size() == 2u);
+    CHECK(planner.placement(a).heap != planner.placement(b).heap);
+    CHECK(planner.placement(b).previous == AliasPlanner::none);
+    CHECK(planner.heaps()[planner.placement(a).heap].group == 1u);
+}
+
+// The most aligned slot goes first, the others after it at their own alignment
+static void testSlotLayout()
+{
+    AliasPlanner planner;
+    const uint32_t a = planner.add({ 100u * KB, 64u * KB, 0u, 0u, 0u });
+    const uint32_t b = planner.add({ 5u * MB, 4u * MB, 0u, 0u, 0u });
+    planner.plan();
+
+    CHECK(planner.placement(b).offset == 0u);
+    CHECK(planner.placement(a).offset == 8u * MB);
+    CHECK(planner.heaps()[0].alignment == 4u * MB);
+    CHECK(planner.heaps()[0].size == 8u * MB + 128u * KB);
+}
+
+static void testClear()
+{
+    AliasPlanner planner;
+    planner.add({ 1u * MB, 64u * KB, 0u, 0u, 0u });
+    planner.plan();
+    planner.clear();
+    planner.plan();
+    CHECK(planner.heaps().empty());
+    CHECK(planner.stats().requests == 0u);
+}
+
+// Random lifetimes: requests live at the same time never overlap in memory, every request
+//  stays aligned and in its heap, and a group never has more slots than requests live at once
+static void testRandomNoLiveOverlap()
+{
+    std::mt19937 rng(13u);
+    bool overlap = false;
+    bool misplaced = false;
+    bool tooManySlots = false;
+    bool badPrevious = false;
+
+    for (uint32_t round = 0u; round < 200u; round++) {
+        AliasPlanner planner;
+        std::vector<AliasPlanner::Request> requests;
+        const uint32_t nRequests = 1u + static_cast<uint32_t>(rng() % 40u);
+        for (uint32_t i = 0u; i < nRequests; i++) {
+            const uint64_t size = 1u + rng() % (8u * MB);
+            const uint64_t alignment = (rng() % 4u == 0u) ? 4u * MB : 64u * KB;
+            const uint32_t group = static_cast<uint32_t>(rng() % 3u);
+            const uint32_t first = static_cast<uint32_t>(rng() % 30u);
+            const uint32_t last = first + static_cast<uint32_t>(rng() % 8u);
+            requests.push_back({ size, alignment, group, first, last });
+            planner.add(requests.back());
+        }
+        planner.plan();
+
+        const std::span<const AliasPlanner::Heap> heaps = planner.heaps();
+        for (uint32_t i = 0u; i < nRequests; i++) {
+            const AliasPlanner::Request& r = requests[i];
+            const AliasPlanner::Placement& p = planner.placement(i);
+            misplaced = misplaced || p.heap >= heaps.size() || heaps[p.heap].group != r.group ||
+                p.offset % r.alignment != 0u || p.offset + r.size > heaps[p.heap].size;
+            if (p.previous != AliasPlanner::none) {
+                const AliasPlanner::Placement& q = planner.placement(p.previous);
+                badPrevious = badPrevious || requests[p.previous].lastUse >= r.firstUse ||
+                    q.heap != p.heap;
+            }
+            for (uint32_t j = i + 1u; j < nRequests; j++) {
+                const AliasPlanner::Request& s = requests[j];
+                const AliasPlanner::Placement& q = planner.placement(j);
+                const bool live = r.firstUse <= s.lastUse && s.firstUse <= r.lastUse;
+                const bool shared = p.heap == q.heap && p.offset < q.offset + s.size &&
+                    q.offset < p.offset + r.size;
+                overlap = overlap || (live && shared);
+            }
+        }
+
+        // Slots per group against the most requests of that group live at one position
+        for (uint32_t group = 0u; group < 3u; group++) {
+            uint32_t maxLive = 0u;
+            for (uint32_t pos = 0u; pos < 40u; pos++) {
+                const uint32_t live = static_cast<uint32_t>(
+                    std::count_if(requests.begin(), requests.end(), [&](const auto& r) {
+                        return r.group == group && r.firstUse <= pos && pos <= r.lastUse;
+                    })
+                );
+                maxLive = std::max(maxLive, live);
+            }
+            std::vector<uint64_t> offsets;
+            for (uint32_t i = 0u; i < nRequests; i++) {
+                if (requests[i].group == group) {
+                    offsets.push_back(planner.placement(i).offset);
+                }
+            }
+            std::sort(offsets.begin(), offsets.end());
+            const size_t nSlots = std::unique(offsets.begin(), offsets.end()) - offsets.begin();
+            tooManySlots = tooManySlots || nSlots > maxLive;
+        }
+        CHECK(planner.stats().heapBytes >= planner.stats().peakLiveBytes);
+        CHECK(planner.stats().heapBytes <= planner.stats().requestedBytes);
+    }
+    CHECK(!overlap);
+    CHECK(!misplaced);
+    CHECK(!tooManySlots);
+    CHECK(!badPrevious);
+}
+
+int main()
+{
+    testDisjointLifetimesShare();
+    testOverlappingLifetimesDont();
+    testSmallestFittingSlot();
+    testLargestSlotGrows();
+    testGroupsGetTheirOwnHeaps();
+    testSlotLayout();
+    testClear();
+    testRandomNoLiveOverlap();
+    return checkResult();
+}
@@ -0,0 +1,332 @@
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "check.h"
+
+import allocator_telemetry;
+
+// Just enough of a JSON parser to tell whether a document is well formed
+class JsonValidator
+{
+   public:
+    explicit JsonValidator(std::string_view text) : text(text) {}
+
+    bool valid()
+    {
+        this->skipSpace();
+        if (!this->value()) {
+            return false;
+        }
+        this->skipSpace();
+        return this->pos == this->text.size();
+    }
+
+   private:
+    std::string_view text;
+    size_t pos = 0u;
+
+    bool value()
+    {
+        this->skipSpace();
+        if (this->pos == this->text.size()) {
+            return false;
+        }
+        switch (this->text[this->pos]) {
+            case '{':
+                return this->container('}', true);
+            case '[':
+                return this->container(']', false);
+            case '"':
+                return this->string();
+            default:
+                return this->literal();
+        }
+    }
+
+    bool container(char close, bool object)
+    {
+        this->pos++;
+        this->skipSpace();
+        if (this->eat(close)) {
+            return true;
+        }
+        do {
+            this->skipSpace();
+            if (object) {
+                if (!this->string()) {
+                    return false;
+                }
+                this->skipSpace();
+                if (!this->eat(':')) {
+                    return false;
+                }
+            }
+            if (!this->value()) {
+                return false;
+            }
+            this->skipSpace();
+        } while (this->eat(','));
+        return this->eat(close);
+    }
+
+    bool string()
+    {
+        if (!this->eat('"')) {
+            return false;
+        }
+        while (this->pos < this->text.size()) {
+            const auto c = static_cast<unsigned char>(this->text[this->pos++]);
+            if (c == '"') {
+                return true;
+            }
+            if (c < 0x20u) {
+                return false;
+            }
+            if (c == '\\') {
+                if (this->pos == this->text.size()) {
+                    return false;
+                }
+                const char e = this->text[this->pos++];
+                if (e == 'u') {
+                    for (uint32_t i = 0u; i < 4u; i++) {
+                        if (this->pos == this->text.size() ||
+                            !std::isxdigit(static_cast<unsigned char>(this->text[this->pos++]))) {
+                            return false;
+                        }
+                    }
+                } else if (std::string_view("\"\\/bfnrt").find(e) == std::string_view::npos) {
+                    return false;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Numbers, true, false and null
+    bool literal()
+    {
+        for (const std::string_view word : { "true", "false", "null" }) {
+            if (this->text.substr(this->pos, word.size()) == word) {
+                this->pos += word.size();
+                return true;
+            }
+        }
+        const std::string number(this->text.substr(this->pos, 64u));
+        char* end = nullptr;
+        std::strtod(number.c_str(), &end);
+        const size_t length = static_cast<size_t>(end - number.c_str());
+        const char first = number.empty() ? '\0' : number[0];
+        if (length == 0u || !(first == '-' || std::isdigit(static_cast<unsigned char>(first)))) {
+            return false;
+        }
+        this->pos += length;
+        return true;
+    }
+
+    bool eat(char c)
+    {
+        if (this->pos < this->text.size() && this->text[this->pos] == c) {
+            this->pos++;
+            return true;
+        }
+        return false;
+    }
+
+    void skipSpace()
+    {
+        while (this->pos < this->text.size() &&
+               std::isspace(static_cast<unsigned char>(this->text[this->pos]))) {
+            this->pos++;
+        }
+    }
+};
+
+static bool validJson(const std::string& text)
+{
+    return JsonValidator(text).valid();
+}
+
+// Occurrences of needle in text
+static size_t count(const std::string& text, const std::string& needle)
+{
+    size_t n = 0u;
+    for (size_t at = text.find(needle); at != std::string::npos; at = text.find(needle, at + 1u)) {
+        n++;
+    }
+    return n;
+}
+
+static void testValidatorRejectsBrokenJson()
+{
+    CHECK(validJson("{\"a\":[1,-2.5e3,true,null,{\"b\":\"c\\u00e9\"}]}"));
+    CHECK(!validJson("{\"a\":1,}"));
+    CHECK(!validJson("{\"a\":\"line\nbreak\"}"));
+    CHECK(!validJson("[1,2"));
+    CHECK(!validJson("{\"a\":nan}"));
+}
+
+// live comes from the allocator at each sample and peakLive is the most it has been since
+static void testLiveAndPeak()
+{
+    AllocatorTelemetry telemetry("upload", "bytes");
+    telemetry.sample(1u, { 100u, 1000u, 900u, 1u });
+    telemetry.sample(2u, { 700u, 1000u, 300u, 1u });
+    telemetry.sample(3u, { 200u, 2000u, 900u, 2u });
+
+    const AllocatorTelemetry::Snapshot s = telemetry.snapshot();
+    CHECK(s.latest.frame == 3u);
+    CHECK(s.latest.gauges.live == 200u);
+    CHECK(s.latest.gauges.reserved == 2000u);
+    CHECK(s.latest.gauges.pages == 2u);
+    CHECK(s.peakLive == 700u);
+
+    // 1800 unused, 900 of it in the largest block
+    CHECK(s.fragmentation() == 0.5);
+    telemetry.sample(4u, { 2000u, 2000u, 0u, 2u });
+    CHECK(telemetry.snapshot().fragmentation() == 0.0);
+    CHECK(telemetry.snapshot().peakLive == 2000u);
+}
+
+// Bucket i holds sizes in (2^(i-1), 2^i], bucket 0 sizes of 0 and 1, the last one everything
+//  past its lower bound
+static void testHistogramBuckets()
+{
+    AllocatorTelemetry telemetry("descriptors", "descriptors");
+    for (const uint64_t amount : { 0u, 1u, 2u, 3u, 4u, 5u, 8u, 9u, 256u, 257u }) {
+        telemetry.recordAllocation(amount);
+    }
+    telemetry.recordAllocation(uint64_t(1u) << 31u);
+    telemetry.recordAllocation((uint64_t(1u) << 31u) + 1u);
+    telemetry.recordAllocation(uint64_t(1u) << 40u);
+    telemetry.sample(1u, {});
+
+    const AllocatorTelemetry::Snapshot s = telemetry.snapshot();
+    CHECK(s.histogram[0] == 2u);
+    CHECK(s.histogram[1] == 1u);
+    CHECK(s.histogram[2] == 2u);
+    CHECK(s.histogram[3] == 2u);
+    CHECK(s.histogram[4] == 1u);
+    CHECK(s.histogram[8] == 1u);
+    CHECK(s.histogram[9] == 1u);
+    CHECK(s.histogram[AllocatorTelemetry::histogramBuckets - 1u] == 3u);
+    uint64_t total = 0u;
+    for (const uint64_t n : s.histogram) {
+        total += n;
+    }
+    CHECK(total == 13u);
+    CHECK(s.allocations == 13u);
+}
+
+// Each sample reports the allocations since the one before, the snapshot the running totals
+static void testPerFrameCounts()
+{
+    AllocatorTelemetry telemetry("arena", "bytes");
+    telemetry.recordAllocation(10u);
+    telemetry.recordAllocation(20u);
+    telemetry.sample(1u, {});
+    telemetry.recordAllocation(5u);
+    telemetry.sample(2u, {});
+    telemetry.sample(3u, {});
+
+    const AllocatorTelemetry::Snapshot s = telemetry.snapshot();
+    CHECK(s.allocations == 3u && s.allocatedAmount == 35u);
+    CHECK(s.latest.allocations == 0u && s.latest.allocatedAmount == 0u);
+    const std::string json = telemetry.json();
+    CHECK(json.find("\"history\":[{\"frame\":1,\"live\":0,\"reserved\":0,\"largestFreeBlock\":0,"
+                    "\"pages\":0,\"allocations\":2,\"allocated\":30}") != std::string::npos);
+    CHECK(json.find("{\"frame\":2,\"live\":0,\"reserved\":0,\"largestFreeBlock\":0,\"pages\":0,"
+                    "\"allocations\":1,\"allocated\":5}") != std::string::npos);
+}
+
+// More threads than there are counter blocks record at once while another thread samples.
+//  Nothing is lost, and the totals only ever grow.
+static void testConcurrentRecording()
+{
+    constexpr uint32_t nThreads = AllocatorTelemetry::maxThreadSlots + 8u;
+    constexpr uint32_t perThread = 20000u;
+    AllocatorTelemetry telemetry("shared", "bytes");
+
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0u; t < nThreads; t++) {
+        threads.emplace_back([&telemetry, t]() {
+            for (uint32_t i = 0u; i < perThread; i++) {
+                // Half of the allocations 16 bytes, the other half 4096 plus the thread
+                telemetry.recordAllocation(i % 2u == 0u ? 16u : 4096u + t);
+            }
+        });
+    }
+    bool monotonic = true;
+    uint64_t previous = 0u;
+    for (uint64_t frame = 1u; frame <= 200u; frame++) {
+        telemetry.sample(frame, {});
+        const uint64_t allocations = telemetry.snapshot().allocations;
+        monotonic = monotonic && allocations >= previous;
+        previous = allocations;
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    telemetry.sample(201u, {});
+
+    const AllocatorTelemetry::Snapshot s = telemetry.snapshot();
+    const uint64_t total = static_cast<uint64_t>(nThreads) * perThread;
+    uint64_t amount = 0u;
+    for (uint32_t t = 0u; t < nThreads; t++) {
+        amount += perThread / 2u * (16u + 4096u + t);
+    }
+    CHECK(monotonic);
+    CHECK(s.allocations == total);
+    CHECK(s.allocatedAmount == amount);
+    CHECK(s.histogram[4] == total / 2u);
+    // 4096 itself, then (4096, 8192] for everyone else
+    CHECK(s.histogram[12] == perThread / 2u);
+    CHECK(s.histogram[13] == total / 2u - perThread / 2u);
+}
+
+// The JSON holds the latest snapshot and at most historyLength samples, and stays well formed
+//  whatever the allocator is called
+static void testJson()
+{
+    AllocatorTelemetry plain("upload", "bytes");
+    AllocatorTelemetry odd("say \"hi\"\\\n\ttab", "bytes");
+    CHECK(validJson(plain.json()));
+
+    for (uint64_t frame = 1u; frame <= AllocatorTelemetry::historyLength + 44u; frame++) {
+        plain.recordAllocation(frame);
+        plain.sample(frame, { frame * 10u, 1u << 20u, 1u << 10u, 3u });
+        odd.sample(frame, {});
+    }
+    const std::string json = plain.json();
+    CHECK(validJson(json));
+    // The latest sample, then the history
+    CHECK(count(json, "\"frame\":") == AllocatorTelemetry::historyLength + 1u);
+    CHECK(json.find("\"history\":[{\"frame\":45,") != std::string::npos);
+    CHECK(json.find("\"peakLive\":3000,") != std::string::npos);
+    CHECK(json.find("\"histogram\":[{\"upTo\":1,\"count\":1}") != std::string::npos);
+
+    const std::string oddJson = odd.json();
+    CHECK(validJson(oddJson));
+    CHECK(oddJson.find("\"name\":\"say \\\"hi\\\"\\\\\\u000a\\u0009tab\"") != std::string::npos);
+
+    const AllocatorTelemetry* all[] = { &plain, &odd };
+    const std::string array = allocatorTelemetryJson(all);
+    CHECK(validJson(array));
+    CHECK(array.front() == '[' && array.back() == ']');
+    CHECK(validJson(allocatorTelemetryJson({})));
+}
+
+int main()
+{
+    testValidatorRejectsBrokenJson();
+    testLiveAndPeak();
+    testHistogramBuckets();
+    testPerFrameCounts();
+    testConcurrentRecording();
+    testJson();
+    return checkResult();
+}
@@ -0,0 +1,125 @@
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "check.h"
+
+import buddy_allocator;
+
+static void testCapacity()
+{
+    // Rounded down to a power of two number of minimum blocks
+    CHECK(BuddyAllocator(1000u, 64u).stats().capacity == 512u);
+    CHECK(BuddyAllocator(4096u, 64u).stats().capacity == 4096u);
+    CHECK(BuddyAllocator(4096u, 64u).stats().largestFreeBlock == 4096u);
+}
+
+static void testSplitAndMerge()
+{
+    BuddyAllocator buddy(1024u, 64u);
+    const uint64_t a = buddy.allocate(64u);
+    CHECK(a == 0u);
+    // 1024 split down to 64: four splits leave 64, 128, 256 and 512 free
+    CHECK(buddy.stats().splits == 4u);
+    CHECK(buddy.stats().largestFreeBlock == 512u);
+
+    const uint64_t b = buddy.allocate(100u);
+    CHECK(buddy.blockSize(b) == 128u);
+    CHECK(b == 128u);
+    const uint64_t c = buddy.allocate(64u);
+    CHECK(c == 64u);
+
+    buddy.free(a);
+    // a's buddy c is still in use
+    CHECK(buddy.stats().merges == 0u);
+    buddy.free(c);
+    CHECK(buddy.stats().merges == 1u);
+    buddy.free(b);
+    CHECK(buddy.empty());
+    CHECK(buddy.stats().largestFreeBlock == 1024u);
+}
+
+static void testAlignment()
+{
+    BuddyAllocator buddy(1024u, 64u);
+    buddy.allocate(64u);
+    const uint64_t aligned = buddy.allocate(64u, 256u);
+    CHECK(aligned == 256u);
+    CHECK(buddy.blockSize(aligned) == 256u);
+}
+
+static void testExhaustionAndFragmentation()
+{
+    BuddyAllocator buddy(1024u, 64u);
+    CHECK(buddy.allocate(2048u) == BuddyAllocator::invalidOffset);
+    const uint64_t a = buddy.allocate(600u);
+    CHECK(buddy.blockSize(a) == 1024u);
+    CHECK(buddy.allocate(1u) == BuddyAllocator::invalidOffset);
+    const BuddyAllocator::Stats stats = buddy.stats();
+    CHECK(stats.failures == 2u);
+    CHECK(stats.allocatedBytes == 1024u);
+    CHECK(stats.requestedBytes == 600u);
+    CHECK(stats.internalFragmentation() > 0.41 && stats.internalFragmentation() < 0.42);
+    CHECK(stats.largestFreeBlock == 0u);
+}
+
+// Random allocations and frees never overlap, stay aligned and merge back into one block
+static void testRandomNoOverlap()
+{
+    constexpr uint64_t minBlock = 64u;
+    constexpr uint64_t capacity = 1u << 20u;
+    BuddyAllocator buddy(capacity, minBlock);
+    std::vector<bool> used(capacity / minBlock, false);
+    std::vector<uint64_t> live;
+    std::mt19937 rng(5u);
+    bool overlap = false;
+    bool misaligned = false;
+
+    for (uint32_t step = 0u; step < 20000u; step++) {
+        if (live.empty() || rng() % 3u != 0u) {
+            const uint64_t size = 1u + rng() % 8192u;
+            const uint64_t alignment = uint64_t(1u) << (rng() % 14u);
+            const uint64_t offset = buddy.allocate(size, alignment);
+            if (offset == BuddyAllocator::invalidOffset) {
+                continue;
+            }
+            const uint64_t blockSize = buddy.blockSize(offset);
+            misaligned = misaligned || offset % alignment != 0u || offset % blockSize != 0u ||
+                blockSize < size;
+            for (uint64_t i = offset / minBlock; i < (offset + blockSize) / minBlock; i++) {
+                overlap = overlap || used[i];
+                used[i] = true;
+            }
+            live.push_back(offset);
+        } else {
+            const size_t index = rng() % live.size();
+            const uint64_t offset = live[index];
+            live[index] = live.back();
+            live.pop_back();
+            const uint64_t blockSize = buddy.blockSize(offset);
+            for (uint64_t i = offset / minBlock; i < (offset + blockSize) / minBlock; i++) {
+                used[i] = false;
+            }
+            buddy.free(offset);
+        }
+    }
+    CHECK(!overlap);
+    CHECK(!misaligned);
+
+    for (const uint64_t offset : live) {
+        buddy.free(offset);
+    }
+    CHECK(buddy.empty());
+    CHECK(buddy.stats().largestFreeBlock == capacity);
+    CHECK(buddy.stats().allocatedBytes == 0u);
+    CHECK(buddy.stats().requestedBytes == 0u);
+}
+
+int main()
+{
+    testCapacity();
+    testSplitAndMerge();
+    testAlignment();
+    testExhaustionAndFragmentation();
+    testRandomNoOverlap();
+    return checkResult();
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdio>
+
+// Checks for the module tests. A failed check is reported and counted rather than aborting,
+//  so one run lists every broken expectation.
+inline int checkFailures = 0;
+
+#define CHECK(cond)                                                                        \
+    do {                                                                                   \
+        if (!(cond)) {                                                                     \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            checkFailures++;                                                               \
+        }                                                                                  \
+    } while (false)
+
+// Exit code for a test's main
+inline int checkResult()
+{
+    if (checkFailures != 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", checkFailures);
+        return 1;
+    }
+    return 0;
+}
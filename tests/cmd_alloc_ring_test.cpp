@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <new>
+#include <span>
+#include <vector>
+#include "check.h"
+
+import cmd_alloc_ring;
+
+// Every global allocation in the process is counted, so a loop can assert it made none
+static std::atomic<uint64_t> heapAllocations = 0u;
+
+void* operator new(size_t size)
+{
+    heapAllocations.fetch_add(1u, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1u)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+struct FakeAllocator
+{
+    uint32_t resets = 0u;
+};
+
+struct FakeList
+{
+    FakeAllocator* allocator = nullptr;
+};
+
+// A queue whose GPU only advances when told to. Submitted lists get consecutive fence values
+//  like the submission thread hands out, and each batch ends in one signal.
+class FakeQueue : public CmdAllocSource<FakeAllocator*, FakeList*>
+{
+   public:
+    uint64_t queued = 0u;
+    uint64_t completed = 0u;
+    uint64_t signals = 0u;
+    std::vector<uint64_t> waitedValues;
+
+    FakeAllocator* createAllocator() override { return &this->allocators.emplace_back(); }
+
+    FakeList* createList(FakeAllocator* const& allocator) override
+    {
+        return &this->lists.emplace_back(FakeList{ allocator });
+    }
+
+    void reset(FakeAllocator* const& allocator, FakeList* const&) override
+    {
+        allocator->resets++;
+    }
+
+    bool isFenceComplete(uint64_t fenceValue) override { return this->completed >= fenceValue; }
+
+    // The GPU catches up while the CPU blocks
+    bool waitForFenceVal(uint64_t fenceValue) override
+    {
+        this->waitedValues.push_back(fenceValue);
+        this->completed = std::max(this->completed, fenceValue);
+        return true;
+    }
+
+    uint64_t push(FakeList*) { return ++this->queued; }
+
+    // Submit lists as one batch ending in a single signal
+    uint64_t execute(
+        CmdAllocRings<FakeAllocator*, FakeList*>& rings,
+        std::span<FakeList* const> batch
+    )
+    {
+        const uint64_t fenceValue = rings.submit(batch, [&](FakeList* list) {
+            return this->push(list);
+        });
+        this->signals++;
+        return fenceValue;
+    }
+
+   private:
+    std::deque<FakeAllocator> allocators;
+    std::deque<FakeList> lists;
+};
+
+using Rings = CmdAllocRings<FakeAllocator*, FakeList*>;
+
+static void testCreatesOncePerEntry()
+{
+    FakeQueue queue;
+    Rings rings(2u, 3u);
+    for (uint32_t frame = 0u; frame < 10u; frame++) {
+        FakeList* lists[2] = { rings.open(queue, 0u), rings.open(queue, 1u) };
+        queue.execute(rings, lists);
+        queue.completed = queue.queued;
+    }
+    CHECK(rings.stats().allocatorCreations == 6u);
+    CHECK(rings.stats().cmdListCreations == 6u);
+    CHECK(rings.stats().stalls == 0u);
+}
+
+// Steady-state recording with three frames in flight, the GPU two frames behind: once every
+//  entry exists, 10K frames neither stall nor allocate
+static void testSteadyStateAllocatesNothing()
+{
+    constexpr uint32_t nThreads = 4u;
+    constexpr uint32_t framesInFlight = 3u;
+    constexpr uint32_t nFrames = 10000u;
+
+    FakeQueue queue;
+    Rings rings(nThreads, framesInFlight);
+    uint64_t frameFence[framesInFlight] = {};
+    FakeList* lists[nThreads] = {};
+
+    auto runFrame = [&](uint32_t frame) {
+        // The GPU has finished the frame that last used this slot
+        queue.completed = std::max(queue.completed, frameFence[frame % framesInFlight]);
+        for (uint32_t t = 0u; t < nThreads; t++) {
+            lists[t] = rings.open(queue, t);
+        }
+        frameFence[frame % framesInFlight] = queue.execute(rings, lists);
+    };
+
+    for (uint32_t frame = 0u; frame < framesInFlight; frame++) {
+        runFrame(frame);
+    }
+    const uint64_t allocationsBefore = heapAllocations.load();
+    for (uint32_t frame = framesInFlight; frame < framesInFlight + nFrames; frame++) {
+        runFrame(frame);
+    }
+    const uint64_t allocations = heapAllocations.load() - allocationsBefore;
+
+    std::printf(
+        "%u simulated frames: %llu heap allocations\n", nFrames,
+        static_cast<unsigned long long>(allocations)
+    );
+    CHECK(allocations == 0u);
+    CHECK(rings.stats().allocatorCreations == nThreads * framesInFlight);
+    CHECK(rings.stats().stalls == 0u);
+}
+
+// A GPU that hasn't finished the entry's previous frame makes open() wait for it
+static void testStallsWhenGpuLags()
+{
+    FakeQueue queue;
+    Rings rings(1u, 2u);
+    for (uint32_t frame = 0u; frame < 6u; frame++) {
+        FakeList* list = rings.open(queue, 0u);
+        queue.execute(rings, { &list, 1u });
+    }
+    // Entries were reused four times, and the GPU never advanced on its own
+    CHECK(rings.stats().stalls == 4u);
+    CHECK(queue.waitedValues == std::vector<uint64_t>({ 1u, 2u, 3u, 4u }));
+}
+
+// One batch across two recording threads ends in one signal, and every allocator in it is
+//  tagged with that signal's value: none is reusable before the whole batch has completed, and
+//  all of them are once it has
+static void testBatchSharesOneFenceValue()
+{
+    FakeQueue queue;
+    Rings rings(2u, 2u);
+    FakeList* batch[4] = {
+        rings.open(queue, 0u), rings.open(queue, 0u), rings.open(queue, 1u), rings.open(queue, 1u)
+    };
+    const uint64_t fenceValue = queue.execute(rings, batch);
+    CHECK(fenceValue == 4u);
+    CHECK(queue.signals == 1u);
+
+    // The GPU is through the first three lists but hasn't signalled the batch
+    queue.completed = fenceValue - 1u;
+    FakeList* first = rings.open(queue, 0u);
+    CHECK(first == batch[0]);
+    CHECK(queue.waitedValues == std::vector<uint64_t>({ fenceValue }));
+
+    // The wait completed the batch, so the other three come back without waiting
+    FakeList* reopened[3] = { rings.open(queue, 0u), rings.open(queue, 1u), rings.open(queue, 1u) };
+    CHECK(reopened[0] == batch[1] && reopened[1] == batch[2] && reopened[2] == batch[3]);
+    CHECK(queue.waitedValues.size() == 1u);
+    CHECK(rings.stats().stalls == 1u);
+    for (FakeList* list : batch) {
+        CHECK(list->allocator->resets == 1u);
+    }
+}
+
+// Lists can go out one at a time as well, each tagged with its own value
+static void testSingleSubmissionsTagTheirOwnValue()
+{
+    FakeQueue queue;
+    Rings rings(1u, 2u);
+    FakeList* a = rings.open(queue, 0u);
+    FakeList* b = rings.open(queue, 0u);
+    CHECK(queue.execute(rings, { &a, 1u }) == 1u);
+    CHECK(queue.execute(rings, { &b, 1u }) == 2u);
+    CHECK(queue.signals == 2u);
+
+    queue.completed = 1u;
+    CHECK(rings.open(queue, 0u) == a);
+    CHECK(queue.waitedValues.empty());
+    rings.open(queue, 0u);
+    CHECK(queue.waitedValues == std::vector<uint64_t>({ 2u }));
+}
+
+int main()
+{
+    testCreatesOncePerEntry();
+    testSteadyStateAllocatesNothing();
+    testStallsWhenGpuLags();
+    testBatchSharesOneFenceValue();
+    testSingleSubmissionsTagTheirOwnValue();
+    return checkResult();
+}
@@ -0,0 +1,139 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include "check.h"
+
+import deferred_release;
+
+// Logs its id when destroyed, which is when the release queue lets go of it
+struct Probe
+{
+    int id;
+    std::vector<int>* released;
+
+    ~Probe() { this->released->push_back(this->id); }
+};
+
+using ReleaseQueue = DeferredReleaseQueue<std::unique_ptr<Probe>, int>;
+
+// Mock fence per queue key
+struct Fences
+{
+    uint64_t completed[2] = {};
+    uint32_t queries = 0u;
+
+    uint64_t operator()(int queue)
+    {
+        this->queries++;
+        return this->completed[queue];
+    }
+};
+
+static std::unique_ptr<Probe> probe(int id, std::vector<int>& released)
+{
+    return std::unique_ptr<Probe>(new Probe{ id, &released });
+}
+
+// Objects of a queue go in the order they were retired, and only up to its completed value.
+//  Another queue's fence doesn't release them.
+static void testPerQueueFifo()
+{
+    std::vector<int> released;
+    ReleaseQueue queue;
+    Fences fences;
+    queue.retire(0, 1u, probe(1, released));
+    queue.retire(1, 1u, probe(10, released));
+    queue.retire(0, 2u, probe(2, released));
+    queue.retire(0, 2u, probe(3, released));
+    queue.retire(1, 4u, probe(11, released));
+    queue.retire(0, 5u, probe(4, released));
+
+    CHECK(queue.drain(fences) == 0u);
+    CHECK(released.empty());
+
+    fences.completed[0] = 2u;
+    CHECK(queue.drain(fences) == 3u);
+    CHECK(released == std::vector<int>({ 1, 2, 3 }));
+
+    fences.completed[1] = 3u;
+    CHECK(queue.drain(fences) == 1u);
+    CHECK(released == std::vector<int>({ 1, 2, 3, 10 }));
+
+    fences.completed[0] = 10u;
+    fences.completed[1] = 10u;
+    CHECK(queue.drain(fences) == 2u);
+    CHECK(released.size() == 6u);
+    CHECK(queue.stats().retained == 6u && queue.stats().released == 6u);
+}
+
+// A drain asks each queue with pending entries for its fence once and stops at the first
+//  incomplete entry, so its cost follows what it releases rather than what is pending
+static void testDrainIsProportionalToReleased()
+{
+    constexpr uint32_t nPending = 200000u;
+    std::vector<int> released;
+    ReleaseQueue queue;
+    Fences fences;
+    queue.retire(0, 1u, probe(0, released));
+    for (uint32_t i = 0u; i < nPending; i++) {
+        queue.retire(0, 100u + i, probe(1, released));
+    }
+    queue.retire(1, 1u, probe(2, released));
+
+    fences.completed[0] = 1u;
+    fences.completed[1] = 1u;
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    CHECK(queue.drain(fences) == 2u);
+    const std::chrono::duration<double, std::micro> elapsed =
+        std::chrono::high_resolution_clock::now() - t0;
+    CHECK(fences.queries == 2u);
+
+    // The second queue is empty now and isn't asked again
+    fences.queries = 0u;
+    for (uint32_t i = 0u; i < 1000u; i++) {
+        queue.drain(fences);
+    }
+    CHECK(fences.queries == 1000u);
+    std::printf("Drained 2 of %u pending entries in %.1f us\n", nPending + 2u, elapsed.count());
+
+    queue.clear();
+    CHECK(released.size() == nPending + 2u);
+}
+
+static void testPeakBytes()
+{
+    std::vector<int> released;
+    ReleaseQueue queue;
+    Fences fences;
+    queue.retire(0, 1u, probe(1, released), 100u);
+    queue.retire(1, 1u, probe(2, released), 200u);
+    CHECK(queue.stats().retainedBytes == 300u);
+    CHECK(queue.stats().peakRetainedBytes == 300u);
+
+    fences.completed[0] = 1u;
+    queue.drain(fences);
+    CHECK(queue.stats().retainedBytes == 200u);
+
+    queue.retire(0, 2u, probe(3, released), 50u);
+    CHECK(queue.stats().retainedBytes == 250u);
+    CHECK(queue.stats().peakRetainedBytes == 300u);
+
+    queue.retire(0, 3u, probe(4, released), 80u);
+    CHECK(queue.stats().peakRetainedBytes == 330u);
+
+    queue.clear();
+    CHECK(queue.stats().retainedBytes == 0u);
+    CHECK(queue.stats().peakRetainedBytes == 330u);
+    CHECK(released.size() == 4u);
+}
+
+int main()
+{
+    testPerQueueFifo();
+    testDrainIsProportionalToReleased();
+    testPeakBytes();
+    return checkResult();
+}
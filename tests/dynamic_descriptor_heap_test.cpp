@@ -0,0 +1,345 @@
+#include <d3d12.h>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <new>
+#include <vector>
+#include "check.h"
+
+import dynamic_descriptor_heap;
+
+static constexpr UINT descriptorSize = 32u;
+
+// Descriptor memory is a map from CPU handle to the descriptor it holds, identified by the
+//  handle it was created at in a CPU-only heap. CopyDescriptors copies between them and logs
+//  each call.
+struct FakeDevice : ID3D12Device
+{
+    struct Copy
+    {
+        D3D12_CPU_DESCRIPTOR_HANDLE dest;
+        UINT destSize;
+        std::vector<UINT> srcSizes;
+    };
+
+    std::map<SIZE_T, SIZE_T> memory;
+    std::vector<Copy> copies;
+
+    UINT GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE) override
+    {
+        return descriptorSize;
+    }
+
+    void CopyDescriptors(
+        UINT numDestRanges,
+        const D3D12_CPU_DESCRIPTOR_HANDLE* destStarts,
+        const UINT* destSizes,
+        UINT numSrcRanges,
+        const D3D12_CPU_DESCRIPTOR_HANDLE* srcStarts,
+        const UINT* srcSizes,
+        D3D12_DESCRIPTOR_HEAP_TYPE
+    ) override
+    {
+        CHECK(numDestRanges == 1u);
+        Copy copy{ destStarts[0], destSizes[0], {} };
+        SIZE_T dest = destStarts[0].ptr;
+        UINT copied = 0u;
+        for (UINT r = 0u; r < numSrcRanges; r++) {
+            copy.srcSizes.push_back(srcSizes[r]);
+            for (UINT i = 0u; i < srcSizes[r]; i++) {
+                this->memory[dest] = srcStarts[r].ptr + static_cast<SIZE_T>(i) * descriptorSize;
+                dest += descriptorSize;
+                copied++;
+            }
+        }
+        CHECK(copied == destSizes[0]);
+        this->copies.push_back(copy);
+    }
+};
+
+struct RecordingList : ID3D12GraphicsCommandList2
+{
+    struct Binding
+    {
+        UINT rootIndex;
+        D3D12_GPU_DESCRIPTOR_HANDLE table;
+        bool compute;
+    };
+
+    std::vector<Binding> bindings;
+
+    void SetGraphicsRootDescriptorTable(UINT rootIndex, D3D12_GPU_DESCRIPTOR_HANDLE table) override
+    {
+        this->bindings.push_back({ rootIndex, table, false });
+    }
+
+    void SetComputeRootDescriptorTable(UINT rootIndex, D3D12_GPU_DESCRIPTOR_HANDLE table) override
+    {
+        this->bindings.push_back({ rootIndex, table, true });
+    }
+};
+
+// Shader-visible memory the heap copies into: CPU handles at 0x10000, GPU handles at 0x90000
+struct FrameRange
+{
+    static constexpr SIZE_T cpuStart = 0x10000u;
+    static constexpr UINT64 gpuStart = 0x90000u;
+
+    DescriptorRange range;
+
+    explicit FrameRange(uint32_t capacity, uint32_t first = 0u)
+    {
+        this->range.cpuBase = { cpuStart + static_cast<SIZE_T>(first) * descriptorSize };
+        this->range.gpuBase = { gpuStart + static_cast<UINT64>(first) * descriptorSize };
+        this->range.descriptorSize = descriptorSize;
+        this->range.capacity = capacity;
+    }
+};
+
+// Descriptor i of the table bound at gpu, as the shader would see it
+static SIZE_T boundDescriptor(FakeDevice& device, D3D12_GPU_DESCRIPTOR_HANDLE gpu, uint32_t i)
+{
+    const SIZE_T cpu = FrameRange::cpuStart + static_cast<SIZE_T>(gpu.ptr - FrameRange::gpuStart) +
+        static_cast<SIZE_T>(i) * descriptorSize;
+    auto it = device.memory.find(cpu);
+    return it == device.memory.end() ? 0u : it->second;
+}
+
+// Handle of descriptor i in a CPU-only heap starting at base
+static D3D12_CPU_DESCRIPTOR_HANDLE cpuDescriptor(SIZE_T base, uint32_t i)
+{
+    return { base + static_cast<SIZE_T>(i) * descriptorSize };
+}
+
+// Root signature with a root CBV at 0, a 7 descriptor SRV table at 1 whose second range is
+//  placed explicitly, a sampler table at 2 and a 4 descriptor UAV table at 3
+struct RootSignature
+{
+    D3D12_DESCRIPTOR_RANGE1 srvRanges[2] = {
+        { D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 3u, 0u, 0u, D3D12_DESCRIPTOR_RANGE_FLAG_NONE,
+          D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND },
+        { D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 2u, 3u, 0u, D3D12_DESCRIPTOR_RANGE_FLAG_NONE, 5u },
+    };
+    D3D12_DESCRIPTOR_RANGE1 samplerRange = { D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER,
+                                             2u,
+                                             0u,
+                                             0u,
+                                             D3D12_DESCRIPTOR_RANGE_FLAG_NONE,
+                                             D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND };
+    D3D12_DESCRIPTOR_RANGE1 uavRange = { D3D12_DESCRIPTOR_RANGE_TYPE_UAV,
+                                         4u,
+                                         0u,
+                                         0u,
+                                         D3D12_DESCRIPTOR_RANGE_FLAG_NONE,
+                                         D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND };
+    D3D12_ROOT_PARAMETER1 params[4] = {};
+    D3D12_ROOT_SIGNATURE_DESC1 desc = {};
+
+    RootSignature()
+    {
+        this->params[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+        this->params[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+        this->params[1].DescriptorTable = { 2u, this->srvRanges };
+        this->params[2].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+        this->params[2].DescriptorTable = { 1u, &this->samplerRange };
+        this->params[3].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+        this->params[3].DescriptorTable = { 1u, &this->uavRange };
+        this->desc.NumParameters = 4u;
+        this->desc.pParameters = this->params;
+    }
+};
+
+static constexpr SIZE_T srvHeap = 0x1000u;
+static constexpr SIZE_T uavHeap = 0x4000u;
+
+// Only tables staged since the last commit are copied and bound, and a commit with nothing
+//  dirty does nothing at all
+static void testDirtyTableTracking()
+{
+    FakeDevice device;
+    RootSignature root;
+    DynamicDescriptorHeap heap(&device);
+    heap.parseRootSignature(root.desc);
+    FrameRange frame(64u);
+    RecordingList list;
+
+    heap.commitForDraw(&list, frame.range);
+    CHECK(device.copies.empty() && list.bindings.empty());
+
+    heap.stageDescriptors(1u, 0u, 3u, cpuDescriptor(srvHeap, 0u));
+    heap.commitForDraw(&list, frame.range);
+    CHECK(device.copies.size() == 1u);
+    CHECK(list.bindings.size() == 1u && list.bindings[0].rootIndex == 1u);
+    CHECK(!list.bindings[0].compute);
+
+    heap.stageDescriptors(3u, 0u, 4u, cpuDescriptor(uavHeap, 0u));
+    heap.commitForDispatch(&list, frame.range);
+    CHECK(device.copies.size() == 2u);
+    CHECK(list.bindings.size() == 2u && list.bindings[1].rootIndex == 3u);
+    CHECK(list.bindings[1].compute);
+
+    heap.commitForDraw(&list, frame.range);
+    CHECK(device.copies.size() == 2u && list.bindings.size() == 2u);
+
+    // A new command list has no bindings, reset() marks every staged table dirty again
+    heap.reset();
+    heap.commitForDraw(&list, frame.range);
+    CHECK(device.copies.size() == 3u);
+    CHECK(list.bindings.size() == 4u);
+    CHECK(heap.stats().commits == 3u && heap.stats().tablesCommitted == 4u);
+}
+
+// Several dirty tables go out in one CopyDescriptors into one destination range, adjacent
+//  sources merged into a single source range, and each table is bound at its part of it
+static void testOneBatchedCopyPerCommit()
+{
+    FakeDevice device;
+    RootSignature root;
+    DynamicDescriptorHeap heap(&device);
+    heap.parseRootSignature(root.desc);
+    FrameRange frame(64u);
+    RecordingList list;
+
+    // SRVs 0-2 are contiguous, 5-6 come from elsewhere, UAVs 0-3 contiguous
+    heap.stageDescriptors(1u, 0u, 3u, cpuDescriptor(srvHeap, 10u));
+    heap.stageDescriptors(1u, 5u, 2u, cpuDescriptor(srvHeap, 40u));
+    heap.stageDescriptors(1u, 3u, 2u, cpuDescriptor(srvHeap, 13u));
+    heap.stageDescriptors(3u, 0u, 4u, cpuDescriptor(uavHeap, 0u));
+    heap.commitForDraw(&list, frame.range);
+
+    CHECK(device.copies.size() == 1u);
+    const FakeDevice::Copy& copy = device.copies[0];
+    CHECK(copy.destSize == 11u);
+    // SRVs 10-14 are one run, 40-41 another and the UAVs a third
+    CHECK(copy.srcSizes == std::vector<UINT>({ 5u, 2u, 4u }));
+    CHECK(heap.stats().sourceRanges == 3u && heap.stats().descriptorsCopied == 11u);
+
+    CHECK(list.bindings.size() == 2u);
+    const D3D12_GPU_DESCRIPTOR_HANDLE srvTable = list.bindings[0].table;
+    const D3D12_GPU_DESCRIPTOR_HANDLE uavTable = list.bindings[1].table;
+    CHECK(uavTable.ptr == srvTable.ptr + 7u * descriptorSize);
+    for (uint32_t i = 0u; i < 5u; i++) {
+        CHECK(boundDescriptor(device, srvTable, i) == cpuDescriptor(srvHeap, 10u + i).ptr);
+    }
+    CHECK(boundDescriptor(device, srvTable, 6u) == cpuDescriptor(srvHeap, 41u).ptr);
+    for (uint32_t i = 0u; i < 4u; i++) {
+        CHECK(boundDescriptor(device, uavTable, i) == cpuDescriptor(uavHeap, i).ptr);
+    }
+}
+
+// Only a table's staged prefix takes space in the frame's range, not its declared size
+static void testAllocatesStagedCountOnly()
+{
+    FakeDevice device;
+    RootSignature root;
+    DynamicDescriptorHeap heap(&device);
+    heap.parseRootSignature(root.desc);
+    FrameRange frame(64u);
+    RecordingList list;
+
+    heap.stageDescriptors(1u, 0u, 2u, cpuDescriptor(srvHeap, 0u));
+    heap.commitForDraw(&list, frame.range);
+    CHECK(frame.range.used.load() == 2u);
+    CHECK(device.copies[0].destSize == 2u);
+
+    // Staging further in grows the prefix, everything up to it is copied again
+    heap.stageDescriptors(1u, 3u, 1u, cpuDescriptor(srvHeap, 3u));
+    heap.stageDescriptors(1u, 2u, 1u, cpuDescriptor(srvHeap, 2u));
+    heap.commitForDraw(&list, frame.range);
+    CHECK(frame.range.used.load() == 6u);
+    CHECK(device.copies[1].destSize == 4u);
+    CHECK(device.copies[1].srcSizes == std::vector<UINT>({ 4u }));
+}
+
+// The sampler table belongs to a sampler heap, and a CBV/SRV/UAV heap leaves it alone
+static void testSamplerTablesSkipped()
+{
+    FakeDevice device;
+    RootSignature root;
+    DynamicDescriptorHeap samplers(&device, D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER);
+    samplers.parseRootSignature(root.desc);
+    FrameRange frame(16u);
+    RecordingList list;
+
+    samplers.stageDescriptors(2u, 0u, 2u, cpuDescriptor(srvHeap, 0u));
+    samplers.commitForDraw(&list, frame.range);
+    CHECK(list.bindings.size() == 1u && list.bindings[0].rootIndex == 2u);
+    CHECK(frame.range.used.load() == 2u);
+}
+
+// Frames take turns on slices of one shader-visible heap. Once the ring comes back around to
+//  a slice, that frame's range is reset and tables land at its start again, without touching
+//  the slices of frames still in flight.
+static void testFrameRangesWrap()
+{
+    constexpr uint32_t framesInFlight = 3u;
+    constexpr uint32_t perFrame = 16u;
+    FakeDevice device;
+    RootSignature root;
+    DynamicDescriptorHeap heap(&device);
+    heap.parseRootSignature(root.desc);
+
+    std::deque<FrameRange> frames;
+    for (uint32_t i = 0u; i < framesInFlight; i++) {
+        frames.emplace_back(perFrame, i * perFrame);
+    }
+
+    for (uint32_t frameNumber = 0u; frameNumber < 2u * framesInFlight + 1u; frameNumber++) {
+        DescriptorRange& range = frames[frameNumber % framesInFlight].range;
+        range.used = 0u;
+        RecordingList list;
+        heap.reset();
+        // Two draws per frame, each with its own UAVs
+        for (uint32_t draw = 0u; draw < 2u; draw++) {
+            heap.stageDescriptors(3u, 0u, 4u, cpuDescriptor(uavHeap, 4u * frameNumber + draw));
+            heap.commitForDraw(&list, range);
+        }
+
+        CHECK(list.bindings.size() == 2u);
+        const UINT64 sliceStart = range.gpuBase.ptr;
+        CHECK(list.bindings[0].table.ptr == sliceStart);
+        CHECK(list.bindings[1].table.ptr == sliceStart + 4u * descriptorSize);
+        CHECK(range.used.load() == 8u);
+        CHECK(
+            boundDescriptor(device, list.bindings[1].table, 0u) ==
+            cpuDescriptor(uavHeap, 4u * frameNumber + 1u).ptr
+        );
+
+        // The previous frame's slice still holds what it was given
+        if (frameNumber > 0u) {
+            const uint32_t previous = frameNumber - 1u;
+            const D3D12_GPU_DESCRIPTOR_HANDLE previousTable = {
+                frames[previous % framesInFlight].range.gpuBase.ptr
+            };
+            CHECK(
+                boundDescriptor(device, previousTable, 0u) ==
+                cpuDescriptor(uavHeap, 4u * previous).ptr
+            );
+        }
+    }
+
+    // A frame that outgrows its slice fails instead of spilling into the next one
+    DescriptorRange& range = frames[0].range;
+    range.used = perFrame - 2u;
+    RecordingList list;
+    heap.stageDescriptors(3u, 0u, 4u, cpuDescriptor(uavHeap, 0u));
+    bool threw = false;
+    try {
+        heap.commitForDraw(&list, range);
+    } catch (const std::bad_alloc&) {
+        threw = true;
+    }
+    CHECK(threw);
+    CHECK(list.bindings.empty());
+}
+
+int main()
+{
+    testDirtyTableTracking();
+    testOneBatchedCopyPerCommit();
+    testAllocatesStagedCountOnly();
+    testSamplerTablesSkipped();
+    testFrameRangesWrap();
+    return checkResult();
+}
@@ -0,0 +1,161 @@
+#include <cstdint>
+#include <set>
+#include <source_location>
+#include <thread>
+#include <vector>
+#include "check.h"
+
+import fence_wait;
+
+static std::source_location siteA()
+{
+    return std::source_location::current();
+}
+
+static std::source_location siteB()
+{
+    return std::source_location::current();
+}
+
+static void testSameSiteSameHistogram()
+{
+    WaitSites sites;
+    WaitHistogram& a = sites.at(siteA());
+    CHECK(&sites.at(siteA()) == &a);
+    CHECK(&sites.at(siteB()) != &a);
+    CHECK(&sites.at(siteA()) == &a);
+
+    a.record({ WaitPhase::Spin, 3.0 });
+    std::vector<uint32_t> lines;
+    sites.forEach([&](const WaitSites::Site& site, const WaitHistogram::Snapshot& snap) {
+        lines.push_back(site.line);
+        CHECK(snap.count == (site.line == siteA().line() ? 1u : 0u));
+    });
+    CHECK(lines.size() == 2u);
+    CHECK(lines[0] == siteA().line() && lines[1] == siteB().line());
+}
+
+// More sites than the lookup index holds, the ones left out still resolve under the lock
+static void testMoreSitesThanIndexed()
+{
+    const std::source_location locations[] = {
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+        std::source_location::current(),
+    };
+    WaitSites sites;
+    std::set<const WaitHistogram*> distinct;
+    for (const std::source_location& location : locations) {
+        distinct.insert(&sites.at(location));
+    }
+    CHECK(distinct.size() == std::size(locations));
+    for (const std::source_location& location : locations) {
+        CHECK(distinct.contains(&sites.at(location)));
+    }
+    size_t listed = 0u;
+    sites.forEach([&](const WaitSites::Site&, const WaitHistogram::Snapshot&) { listed++; });
+    CHECK(listed == std::size(locations));
+}
+
+static void testConcurrentRecording()
+{
+    constexpr uint32_t threads = 4u;
+    constexpr uint32_t waits = 10000u;
+    WaitSites sites;
+
+    std::vector<std::thread> workers;
+    for (uint32_t t = 0u; t < threads; t++) {
+        workers.emplace_back([&] {
+            for (uint32_t i = 0u; i < waits; i++) {
+                sites.at(i % 2u ? siteA() : siteB()).record({ WaitPhase::Ready, 0.0 });
+            }
+        });
+    }
+    for (std::thread& t : workers) {
+        t.join();
+    }
+
+    uint64_t total = 0u;
+    sites.forEach([&](const WaitSites::Site&, const WaitHistogram::Snapshot& snap) {
+        CHECK(snap.count == threads * waits / 2u);
+        total += snap.count;
+    });
+    CHECK(total == threads * waits);
+}
+
+int main()
+{
+    testSameSiteSameHistogram();
+    testMoreSitesThanIndexed();
+    testConcurrentRecording();
+    return checkResult();
+}
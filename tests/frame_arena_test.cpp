@@ -0,0 +1,256 @@
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory_resource>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#include "check.h"
+
+import frame_arena;
+
+// Every allocation from the global heap in this program goes through here and is counted
+static std::atomic<uint64_t> globalAllocations = 0u;
+
+void* operator new(size_t size)
+{
+    globalAllocations.fetch_add(1u, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0u ? 1u : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    globalAllocations.fetch_add(1u, std::memory_order_relaxed);
+    const size_t a = static_cast<size_t>(alignment);
+    if (void* p = std::aligned_alloc(a, (size + a - 1u) / a * a)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+static bool isAligned(const void* p, size_t alignment)
+{
+    return reinterpret_cast<uintptr_t>(p) % alignment == 0u;
+}
+
+static void testAlignment()
+{
+    LinearArena arena(1024u);
+    void* a = arena.allocate(3u, 1u);
+    void* b = arena.allocate(8u, 64u);
+    void* c = arena.allocate(1u, 1u);
+    CHECK(isAligned(b, 64u));
+    CHECK(static_cast<std::byte*>(c) == static_cast<std::byte*>(b) + 8);
+    CHECK(b != a);
+    CHECK(arena.stats().allocations == 3u);
+}
+
+// A frame that outgrows the block chains another on, and the next reset replaces the chain with
+//  one block holding all of it
+static void testGrowthCollapsesOnReset()
+{
+    LinearArena arena(1024u);
+    for (uint32_t i = 0u; i < 5u; i++) {
+        CHECK(arena.allocate(512u, 16u) != nullptr);
+    }
+    CHECK(arena.stats().blocksCreated == 3u);
+    CHECK(arena.stats().usedBytes == 2560u);
+    const size_t capacity = arena.stats().capacity;
+    CHECK(capacity == 3u * 1024u);
+
+    arena.reset();
+    CHECK(arena.stats().blocksCreated == 4u);
+    CHECK(arena.stats().capacity == capacity);
+    CHECK(arena.stats().usedBytes == 0u);
+    CHECK(arena.stats().peakBytes == 2560u);
+
+    // The same frame now fits without another block
+    for (uint32_t i = 0u; i < 5u; i++) {
+        CHECK(arena.allocate(512u, 16u) != nullptr);
+    }
+    CHECK(arena.stats().blocksCreated == 4u);
+
+    // Larger than a block on its own
+    CHECK(arena.allocate(10000u, 16u) != nullptr);
+    CHECK(arena.stats().blocksCreated == 5u);
+}
+
+// What a frame might build: a draw list, some names and constants, all on pmr containers
+//  fed by the frame arena and one of the thread arenas
+static size_t recordFrame(FrameArena& arenas, uint32_t shape, uint32_t threadSlot)
+{
+    std::pmr::vector<uint32_t> draws(&arenas.frame());
+    for (uint32_t i = 0u; i < 100u + 40u * shape; i++) {
+        draws.push_back(i * 3u);
+    }
+    std::pmr::vector<std::pmr::string> names(&arenas.thread(threadSlot));
+    for (uint32_t i = 0u; i < 8u + shape; i++) {
+        names.emplace_back("a pass name too long for the small string buffer");
+    }
+    std::pmr::vector<float> constants(64u * (1u + shape % 3u), 1.0f, &arenas.thread(threadSlot));
+    return draws.size() + names.size() + constants.size();
+}
+
+// After the first frames have sized the arenas, a frame loop allocates nothing from the global
+//  heap, however its frames vary within what it has already seen
+static void testSteadyStateAllocatesNothing()
+{
+    constexpr uint32_t nShapes = 8u;
+    constexpr uint32_t nThreads = 2u;
+    FrameArena arenas(nThreads, 1024u);
+    std::mt19937 rng(3u);
+    size_t checksum = 0u;
+
+    // One frame of every shape, growing each time
+    for (uint32_t shape = 0u; shape < nShapes; shape++) {
+        for (uint32_t thread = 0u; thread < nThreads; thread++) {
+            checksum += recordFrame(arenas, shape, thread);
+        }
+        arenas.reset();
+    }
+    const uint64_t blocks = arenas.stats().blocksCreated;
+
+    const uint64_t before = globalAllocations.load();
+    for (uint32_t frame = 0u; frame < 10000u; frame++) {
+        const uint32_t shape = rng() % nShapes;
+        for (uint32_t thread = 0u; thread < nThreads; thread++) {
+            checksum += recordFrame(arenas, shape, thread);
+        }
+        arenas.reset();
+    }
+    const uint64_t allocations = globalAllocations.load() - before;
+
+    CHECK(allocations == 0u);
+    CHECK(arenas.stats().blocksCreated == blocks);
+    CHECK(checksum != 0u);
+    std::printf(
+        "10000 steady frames: %llu global allocations\n",
+        static_cast<unsigned long long>(allocations)
+    );
+}
+
+// Debug builds fill memory with 0xDD when it's deallocated or the arena is reset, so anything
+//  still pointing into the last frame reads garbage instead of plausible data
+static void testDebugPoisoning()
+{
+#if defined(_DEBUG)
+    LinearArena arena(4096u);
+    auto* kept = static_cast<unsigned char*>(arena.allocate(100u, 1u));
+    auto* freed = static_cast<unsigned char*>(arena.allocate(100u, 1u));
+    for (size_t i = 0u; i < 100u; i++) {
+        kept[i] = freed[i] = 0x11u;
+    }
+
+    arena.deallocate(freed, 100u, 1u);
+    bool freedPoisoned = true;
+    bool keptIntact = true;
+    for (size_t i = 0u; i < 100u; i++) {
+        freedPoisoned = freedPoisoned && freed[i] == 0xDDu;
+        keptIntact = keptIntact && kept[i] == 0x11u;
+    }
+    CHECK(freedPoisoned);
+    CHECK(keptIntact);
+
+    // A single block is kept over the reset, so the old pointer can still be looked through
+    arena.reset();
+    bool resetPoisoned = true;
+    for (size_t i = 0u; i < 100u; i++) {
+        resetPoisoned = resetPoisoned && kept[i] == 0xDDu;
+    }
+    CHECK(resetPoisoned);
+    CHECK(arena.allocate(1u, 1u) == kept);
+#else
+    std::printf("Release build, debug poisoning not tested\n");
+#endif
+}
+
+// Many small, short-lived allocations a frame, as scene traversal and command recording make
+//  them: the arena against a new and delete for each
+static void testAllocationRate()
+{
+    constexpr uint32_t nFrames = 2000u;
+    constexpr uint32_t perFrame = 2000u;
+    std::vector<void*> pointers(perFrame);
+    std::vector<size_t> sizes(perFrame);
+    std::mt19937 rng(9u);
+    for (size_t& size : sizes) {
+        size = 16u + rng() % 240u;
+    }
+    size_t checksum = 0u;
+
+    LinearArena arena;
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    for (uint32_t frame = 0u; frame < nFrames; frame++) {
+        for (uint32_t i = 0u; i < perFrame; i++) {
+            auto* p = static_cast<unsigned char*>(arena.allocate(sizes[i], 16u));
+            p[0] = static_cast<unsigned char>(i);
+            pointers[i] = p;
+        }
+        for (uint32_t i = 0u; i < perFrame; i += 97u) {
+            checksum += *static_cast<unsigned char*>(pointers[i]);
+        }
+        arena.reset();
+    }
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    for (uint32_t frame = 0u; frame < nFrames; frame++) {
+        for (uint32_t i = 0u; i < perFrame; i++) {
+            auto* p = static_cast<unsigned char*>(::operator new(sizes[i]));
+            p[0] = static_cast<unsigned char>(i);
+            pointers[i] = p;
+        }
+        for (uint32_t i = 0u; i < perFrame; i += 97u) {
+            checksum += *static_cast<unsigned char*>(pointers[i]);
+        }
+        for (void* p : pointers) {
+            ::operator delete(p);
+        }
+    }
+    const auto t2 = std::chrono::high_resolution_clock::now();
+
+    CHECK(checksum != 0u);
+    const double total = static_cast<double>(nFrames) * perFrame;
+    const std::chrono::duration<double> arenaSeconds = t1 - t0;
+    const std::chrono::duration<double> heapSeconds = t2 - t1;
+    std::printf(
+        "arena %.2f M allocations/s, new/delete %.2f M allocations/s (%.1fx)\n",
+        total / arenaSeconds.count() / 1e6, total / heapSeconds.count() / 1e6,
+        heapSeconds.count() / arenaSeconds.count()
+    );
+}
+
+int main()
+{
+    testAlignment();
+    testGrowthCollapsesOnReset();
+    testSteadyStateAllocatesNothing();
+    testDebugPoisoning();
+    testAllocationRate();
+    return checkResult();
+}
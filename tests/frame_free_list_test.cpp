@@ -0,0 +1,187 @@
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <vector>
+#include "check.h"
+
+import frame_free_list;
+
+// A freed block stays out of reach until its frame has retired, even when nothing else is free
+static void testNoReuseBeforeRetire()
+{
+    FrameFreeList list(4u);
+    CHECK(list.allocate(4u) == 0u);
+    list.free(0u, 4u, 5u);
+    CHECK(list.staleCount() == 4u);
+    CHECK(list.freeCount() == 0u);
+    CHECK(list.allocate(1u) == FrameFreeList::invalidOffset);
+
+    list.releaseStale(4u);
+    CHECK(list.allocate(1u) == FrameFreeList::invalidOffset);
+    list.releaseStale(5u);
+    CHECK(list.staleCount() == 0u);
+    CHECK(list.allocate(4u) == 0u);
+}
+
+// Blocks come back frame by frame, in the order they were freed
+static void testReleaseInFrameOrder()
+{
+    FrameFreeList list(30u);
+    const uint32_t a = list.allocate(10u);
+    const uint32_t b = list.allocate(10u);
+    const uint32_t c = list.allocate(10u);
+    list.free(a, 10u, 1u);
+    list.free(b, 10u, 2u);
+    list.free(c, 10u, 2u);
+
+    list.releaseStale(1u);
+    CHECK(list.freeCount() == 10u && list.staleCount() == 20u);
+    CHECK(list.allocate(10u) == a);
+    CHECK(list.allocate(10u) == FrameFreeList::invalidOffset);
+
+    list.releaseStale(3u);
+    CHECK(list.staleCount() == 0u);
+    // b and c merged once released
+    CHECK(list.allocate(20u) == b);
+}
+
+// A block freed with an older frame than one queued before it is held back with that one
+static void testOutOfOrderFreeWaitsForQueue()
+{
+    FrameFreeList list(2u);
+    list.allocate(2u);
+    list.free(0u, 1u, 3u);
+    list.free(1u, 1u, 2u);
+    list.releaseStale(2u);
+    CHECK(list.freeCount() == 0u);
+    list.releaseStale(3u);
+    CHECK(list.freeCount() == 2u);
+}
+
+// Released singles are handed out again most recent first without touching the free list, up
+//  to maxCachedSingles of them
+static void testSinglesCache()
+{
+    constexpr uint32_t cached = FrameFreeList::maxCachedSingles;
+    constexpr uint32_t capacity = 4u * cached;
+    FrameFreeList list(capacity);
+    for (uint32_t i = 0u; i < capacity; i++) {
+        CHECK(list.allocate(1u) == i);
+    }
+    // Every other descriptor, so none of them merge in the free list
+    for (uint32_t i = 0u; i < capacity; i += 2u) {
+        list.free(i, 1u, 1u);
+    }
+    list.releaseStale(1u);
+    CHECK(list.freeCount() == capacity / 2u);
+    const FreeList::Stats stats = list.stats();
+    CHECK(stats.freeBlocks == capacity / 2u);
+    CHECK(stats.largestFreeBlock == 1u);
+
+    // The cache holds the first maxCachedSingles released, the rest went to the list
+    for (uint32_t i = 0u; i < cached; i++) {
+        CHECK(list.allocate(1u) == 2u * (cached - 1u - i));
+    }
+    CHECK(list.allocate(1u) == 2u * cached);
+}
+
+// A request the free list can't meet flushes the cached singles into it, which merges them with
+//  their free neighbours
+static void testLargeAllocationFlushesSingles()
+{
+    FrameFreeList list(4u);
+    for (uint32_t i = 0u; i < 4u; i++) {
+        list.allocate(1u);
+    }
+    list.free(1u, 1u, 1u);
+    list.free(2u, 1u, 1u);
+    list.releaseStale(1u);
+    CHECK(list.stats().freeBlocks == 2u);
+
+    CHECK(list.allocate(2u) == 1u);
+    CHECK(list.freeCount() == 0u);
+}
+
+// Random frames of allocations and frees, the GPU a few frames behind. Every offset handed out
+//  must have been freed in a frame that had already retired.
+static void testRandomFramesNeverReuseEarly()
+{
+    constexpr uint32_t capacity = 512u;
+    constexpr uint64_t framesInFlight = 3u;
+    constexpr uint64_t nFrames = 5000u;
+
+    struct Block
+    {
+        uint32_t offset;
+        uint32_t count;
+    };
+
+    FrameFreeList list(capacity);
+    // Frame each element was last freed in, 0 if never
+    std::vector<uint64_t> freedIn(capacity, 0u);
+    std::deque<Block> live;
+    std::mt19937 rng(5u);
+    uint64_t retired = 0u;
+    uint32_t allocations = 0u;
+    bool early = false;
+    bool overlap = false;
+    std::vector<bool> inUse(capacity, false);
+
+    for (uint64_t frame = 1u; frame <= nFrames; frame++) {
+        if (frame > framesInFlight) {
+            retired = frame - framesInFlight;
+            list.releaseStale(retired);
+        }
+        const uint32_t nAllocs = rng() % 8u;
+        for (uint32_t i = 0u; i < nAllocs; i++) {
+            const uint32_t count = rng() % 4u == 0u ? 1u + rng() % 16u : 1u;
+            const uint32_t offset = list.allocate(count);
+            if (offset == FrameFreeList::invalidOffset) {
+                continue;
+            }
+            for (uint32_t e = offset; e < offset + count; e++) {
+                early = early || freedIn[e] > retired;
+                overlap = overlap || inUse[e];
+                inUse[e] = true;
+            }
+            live.push_back({ offset, count });
+            allocations++;
+        }
+        // Free a random handful of what's live
+        const uint32_t nFrees = live.empty() ? 0u : rng() % 8u;
+        for (uint32_t i = 0u; i < nFrees && !live.empty(); i++) {
+            const size_t pick = rng() % live.size();
+            const Block block = live[pick];
+            live.erase(live.begin() + static_cast<std::ptrdiff_t>(pick));
+            for (uint32_t e = block.offset; e < block.offset + block.count; e++) {
+                freedIn[e] = frame;
+                inUse[e] = false;
+            }
+            list.free(block.offset, block.count, frame);
+        }
+    }
+
+    CHECK(!early);
+    CHECK(!overlap);
+    CHECK(allocations > nFrames);
+
+    // Everything returned and retired adds back up to the whole range
+    for (const Block& block : live) {
+        list.free(block.offset, block.count, nFrames);
+    }
+    list.releaseStale(nFrames);
+    CHECK(list.freeCount() == capacity);
+    CHECK(list.staleCount() == 0u);
+}
+
+int main()
+{
+    testNoReuseBeforeRetire();
+    testReleaseInFrameOrder();
+    testOutOfOrderFreeWaitsForQueue();
+    testSinglesCache();
+    testLargeAllocationFlushesSingles();
+    testRandomFramesNeverReuseEarly();
+    return checkResult();
+}
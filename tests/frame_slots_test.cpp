@@ -0,0 +1,139 @@
+#include <cstdint>
+#include <vector>
+#include "check.h"
+
+import frame_slots;
+
+// A fence the GPU only advances when told to, or when the CPU blocks on it
+struct FakeFence
+{
+    uint64_t completed = 0u;
+    std::vector<uint64_t> waits;
+
+    bool isFenceComplete(uint64_t value) const { return this->completed >= value; }
+    bool waitForFenceVal(uint64_t value)
+    {
+        this->waits.push_back(value);
+        this->completed = value;
+        return true;
+    }
+    uint64_t completedValue() const { return this->completed; }
+};
+
+// With the GPU never running ahead, frame N waits for exactly the fence frame
+//  N - framesInFlight ended with
+static void testBeginWaitsOnOldestFrame()
+{
+    for (uint32_t framesInFlight : { 1u, 2u, 3u }) {
+        FrameSlots slots(framesInFlight);
+        FakeFence fence;
+        std::vector<uint64_t> frameFences;
+        bool waitedOnOldest = true;
+
+        for (uint64_t frame = 0u; frame < 12u; frame++) {
+            const size_t nWaits = fence.waits.size();
+            slots.begin(fence);
+            if (frame < framesInFlight) {
+                waitedOnOldest = waitedOnOldest && fence.waits.size() == nWaits;
+            } else {
+                waitedOnOldest = waitedOnOldest && fence.waits.size() == nWaits + 1u &&
+                    fence.waits.back() == frameFences[frame - framesInFlight];
+            }
+            CHECK(slots.currentSlot() == frame % framesInFlight);
+            // Two submissions per frame, so fence values and frame numbers differ
+            frameFences.push_back(2u * frame + 2u);
+            slots.end(frameFences.back());
+        }
+        CHECK(waitedOnOldest);
+        CHECK(slots.stats().frames == 12u);
+        CHECK(slots.stats().blockedFrames == 12u - framesInFlight);
+    }
+}
+
+// A GPU that keeps up means no frame blocks
+static void testNoWaitWhenRetired()
+{
+    FrameSlots slots(2u);
+    FakeFence fence;
+    for (uint64_t frame = 0u; frame < 8u; frame++) {
+        slots.begin(fence);
+        slots.end(frame + 1u);
+        fence.completed = frame + 1u;
+    }
+    CHECK(fence.waits.empty());
+    CHECK(slots.stats().blockedFrames == 0u);
+}
+
+// begin() hands back the fence's completed value, which retires at least the slot's previous
+//  frame and may retire newer ones, and end() commits the current frame under its own value
+static void testRetireCommitOrdering()
+{
+    FrameSlots slots(3u);
+    FakeFence fence;
+    for (uint64_t frame = 0u; frame < 3u; frame++) {
+        CHECK(slots.begin(fence) == 0u);
+        slots.end(10u * (frame + 1u));
+    }
+    CHECK(slots.pendingFence() == 10u);
+
+    // The GPU ran ahead past frame 1 while frame 3 was being set up
+    fence.completed = 25u;
+    CHECK(slots.begin(fence) == 25u);
+    CHECK(fence.waits.empty());
+    slots.end(40u);
+
+    // Frame 4 reuses frame 1's slot, already retired by the value frame 3 saw
+    CHECK(slots.pendingFence() == 20u);
+    CHECK(slots.begin(fence) == 25u);
+    slots.end(50u);
+    CHECK(slots.pendingFence() == 30u);
+    CHECK(slots.begin(fence) == 30u);
+    CHECK(fence.waits == std::vector<uint64_t>({ 30u }));
+}
+
+// Frames in flight don't follow the swap chain: with two frames in flight and three back
+//  buffers, frame N waits on frame N - 2 whichever back buffer it presents to
+static void testFramesInFlightIndependentOfBuffers()
+{
+    constexpr uint32_t nBuffers = 3u;
+    FrameSlots slots(2u);
+    FakeFence fence;
+    std::vector<uint64_t> frameFences;
+    uint32_t backBuffer = 0u;
+    std::vector<uint32_t> backBuffers;
+    std::vector<uint32_t> frameSlots;
+
+    for (uint64_t frame = 0u; frame < 9u; frame++) {
+        slots.begin(fence);
+        frameSlots.push_back(slots.currentSlot());
+        backBuffers.push_back(backBuffer);
+        backBuffer = (backBuffer + 1u) % nBuffers;
+        frameFences.push_back(frame + 1u);
+        slots.end(frameFences.back());
+    }
+    CHECK(fence.waits == std::vector<uint64_t>({ 1u, 2u, 3u, 4u, 5u, 6u, 7u }));
+    CHECK(slots.size() == 2u);
+    // Frame 2 reuses slot 0 while presenting to the third back buffer
+    CHECK(frameSlots[2] == 0u && backBuffers[2] == 2u);
+    CHECK(frameSlots[3] == 1u && backBuffers[3] == 0u);
+}
+
+static void testAddWaitTime()
+{
+    FrameSlots slots(2u);
+    slots.addWaitTime(1.5);
+    slots.addWaitTime(4.0);
+    CHECK(slots.stats().blockedFrames == 2u);
+    CHECK(slots.stats().blockedMs == 5.5);
+    CHECK(slots.stats().maxBlockedMs == 4.0);
+}
+
+int main()
+{
+    testBeginWaitsOnOldestFrame();
+    testNoWaitWhenRetired();
+    testRetireCommitOrdering();
+    testFramesInFlightIndependentOfBuffers();
+    testAddWaitTime();
+    return checkResult();
+}
@@ -0,0 +1,120 @@
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+#include "check.h"
+
+import free_list;
+
+static void testAllocateInOrder()
+{
+    FreeList list(100u);
+    CHECK(list.allocate(0u) == FreeList::invalidOffset);
+    CHECK(list.allocate(30u) == 0u);
+    CHECK(list.allocate(30u) == 30u);
+    CHECK(list.allocate(50u) == FreeList::invalidOffset);
+    CHECK(list.allocate(40u) == 60u);
+    CHECK(list.freeCount() == 0u);
+    CHECK(list.allocate(1u) == FreeList::invalidOffset);
+    CHECK(FreeList().allocate(1u) == FreeList::invalidOffset);
+}
+
+static void testBestFit()
+{
+    FreeList list(100u);
+    const uint32_t a = list.allocate(10u);
+    list.allocate(5u);
+    const uint32_t c = list.allocate(20u);
+    list.allocate(5u);
+    list.free(a, 10u);
+    list.free(c, 20u);
+
+    // Free blocks of 10, 20 and the 60 left at the end, the smallest fitting one is taken
+    CHECK(list.stats().freeBlocks == 3u);
+    CHECK(list.allocate(8u) == a);
+    CHECK(list.allocate(15u) == c);
+    CHECK(list.allocate(30u) == 40u);
+}
+
+static void testMergeNeighbors()
+{
+    FreeList list(40u);
+    const uint32_t a = list.allocate(10u);
+    const uint32_t b = list.allocate(10u);
+    const uint32_t c = list.allocate(10u);
+    const uint32_t d = list.allocate(10u);
+
+    list.free(a, 10u);
+    list.free(c, 10u);
+    CHECK(list.stats().freeBlocks == 2u);
+    CHECK(list.stats().largestFreeBlock == 10u);
+
+    // Merges with both the block before and the one after
+    list.free(b, 10u);
+    CHECK(list.stats().freeBlocks == 1u);
+    CHECK(list.stats().largestFreeBlock == 30u);
+
+    list.free(d, 10u);
+    const FreeList::Stats stats = list.stats();
+    CHECK(stats.freeBlocks == 1u);
+    CHECK(stats.largestFreeBlock == 40u);
+    CHECK(stats.freeCount == 40u);
+    CHECK(list.allocate(40u) == 0u);
+}
+
+// Random allocations and frees checked against a map of used units
+static void testRandomAgainstBitmap()
+{
+    constexpr uint32_t capacity = 1024u;
+    FreeList list(capacity);
+    std::vector<bool> used(capacity, false);
+    std::vector<std::pair<uint32_t, uint32_t>> live;
+    std::mt19937 rng(7u);
+    uint32_t usedCount = 0u;
+    bool overlap = false;
+
+    for (uint32_t step = 0u; step < 20000u; step++) {
+        if (live.empty() || rng() % 3u != 0u) {
+            const uint32_t count = 1u + rng() % 40u;
+            const uint32_t offset = list.allocate(count);
+            if (offset == FreeList::invalidOffset) {
+                CHECK(list.stats().largestFreeBlock < count);
+                continue;
+            }
+            CHECK(offset + count <= capacity);
+            for (uint32_t i = offset; i < offset + count; i++) {
+                overlap = overlap || used[i];
+                used[i] = true;
+            }
+            usedCount += count;
+            live.push_back({ offset, count });
+        } else {
+            const size_t index = rng() % live.size();
+            const auto [offset, count] = live[index];
+            live[index] = live.back();
+            live.pop_back();
+            for (uint32_t i = offset; i < offset + count; i++) {
+                used[i] = false;
+            }
+            usedCount -= count;
+            list.free(offset, count);
+        }
+        CHECK(list.freeCount() == capacity - usedCount);
+    }
+    CHECK(!overlap);
+
+    for (const auto& [offset, count] : live) {
+        list.free(offset, count);
+    }
+    CHECK(list.stats().freeBlocks == 1u);
+    CHECK(list.stats().largestFreeBlock == capacity);
+}
+
+int main()
+{
+    testAllocateInOrder();
+    testBestFit();
+    testMergeNeighbors();
+    testRandomAgainstBitmap();
+    return checkResult();
+}
@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <random>
+#include <vector>
+#include "check.h"
+
+import large_page_pool;
+
+// Upload page stand-in backed by CPU memory
+struct CpuPage
+{
+    std::vector<uint8_t> bytes;
+};
+
+using Pool = LargePagePool<CpuPage>;
+
+static constexpr size_t KB = 1024u;
+static constexpr size_t MB = 1024u * KB;
+
+static Pool cpuPool(size_t minClassSize, uint32_t trimAfterFrames)
+{
+    return Pool(
+        [](size_t sizeInBytes) {
+            auto page = std::make_unique<CpuPage>();
+            page->bytes.resize(sizeInBytes);
+            return page;
+        },
+        minClassSize, trimAfterFrames
+    );
+}
+
+static void testClassRounding()
+{
+    // The minimum class is rounded up to a power of two as well
+    Pool pool = cpuPool(3u * MB, 4u);
+    CHECK(pool.classSize(1u) == 4u * MB);
+    CHECK(pool.classSize(4u * MB) == 4u * MB);
+    CHECK(pool.classSize(4u * MB + 1u) == 8u * MB);
+    CHECK(pool.classSize(9u * MB) == 16u * MB);
+
+    CpuPage& page = pool.acquire(5u * MB);
+    CHECK(page.bytes.size() == 8u * MB);
+    CHECK(pool.inUseBytes() == 8u * MB);
+}
+
+// A page stays out of the pool until the tag it was committed with retires, so acquiring the
+//  same size again in the meantime creates a new page
+static void testNoReuseBeforeRetire()
+{
+    Pool pool = cpuPool(1u * MB, 4u);
+    CpuPage* first = &pool.acquire(3u * MB);
+    pool.commit(1u);
+    CpuPage* second = &pool.acquire(3u * MB);
+    pool.commit(2u);
+    CHECK(first != second);
+
+    pool.retire(0u);
+    CHECK(&pool.acquire(3u * MB) != first);
+    CHECK(pool.stats().pagesCreated == 3u);
+    CHECK(pool.stats().pagesReused == 0u);
+
+    // Uncommitted pages are in use no matter how far the fence has come
+    pool.retire(2u);
+    CHECK(pool.inUseBytes() == 4u * MB);
+}
+
+static void testReuseAfterRetire()
+{
+    Pool pool = cpuPool(1u * MB, 4u);
+    CpuPage* page = &pool.acquire(3u * MB);
+    pool.commit(1u);
+    pool.retire(1u);
+    CHECK(pool.inUseBytes() == 0u);
+
+    // Any size of the same class gets the page back, other classes don't
+    CHECK(&pool.acquire(2u * MB + 1u) == page);
+    CHECK(&pool.acquire(5u * MB) != page);
+    CHECK(pool.stats().pagesCreated == 2u);
+    CHECK(pool.stats().pagesReused == 1u);
+    CHECK(pool.stats().residentBytes == 12u * MB);
+}
+
+// A pooled page survives trimAfterFrames frames without use and is released on the next one.
+//  Using it again restarts its count.
+static void testTrimAfterIdleFrames()
+{
+    constexpr uint32_t trimAfterFrames = 3u;
+    Pool pool = cpuPool(1u * MB, trimAfterFrames);
+    pool.acquire(2u * MB);
+    pool.acquire(4u * MB);
+    pool.commit(1u);
+    pool.retire(1u);
+    CHECK(pool.stats().residentBytes == 6u * MB);
+
+    pool.endFrame();
+    // Back in use for a frame, so only the 4MB page keeps aging
+    pool.acquire(2u * MB);
+    pool.commit(2u);
+    pool.retire(2u);
+    for (uint32_t i = 1u; i < trimAfterFrames; i++) {
+        pool.endFrame();
+    }
+    CHECK(pool.stats().pagesTrimmed == 0u);
+
+    pool.endFrame();
+    CHECK(pool.stats().pagesTrimmed == 1u);
+    CHECK(pool.stats().residentBytes == 2u * MB);
+
+    pool.endFrame();
+    CHECK(pool.stats().pagesTrimmed == 2u);
+    CHECK(pool.stats().residentBytes == 0u);
+    CHECK(pool.stats().peakResidentBytes == 6u * MB);
+
+    // Pages in use are never trimmed
+    pool.acquire(2u * MB);
+    pool.commit(3u);
+    for (uint32_t i = 0u; i < 2u * trimAfterFrames; i++) {
+        pool.endFrame();
+    }
+    CHECK(pool.stats().residentBytes == 2u * MB);
+}
+
+// Frames of mixed-size large uploads with a few frames in flight. Reports how much memory the
+//  pool held at its peak against the most the frames in flight asked for, and checks a page is
+//  never handed out while its frame is still in flight.
+static void testMixedSizePeakMemory()
+{
+    constexpr uint32_t framesInFlight = 3u;
+    constexpr uint32_t nFrames = 2000u;
+    constexpr uint32_t trimAfterFrames = 60u;
+
+    struct InFlight
+    {
+        uint64_t frame;
+        CpuPage* page;
+        size_t size;
+        uint8_t pattern;
+    };
+
+    Pool pool = cpuPool(512u * KB, trimAfterFrames);
+    std::deque<InFlight> inFlight;
+    std::mt19937 rng(11u);
+    size_t requested = 0u;
+    size_t peakRequested = 0u;
+    size_t peakInUse = 0u;
+    bool intact = true;
+
+    auto retire = [&](uint64_t completed) {
+        while (!inFlight.empty() && inFlight.front().frame <= completed) {
+            const InFlight& f = inFlight.front();
+            for (size_t i = 0u; i < f.size; i += 4093u) {
+                intact = intact && f.page->bytes[i] == f.pattern;
+            }
+            requested -= f.size;
+            inFlight.pop_front();
+        }
+        pool.retire(completed);
+    };
+
+    for (uint64_t frame = 1u; frame <= nFrames; frame++) {
+        if (frame > framesInFlight) {
+            retire(frame - framesInFlight);
+        }
+        // Mostly textures of a few hundred KB to 2MB, now and then a large one up to 16MB
+        const uint32_t nUploads = rng() % 6u;
+        for (uint32_t i = 0u; i < nUploads; i++) {
+            const size_t size = rng() % 8u == 0u ? 2u * MB + rng() % (14u * MB)
+                                                 : 256u * KB + rng() % (1792u * KB);
+            CpuPage& page = pool.acquire(size);
+            const uint8_t pattern = static_cast<uint8_t>(rng());
+            std::memset(page.bytes.data(), pattern, size);
+            inFlight.push_back({ frame, &page, size, pattern });
+            requested += size;
+        }
+        peakRequested = std::max(peakRequested, requested);
+        peakInUse = std::max(peakInUse, pool.inUseBytes());
+        pool.commit(frame);
+        pool.endFrame();
+    }
+    const Pool::Stats busy = pool.stats();
+
+    CHECK(intact);
+    CHECK(busy.peakResidentBytes >= peakInUse);
+    CHECK(busy.pagesReused > busy.pagesCreated);
+
+    // Once uploads stop, every page goes back and is trimmed
+    retire(nFrames);
+    for (uint32_t i = 0u; i <= trimAfterFrames; i++) {
+        pool.endFrame();
+    }
+    CHECK(pool.stats().residentBytes == 0u);
+
+    std::printf(
+        "%u frames: peak resident %.1f MB, peak in use %.1f MB, peak requested %.1f MB "
+        "(%.2fx), %llu pages created, %llu reused, %llu trimmed\n",
+        nFrames, static_cast<double>(busy.peakResidentBytes) / MB,
+        static_cast<double>(peakInUse) / MB, static_cast<double>(peakRequested) / MB,
+        static_cast<double>(busy.peakResidentBytes) / static_cast<double>(peakRequested),
+        static_cast<unsigned long long>(busy.pagesCreated),
+        static_cast<unsigned long long>(busy.pagesReused),
+        static_cast<unsigned long long>(busy.pagesTrimmed)
+    );
+}
+
+int main()
+{
+    testClassRounding();
+    testNoReuseBeforeRetire();
+    testReuseAfterRetire();
+    testTrimAfterIdleFrames();
+    testMixedSizePeakMemory();
+    return checkResult();
+}
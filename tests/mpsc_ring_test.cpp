@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "check.h"
+
+import mpsc_ring;
+
+static void testCapacity()
+{
+    CHECK(MpscRing<int>(0u).size() == 2u);
+    CHECK(MpscRing<int>(5u).size() == 8u);
+    CHECK(MpscRing<int>(64u).size() == 64u);
+}
+
+static void testSingleThreadOrder()
+{
+    MpscRing<int> ring(4u);
+    int out = 0;
+    CHECK(!ring.tryPop(out));
+
+    // Wraps around the ring several times
+    for (int i = 0; i < 10; i++) {
+        CHECK(ring.push(2 * i) == uint64_t(2 * i));
+        CHECK(ring.push(2 * i + 1) == uint64_t(2 * i + 1));
+        CHECK(ring.tryPop(out) && out == 2 * i);
+        CHECK(ring.tryPop(out) && out == 2 * i + 1);
+        CHECK(!ring.tryPop(out));
+    }
+    CHECK(ring.pushed() == 20u);
+    CHECK(ring.popped() == 20u);
+}
+
+// Producers outrun a small ring, so they stall on full cells while the consumer sleeps and
+//  wakes on the published counter. Every value arrives once, in push order per producer.
+static void testProducersKeepTheirOrder()
+{
+    constexpr uint32_t producers = 4u;
+    constexpr uint32_t perProducer = 20000u;
+    MpscRing<std::pair<uint32_t, uint32_t>> ring(8u);
+
+    std::vector<std::thread> threads;
+    for (uint32_t p = 0u; p < producers; p++) {
+        threads.emplace_back([&ring, p] {
+            for (uint32_t i = 0u; i < perProducer; i++) {
+                ring.push({ p, i });
+            }
+        });
+    }
+
+    std::vector<uint32_t> next(producers, 0u);
+    uint32_t received = 0u;
+    bool ordered = true;
+    while (received < producers * perProducer) {
+        const uint64_t snapshot = ring.pushSnapshot();
+        std::pair<uint32_t, uint32_t> value;
+        bool any = false;
+        while (ring.tryPop(value)) {
+            ordered = ordered && value.second == next[value.first];
+            next[value.first] = value.second + 1u;
+            received++;
+            any = true;
+        }
+        if (!any) {
+            ring.waitForPush(snapshot);
+        }
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    CHECK(ordered);
+    CHECK(ring.pushed() == producers * perProducer);
+    CHECK(ring.popped() == producers * perProducer);
+    std::pair<uint32_t, uint32_t> value;
+    CHECK(!ring.tryPop(value));
+}
+
+static void testWakeConsumer()
+{
+    MpscRing<int> ring;
+    const uint64_t snapshot = ring.pushSnapshot();
+    std::thread consumer([&] { ring.waitForPush(snapshot); });
+    ring.wakeConsumer();
+    consumer.join();
+    int out = 0;
+    CHECK(!ring.tryPop(out));
+}
+
+// Submissions per second through a ring sized like CommandQueue's, with 1..N producers and a
+//  consumer that drains whatever is queued as one batch the way the submission thread does
+static void testThroughput()
+{
+    struct Submission
+    {
+        const void* cmdList = nullptr;
+        const void* waitFence = nullptr;
+        uint64_t waitValue = 0u;
+    };
+    constexpr uint32_t total = 400000u;
+    const uint32_t maxProducers = std::clamp(std::thread::hardware_concurrency(), 2u, 16u);
+
+    for (uint32_t producers = 1u; producers <= maxProducers; producers *= 2u) {
+        MpscRing<Submission> ring(64u);
+        const uint32_t perProducer = total / producers;
+        const uint64_t expected = uint64_t(perProducer) * producers;
+        uint64_t batches = 0u;
+
+        const auto t0 = std::chrono::high_resolution_clock::now();
+        std::thread consumer([&] {
+            uint64_t received = 0u;
+            while (received < expected) {
+                const uint64_t snapshot = ring.pushSnapshot();
+                const uint64_t first = ring.popped();
+                Submission submission;
+                while (ring.popped() - first < ring.size() && ring.tryPop(submission)) {
+                    received++;
+                }
+                if (ring.popped() == first) {
+                    ring.waitForPush(snapshot);
+                } else {
+                    batches++;
+                }
+            }
+        });
+        std::vector<std::thread> threads;
+        for (uint32_t p = 0u; p < producers; p++) {
+            threads.emplace_back([&ring, perProducer] {
+                for (uint32_t i = 0u; i < perProducer; i++) {
+                    ring.push({ &ring, nullptr, i });
+                }
+            });
+        }
+        for (std::thread& t : threads) {
+            t.join();
+        }
+        consumer.join();
+        const std::chrono::duration<double> elapsed =
+            std::chrono::high_resolution_clock::now() - t0;
+
+        CHECK(ring.popped() == expected);
+        std::printf(
+            "%2u producer(s): %6.2f M submissions/s, %5.1f per batch, %llu full stalls\n",
+            producers, expected / elapsed.count() / 1e6, double(expected) / double(batches),
+            static_cast<unsigned long long>(ring.stalls())
+        );
+    }
+}
+
+int main()
+{
+    testCapacity();
+    testSingleThreadOrder();
+    testProducersKeepTheirOrder();
+    testWakeConsumer();
+    testThroughput();
+    return checkResult();
+}
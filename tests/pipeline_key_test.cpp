@@ -0,0 +1,350 @@
+#include <d3d12.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <span>
+#include <string>
+#include <vector>
+#include "check.h"
+
+import pipeline_key;
+
+// Laid out like d3dx12's CD3DX12_PIPELINE_STATE_STREAM_SUBOBJECT
+template <D3D12_PIPELINE_STATE_SUBOBJECT_TYPE Type, typename Inner> struct alignas(void*) Subobject
+{
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type = Type;
+    Inner inner = {};
+};
+
+// The stream the application creates its pipeline from
+struct SceneStream
+{
+    Subobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE, ID3D12RootSignature*>
+        rootSignature;
+    Subobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_INPUT_LAYOUT, D3D12_INPUT_LAYOUT_DESC>
+        inputLayout;
+    Subobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PRIMITIVE_TOPOLOGY, D3D12_PRIMITIVE_TOPOLOGY_TYPE>
+        topology;
+    Subobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VS, D3D12_SHADER_BYTECODE> vs;
+    Subobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PS, D3D12_SHADER_BYTECODE> ps;
+    Subobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL_FORMAT, DXGI_FORMAT> dsvFormat;
+    Subobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RENDER_TARGET_FORMATS, D3D12_RT_FORMAT_ARRAY>
+        rtvFormats;
+};
+
+// Everything a scene pipeline is made of, owned apart from the stream pointing into it
+struct SceneSources
+{
+    std::string position = "POSITION";
+    std::string color = "COLOR";
+    std::vector<uint8_t> vs = { 0x44, 0x58, 0x42, 0x43, 1u, 2u, 3u };
+    std::vector<uint8_t> ps = { 0x44, 0x58, 0x42, 0x43, 4u, 5u };
+    std::vector<uint8_t> rootSignature = { 9u, 8u, 7u };
+    D3D12_INPUT_ELEMENT_DESC elements[2] = {};
+    ID3D12RootSignature root;
+
+    SceneStream stream()
+    {
+        this->elements[0] = { this->position.c_str(), 0u, DXGI_FORMAT_R32G32B32_FLOAT, 0u, 0u,
+                              D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0u };
+        this->elements[1] = { this->color.c_str(), 0u, DXGI_FORMAT_R32G32B32_FLOAT, 0u, 12u,
+                              D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0u };
+        SceneStream s;
+        s.rootSignature.inner = &this->root;
+        s.inputLayout.inner = { this->elements, 2u };
+        s.topology.inner = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+        s.vs.inner = { this->vs.data(), this->vs.size() };
+        s.ps.inner = { this->ps.data(), this->ps.size() };
+        s.dsvFormat.inner = DXGI_FORMAT_D32_FLOAT;
+        s.rtvFormats.inner.NumRenderTargets = 1u;
+        s.rtvFormats.inner.RTFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+        return s;
+    }
+};
+
+template <typename Stream> static uint64_t hash(Stream& stream, std::span<const uint8_t> root)
+{
+    const D3D12_PIPELINE_STATE_STREAM_DESC desc = { sizeof(Stream), &stream };
+    return hashPipelineStream(desc, root);
+}
+
+template <typename T> static void scribblePadding(T& subobject)
+{
+    const size_t type = sizeof(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE);
+    std::memset(reinterpret_cast<uint8_t*>(&subobject) + type, 0xcd, offsetof(T, inner) - type);
+}
+
+// Equal contents at different addresses hash the same, as they would from one run to the next
+static void testHashIgnoresAddresses()
+{
+    SceneSources a;
+    SceneSources b;
+    SceneStream sa = a.stream();
+    SceneStream sb = b.stream();
+    CHECK(sa.vs.inner.pShaderBytecode != sb.vs.inner.pShaderBytecode);
+    CHECK(sa.rootSignature.inner != sb.rootSignature.inner);
+    CHECK(hash(sa, a.rootSignature) == hash(sb, b.rootSignature));
+
+    // Nor is the padding between a subobject's type and what it holds
+    SceneStream sc = a.stream();
+    scribblePadding(sc.rootSignature);
+    scribblePadding(sc.inputLayout);
+    scribblePadding(sc.vs);
+    scribblePadding(sc.ps);
+    CHECK(hash(sc, a.rootSignature) == hash(sa, a.rootSignature));
+}
+
+// Each thing a pipeline is made of changes the key
+static void testHashCoversContents()
+{
+    SceneSources sources;
+    SceneStream base = sources.stream();
+    const uint64_t key = hash(base, sources.rootSignature);
+    std::vector<uint64_t> keys;
+
+    {
+        SceneSources s;
+        s.ps.back() ^= 1u;
+        SceneStream stream = s.stream();
+        keys.push_back(hash(stream, s.rootSignature));
+    }
+    {
+        SceneSources s;
+        s.color = "NORMAL";
+        SceneStream stream = s.stream();
+        keys.push_back(hash(stream, s.rootSignature));
+    }
+    {
+        SceneSources s;
+        s.rootSignature.push_back(0u);
+        SceneStream stream = s.stream();
+        keys.push_back(hash(stream, s.rootSignature));
+    }
+    {
+        SceneStream stream = sources.stream();
+        stream.inputLayout.inner.NumElements = 1u;
+        keys.push_back(hash(stream, sources.rootSignature));
+    }
+    {
+        SceneStream stream = sources.stream();
+        sources.elements[1].AlignedByteOffset = 16u;
+        keys.push_back(hash(stream, sources.rootSignature));
+    }
+    {
+        SceneStream stream = sources.stream();
+        stream.topology.inner = D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE;
+        keys.push_back(hash(stream, sources.rootSignature));
+    }
+    {
+        SceneStream stream = sources.stream();
+        stream.rtvFormats.inner.RTFormats[0] = DXGI_FORMAT_R32G32B32A32_FLOAT;
+        keys.push_back(hash(stream, sources.rootSignature));
+    }
+    {
+        // Formats past NumRenderTargets are still part of the desc the device sees
+        SceneStream stream = sources.stream();
+        stream.rtvFormats.inner.RTFormats[3] = DXGI_FORMAT_R8G8B8A8_UNORM;
+        keys.push_back(hash(stream, sources.rootSignature));
+    }
+    {
+        SceneStream stream = sources.stream();
+        stream.dsvFormat.inner = DXGI_FORMAT_UNKNOWN;
+        keys.push_back(hash(stream, sources.rootSignature));
+    }
+
+    bool collision = false;
+    for (size_t i = 0u; i < keys.size(); i++) {
+        collision = collision || keys[i] == key;
+        for (size_t j = i + 1u; j < keys.size(); j++) {
+            collision = collision || keys[i] == keys[j];
+        }
+    }
+    CHECK(!collision);
+}
+
+// A stream with the remaining fixed-function subobjects, each field of which changes the key
+struct StateStream
+{
+    Subobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_BLEND, D3D12_BLEND_DESC> blend;
+    Subobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_SAMPLE_MASK, UINT> sampleMask;
+    Subobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RASTERIZER, D3D12_RASTERIZER_DESC> rasterizer;
+    Subobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL1, D3D12_DEPTH_STENCIL_DESC1>
+        depthStencil;
+    Subobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_SAMPLE_DESC, DXGI_SAMPLE_DESC> samples;
+    Subobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_IB_STRIP_CUT_VALUE,
+              D3D12_INDEX_BUFFER_STRIP_CUT_VALUE>
+        stripCut;
+    Subobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_STREAM_OUTPUT, D3D12_STREAM_OUTPUT_DESC>
+        streamOutput;
+    Subobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VIEW_INSTANCING, D3D12_VIEW_INSTANCING_DESC>
+        viewInstancing;
+    Subobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_FLAGS, D3D12_PIPELINE_STATE_FLAGS> flags;
+    Subobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_NODE_MASK, UINT> nodeMask;
+};
+
+static void testHashCoversFixedFunction()
+{
+    const D3D12_SO_DECLARATION_ENTRY soEntries[] = { { 0u, "POSITION", 0u, 0u, 3u, 0u } };
+    const UINT strides[] = { 12u };
+    const D3D12_VIEW_INSTANCE_LOCATION views[] = { { 0u, 0u }, { 1u, 1u } };
+    StateStream base;
+    base.blend.inner.RenderTarget[0] = {
+        TRUE,
+        FALSE,
+        D3D12_BLEND_SRC_ALPHA,
+        D3D12_BLEND_INV_SRC_ALPHA,
+        D3D12_BLEND_OP_ADD,
+        D3D12_BLEND_ONE,
+        D3D12_BLEND_ZERO,
+        D3D12_BLEND_OP_ADD,
+        D3D12_LOGIC_OP_NOOP,
+        0xfu,
+    };
+    base.sampleMask.inner = UINT32_MAX;
+    base.rasterizer.inner.FillMode = D3D12_FILL_MODE_SOLID;
+    base.rasterizer.inner.CullMode = D3D12_CULL_MODE_BACK;
+    base.depthStencil.inner.DepthEnable = TRUE;
+    base.depthStencil.inner.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
+    base.samples.inner = { 1u, 0u };
+    base.streamOutput.inner = { soEntries, 1u, strides, 1u, 0u };
+    base.viewInstancing.inner = { 2u, views, D3D12_VIEW_INSTANCING_FLAG_NONE };
+    const uint64_t key = hash(base, {});
+
+    // Each change made to a copy of the base stream
+    const auto changes = {
+        +[](StateStream& s) { s.blend.inner.RenderTarget[7].RenderTargetWriteMask = 1u; },
+        +[](StateStream& s) { s.blend.inner.AlphaToCoverageEnable = TRUE; },
+        +[](StateStream& s) { s.sampleMask.inner = 1u; },
+        +[](StateStream& s) { s.rasterizer.inner.DepthBias = 1; },
+        +[](StateStream& s) { s.rasterizer.inner.SlopeScaledDepthBias = 0.5f; },
+        +[](StateStream& s) {
+            s.rasterizer.inner.ConservativeRaster = D3D12_CONSERVATIVE_RASTERIZATION_MODE_ON;
+        },
+        +[](StateStream& s) {
+            s.depthStencil.inner.BackFace.StencilPassOp = D3D12_STENCIL_OP_ZERO;
+        },
+        +[](StateStream& s) { s.depthStencil.inner.DepthBoundsTestEnable = TRUE; },
+        +[](StateStream& s) { s.samples.inner.Count = 4u; },
+        +[](StateStream& s) { s.stripCut.inner = D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_0xFFFF; },
+        +[](StateStream& s) { s.streamOutput.inner.RasterizedStream = 1u; },
+        +[](StateStream& s) { s.viewInstancing.inner.ViewInstanceCount = 1u; },
+        +[](StateStream& s) { s.flags.inner = D3D12_PIPELINE_STATE_FLAG_TOOL_DEBUG; },
+        +[](StateStream& s) { s.nodeMask.inner = 1u; },
+    };
+    std::vector<uint64_t> keys;
+    for (void (*change)(StateStream&) : changes) {
+        StateStream stream = base;
+        change(stream);
+        keys.push_back(hash(stream, {}));
+    }
+    bool collision = false;
+    for (size_t i = 0u; i < keys.size(); i++) {
+        collision = collision || keys[i] == key;
+        for (size_t j = i + 1u; j < keys.size(); j++) {
+            collision = collision || keys[i] == keys[j];
+        }
+    }
+    CHECK(!collision);
+}
+
+struct CachedStream
+{
+    Subobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_CS, D3D12_SHADER_BYTECODE> cs;
+    Subobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_CACHED_PSO, D3D12_CACHED_PIPELINE_STATE> cached;
+};
+
+static bool hashThrows(const D3D12_PIPELINE_STATE_STREAM_DESC& desc)
+{
+    try {
+        hashPipelineStream(desc, {});
+    } catch (const std::exception&) {
+        return true;
+    }
+    return false;
+}
+
+static void testCachedPsoAndBadStreams()
+{
+    const uint8_t cs[] = { 1u, 2u, 3u };
+    const uint8_t blobA[] = { 4u };
+    const uint8_t blobB[] = { 5u, 6u };
+    CachedStream a;
+    a.cs.inner = { cs, sizeof(cs) };
+    a.cached.inner = { blobA, sizeof(blobA) };
+    CachedStream b = a;
+    b.cached.inner = { blobB, sizeof(blobB) };
+    CHECK(hash(a, {}) == hash(b, {}));
+
+    // Ends halfway through the cached PSO subobject
+    CHECK(hashThrows({ sizeof(CachedStream) - sizeof(void*), &a }));
+
+    Subobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL2, D3D12_DEPTH_STENCIL_DESC> unknown;
+    CHECK(hashThrows({ sizeof(unknown), &unknown }));
+}
+
+static void testPipelineName()
+{
+    CHECK(pipelineName(0x0123456789abcdefull) == L"pso_0123456789abcdef");
+    CHECK(pipelineName(0u) == L"pso_0000000000000000");
+    CHECK(pipelineName(UINT64_MAX) == L"pso_ffffffffffffffff");
+}
+
+static bool same(std::span<const uint8_t> a, std::span<const uint8_t> b)
+{
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+static void testCacheRoundTrip()
+{
+    std::vector<uint8_t> library(1000u);
+    for (size_t i = 0u; i < library.size(); i++) {
+        library[i] = static_cast<uint8_t>(i * 7u);
+    }
+    const std::vector<uint8_t> file = encodePipelineCache(library);
+    CHECK(file.size() > library.size());
+    CHECK(same(decodePipelineCache(file), library));
+    // The library is returned in place, not copied
+    CHECK(decodePipelineCache(file).data() == file.data() + (file.size() - library.size()));
+
+    const std::vector<uint8_t> empty = encodePipelineCache({});
+    CHECK(!empty.empty());
+    CHECK(decodePipelineCache(empty).empty());
+}
+
+// Anything but an intact file of this version decodes to nothing
+static void testCacheRejectsDamage()
+{
+    const std::vector<uint8_t> library(256u, 0x5au);
+    const std::vector<uint8_t> file = encodePipelineCache(library);
+    const size_t header = file.size() - library.size();
+
+    CHECK(decodePipelineCache({}).empty());
+    CHECK(decodePipelineCache(std::span(file).first(header - 1u)).empty());
+    CHECK(decodePipelineCache(std::span(file).first(file.size() - 1u)).empty());
+
+    std::vector<uint8_t> longer = file;
+    longer.push_back(0u);
+    CHECK(decodePipelineCache(longer).empty());
+
+    uint32_t failures = 0u;
+    for (size_t byte = 0u; byte < file.size(); byte++) {
+        std::vector<uint8_t> damaged = file;
+        damaged[byte] ^= 0x10u;
+        failures += decodePipelineCache(damaged).empty() ? 0u : 1u;
+    }
+    CHECK(failures == 0u);
+}
+
+int main()
+{
+    testHashIgnoresAddresses();
+    testHashCoversContents();
+    testHashCoversFixedFunction();
+    testCachedPsoAndBadStreams();
+    testPipelineName();
+    testCacheRoundTrip();
+    testCacheRejectsDamage();
+    return checkResult();
+}
@@ -0,0 +1,640 @@
+#include <d3d12.h>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "check.h"
+
+import render_graph;
+
+// Keeps the barriers recorded into it
+struct RecordingList : ID3D12GraphicsCommandList2
+{
+    std::vector<D3D12_RESOURCE_BARRIER> barriers;
+
+    void ResourceBarrier(UINT NumBarriers, const D3D12_RESOURCE_BARRIER* pBarriers) override
+    {
+        this->barriers.insert(this->barriers.end(), pBarriers, pBarriers + NumBarriers);
+    }
+};
+
+static bool isTransition(
+    const D3D12_RESOURCE_BARRIER& barrier,
+    ID3D12Resource* resource,
+    D3D12_RESOURCE_STATES before,
+    D3D12_RESOURCE_STATES after
+)
+{
+    return barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION &&
+        barrier.Flags == D3D12_RESOURCE_BARRIER_FLAG_NONE &&
+        barrier.Transition.pResource == resource && barrier.Transition.StateBefore == before &&
+        barrier.Transition.StateAfter == after;
+}
+
+// Readers of a version run before the pass that modifies it, even when declared after it
+static void testOrderFollowsDependencies()
+{
+    ID3D12Resource texture;
+    RenderGraph graph;
+    const RenderGraph::ResourceId v0 =
+        graph.importResource("texture", &texture, D3D12_RESOURCE_STATE_COMMON);
+    const RenderGraph::ResourceId v1 =
+        graph.addPass("write", nullptr).write(v0, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    graph.addPass("read old", nullptr)
+        .read(v0, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)
+        .sideEffects();
+    graph.addPass("read new", nullptr)
+        .read(v1, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)
+        .sideEffects();
+    graph.compile();
+
+    const std::vector<uint32_t> order(graph.passOrder().begin(), graph.passOrder().end());
+    CHECK((order == std::vector<uint32_t>{ 1u, 0u, 2u }));
+    CHECK(graph.passName(order[0]) == "read old");
+}
+
+// Passes nothing kept reads from are culled, and so in turn are the passes only they read from
+static void testCulling()
+{
+    ID3D12Resource color, scratch, other;
+    RenderGraph graph;
+    RenderGraph::ResourceId c = graph.importResource("color", &color, D3D12_RESOURCE_STATE_COMMON);
+    RenderGraph::ResourceId s =
+        graph.importResource("scratch", &scratch, D3D12_RESOURCE_STATE_COMMON);
+
+    c = graph.addPass("draw", nullptr).write(c, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    s = graph.addPass("unused producer", nullptr).write(s, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    RenderGraph::PassBuilder unused = graph.addPass("unused consumer", nullptr);
+    unused.read(s, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    unused.write(
+        graph.importResource("other", &other, D3D12_RESOURCE_STATE_COMMON),
+        D3D12_RESOURCE_STATE_RENDER_TARGET
+    );
+    graph.addPass("debug", nullptr).read(c, D3D12_RESOURCE_STATE_COPY_SOURCE).sideEffects();
+    graph.exportResource(c, D3D12_RESOURCE_STATE_PRESENT);
+    graph.compile();
+
+    CHECK(!graph.culled(0u));
+    CHECK(graph.culled(1u));
+    CHECK(graph.culled(2u));
+    CHECK(!graph.culled(3u));
+    CHECK(graph.passOrder().size() == 2u);
+    CHECK(graph.stats().culledPasses == 2u);
+    // The culled passes' resource is left alone
+    CHECK(graph.finalState(s) == D3D12_RESOURCE_STATE_COMMON);
+}
+
+static void testBarriers()
+{
+    ID3D12Resource texture, buffer;
+    ResourceStates states;
+    states.add(&texture, D3D12_RESOURCE_STATE_COMMON);
+    states.add(&buffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+    RenderGraph graph;
+    RenderGraph::ResourceId t = graph.importResource("texture", &texture, states);
+    RenderGraph::ResourceId b = graph.importResource("buffer", &buffer, states);
+    t = graph.addPass("draw", nullptr).write(t, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    graph.addPass("pixel read", nullptr)
+        .read(t, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)
+        .sideEffects();
+    RenderGraph::PassBuilder compute = graph.addPass("compute", nullptr);
+    compute.read(t, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    b = compute.write(b, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    b = graph.addPass("compute again", nullptr).write(b, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    graph.exportResource(t, D3D12_RESOURCE_STATE_COMMON);
+    graph.exportResource(b, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    graph.compile();
+
+    // Both readers need one merged read state, entered once
+    CHECK(graph.barriersBefore(0u).size() == 1u);
+    CHECK(isTransition(
+        graph.barriersBefore(0u)[0], &texture, D3D12_RESOURCE_STATE_COMMON,
+        D3D12_RESOURCE_STATE_RENDER_TARGET
+    ));
+    const D3D12_RESOURCE_STATES read = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE |
+        D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+    CHECK(graph.barriersBefore(1u).size() == 1u);
+    CHECK(isTransition(
+        graph.barriersBefore(1u)[0], &texture, D3D12_RESOURCE_STATE_RENDER_TARGET, read
+    ));
+    // Whatever wrote the buffer before the graph is waited on, as is each write after that
+    CHECK(graph.barriersBefore(2u).size() == 1u);
+    CHECK(graph.barriersBefore(2u)[0].Type == D3D12_RESOURCE_BARRIER_TYPE_UAV);
+    CHECK(graph.barriersBefore(2u)[0].UAV.pResource == &buffer);
+    CHECK(graph.barriersBefore(3u).size() == 2u);
+    CHECK(graph.barriersBefore(3u)[1].Type == D3D12_RESOURCE_BARRIER_TYPE_UAV);
+
+    // The texture's last use is the compute pass, so its way back begins right after it
+    const D3D12_RESOURCE_BARRIER& begin = graph.barriersBefore(3u)[0];
+    CHECK(begin.Flags == D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY);
+    CHECK(begin.Transition.pResource == &texture);
+    CHECK(graph.finalBarriers().size() == 1u);
+    const D3D12_RESOURCE_BARRIER& end = graph.finalBarriers()[0];
+    CHECK(end.Flags == D3D12_RESOURCE_BARRIER_FLAG_END_ONLY);
+    CHECK(end.Transition.StateBefore == read);
+    CHECK(end.Transition.StateAfter == D3D12_RESOURCE_STATE_COMMON);
+    CHECK(graph.stats().barriers == 6u);
+    CHECK(graph.stats().splitBarriers == 1u);
+
+    // Only once committed do the states reflect what the graph did
+    states.setState(&texture, D3D12_RESOURCE_STATE_COPY_DEST);
+    graph.commitStates(states);
+    CHECK(states.state(&texture) == D3D12_RESOURCE_STATE_COMMON);
+    CHECK(states.state(&buffer) == D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+}
+
+// The frame the application records: a clear sharing the first list with the first of three
+//  scene parts, the final transition at the end of the last
+static void testRecordLists()
+{
+    ID3D12Resource backBuffer, depthBuffer;
+    ResourceStates states;
+    states.add(&backBuffer, D3D12_RESOURCE_STATE_PRESENT);
+    states.add(&depthBuffer, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+    std::vector<std::string> recorded;
+    RenderGraph graph;
+    RenderGraph::ResourceId target = graph.importResource("back buffer", &backBuffer, states);
+    RenderGraph::ResourceId depth = graph.importResource("depth buffer", &depthBuffer, states);
+    RenderGraph::PassBuilder clear = graph.addPass("clear", [&](const RenderGraph::Context& c) {
+        recorded.push_back("clear " + std::to_string(c.list));
+    });
+    target = clear.write(target, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    depth = clear.write(depth, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+    RenderGraph::PassBuilder scene = graph.addPass("scene", [&](const RenderGraph::Context& c) {
+        recorded.push_back("scene." + std::to_string(c.part) + " " + std::to_string(c.list));
+    });
+    scene.parts(3u);
+    target = scene.write(target, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    depth = scene.write(depth, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+    graph.exportResource(target, D3D12_RESOURCE_STATE_PRESENT);
+    graph.compile();
+
+    CHECK(graph.listCount() == 3u);
+    std::vector<RecordingList> lists(graph.listCount());
+    for (uint32_t i = 0u; i < graph.listCount(); i++) {
+        graph.recordList(i, &lists[i]);
+    }
+    CHECK((recorded == std::vector<std::string>{ "clear 0", "scene.0 0", "scene.1 1",
+                                                 "scene.2 2" }));
+    CHECK(lists[0].barriers.size() == 1u);
+    CHECK(isTransition(
+        lists[0].barriers[0], &backBuffer, D3D12_RESOURCE_STATE_PRESENT,
+        D3D12_RESOURCE_STATE_RENDER_TARGET
+    ));
+    CHECK(lists[1].barriers.empty());
+    CHECK(lists[2].barriers.size() == 1u);
+    CHECK(isTransition(
+        lists[2].barriers[0], &backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET,
+        D3D12_RESOURCE_STATE_PRESENT
+    ));
+
+    graph.commitStates(states);
+    CHECK(states.state(&backBuffer) == D3D12_RESOURCE_STATE_PRESENT);
+    CHECK(states.state(&depthBuffer) == D3D12_RESOURCE_STATE_DEPTH_WRITE);
+}
+
+// Two transients used one after the other share memory, the second waiting on the first
+static void testTransientsAlias()
+{
+    constexpr uint64_t MB = 1024u * 1024u;
+    ID3D12Resource output;
+    ID3D12Resource placed[2];
+    std::vector<RenderGraph::TransientPlacement> placements;
+    RenderGraph graph;
+    RenderGraph::ResourceId out =
+        graph.importResource("output", &output, D3D12_RESOURCE_STATE_COMMON);
+    RenderGraph::ResourceId a = graph.createTransient("a", MB, 64u * 1024u);
+    RenderGraph::ResourceId b = graph.createTransient("b", MB, 64u * 1024u);
+
+    a = graph.addPass("draw a", nullptr).write(a, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    RenderGraph::PassBuilder useA = graph.addPass("use a", nullptr);
+    useA.read(a, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    out = useA.write(out, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    b = graph.addPass("draw b", nullptr).write(b, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    RenderGraph::PassBuilder useB = graph.addPass("use b", nullptr);
+    useB.read(b, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    out = useB.write(out, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    graph.exportResource(out, D3D12_RESOURCE_STATE_COMMON);
+    graph.compile([&](RenderGraph::ResourceId, const RenderGraph::TransientPlacement& p) {
+        placements.push_back(p);
+        return &placed[placements.size() - 1u];
+    });
+
+    // Created in the state of their first use, in one heap of the size of one
+    CHECK(placements.size() == 2u);
+    CHECK(placements[0].heap == placements[1].heap);
+    CHECK(placements[0].offset == placements[1].offset);
+    CHECK(placements[0].initialState == D3D12_RESOURCE_STATE_RENDER_TARGET);
+    CHECK(graph.transientHeaps().size() == 1u);
+    CHECK(graph.stats().transientBytes == 2u * MB);
+    CHECK(graph.stats().transientHeapBytes == MB);
+    CHECK(graph.resource(b) == &placed[1]);
+
+    // a needs nothing before its first use, only the output's transition begins there
+    CHECK(graph.barriersBefore(0u).size() == 1u);
+    CHECK(graph.barriersBefore(0u)[0].Transition.pResource == &output);
+    CHECK(graph.barriersBefore(2u).size() == 1u);
+    const D3D12_RESOURCE_BARRIER& aliasing = graph.barriersBefore(2u)[0];
+    CHECK(aliasing.Type == D3D12_RESOURCE_BARRIER_TYPE_ALIASING);
+    CHECK(aliasing.Aliasing.pResourceBefore == &placed[0]);
+    CHECK(aliasing.Aliasing.pResourceAfter == &placed[1]);
+}
+
+static bool placedAt(RenderGraph::SplitPlacement placement, uint32_t begin, uint32_t end)
+{
+    return placement.begin == begin && placement.end == end;
+}
+
+static void testSplitPlacement()
+{
+    // Positions 0 to 2 in list 0, 3 in list 1, the final barriers at 4 in list 1
+    const uint32_t lists[] = { 0u, 0u, 0u, 1u, 1u };
+    const uint32_t none = RenderGraph::none;
+    CHECK(placedAt(RenderGraph::splitPlacement(0u, 2u, lists), 1u, 2u));
+    // Nothing in between
+    CHECK(placedAt(RenderGraph::splitPlacement(0u, 1u, lists), 1u, 1u));
+    CHECK(placedAt(RenderGraph::splitPlacement(3u, 4u, lists), 4u, 4u));
+    // A first use begins with the frame
+    CHECK(placedAt(RenderGraph::splitPlacement(none, 2u, lists), 0u, 2u));
+    CHECK(placedAt(RenderGraph::splitPlacement(none, 0u, lists), 0u, 0u));
+    // Halves in different lists
+    CHECK(placedAt(RenderGraph::splitPlacement(1u, 3u, lists), 3u, 3u));
+    CHECK(placedAt(RenderGraph::splitPlacement(none, 4u, lists), 4u, 4u));
+    // The list the previous use is in doesn't matter, only the one of the pass after it
+    CHECK(placedAt(RenderGraph::splitPlacement(2u, 4u, lists), 3u, 4u));
+}
+
+// Logs every barrier recorded, in the order the GPU sees them within its list
+struct LoggingList : ID3D12GraphicsCommandList2
+{
+    std::vector<std::string>* log;
+    const std::vector<std::pair<ID3D12Resource*, std::string>>* names;
+
+    void ResourceBarrier(UINT NumBarriers, const D3D12_RESOURCE_BARRIER* pBarriers) override
+    {
+        for (UINT i = 0u; i < NumBarriers; i++) {
+            const D3D12_RESOURCE_BARRIER& barrier = pBarriers[i];
+            const bool uav = barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_UAV;
+            ID3D12Resource* resource = uav ? barrier.UAV.pResource : barrier.Transition.pResource;
+            std::string entry = uav ? "uav" :
+                barrier.Flags == D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY ? "begin" :
+                barrier.Flags == D3D12_RESOURCE_BARRIER_FLAG_END_ONLY   ? "end" :
+                                                                          "transition";
+            for (const auto& [r, name] : *this->names) {
+                if (r == resource) {
+                    entry += " " + name;
+                }
+            }
+            this->log->push_back(entry);
+        }
+    }
+};
+
+// A deferred shading frame, recorded list by list. Transitions with idle passes before them
+//  in the same list begin early, the rest are recorded whole right before their use.
+static void testSplitsInRecordedFrame()
+{
+    ID3D12Resource shadowMap, gbuffer, ao, hdr, backBuffer;
+    const std::vector<std::pair<ID3D12Resource*, std::string>> names = {
+        { &shadowMap, "shadow map" }, { &gbuffer, "gbuffer" }, { &ao, "ao" },
+        { &hdr, "hdr" },              { &backBuffer, "back buffer" },
+    };
+    std::vector<std::string> log;
+    const auto pass = [&](const char* name) {
+        return [&log, name](const RenderGraph::Context& c) {
+            log.push_back(std::string(name) + "." + std::to_string(c.part));
+        };
+    };
+
+    RenderGraph graph;
+    RenderGraph::ResourceId shadow =
+        graph.importResource("shadow map", &shadowMap, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+    RenderGraph::ResourceId g =
+        graph.importResource("gbuffer", &gbuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    RenderGraph::ResourceId occlusion =
+        graph.importResource("ao", &ao, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    RenderGraph::ResourceId lit =
+        graph.importResource("hdr", &hdr, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    RenderGraph::ResourceId target =
+        graph.importResource("back buffer", &backBuffer, D3D12_RESOURCE_STATE_PRESENT);
+
+    shadow = graph.addPass("shadows", pass("shadows"))
+                 .write(shadow, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+    g = graph.addPass("geometry", pass("geometry")).write(g, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    RenderGraph::PassBuilder ssao = graph.addPass("ssao", pass("ssao"));
+    ssao.read(g, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    occlusion = ssao.write(occlusion, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    RenderGraph::PassBuilder lighting = graph.addPass("lighting", pass("lighting"));
+    lighting.read(shadow, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)
+        .read(g, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)
+        .read(occlusion, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    lit = lighting.write(lit, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    RenderGraph::PassBuilder post = graph.addPass("post", pass("post"));
+    post.parts(2u).read(lit, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    target = post.write(target, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    graph.exportResource(target, D3D12_RESOURCE_STATE_PRESENT);
+    graph.compile();
+
+    CHECK(graph.listCount() == 2u);
+    std::vector<std::vector<std::string>> recorded;
+    for (uint32_t i = 0u; i < graph.listCount(); i++) {
+        LoggingList list;
+        list.log = &log;
+        list.names = &names;
+        graph.recordList(i, &list);
+        recorded.push_back(std::move(log));
+        log.clear();
+    }
+
+    const std::vector<std::vector<std::string>> expected = {
+        {
+            "begin back buffer",
+            "shadows.0",
+            "begin shadow map",
+            "geometry.0",
+            "transition gbuffer",
+            "uav ao",
+            "ssao.0",
+            "end shadow map",
+            "transition ao",
+            "lighting.0",
+            "transition hdr",
+            "end back buffer",
+            "post.0",
+        },
+        {
+            "post.1",
+            "transition back buffer",
+        },
+    };
+    CHECK(recorded == expected);
+    CHECK(graph.stats().splitBarriers == 2u);
+}
+
+static bool compileThrows(RenderGraph& graph)
+{
+    try {
+        graph.compile();
+    } catch (const std::exception&) {
+        return true;
+    }
+    return false;
+}
+
+static void testErrors()
+{
+    ID3D12Resource a, b;
+    {
+        RenderGraph graph;
+        const RenderGraph::ResourceId v0 =
+            graph.importResource("a", &a, D3D12_RESOURCE_STATE_COMMON);
+        graph.addPass("first", nullptr).write(v0, D3D12_RESOURCE_STATE_RENDER_TARGET);
+        bool threw = false;
+        try {
+            graph.addPass("second", nullptr).write(v0, D3D12_RESOURCE_STATE_RENDER_TARGET);
+        } catch (const std::exception&) {
+            threw = true;
+        }
+        CHECK(threw);
+    }
+    {
+        // Each pass reads what the other produces
+        RenderGraph graph;
+        const RenderGraph::ResourceId a0 =
+            graph.importResource("a", &a, D3D12_RESOURCE_STATE_COMMON);
+        const RenderGraph::ResourceId b0 =
+            graph.importResource("b", &b, D3D12_RESOURCE_STATE_COMMON);
+        RenderGraph::PassBuilder first = graph.addPass("first", nullptr);
+        RenderGraph::PassBuilder second = graph.addPass("second", nullptr);
+        const RenderGraph::ResourceId a1 = first.write(a0, D3D12_RESOURCE_STATE_RENDER_TARGET);
+        const RenderGraph::ResourceId b1 = second.write(b0, D3D12_RESOURCE_STATE_RENDER_TARGET);
+        first.read(b1, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        second.read(a1, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        CHECK(compileThrows(graph));
+    }
+    {
+        RenderGraph graph;
+        RenderGraph::ResourceId t = graph.createTransient("transient", 1024u, 256u);
+        t = graph.addPass("use", nullptr).write(t, D3D12_RESOURCE_STATE_RENDER_TARGET);
+        graph.addPass("keep", nullptr).read(t, D3D12_RESOURCE_STATE_COPY_SOURCE).sideEffects();
+        CHECK(compileThrows(graph));
+    }
+}
+
+// The GPU's view of resource states, checking each barrier recorded against it
+struct StateModel
+{
+    struct Entry
+    {
+        D3D12_RESOURCE_STATES state;
+        // Between the begin and end of a split transition, into splitState
+        bool splitting = false;
+        D3D12_RESOURCE_STATES splitState = D3D12_RESOURCE_STATE_COMMON;
+    };
+
+    std::map<ID3D12Resource*, Entry> resources;
+    bool valid = true;
+    // Set by a barrier batch and cleared by the next pass, so two batches in a row show
+    bool barriersPending = false;
+    uint64_t batches = 0u;
+    uint64_t barriers = 0u;
+
+    void apply(const D3D12_RESOURCE_BARRIER& barrier)
+    {
+        if (barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_UAV) {
+            const Entry& e = this->resources.at(barrier.UAV.pResource);
+            this->valid = this->valid && !e.splitting &&
+                e.state == D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+            return;
+        }
+        this->valid = this->valid && barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+        Entry& e = this->resources.at(barrier.Transition.pResource);
+        this->valid = this->valid && barrier.Transition.StateBefore == e.state &&
+            barrier.Transition.StateBefore != barrier.Transition.StateAfter;
+        if (barrier.Flags == D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY) {
+            this->valid = this->valid && !e.splitting;
+            e.splitting = true;
+            e.splitState = barrier.Transition.StateAfter;
+        } else if (barrier.Flags == D3D12_RESOURCE_BARRIER_FLAG_END_ONLY) {
+            this->valid =
+                this->valid && e.splitting && e.splitState == barrier.Transition.StateAfter;
+            e.splitting = false;
+            e.state = barrier.Transition.StateAfter;
+        } else {
+            this->valid = this->valid && !e.splitting;
+            e.state = barrier.Transition.StateAfter;
+        }
+    }
+
+    // A pass may only touch a resource once its transition has ended, in a state that allows
+    //  the access: exactly the written state, or a read state including the one read
+    void use(ID3D12Resource* resource, D3D12_RESOURCE_STATES state, bool write)
+    {
+        const Entry& e = this->resources.at(resource);
+        this->valid = this->valid && !e.splitting &&
+            (write ? e.state == state : (e.state & state) == state);
+        this->barriersPending = false;
+    }
+};
+
+// Applies each batch of barriers to the model as the GPU would
+struct ModelList : ID3D12GraphicsCommandList2
+{
+    StateModel* model;
+
+    void ResourceBarrier(UINT NumBarriers, const D3D12_RESOURCE_BARRIER* pBarriers) override
+    {
+        // Everything a pass needs comes in one call, and an empty batch is never recorded
+        this->model->valid = this->model->valid && NumBarriers > 0u &&
+            !this->model->barriersPending;
+        this->model->barriersPending = true;
+        this->model->batches++;
+        this->model->barriers += NumBarriers;
+        for (UINT i = 0u; i < NumBarriers; i++) {
+            this->model->apply(pBarriers[i]);
+        }
+    }
+};
+
+// Random frames over a set of resources whose states carry over from frame to frame through
+//  ResourceStates. Every barrier recorded must start from the state the resource is really in,
+//  every pass must find its resources in the states it declared, each pass's barriers must come
+//  in a single batch, and the committed states must match what the GPU was left with.
+static void testRandomFramesTrackStates()
+{
+    constexpr uint32_t nResources = 6u;
+    constexpr uint32_t nFrames = 500u;
+    const std::array writeStates = {
+        D3D12_RESOURCE_STATE_RENDER_TARGET,
+        D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+        D3D12_RESOURCE_STATE_DEPTH_WRITE,
+        D3D12_RESOURCE_STATE_COPY_DEST,
+    };
+    const std::array readStates = {
+        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+        D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
+        D3D12_RESOURCE_STATE_DEPTH_READ,
+        D3D12_RESOURCE_STATE_COPY_SOURCE,
+        D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT,
+    };
+
+    struct Access
+    {
+        ID3D12Resource* resource;
+        D3D12_RESOURCE_STATES state;
+        bool write;
+    };
+
+    std::array<ID3D12Resource, nResources> resources;
+    std::mt19937 rng(17u);
+    const auto pick = [&rng](const auto& states) { return states[rng() % states.size()]; };
+    ResourceStates states;
+    StateModel model;
+    for (ID3D12Resource& resource : resources) {
+        const D3D12_RESOURCE_STATES initial =
+            rng() % 2u == 0u ? pick(writeStates) : D3D12_RESOURCE_STATE_COMMON;
+        states.add(&resource, initial);
+        model.resources[&resource] = { initial };
+    }
+
+    uint64_t passesRecorded = 0u;
+    uint64_t culled = 0u;
+    uint64_t splits = 0u;
+    uint64_t lists = 0u;
+    for (uint32_t frame = 0u; frame < nFrames; frame++) {
+        RenderGraph graph;
+        std::array<RenderGraph::ResourceId, nResources> current;
+        for (uint32_t r = 0u; r < nResources; r++) {
+            current[r] = graph.importResource("resource", &resources[r], states);
+        }
+
+        // Each pass touches up to three different resources
+        std::deque<std::vector<Access>> accesses;
+        const uint32_t nPasses = 2u + rng() % 7u;
+        for (uint32_t p = 0u; p < nPasses; p++) {
+            std::vector<Access>& passAccesses = accesses.emplace_back();
+            RenderGraph::PassBuilder pass = graph.addPass(
+                "pass",
+                [&model, &passAccesses, &passesRecorded](const RenderGraph::Context& c) {
+                    for (const Access& a : passAccesses) {
+                        model.use(a.resource, a.state, a.write);
+                    }
+                    passesRecorded += c.part == 0u ? 1u : 0u;
+                }
+            );
+            const uint32_t first = rng() % nResources;
+            const uint32_t nAccesses = 1u + rng() % 3u;
+            for (uint32_t i = 0u; i < nAccesses; i++) {
+                const uint32_t r = (first + i) % nResources;
+                if (rng() % 2u == 0u) {
+                    const D3D12_RESOURCE_STATES state = pick(writeStates);
+                    current[r] = pass.write(current[r], state);
+                    passAccesses.push_back({ &resources[r], state, true });
+                } else {
+                    const D3D12_RESOURCE_STATES state = pick(readStates);
+                    pass.read(current[r], state);
+                    passAccesses.push_back({ &resources[r], state, false });
+                }
+            }
+            if (rng() % 4u == 0u) {
+                pass.parts(2u + rng() % 2u);
+            }
+            if (rng() % 6u == 0u) {
+                pass.sideEffects();
+            }
+        }
+        for (uint32_t r = 0u; r < nResources; r++) {
+            if (rng() % 3u != 0u) {
+                graph.exportResource(
+                    current[r], rng() % 2u == 0u ? D3D12_RESOURCE_STATE_PRESENT : pick(readStates)
+                );
+            }
+        }
+        graph.compile();
+
+        // Lists are executed in order, the model carrying the states from one to the next
+        for (uint32_t i = 0u; i < graph.listCount(); i++) {
+            ModelList list;
+            list.model = &model;
+            model.barriersPending = false;
+            graph.recordList(i, &list);
+        }
+        graph.commitStates(states);
+        for (ID3D12Resource& resource : resources) {
+            const StateModel::Entry& e = model.resources.at(&resource);
+            CHECK(!e.splitting);
+            CHECK(states.state(&resource) == e.state);
+        }
+
+        culled += graph.stats().culledPasses;
+        splits += graph.stats().splitBarriers;
+        lists += graph.stats().lists;
+    }
+
+    CHECK(model.valid);
+    // The frames did exercise culling, splits and several lists
+    CHECK(culled > 0u && splits > 0u && lists > nFrames);
+    CHECK(model.batches > 0u && model.barriers > model.batches);
+    CHECK(passesRecorded > nFrames);
+}
+
+int main()
+{
+    testOrderFollowsDependencies();
+    testCulling();
+    testBarriers();
+    testRecordLists();
+    testTransientsAlias();
+    testSplitPlacement();
+    testSplitsInRecordedFrame();
+    testErrors();
+    testRandomFramesTrackStates();
+    return checkResult();
+}
@@ -0,0 +1,231 @@
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "check.h"
+
+import residency_set;
+
+// Objects are plain ids
+using Set = ResidencySet<uint32_t>;
+
+// Runs updates and logs the batches they hand to the callbacks
+struct Batches
+{
+    std::vector<std::vector<uint32_t>> evicted;
+    std::vector<std::vector<uint32_t>> madeResident;
+    // 'e' or 'r' per callback, in call order
+    std::vector<char> order;
+
+    void update(Set& set, uint64_t budget)
+    {
+        set.update(
+            budget,
+            [this](std::span<const uint32_t> objects) {
+                this->madeResident.emplace_back(objects.begin(), objects.end());
+                this->order.push_back('r');
+            },
+            [this](std::span<const uint32_t> objects) {
+                this->evicted.emplace_back(objects.begin(), objects.end());
+                this->order.push_back('e');
+            }
+        );
+    }
+};
+
+static constexpr uint64_t noBudget = ~0ull;
+
+// Eviction goes least recently used first, a use moving an object to the back, and stops as
+//  soon as the rest fits
+static void testLruEvictionOrder()
+{
+    Set set(1u);
+    Batches batches;
+    const Set::Handle a = set.track(1u, 10u);
+    set.track(2u, 10u);
+    set.track(3u, 10u);
+    const Set::Handle d = set.track(4u, 10u);
+    batches.update(set, noBudget);
+
+    set.markUsed(a);
+    set.markUsed(d);
+    batches.update(set, noBudget);
+    CHECK(batches.evicted.empty());
+
+    // 2 and 3 were last used before 1 and 4, and 1 before 4
+    batches.update(set, 20u);
+    CHECK(batches.evicted.size() == 1u);
+    CHECK(batches.evicted[0] == std::vector<uint32_t>({ 2u, 3u }));
+    batches.update(set, 10u);
+    CHECK(batches.evicted.size() == 2u);
+    CHECK(batches.evicted[1] == std::vector<uint32_t>({ 1u }));
+    CHECK(set.stats().residentBytes == 10u && set.stats().evictedBytes == 30u);
+    CHECK(set.stats().evictBatches == 2u);
+    CHECK(batches.madeResident.empty());
+}
+
+// Objects used within the last minIdleFrames frames stay resident even over budget
+static void testMinIdleFramesProtection()
+{
+    constexpr uint32_t minIdleFrames = 3u;
+    Set set(minIdleFrames);
+    Batches batches;
+    const Set::Handle a = set.track(1u, 10u);
+    set.track(2u, 10u);
+
+    // Tracked in frame 0, so evictable from frame 3 on
+    for (uint32_t frame = 0u; frame < minIdleFrames; frame++) {
+        batches.update(set, 0u);
+    }
+    CHECK(batches.evicted.empty());
+    CHECK(set.stats().overBudgetUpdates == minIdleFrames);
+
+    // A use in frame 3 protects 1 until frame 6, 2 goes now
+    set.markUsed(a);
+    batches.update(set, 0u);
+    CHECK(batches.evicted.size() == 1u);
+    CHECK(batches.evicted[0] == std::vector<uint32_t>({ 2u }));
+    CHECK(set.stats().overBudgetUpdates == minIdleFrames + 1u);
+
+    batches.update(set, 0u);
+    batches.update(set, 0u);
+    CHECK(batches.evicted.size() == 1u);
+    batches.update(set, 0u);
+    CHECK(batches.evicted.size() == 2u);
+    CHECK(batches.evicted[1] == std::vector<uint32_t>({ 1u }));
+    CHECK(set.stats().residentBytes == 0u);
+}
+
+// Evicted objects used during a frame come back together in one batch, after room has been
+//  made for them
+static void testPendingMakeResidentBatched()
+{
+    Set set(1u);
+    Batches batches;
+    const Set::Handle a = set.track(1u, 10u);
+    const Set::Handle b = set.track(2u, 10u);
+    set.track(3u, 10u);
+    batches.update(set, noBudget);
+    batches.update(set, 10u);
+    CHECK(batches.evicted[0] == std::vector<uint32_t>({ 1u, 2u }));
+    const Set::Handle d = set.track(4u, 10u);
+
+    // Used twice, still listed once
+    set.markUsed(b);
+    set.markUsed(a);
+    set.markUsed(b);
+    CHECK(batches.madeResident.empty());
+    batches.update(set, 30u);
+
+    // 3 is the least recent and goes to make room for 1 and 2, 4 was tracked this frame
+    CHECK(batches.evicted.size() == 2u);
+    CHECK(batches.evicted[1] == std::vector<uint32_t>({ 3u }));
+    CHECK(batches.madeResident.size() == 1u);
+    CHECK(batches.madeResident[0] == std::vector<uint32_t>({ 2u, 1u }));
+    CHECK(batches.order == std::vector<char>({ 'e', 'e', 'r' }));
+    CHECK(set.stats().makeResidentBatches == 1u);
+    CHECK(set.stats().residentBytes == 30u && set.stats().evictedBytes == 10u);
+
+    // They came back as the most recently used, in batch order. Once 4 is used again they are
+    //  the oldest.
+    set.markUsed(d);
+    batches.update(set, noBudget);
+    batches.update(set, 10u);
+    CHECK(batches.evicted[2] == std::vector<uint32_t>({ 2u, 1u }));
+
+    // Nothing pending, nothing to make resident
+    batches.update(set, noBudget);
+    CHECK(batches.madeResident.size() == 1u);
+}
+
+// Untracking drops an object from every list and its bytes from the counters, whether it was
+//  resident, evicted or waiting to come back
+static void testUntrack()
+{
+    Set set(1u);
+    Batches batches;
+    const Set::Handle a = set.track(1u, 10u, 1u);
+    const Set::Handle b = set.track(2u, 20u, 1u);
+    const Set::Handle c = set.track(3u, 40u, 1u);
+    const Set::Handle d = set.track(4u, 80u, 1u);
+    batches.update(set, noBudget);
+    batches.update(set, 120u);
+    CHECK(batches.evicted[0] == std::vector<uint32_t>({ 1u, 2u }));
+
+    // Evicted
+    set.untrack(a);
+    CHECK(set.stats().evictedBytes == 20u);
+    CHECK(set.category(1u).evictedBytes == 20u);
+
+    // Evicted and pending: never made resident
+    set.markUsed(b);
+    set.untrack(b);
+    batches.update(set, noBudget);
+    CHECK(batches.madeResident.empty());
+    CHECK(set.stats().evictedBytes == 0u);
+
+    // Resident in the middle of the list: eviction skips it and carries on to the next
+    set.untrack(c);
+    CHECK(set.stats().residentBytes == 80u);
+    CHECK(set.category(1u).residentBytes == 80u);
+    batches.update(set, 0u);
+    CHECK(batches.evicted[1] == std::vector<uint32_t>({ 4u }));
+
+    // The most recently freed slot is reused, as a fresh resident object
+    const Set::Handle e = set.track(5u, 5u, 1u);
+    CHECK(e == c);
+    set.untrack(d);
+    CHECK(set.stats().residentBytes == 5u && set.stats().evictedBytes == 0u);
+    CHECK(set.category(1u).residentBytes == 5u && set.category(1u).evictedBytes == 0u);
+}
+
+// Counters are kept per category as well as overall
+static void testCategoryCounters()
+{
+    constexpr uint32_t textures = 1u;
+    constexpr uint32_t buffers = 2u;
+    Set set(1u);
+    Batches batches;
+    const Set::Handle t0 = set.track(1u, 100u, textures);
+    set.track(2u, 100u, textures);
+    const Set::Handle b0 = set.track(3u, 10u, buffers);
+    set.track(4u, 10u, buffers);
+    batches.update(set, noBudget);
+
+    // Evicts textures 1 and 2 and buffer 3
+    batches.update(set, 10u);
+    CHECK(set.category(textures).residentBytes == 0u);
+    CHECK(set.category(textures).evictedBytes == 200u);
+    CHECK(set.category(textures).evictions == 2u);
+    CHECK(set.category(buffers).residentBytes == 10u);
+    CHECK(set.category(buffers).evictedBytes == 10u);
+    CHECK(set.category(buffers).evictions == 1u);
+    CHECK(set.category(0u).evictions == 0u);
+
+    set.markUsed(t0);
+    set.markUsed(b0);
+    batches.update(set, noBudget);
+    CHECK(set.category(textures).madeResident == 1u);
+    CHECK(set.category(buffers).madeResident == 1u);
+    CHECK(set.category(textures).residentBytes == 100u);
+    CHECK(set.category(buffers).residentBytes == 20u);
+
+    // The categories add up to the totals
+    uint64_t resident = 0u;
+    uint64_t evicted = 0u;
+    for (uint32_t c = 0u; c < Set::maxCategories; c++) {
+        resident += set.category(c).residentBytes;
+        evicted += set.category(c).evictedBytes;
+    }
+    CHECK(resident == set.stats().residentBytes && resident == 120u);
+    CHECK(evicted == set.stats().evictedBytes && evicted == 100u);
+}
+
+int main()
+{
+    testLruEvictionOrder();
+    testMinIdleFramesProtection();
+    testPendingMakeResidentBatched();
+    testUntrack();
+    testCategoryCounters();
+    return checkResult();
+}
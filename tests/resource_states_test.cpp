@@ -0,0 +1,88 @@
+#include <d3d12.h>
+#include <thread>
+#include <vector>
+#include "check.h"
+
+import resource_states;
+
+static void testWholeResource()
+{
+    ResourceStates states;
+    ID3D12Resource buffer;
+    states.add(&buffer, D3D12_RESOURCE_STATE_COMMON);
+    CHECK(states.state(&buffer) == D3D12_RESOURCE_STATE_COMMON);
+    CHECK(states.state(&buffer, 0u) == D3D12_RESOURCE_STATE_COMMON);
+
+    states.setState(&buffer, D3D12_RESOURCE_STATE_COPY_DEST);
+    CHECK(states.state(&buffer) == D3D12_RESOURCE_STATE_COPY_DEST);
+
+    // Adding again starts over
+    states.add(&buffer, D3D12_RESOURCE_STATE_GENERIC_READ);
+    CHECK(states.state(&buffer) == D3D12_RESOURCE_STATE_GENERIC_READ);
+}
+
+static void testSubresources()
+{
+    ResourceStates states;
+    ID3D12Resource texture;
+    states.add(&texture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 4u);
+
+    states.setState(&texture, D3D12_RESOURCE_STATE_RENDER_TARGET, 2u);
+    CHECK(states.state(&texture, 1u) == D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    CHECK(states.state(&texture, 2u) == D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+    // Setting the whole resource brings every subresource into agreement again
+    states.setState(&texture, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    for (UINT i = 0u; i < 4u; i++) {
+        CHECK(states.state(&texture, i) == D3D12_RESOURCE_STATE_COPY_SOURCE);
+    }
+    CHECK(states.state(&texture) == D3D12_RESOURCE_STATE_COPY_SOURCE);
+}
+
+// Readers on several threads while one thread writes, for the thread sanitizer
+static void testConcurrentAccess()
+{
+    ResourceStates states;
+    std::vector<ID3D12Resource> resources(8u);
+    for (ID3D12Resource& r : resources) {
+        states.add(&r, D3D12_RESOURCE_STATE_COMMON);
+    }
+
+    std::vector<std::thread> readers;
+    bool valid[4] = {};
+    for (uint32_t t = 0u; t < 4u; t++) {
+        readers.emplace_back([&, t] {
+            bool ok = true;
+            for (uint32_t i = 0u; i < 10000u; i++) {
+                const D3D12_RESOURCE_STATES s = states.state(&resources[i % resources.size()]);
+                ok = ok && (s == D3D12_RESOURCE_STATE_COMMON ||
+                            s == D3D12_RESOURCE_STATE_RENDER_TARGET);
+            }
+            valid[t] = ok;
+        });
+    }
+    for (uint32_t i = 0u; i < 10000u; i++) {
+        states.setState(
+            &resources[i % resources.size()],
+            i % 2u ? D3D12_RESOURCE_STATE_COMMON : D3D12_RESOURCE_STATE_RENDER_TARGET
+        );
+    }
+    for (std::thread& t : readers) {
+        t.join();
+    }
+    for (const bool ok : valid) {
+        CHECK(ok);
+    }
+
+    states.remove(&resources[0]);
+    states.add(&resources[0], D3D12_RESOURCE_STATE_DEPTH_WRITE);
+    CHECK(states.state(&resources[0]) == D3D12_RESOURCE_STATE_DEPTH_WRITE);
+}
+
+int main()
+{
+    testWholeResource();
+    testSubresources();
+    testConcurrentAccess();
+    return checkResult();
+}
@@ -0,0 +1,232 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <vector>
+#include "check.h"
+
+import ring_allocator;
+
+static void testAlignment()
+{
+    RingAllocator ring(1024u);
+    CHECK(ring.allocate(10u, 1u) == 0u);
+    CHECK(ring.allocate(16u, 256u) == 256u);
+    CHECK(ring.usedBytes() == 272u);
+}
+
+// An allocation that doesn't fit before the end starts over at 0, giving up the rest
+static void testWrapAround()
+{
+    RingAllocator ring(1000u);
+    CHECK(ring.allocate(400u, 1u) == 0u);
+    ring.commit(1u);
+    CHECK(ring.allocate(400u, 1u) == 400u);
+    ring.commit(2u);
+    ring.retire(1u);
+    CHECK(ring.usedBytes() == 400u);
+
+    CHECK(ring.allocate(300u, 1u) == 0u);
+    CHECK(ring.stats().wastedBytes == 200u);
+    CHECK(ring.usedBytes() == 900u);
+    CHECK(ring.largestFreeBlock() == 100u);
+    ring.commit(3u);
+
+    // The skipped end belongs to the block that wrapped, and comes back with it rather than
+    //  with the block before the wrap
+    ring.retire(2u);
+    CHECK(ring.usedBytes() == 500u);
+    CHECK(ring.largestFreeBlock() == 500u);
+    CHECK(ring.allocate(501u, 1u) == RingAllocator::invalidOffset);
+    CHECK(ring.allocate(500u, 1u) == 300u);
+    ring.commit(4u);
+    ring.retire(3u);
+    CHECK(ring.usedBytes() == 500u);
+    // Free space is split into [800, 1000) and [0, 300)
+    CHECK(ring.largestFreeBlock() == 300u);
+}
+
+// Space comes back batch by batch as fences complete, in commit order
+static void testCommitRetire()
+{
+    RingAllocator ring(1000u);
+    ring.allocate(100u, 1u);
+    ring.allocate(100u, 1u);
+    ring.commit(5u);
+    ring.allocate(300u, 1u);
+    ring.commit(6u);
+    // Nothing new since the last commit, so no batch is added
+    ring.commit(7u);
+    CHECK(ring.usedBytes() == 500u);
+
+    ring.retire(4u);
+    CHECK(ring.usedBytes() == 500u);
+    ring.retire(5u);
+    CHECK(ring.usedBytes() == 300u);
+    ring.retire(7u);
+    CHECK(ring.usedBytes() == 0u);
+
+    // An empty ring starts over at the beginning
+    CHECK(ring.allocate(1000u, 1u) == 0u);
+}
+
+static void testFullRing()
+{
+    RingAllocator ring(1000u);
+    CHECK(ring.allocate(600u, 1u) == 0u);
+    CHECK(ring.allocate(400u, 1u) == 600u);
+    CHECK(ring.largestFreeBlock() == 0u);
+    CHECK(ring.allocate(1u, 1u) == RingAllocator::invalidOffset);
+    ring.commit(1u);
+    CHECK(ring.allocate(1u, 1u) == RingAllocator::invalidOffset);
+    CHECK(ring.stats().failures == 2u);
+
+    ring.retire(1u);
+    CHECK(ring.allocate(1000u, 1u) == 0u);
+    CHECK(ring.allocate(2000u, 1u) == RingAllocator::invalidOffset);
+    CHECK(ring.stats().peakUsedBytes == 1000u);
+}
+
+// With more fences pending than the batch array holds, the newest batch absorbs the next
+//  one and is only retired by the later fence
+static void testBatchOverflow()
+{
+    RingAllocator ring(1000u, 2u);
+    ring.allocate(100u, 1u);
+    ring.commit(1u);
+    ring.allocate(100u, 1u);
+    ring.commit(2u);
+    ring.allocate(100u, 1u);
+    ring.commit(3u);
+
+    ring.retire(1u);
+    CHECK(ring.usedBytes() == 200u);
+    ring.retire(2u);
+    CHECK(ring.usedBytes() == 200u);
+    ring.retire(3u);
+    CHECK(ring.usedBytes() == 0u);
+}
+
+// Frames allocate random blocks from a CPU backing store and fill them. The simulated GPU
+//  completes frames a few behind and checks each block still holds what was written, so any
+//  block handed out again before its fence completed would show up as corruption.
+static void testCpuBackedFrames()
+{
+    // Small enough that the ring regularly fills up and the CPU has to wait
+    constexpr size_t capacity = 48u * 1024u;
+    constexpr uint32_t framesInFlight = 3u;
+    constexpr uint32_t nFrames = 20000u;
+
+    struct Block
+    {
+        size_t offset;
+        size_t size;
+        uint8_t pattern;
+        uint64_t fenceValue;
+    };
+
+    std::vector<uint8_t> memory(capacity);
+    RingAllocator ring(capacity, 8u);
+    std::deque<Block> inFlight;
+    std::mt19937 rng(7u);
+    uint64_t completed = 0u;
+    uint64_t allocations = 0u;
+    uint64_t cpuWaits = 0u;
+    bool intact = true;
+
+    auto retire = [&](uint64_t value) {
+        completed = value;
+        while (!inFlight.empty() && inFlight.front().fenceValue <= completed) {
+            const Block& b = inFlight.front();
+            for (size_t i = 0u; i < b.size; i += 61u) {
+                intact = intact && memory[b.offset + i] == b.pattern;
+            }
+            inFlight.pop_front();
+        }
+        ring.retire(completed);
+    };
+
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    for (uint64_t frame = 1u; frame <= nFrames; frame++) {
+        if (frame > framesInFlight) {
+            retire(frame - framesInFlight);
+        }
+        // At most 16 blocks of under 2.3KB each, so a frame always fits on its own
+        const uint32_t nBlocks = 1u + static_cast<uint32_t>(rng() % 16u);
+        for (uint32_t i = 0u; i < nBlocks; i++) {
+            const size_t size = 16u + rng() % 2048u;
+            size_t offset = ring.allocate(size, 256u);
+            while (offset == RingAllocator::invalidOffset && completed + 1u < frame) {
+                // Out of space: the CPU waits on the oldest frame still in flight
+                retire(completed + 1u);
+                cpuWaits++;
+                offset = ring.allocate(size, 256u);
+            }
+            CHECK(offset != RingAllocator::invalidOffset);
+            if (offset == RingAllocator::invalidOffset) {
+                continue;
+            }
+            const uint8_t pattern = static_cast<uint8_t>(rng());
+            std::memset(memory.data() + offset, pattern, size);
+            inFlight.push_back({ offset, size, pattern, frame });
+            allocations++;
+        }
+        ring.commit(frame);
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - t0;
+
+    CHECK(intact);
+    CHECK(cpuWaits > 0u);
+    CHECK(ring.usedBytes() <= capacity);
+    retire(nFrames);
+    CHECK(ring.usedBytes() == 0u);
+    std::printf(
+        "%llu allocations over %u frames: %.2f M allocations/s (including writes), "
+        "peak %zu of %zu bytes, %llu waits for space\n",
+        static_cast<unsigned long long>(allocations), nFrames,
+        allocations / elapsed.count() / 1e6, ring.stats().peakUsedBytes, capacity,
+        static_cast<unsigned long long>(cpuWaits)
+    );
+}
+
+// Allocation alone, without touching the memory
+static void testAllocationRate()
+{
+    constexpr uint32_t nFrames = 100000u;
+    constexpr uint32_t perFrame = 64u;
+    RingAllocator ring(64u * 1024u * 1024u);
+
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    size_t checksum = 0u;
+    for (uint64_t frame = 1u; frame <= nFrames; frame++) {
+        if (frame > 2u) {
+            ring.retire(frame - 2u);
+        }
+        for (uint32_t i = 0u; i < perFrame; i++) {
+            checksum += ring.allocate(256u, 256u);
+        }
+        ring.commit(frame);
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - t0;
+
+    CHECK(ring.stats().failures == 0u);
+    CHECK(checksum != 0u);
+    std::printf(
+        "%.2f M allocations/s\n", static_cast<double>(nFrames) * perFrame / elapsed.count() / 1e6
+    );
+}
+
+int main()
+{
+    testAlignment();
+    testWrapAround();
+    testCommitRetire();
+    testFullRing();
+    testBatchOverflow();
+    testCpuBackedFrames();
+    testAllocationRate();
+    return checkResult();
+}
@@ -0,0 +1,212 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include "check.h"
+
+import fence_watcher;
+import scheduler;
+
+// A fence the test signals by hand, waking the watcher like an event would
+class SimulatedFence : public WatchedFence
+{
+   public:
+    void signal(uint64_t value)
+    {
+        {
+            std::scoped_lock lock(this->mutex);
+            this->completed = value;
+            this->signaled = true;
+        }
+        this->cv.notify_all();
+    }
+
+    uint64_t completedValue() const override
+    {
+        std::scoped_lock lock(this->mutex);
+        return this->completed;
+    }
+
+    void armEvent(uint64_t value) override
+    {
+        this->armed.fetch_add(1u);
+        {
+            std::scoped_lock lock(this->mutex);
+            if (this->completed < value) {
+                return;
+            }
+            this->signaled = true;
+        }
+        this->cv.notify_all();
+    }
+
+    void waitForSignal() override
+    {
+        std::unique_lock lock(this->mutex);
+        this->cv.wait(lock, [this]() { return this->signaled; });
+        this->signaled = false;
+    }
+
+    void wake() override { this->signal(this->completedValue()); }
+
+    // Times a waiter registered with the watcher
+    std::atomic<uint32_t> armed = 0u;
+
+   private:
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+    uint64_t completed = 0u;
+    bool signaled = false;
+};
+
+static Task count(Scheduler& scheduler, std::atomic<uint32_t>& n)
+{
+    co_await scheduler.schedule();
+    n.fetch_add(1u);
+}
+
+static void testSpawnAndWaitIdle()
+{
+    Scheduler scheduler(4u);
+    std::atomic<uint32_t> n = 0u;
+    for (uint32_t i = 0u; i < 100u; i++) {
+        scheduler.spawn(count(scheduler, n));
+    }
+    scheduler.waitIdle();
+    CHECK(n.load() == 100u);
+}
+
+// Waits for a fence value from a worker thread, noting which thread it ran on before and after
+static Task awaitFence(
+    Scheduler& scheduler,
+    FenceWatcher& watcher,
+    uint64_t value,
+    std::thread::id& before,
+    std::thread::id& after,
+    std::atomic<bool>& done
+)
+{
+    co_await scheduler.schedule();
+    before = std::this_thread::get_id();
+    co_await FenceAwaiter{ &watcher, value, &scheduler };
+    after = std::this_thread::get_id();
+    done.store(true);
+}
+
+// The coroutine stays suspended until its value is reached, and is resumed through the
+//  scheduler's post() rather than on the watcher's thread: with a single worker, it resumes on
+//  the thread it suspended on
+static void testAwaitSimulatedFence()
+{
+    Scheduler scheduler(1u);
+    auto fence = std::make_unique<SimulatedFence>();
+    SimulatedFence& sim = *fence;
+    FenceWatcher watcher(std::move(fence));
+
+    std::thread::id before;
+    std::thread::id after;
+    std::atomic<bool> done = false;
+    scheduler.spawn(awaitFence(scheduler, watcher, 5u, before, after, done));
+
+    sim.signal(4u);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(!done.load());
+
+    sim.signal(5u);
+    scheduler.waitIdle();
+    CHECK(done.load());
+    CHECK(before == after);
+    CHECK(after != std::this_thread::get_id());
+}
+
+// Awaiting a value that's already been reached doesn't suspend
+static void testAwaitCompletedFence()
+{
+    Scheduler scheduler(1u);
+    auto fence = std::make_unique<SimulatedFence>();
+    fence->signal(10u);
+    FenceWatcher watcher(std::move(fence));
+
+    std::thread::id before;
+    std::thread::id after;
+    std::atomic<bool> done = false;
+    scheduler.spawn(awaitFence(scheduler, watcher, 7u, before, after, done));
+    scheduler.waitIdle();
+    CHECK(done.load());
+}
+
+static Task fail(Scheduler& scheduler)
+{
+    co_await scheduler.schedule();
+    throw std::runtime_error("task failed");
+}
+
+static Task catchFailure(Scheduler& scheduler, std::atomic<bool>& caught)
+{
+    try {
+        co_await fail(scheduler);
+    } catch (const std::runtime_error&) {
+        caught.store(true);
+    }
+}
+
+// An exception leaves an awaited task through the await, and a spawned task that throws is
+//  logged and still counted as done
+static void testExceptionPropagation()
+{
+    Scheduler scheduler(2u);
+    std::atomic<bool> caught = false;
+    scheduler.spawn(catchFailure(scheduler, caught));
+    scheduler.spawn(fail(scheduler));
+    scheduler.waitIdle();
+    CHECK(caught.load());
+}
+
+static Task awaitUnreached(
+    Scheduler& scheduler,
+    FenceWatcher& watcher,
+    std::atomic<bool>& cancelled
+)
+{
+    co_await scheduler.schedule();
+    try {
+        co_await FenceAwaiter{ &watcher, 100u, &scheduler };
+    } catch (const std::exception&) {
+        cancelled.store(true);
+    }
+}
+
+// Destroying the watcher resumes a waiter whose value will never be reached, and its await
+//  throws so the coroutine unwinds instead of leaking
+static void testDestructorCancelsWaiters()
+{
+    Scheduler scheduler(1u);
+    std::atomic<bool> cancelled = false;
+    {
+        auto fence = std::make_unique<SimulatedFence>();
+        SimulatedFence& sim = *fence;
+        FenceWatcher watcher(std::move(fence));
+        scheduler.spawn(awaitUnreached(scheduler, watcher, cancelled));
+        // Registered once the watcher has armed the fence for it
+        while (sim.armed.load() == 0u) {
+            std::this_thread::yield();
+        }
+        CHECK(!cancelled.load());
+    }
+    scheduler.waitIdle();
+    CHECK(cancelled.load());
+}
+
+int main()
+{
+    testSpawnAndWaitIdle();
+    testAwaitSimulatedFence();
+    testAwaitCompletedFence();
+    testExceptionPropagation();
+    testDestructorCancelsWaiters();
+    return checkResult();
+}
@@ -0,0 +1,130 @@
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "check.h"
+
+import slot_map;
+
+using Map = SlotMap<int, std::string>;
+
+static void testInsertAndGet()
+{
+    Map map;
+    CHECK(!map.contains({}));
+    const Map::Handle a = map.insert(1, "one");
+    const Map::Handle b = map.insert(2, "two");
+    CHECK(a && b && a != b);
+    CHECK(map.size() == 2u);
+    CHECK(*map.get<0>(a) == 1 && *map.get<1>(a) == "one");
+    CHECK(*map.get<1>(b) == "two");
+
+    // Columns are dense and in the same order
+    CHECK(map.column<0>().size() == 2u);
+    for (uint32_t i = 0u; i < map.size(); i++) {
+        CHECK(*map.get<0>(map.handleAt(i)) == map.column<0>()[i]);
+    }
+}
+
+static void testEraseMakesHandlesStale()
+{
+    Map map;
+    const Map::Handle a = map.insert(1, "one");
+    const Map::Handle b = map.insert(2, "two");
+    const Map::Handle c = map.insert(3, "three");
+
+    CHECK(map.erase(a));
+    CHECK(!map.erase(a));
+    CHECK(!map.contains(a));
+    CHECK(map.get<0>(a) == nullptr);
+    // The last object moved into the hole, the others' handles still reach them
+    CHECK(map.size() == 2u);
+    CHECK(*map.get<1>(b) == "two");
+    CHECK(*map.get<1>(c) == "three");
+    CHECK(map.column<0>()[0] == 3);
+
+    // The slot comes back with a new generation, the old handle stays stale
+    const Map::Handle d = map.insert(4, "four");
+    CHECK(d.index() == a.index());
+    CHECK(d.generation() != a.generation());
+    CHECK(map.get<0>(a) == nullptr);
+    CHECK(*map.get<0>(d) == 4);
+}
+
+static void testOldestSlotReusedFirst()
+{
+    Map map;
+    std::vector<Map::Handle> handles;
+    for (int i = 0; i < 4; i++) {
+        handles.push_back(map.insert(i, {}));
+    }
+    map.erase(handles[2]);
+    map.erase(handles[0]);
+    map.erase(handles[3]);
+    CHECK(map.insert(10, {}).index() == handles[2].index());
+    CHECK(map.insert(11, {}).index() == handles[0].index());
+    CHECK(map.insert(12, {}).index() == handles[3].index());
+    CHECK(map.insert(13, {}).index() == 4u);
+}
+
+static void testGenerationWraps()
+{
+    Map map;
+    const Map::Handle first = map.insert(0, {});
+    Map::Handle h = first;
+    for (uint32_t i = 0u; i < Map::maxGeneration; i++) {
+        map.erase(h);
+        h = map.insert(0, {});
+        CHECK(h.generation() != 0u);
+        CHECK(h.value != 0u);
+    }
+    // Wrapped all the way around, skipping generation 0
+    CHECK(h == first);
+}
+
+// Random inserts and erases checked against a map from handle to value
+static void testRandomAgainstReference()
+{
+    SlotMap<uint32_t> map;
+    std::map<uint32_t, uint32_t> reference;
+    std::vector<SlotMap<uint32_t>::Handle> stale;
+    std::mt19937 rng(9u);
+    bool mismatch = false;
+
+    for (uint32_t step = 0u; step < 20000u; step++) {
+        if (reference.empty() || rng() % 2u == 0u) {
+            const uint32_t value = rng();
+            reference[map.insert(value).value] = value;
+        } else {
+            auto it = reference.begin();
+            std::advance(it, rng() % reference.size());
+            const SlotMap<uint32_t>::Handle handle = { it->first };
+            mismatch = mismatch || !map.erase(handle);
+            stale.push_back(handle);
+            reference.erase(it);
+        }
+    }
+
+    CHECK(map.size() == reference.size());
+    for (const auto& [value, expected] : reference) {
+        const uint32_t* found = map.get<0>({ value });
+        mismatch = mismatch || !found || *found != expected;
+    }
+    for (const SlotMap<uint32_t>::Handle handle : stale) {
+        // A stale handle may only match if its slot wrapped around to the same generation
+        mismatch = mismatch || (map.contains(handle) && !reference.contains(handle.value));
+    }
+    CHECK(!mismatch);
+}
+
+int main()
+{
+    testInsertAndGet();
+    testEraseMakesHandlesStale();
+    testOldestSlotReusedFirst();
+    testGenerationWraps();
+    testRandomAgainstReference();
+    return checkResult();
+}
@@ -0,0 +1,530 @@
+#pragma once
+
+// Just enough of the D3D12 headers for the device-independent modules to build off Windows.
+//  Values match the Windows SDK. Interfaces are structs the tests create directly, with virtual
+//  methods where a test overrides them to record the calls.
+
+#include <cstddef>
+#include <cstdint>
+
+typedef unsigned int UINT;
+typedef int BOOL;
+typedef int INT;
+typedef float FLOAT;
+typedef unsigned char BYTE;
+typedef uint8_t UINT8;
+typedef size_t SIZE_T;
+typedef const char* LPCSTR;
+typedef uint64_t UINT64;
+#define TRUE 1
+#define FALSE 0
+#define STDMETHODCALLTYPE
+
+#define D3D12_DEFINE_FLAG_OPERATORS(T)                                                       \
+    constexpr T operator|(T a, T b) { return T(static_cast<int>(a) | static_cast<int>(b)); } \
+    constexpr T operator&(T a, T b) { return T(static_cast<int>(a) & static_cast<int>(b)); } \
+    constexpr T operator~(T a) { return T(~static_cast<int>(a)); }                           \
+    constexpr T& operator|=(T& a, T b) { return a = a | b; }                                 \
+    constexpr T& operator&=(T& a, T b) { return a = a & b; }
+
+struct ID3D12Resource
+{
+};
+
+struct ID3D12RootSignature
+{
+};
+
+enum D3D12_RESOURCE_STATES
+{
+    D3D12_RESOURCE_STATE_COMMON = 0,
+    D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER = 0x1,
+    D3D12_RESOURCE_STATE_INDEX_BUFFER = 0x2,
+    D3D12_RESOURCE_STATE_RENDER_TARGET = 0x4,
+    D3D12_RESOURCE_STATE_UNORDERED_ACCESS = 0x8,
+    D3D12_RESOURCE_STATE_DEPTH_WRITE = 0x10,
+    D3D12_RESOURCE_STATE_DEPTH_READ = 0x20,
+    D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE = 0x40,
+    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE = 0x80,
+    D3D12_RESOURCE_STATE_STREAM_OUT = 0x100,
+    D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT = 0x200,
+    D3D12_RESOURCE_STATE_COPY_DEST = 0x400,
+    D3D12_RESOURCE_STATE_COPY_SOURCE = 0x800,
+    D3D12_RESOURCE_STATE_RESOLVE_DEST = 0x1000,
+    D3D12_RESOURCE_STATE_RESOLVE_SOURCE = 0x2000,
+    D3D12_RESOURCE_STATE_GENERIC_READ = 0xac3,
+    D3D12_RESOURCE_STATE_PRESENT = 0,
+};
+D3D12_DEFINE_FLAG_OPERATORS(D3D12_RESOURCE_STATES)
+
+#define D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES 0xffffffff
+
+enum D3D12_RESOURCE_BARRIER_TYPE
+{
+    D3D12_RESOURCE_BARRIER_TYPE_TRANSITION = 0,
+    D3D12_RESOURCE_BARRIER_TYPE_ALIASING = 1,
+    D3D12_RESOURCE_BARRIER_TYPE_UAV = 2,
+};
+
+enum D3D12_RESOURCE_BARRIER_FLAGS
+{
+    D3D12_RESOURCE_BARRIER_FLAG_NONE = 0,
+    D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY = 0x1,
+    D3D12_RESOURCE_BARRIER_FLAG_END_ONLY = 0x2,
+};
+D3D12_DEFINE_FLAG_OPERATORS(D3D12_RESOURCE_BARRIER_FLAGS)
+
+struct D3D12_RESOURCE_TRANSITION_BARRIER
+{
+    ID3D12Resource* pResource;
+    UINT Subresource;
+    D3D12_RESOURCE_STATES StateBefore;
+    D3D12_RESOURCE_STATES StateAfter;
+};
+
+struct D3D12_RESOURCE_ALIASING_BARRIER
+{
+    ID3D12Resource* pResourceBefore;
+    ID3D12Resource* pResourceAfter;
+};
+
+struct D3D12_RESOURCE_UAV_BARRIER
+{
+    ID3D12Resource* pResource;
+};
+
+struct D3D12_RESOURCE_BARRIER
+{
+    D3D12_RESOURCE_BARRIER_TYPE Type;
+    D3D12_RESOURCE_BARRIER_FLAGS Flags;
+    union {
+        D3D12_RESOURCE_TRANSITION_BARRIER Transition;
+        D3D12_RESOURCE_ALIASING_BARRIER Aliasing;
+        D3D12_RESOURCE_UAV_BARRIER UAV;
+    };
+};
+
+// Descriptors
+
+enum D3D12_DESCRIPTOR_HEAP_TYPE
+{
+    D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV = 0,
+    D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER = 1,
+    D3D12_DESCRIPTOR_HEAP_TYPE_RTV = 2,
+    D3D12_DESCRIPTOR_HEAP_TYPE_DSV = 3,
+};
+
+struct D3D12_CPU_DESCRIPTOR_HANDLE
+{
+    SIZE_T ptr;
+};
+
+struct D3D12_GPU_DESCRIPTOR_HANDLE
+{
+    UINT64 ptr;
+};
+
+enum D3D12_DESCRIPTOR_RANGE_TYPE
+{
+    D3D12_DESCRIPTOR_RANGE_TYPE_SRV = 0,
+    D3D12_DESCRIPTOR_RANGE_TYPE_UAV = 1,
+    D3D12_DESCRIPTOR_RANGE_TYPE_CBV = 2,
+    D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER = 3,
+};
+
+enum D3D12_DESCRIPTOR_RANGE_FLAGS
+{
+    D3D12_DESCRIPTOR_RANGE_FLAG_NONE = 0,
+};
+
+#define D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND 0xffffffff
+
+struct D3D12_DESCRIPTOR_RANGE1
+{
+    D3D12_DESCRIPTOR_RANGE_TYPE RangeType;
+    UINT NumDescriptors;
+    UINT BaseShaderRegister;
+    UINT RegisterSpace;
+    D3D12_DESCRIPTOR_RANGE_FLAGS Flags;
+    UINT OffsetInDescriptorsFromTableStart;
+};
+
+struct D3D12_ROOT_DESCRIPTOR_TABLE1
+{
+    UINT NumDescriptorRanges;
+    const D3D12_DESCRIPTOR_RANGE1* pDescriptorRanges;
+};
+
+struct D3D12_ROOT_CONSTANTS
+{
+    UINT ShaderRegister;
+    UINT RegisterSpace;
+    UINT Num32BitValues;
+};
+
+enum D3D12_ROOT_DESCRIPTOR_FLAGS
+{
+    D3D12_ROOT_DESCRIPTOR_FLAG_NONE = 0,
+};
+
+struct D3D12_ROOT_DESCRIPTOR1
+{
+    UINT ShaderRegister;
+    UINT RegisterSpace;
+    D3D12_ROOT_DESCRIPTOR_FLAGS Flags;
+};
+
+enum D3D12_ROOT_PARAMETER_TYPE
+{
+    D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE = 0,
+    D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS = 1,
+    D3D12_ROOT_PARAMETER_TYPE_CBV = 2,
+    D3D12_ROOT_PARAMETER_TYPE_SRV = 3,
+    D3D12_ROOT_PARAMETER_TYPE_UAV = 4,
+};
+
+enum D3D12_SHADER_VISIBILITY
+{
+    D3D12_SHADER_VISIBILITY_ALL = 0,
+    D3D12_SHADER_VISIBILITY_VERTEX = 1,
+    D3D12_SHADER_VISIBILITY_PIXEL = 5,
+};
+
+struct D3D12_ROOT_PARAMETER1
+{
+    D3D12_ROOT_PARAMETER_TYPE ParameterType;
+    union {
+        D3D12_ROOT_DESCRIPTOR_TABLE1 DescriptorTable;
+        D3D12_ROOT_CONSTANTS Constants;
+        D3D12_ROOT_DESCRIPTOR1 Descriptor;
+    };
+    D3D12_SHADER_VISIBILITY ShaderVisibility;
+};
+
+struct D3D12_STATIC_SAMPLER_DESC;
+
+enum D3D12_ROOT_SIGNATURE_FLAGS
+{
+    D3D12_ROOT_SIGNATURE_FLAG_NONE = 0,
+};
+
+struct D3D12_ROOT_SIGNATURE_DESC1
+{
+    UINT NumParameters;
+    const D3D12_ROOT_PARAMETER1* pParameters;
+    UINT NumStaticSamplers;
+    const D3D12_STATIC_SAMPLER_DESC* pStaticSamplers;
+    D3D12_ROOT_SIGNATURE_FLAGS Flags;
+};
+
+struct ID3D12Device
+{
+    virtual ~ID3D12Device() = default;
+    virtual UINT GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE) { return 0u; }
+    virtual void CopyDescriptors(
+        UINT,
+        const D3D12_CPU_DESCRIPTOR_HANDLE*,
+        const UINT*,
+        UINT,
+        const D3D12_CPU_DESCRIPTOR_HANDLE*,
+        const UINT*,
+        D3D12_DESCRIPTOR_HEAP_TYPE
+    )
+    {
+    }
+};
+
+// Command lists
+
+struct ID3D12GraphicsCommandList
+{
+    virtual ~ID3D12GraphicsCommandList() = default;
+    virtual void ResourceBarrier(UINT, const D3D12_RESOURCE_BARRIER*) {}
+    virtual void SetComputeRootDescriptorTable(UINT, D3D12_GPU_DESCRIPTOR_HANDLE) {}
+    virtual void SetGraphicsRootDescriptorTable(UINT, D3D12_GPU_DESCRIPTOR_HANDLE) {}
+};
+
+struct ID3D12GraphicsCommandList2 : ID3D12GraphicsCommandList
+{
+};
+
+// Pipeline state streams
+
+enum DXGI_FORMAT
+{
+    DXGI_FORMAT_UNKNOWN = 0,
+    DXGI_FORMAT_R32G32B32A32_FLOAT = 2,
+    DXGI_FORMAT_R32G32B32_FLOAT = 6,
+    DXGI_FORMAT_R8G8B8A8_UNORM = 28,
+    DXGI_FORMAT_D32_FLOAT = 40,
+};
+
+struct DXGI_SAMPLE_DESC
+{
+    UINT Count;
+    UINT Quality;
+};
+
+enum D3D12_PIPELINE_STATE_SUBOBJECT_TYPE
+{
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE = 0,
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VS = 1,
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PS = 2,
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DS = 3,
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_HS = 4,
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_GS = 5,
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_CS = 6,
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_STREAM_OUTPUT = 7,
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_BLEND = 8,
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_SAMPLE_MASK = 9,
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RASTERIZER = 10,
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL = 11,
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_INPUT_LAYOUT = 12,
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_IB_STRIP_CUT_VALUE = 13,
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PRIMITIVE_TOPOLOGY = 14,
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RENDER_TARGET_FORMATS = 15,
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL_FORMAT = 16,
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_SAMPLE_DESC = 17,
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_NODE_MASK = 18,
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_CACHED_PSO = 19,
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_FLAGS = 20,
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL1 = 21,
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VIEW_INSTANCING = 22,
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_AS = 24,
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_MS = 25,
+    D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL2 = 26,
+};
+
+struct D3D12_PIPELINE_STATE_STREAM_DESC
+{
+    SIZE_T SizeInBytes;
+    void* pPipelineStateSubobjectStream;
+};
+
+struct D3D12_SHADER_BYTECODE
+{
+    const void* pShaderBytecode;
+    SIZE_T BytecodeLength;
+};
+
+struct D3D12_SO_DECLARATION_ENTRY
+{
+    UINT Stream;
+    LPCSTR SemanticName;
+    UINT SemanticIndex;
+    BYTE StartComponent;
+    BYTE ComponentCount;
+    BYTE OutputSlot;
+};
+
+struct D3D12_STREAM_OUTPUT_DESC
+{
+    const D3D12_SO_DECLARATION_ENTRY* pSODeclaration;
+    UINT NumEntries;
+    const UINT* pBufferStrides;
+    UINT NumStrides;
+    UINT RasterizedStream;
+};
+
+enum D3D12_BLEND
+{
+    D3D12_BLEND_ZERO = 1,
+    D3D12_BLEND_ONE = 2,
+    D3D12_BLEND_SRC_ALPHA = 5,
+    D3D12_BLEND_INV_SRC_ALPHA = 6,
+};
+
+enum D3D12_BLEND_OP
+{
+    D3D12_BLEND_OP_ADD = 1,
+};
+
+enum D3D12_LOGIC_OP
+{
+    D3D12_LOGIC_OP_NOOP = 4,
+};
+
+struct D3D12_RENDER_TARGET_BLEND_DESC
+{
+    BOOL BlendEnable;
+    BOOL LogicOpEnable;
+    D3D12_BLEND SrcBlend;
+    D3D12_BLEND DestBlend;
+    D3D12_BLEND_OP BlendOp;
+    D3D12_BLEND SrcBlendAlpha;
+    D3D12_BLEND DestBlendAlpha;
+    D3D12_BLEND_OP BlendOpAlpha;
+    D3D12_LOGIC_OP LogicOp;
+    UINT8 RenderTargetWriteMask;
+};
+
+struct D3D12_BLEND_DESC
+{
+    BOOL AlphaToCoverageEnable;
+    BOOL IndependentBlendEnable;
+    D3D12_RENDER_TARGET_BLEND_DESC RenderTarget[8];
+};
+
+enum D3D12_FILL_MODE
+{
+    D3D12_FILL_MODE_WIREFRAME = 2,
+    D3D12_FILL_MODE_SOLID = 3,
+};
+
+enum D3D12_CULL_MODE
+{
+    D3D12_CULL_MODE_NONE = 1,
+    D3D12_CULL_MODE_FRONT = 2,
+    D3D12_CULL_MODE_BACK = 3,
+};
+
+enum D3D12_CONSERVATIVE_RASTERIZATION_MODE
+{
+    D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF = 0,
+    D3D12_CONSERVATIVE_RASTERIZATION_MODE_ON = 1,
+};
+
+struct D3D12_RASTERIZER_DESC
+{
+    D3D12_FILL_MODE FillMode;
+    D3D12_CULL_MODE CullMode;
+    BOOL FrontCounterClockwise;
+    INT DepthBias;
+    FLOAT DepthBiasClamp;
+    FLOAT SlopeScaledDepthBias;
+    BOOL DepthClipEnable;
+    BOOL MultisampleEnable;
+    BOOL AntialiasedLineEnable;
+    UINT ForcedSampleCount;
+    D3D12_CONSERVATIVE_RASTERIZATION_MODE ConservativeRaster;
+};
+
+enum D3D12_COMPARISON_FUNC
+{
+    D3D12_COMPARISON_FUNC_NEVER = 1,
+    D3D12_COMPARISON_FUNC_LESS = 2,
+    D3D12_COMPARISON_FUNC_LESS_EQUAL = 4,
+    D3D12_COMPARISON_FUNC_ALWAYS = 8,
+};
+
+enum D3D12_DEPTH_WRITE_MASK
+{
+    D3D12_DEPTH_WRITE_MASK_ZERO = 0,
+    D3D12_DEPTH_WRITE_MASK_ALL = 1,
+};
+
+enum D3D12_STENCIL_OP
+{
+    D3D12_STENCIL_OP_KEEP = 1,
+    D3D12_STENCIL_OP_ZERO = 2,
+    D3D12_STENCIL_OP_REPLACE = 3,
+};
+
+struct D3D12_DEPTH_STENCILOP_DESC
+{
+    D3D12_STENCIL_OP StencilFailOp;
+    D3D12_STENCIL_OP StencilDepthFailOp;
+    D3D12_STENCIL_OP StencilPassOp;
+    D3D12_COMPARISON_FUNC StencilFunc;
+};
+
+struct D3D12_DEPTH_STENCIL_DESC
+{
+    BOOL DepthEnable;
+    D3D12_DEPTH_WRITE_MASK DepthWriteMask;
+    D3D12_COMPARISON_FUNC DepthFunc;
+    BOOL StencilEnable;
+    UINT8 StencilReadMask;
+    UINT8 StencilWriteMask;
+    D3D12_DEPTH_STENCILOP_DESC FrontFace;
+    D3D12_DEPTH_STENCILOP_DESC BackFace;
+};
+
+struct D3D12_DEPTH_STENCIL_DESC1
+{
+    BOOL DepthEnable;
+    D3D12_DEPTH_WRITE_MASK DepthWriteMask;
+    D3D12_COMPARISON_FUNC DepthFunc;
+    BOOL StencilEnable;
+    UINT8 StencilReadMask;
+    UINT8 StencilWriteMask;
+    D3D12_DEPTH_STENCILOP_DESC FrontFace;
+    D3D12_DEPTH_STENCILOP_DESC BackFace;
+    BOOL DepthBoundsTestEnable;
+};
+
+enum D3D12_INPUT_CLASSIFICATION
+{
+    D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA = 0,
+    D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA = 1,
+};
+
+struct D3D12_INPUT_ELEMENT_DESC
+{
+    LPCSTR SemanticName;
+    UINT SemanticIndex;
+    DXGI_FORMAT Format;
+    UINT InputSlot;
+    UINT AlignedByteOffset;
+    D3D12_INPUT_CLASSIFICATION InputSlotClass;
+    UINT InstanceDataStepRate;
+};
+
+struct D3D12_INPUT_LAYOUT_DESC
+{
+    const D3D12_INPUT_ELEMENT_DESC* pInputElementDescs;
+    UINT NumElements;
+};
+
+enum D3D12_INDEX_BUFFER_STRIP_CUT_VALUE
+{
+    D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_DISABLED = 0,
+    D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_0xFFFF = 1,
+    D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_0xFFFFFFFF = 2,
+};
+
+enum D3D12_PRIMITIVE_TOPOLOGY_TYPE
+{
+    D3D12_PRIMITIVE_TOPOLOGY_TYPE_UNDEFINED = 0,
+    D3D12_PRIMITIVE_TOPOLOGY_TYPE_POINT = 1,
+    D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE = 2,
+    D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE = 3,
+    D3D12_PRIMITIVE_TOPOLOGY_TYPE_PATCH = 4,
+};
+
+struct D3D12_RT_FORMAT_ARRAY
+{
+    DXGI_FORMAT RTFormats[8];
+    UINT NumRenderTargets;
+};
+
+struct D3D12_CACHED_PIPELINE_STATE
+{
+    const void* pCachedBlob;
+    SIZE_T CachedBlobSizeInBytes;
+};
+
+enum D3D12_PIPELINE_STATE_FLAGS
+{
+    D3D12_PIPELINE_STATE_FLAG_NONE = 0,
+    D3D12_PIPELINE_STATE_FLAG_TOOL_DEBUG = 0x1,
+};
+
+struct D3D12_VIEW_INSTANCE_LOCATION
+{
+    UINT ViewportArrayIndex;
+    UINT RenderTargetArrayIndex;
+};
+
+enum D3D12_VIEW_INSTANCING_FLAGS
+{
+    D3D12_VIEW_INSTANCING_FLAG_NONE = 0,
+    D3D12_VIEW_INSTANCING_FLAG_ENABLE_VIEW_INSTANCE_MASKING = 0x1,
+};
+
+struct D3D12_VIEW_INSTANCING_DESC
+{
+    UINT ViewInstanceCount;
+    const D3D12_VIEW_INSTANCE_LOCATION* pViewInstanceLocations;
+    D3D12_VIEW_INSTANCING_FLAGS Flags;
+};
@@ -0,0 +1,105 @@
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "check.h"
+
+import task_pool;
+
+static bool covers(const std::pmr::vector<IndexRange>& ranges, uint32_t total)
+{
+    uint32_t next = 0u;
+    for (const IndexRange& range : ranges) {
+        if (range.first != next || range.count == 0u) {
+            return false;
+        }
+        next += range.count;
+    }
+    return next == total;
+}
+
+static void testSplitRange()
+{
+    CHECK(splitRange(0u, 4u).empty());
+    CHECK(splitRange(0u, 4u, 3u).empty());
+
+    // Whole triangles: every slice but the last a multiple of 3
+    const std::pmr::vector<IndexRange> triangles = splitRange(30u, 4u, 3u);
+    CHECK(triangles.size() == 4u);
+    CHECK(covers(triangles, 30u));
+    for (const IndexRange& range : triangles) {
+        CHECK(range.count % 3u == 0u);
+    }
+    // Ten granules over four parts, the first two parts taking the extra ones
+    CHECK(triangles[0].count == 9u && triangles[1].count == 9u);
+    CHECK(triangles[2].count == 6u && triangles[3].count == 6u);
+
+    // A partial granule at the end stays in the last slice
+    const std::pmr::vector<IndexRange> partial = splitRange(10u, 2u, 3u);
+    CHECK(covers(partial, 10u));
+    CHECK(partial[0].count == 6u && partial[1].count == 4u);
+
+    // More parts than granules: one slice per granule
+    const std::pmr::vector<IndexRange> few = splitRange(6u, 8u, 3u);
+    CHECK(few.size() == 2u);
+    CHECK(covers(few, 6u));
+
+    // Zero parts and granularity are treated as one
+    CHECK(splitRange(5u, 0u).size() == 1u);
+    CHECK(covers(splitRange(5u, 2u, 0u), 5u));
+}
+
+static void testParallelForRunsEachIndexOnce()
+{
+    TaskPool pool(4u);
+    CHECK(pool.size() == 4u);
+    for (uint32_t count : { 0u, 1u, 3u, 1000u }) {
+        std::vector<std::atomic<uint32_t>> calls(count);
+        pool.parallelFor(count, [&](uint32_t i) { calls[i].fetch_add(1u); });
+        bool once = true;
+        for (const std::atomic<uint32_t>& c : calls) {
+            once = once && c.load() == 1u;
+        }
+        CHECK(once);
+    }
+
+    // Without workers, everything runs on the caller
+    TaskPool single(0u);
+    CHECK(single.size() == 1u);
+    uint32_t sum = 0u;
+    single.parallelFor(5u, [&](uint32_t i) { sum += i; });
+    CHECK(sum == 10u);
+}
+
+// A failing invocation doesn't stop the others, its exception reaches the caller, and the
+//  pool stays usable
+static void testParallelForRethrows()
+{
+    TaskPool pool(4u);
+    std::atomic<uint32_t> ran = 0u;
+    bool threw = false;
+    try {
+        pool.parallelFor(64u, [&](uint32_t i) {
+            ran.fetch_add(1u);
+            if (i % 16u == 5u) {
+                throw std::runtime_error("slice failed");
+            }
+        });
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+    CHECK(ran.load() == 64u);
+
+    std::atomic<uint32_t> after = 0u;
+    pool.parallelFor(64u, [&](uint32_t) { after.fetch_add(1u); });
+    CHECK(after.load() == 64u);
+}
+
+int main()
+{
+    testSplitRange();
+    testParallelForRunsEachIndexOnce();
+    testParallelForRethrows();
+    return checkResult();
+}
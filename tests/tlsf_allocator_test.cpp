@@ -0,0 +1,184 @@
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "check.h"
+
+import tlsf_allocator;
+
+constexpr uint64_t KB = 1024u;
+constexpr uint64_t MB = 1024u * KB;
+
+static void testAllocateAndFree()
+{
+    TlsfAllocator tlsf(1u * MB, 256u);
+    const TlsfAllocator::Handle a = tlsf.allocate(1000u);
+    const TlsfAllocator::Handle b = tlsf.allocate(256u);
+    CHECK(a != TlsfAllocator::invalidHandle && b != TlsfAllocator::invalidHandle);
+    // Sizes round up to the granularity
+    CHECK(tlsf.size(a) == 1024u);
+    CHECK(tlsf.offset(a) == 0u);
+    CHECK(tlsf.offset(b) == 1024u);
+    CHECK(tlsf.stats().usedBytes == 1280u);
+    CHECK(tlsf.stats().allocations == 2u);
+
+    tlsf.free(a);
+    tlsf.free(b);
+    CHECK(tlsf.empty());
+    const TlsfAllocator::Stats stats = tlsf.stats();
+    CHECK(stats.freeBlocks == 1u);
+    CHECK(stats.largestFreeBlock == 1u * MB);
+}
+
+static void testAlignment()
+{
+    TlsfAllocator tlsf(4u * MB, 4u * KB);
+    tlsf.allocate(4u * KB);
+    const TlsfAllocator::Handle aligned = tlsf.allocate(64u * KB, 64u * KB);
+    CHECK(aligned != TlsfAllocator::invalidHandle);
+    CHECK(tlsf.offset(aligned) % (64u * KB) == 0u);
+    // The padding in front of it stays free and gets used by smaller allocations
+    const TlsfAllocator::Handle small = tlsf.allocate(4u * KB);
+    CHECK(tlsf.offset(small) < tlsf.offset(aligned));
+}
+
+static void testExhaustion()
+{
+    TlsfAllocator tlsf(64u * KB, 4u * KB);
+    std::vector<TlsfAllocator::Handle> handles;
+    for (uint32_t i = 0u; i < 16u; i++) {
+        handles.push_back(tlsf.allocate(4u * KB));
+        CHECK(handles.back() != TlsfAllocator::invalidHandle);
+    }
+    CHECK(tlsf.allocate(4u * KB) == TlsfAllocator::invalidHandle);
+    CHECK(tlsf.stats().failures == 1u);
+
+    // Freeing two neighbors makes room for one allocation of both
+    tlsf.free(handles[4]);
+    tlsf.free(handles[5]);
+    const TlsfAllocator::Handle merged = tlsf.allocate(8u * KB);
+    CHECK(merged != TlsfAllocator::invalidHandle);
+    CHECK(tlsf.offset(merged) == 16u * KB);
+}
+
+// A fresh allocator of capacityFor() bytes has to fit the request, which a capacity of just the
+//  aligned size doesn't always, as the search pads for alignment and rounds up to a bin
+static void testCapacityForFits()
+{
+    const uint64_t granularities[] = { 256u, 4u * KB, 64u * KB };
+    const uint64_t alignments[] = { 1u, 4u * KB, 64u * KB, 4u * MB };
+    std::mt19937_64 rng(11u);
+    uint32_t failures = 0u;
+    for (const uint64_t granularity : granularities) {
+        for (const uint64_t alignment : alignments) {
+            for (uint32_t i = 0u; i < 500u; i++) {
+                const uint64_t size = 1u + rng() % (256u * MB);
+                const uint64_t capacity = TlsfAllocator::capacityFor(size, alignment, granularity);
+                TlsfAllocator tlsf(capacity, granularity);
+                const TlsfAllocator::Handle h = tlsf.allocate(size, alignment);
+                if (h == TlsfAllocator::invalidHandle || tlsf.size(h) < size) {
+                    failures++;
+                }
+            }
+        }
+    }
+    CHECK(failures == 0u);
+
+    // A 64MB heap of 4KB granularity can't hold a 64MB texture at 64KB placement
+    const uint64_t heapSized = TlsfAllocator::capacityFor(64u * MB, 64u * KB, 4u * KB);
+    CHECK(heapSized > 64u * MB);
+    CHECK(TlsfAllocator(64u * MB, 4u * KB).allocate(64u * MB, 64u * KB) ==
+          TlsfAllocator::invalidHandle);
+    CHECK(TlsfAllocator(heapSized, 4u * KB).allocate(64u * MB, 64u * KB) !=
+          TlsfAllocator::invalidHandle);
+    // Nor a 4MB aligned MSAA target a heap of its aligned size
+    const uint64_t msaa = TlsfAllocator::capacityFor(5u * MB, 4u * MB, 64u * KB);
+    CHECK(msaa > 8u * MB);
+    CHECK(TlsfAllocator(8u * MB, 64u * KB).allocate(5u * MB, 4u * MB) ==
+          TlsfAllocator::invalidHandle);
+    CHECK(TlsfAllocator(msaa, 64u * KB).allocate(5u * MB, 4u * MB) !=
+          TlsfAllocator::invalidHandle);
+}
+
+// Random allocations and frees must never overlap, and free everything back into one block
+static void testRandomNoOverlap()
+{
+    constexpr uint64_t granularity = 256u;
+    constexpr uint64_t capacity = 4u * MB;
+    TlsfAllocator tlsf(capacity, granularity);
+    std::vector<bool> used(capacity / granularity, false);
+    std::vector<TlsfAllocator::Handle> live;
+    std::mt19937 rng(3u);
+    bool overlap = false;
+    bool misaligned = false;
+
+    for (uint32_t step = 0u; step < 20000u; step++) {
+        if (live.empty() || rng() % 3u != 0u) {
+            const uint64_t size = 1u + rng() % (64u * KB);
+            const uint64_t alignment = uint64_t(1u) << (rng() % 17u);
+            const TlsfAllocator::Handle h = tlsf.allocate(size, alignment);
+            if (h == TlsfAllocator::invalidHandle) {
+                continue;
+            }
+            misaligned = misaligned || tlsf.offset(h) % alignment != 0u;
+            const uint64_t first = tlsf.offset(h) / granularity;
+            for (uint64_t i = first; i < first + tlsf.size(h) / granularity; i++) {
+                overlap = overlap || used[i];
+                used[i] = true;
+            }
+            live.push_back(h);
+        } else {
+            const size_t index = rng() % live.size();
+            const TlsfAllocator::Handle h = live[index];
+            live[index] = live.back();
+            live.pop_back();
+            const uint64_t first = tlsf.offset(h) / granularity;
+            for (uint64_t i = first; i < first + tlsf.size(h) / granularity; i++) {
+                used[i] = false;
+            }
+            tlsf.free(h);
+        }
+    }
+    CHECK(!overlap);
+    CHECK(!misaligned);
+
+    for (const TlsfAllocator::Handle h : live) {
+        tlsf.free(h);
+    }
+    CHECK(tlsf.empty());
+    CHECK(tlsf.stats().freeBlocks == 1u);
+    CHECK(tlsf.stats().largestFreeBlock == capacity);
+}
+
+static void testDefragment()
+{
+    TlsfAllocator tlsf(64u * KB, 4u * KB);
+    std::vector<TlsfAllocator::Handle> handles;
+    for (uint32_t i = 0u; i < 8u; i++) {
+        handles.push_back(tlsf.allocate(4u * KB));
+    }
+    for (uint32_t i = 0u; i < 6u; i++) {
+        tlsf.free(handles[i]);
+    }
+
+    // The last two blocks move into the hole at the front
+    const std::vector<TlsfAllocator::Move> moves = tlsf.beginDefragment(4u);
+    CHECK(moves.size() == 2u);
+    for (const TlsfAllocator::Move& m : moves) {
+        CHECK(tlsf.offset(m.dst) < tlsf.offset(m.src));
+        CHECK(tlsf.size(m.dst) == tlsf.size(m.src));
+        tlsf.free(m.src);
+    }
+    CHECK(tlsf.stats().allocations == 2u);
+    CHECK(tlsf.stats().largestFreeBlock == 56u * KB);
+}
+
+int main()
+{
+    testAllocateAndFree();
+    testAlignment();
+    testExhaustion();
+    testCapacityForFits();
+    testRandomNoOverlap();
+    testDefragment();
+    return checkResult();
+}
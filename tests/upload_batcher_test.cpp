@@ -0,0 +1,160 @@
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "check.h"
+
+import upload_batcher;
+
+using Resource = std::shared_ptr<int>;
+
+// Records what the batcher asks of a copy queue, fences are completed by hand
+class FakeQueue : public UploadQueue<Resource>
+{
+   public:
+    struct Copy
+    {
+        int destination;
+        int source;
+        size_t sourceOffset;
+        size_t size;
+    };
+
+    bool recording = false;
+    uint32_t batchesOpened = 0u;
+    std::vector<Copy> copies;
+    uint64_t signalled = 0u;
+    uint64_t completed = 0u;
+
+    void openBatch() override
+    {
+        CHECK(!this->recording);
+        this->recording = true;
+        this->batchesOpened++;
+    }
+
+    void copy(
+        const Resource& destination,
+        const Resource& source,
+        size_t sourceOffset,
+        size_t size
+    ) override
+    {
+        CHECK(this->recording);
+        this->copies.push_back({ *destination, *source, sourceOffset, size });
+    }
+
+    uint64_t submitBatch() override
+    {
+        CHECK(this->recording);
+        this->recording = false;
+        // Other work is submitted on the queue too, so batch fences aren't consecutive
+        this->signalled += 3u;
+        return this->signalled;
+    }
+
+    uint64_t completedValue() const override { return this->completed; }
+};
+
+using ReleaseQueue = DeferredReleaseQueue<Resource, const FakeQueue*>;
+
+static size_t drain(ReleaseQueue& releaseQueue)
+{
+    return releaseQueue.drain([](const FakeQueue* q) { return q->completedValue(); });
+}
+
+static void testEmptySubmit()
+{
+    FakeQueue queue;
+    ReleaseQueue releaseQueue;
+    UploadBatcher<Resource, const FakeQueue*> batcher(queue, releaseQueue, &queue);
+
+    CHECK(batcher.submit().fenceValue == 0u);
+    CHECK(queue.batchesOpened == 0u);
+    CHECK(batcher.stats().batches == 0u);
+}
+
+static void testCopiesShareOneBatch()
+{
+    FakeQueue queue;
+    ReleaseQueue releaseQueue;
+    UploadBatcher<Resource, const FakeQueue*> batcher(queue, releaseQueue, &queue);
+
+    const Resource dst0 = std::make_shared<int>(10);
+    const Resource dst1 = std::make_shared<int>(11);
+    std::weak_ptr<int> src0 = [&] {
+        Resource src = std::make_shared<int>(20);
+        batcher.copy(dst0, src, 0u, 64u);
+        return std::weak_ptr<int>(src);
+    }();
+    std::weak_ptr<int> src1 = [&] {
+        Resource src = std::make_shared<int>(21);
+        batcher.copy(dst1, src, 256u, 32u);
+        return std::weak_ptr<int>(src);
+    }();
+
+    CHECK(queue.batchesOpened == 1u);
+    CHECK(queue.copies.size() == 2u);
+    CHECK(queue.copies[0].destination == 10 && queue.copies[0].source == 20);
+    CHECK(queue.copies[1].destination == 11 && queue.copies[1].size == 32u);
+    CHECK(queue.copies[1].sourceOffset == 256u);
+
+    const UploadTicket ticket = batcher.submit();
+    CHECK(ticket.fenceValue == queue.signalled);
+    CHECK(!queue.recording);
+
+    // Sources are held by the release queue until the batch's fence is reached
+    CHECK(!src0.expired() && !src1.expired());
+    queue.completed = ticket.fenceValue - 1u;
+    CHECK(drain(releaseQueue) == 0u);
+    CHECK(!src0.expired());
+    queue.completed = ticket.fenceValue;
+    CHECK(drain(releaseQueue) == 2u);
+    CHECK(src0.expired() && src1.expired());
+
+    const auto stats = batcher.stats();
+    CHECK(stats.copies == 2u);
+    CHECK(stats.bytesUploaded == 96u);
+    CHECK(stats.batches == 1u);
+}
+
+static void testTicketsFollowSubmissionOrder()
+{
+    FakeQueue queue;
+    ReleaseQueue releaseQueue;
+    UploadBatcher<Resource, const FakeQueue*> batcher(queue, releaseQueue, &queue);
+    const Resource dst = std::make_shared<int>(0);
+
+    batcher.copy(dst, std::make_shared<int>(1), 0u, 16u);
+    const UploadTicket first = batcher.submit();
+    batcher.copy(dst, std::make_shared<int>(2), 0u, 16u);
+    const UploadTicket second = batcher.submit();
+    CHECK(second.fenceValue > first.fenceValue);
+    CHECK(queue.batchesOpened == 2u);
+
+    // Nothing new was queued, so the ticket still covers the last batch
+    CHECK(batcher.submit().fenceValue == second.fenceValue);
+    CHECK(batcher.stats().batches == 2u);
+
+    // Only the completed prefix retires
+    CHECK(batcher.batchesInFlight() == 2u);
+    batcher.retire();
+    CHECK(batcher.batchesInFlight() == 2u);
+    queue.completed = first.fenceValue;
+    batcher.retire();
+    CHECK(batcher.batchesInFlight() == 1u);
+    CHECK(drain(releaseQueue) == 1u);
+    queue.completed = second.fenceValue;
+    batcher.retire();
+    CHECK(batcher.batchesInFlight() == 0u);
+    CHECK(drain(releaseQueue) == 1u);
+    CHECK(batcher.stats().maxLatencyMs >= 0.0);
+}
+
+int main()
+{
+    testEmptySubmit();
+    testCopiesShareOneBatch();
+    testTicketsFollowSubmissionOrder();
+    return checkResult();
+}